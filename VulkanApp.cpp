@@ -2,7 +2,13 @@
 
 #include "VulkanApp.h"
 #include "random/random.h"
+#include "profiler/profiler.h"
+#include "metrics/spawn_latency.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
@@ -20,6 +26,62 @@
 
 void __key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    // dumps the profiler zones of the last frames on demand
+    if (key == ParticlesConstants::PROFILE_DUMP_KEY && action == GLFW_PRESS)
+    {
+        const char* path = (ParticlesApp::config().trace_path != nullptr) ? ParticlesApp::config().trace_path : ParticlesConstants::DEFAULT_TRACE_PATH;
+        try
+        {
+            profiler::dump_chrome_trace(path);
+            std::cout << "Profile written to \"" << path << "\"." << std::endl;
+        }
+        catch (std::exception& e)
+        {
+            std::cout << e.what() << std::endl;
+        }
+    }
+
+    // the checkpoint is handled by the application thread, which owns the pool and the engines
+    if (key == ParticlesConstants::CHECKPOINT_SAVE_KEY && action == GLFW_PRESS)
+        ParticlesApp::request_checkpoint(ParticlesApp::CHECKPOINT_SAVE);
+    if (key == ParticlesConstants::CHECKPOINT_RESTORE_KEY && action == GLFW_PRESS)
+        ParticlesApp::request_checkpoint(ParticlesApp::CHECKPOINT_RESTORE);
+}
+
+// writes mean, median, 99th percentile and maximum of @param values (e.g. milliseconds) as a JSON object
+static void write_statistics_json(std::ostream& os, std::vector<double> values)
+{
+    if (values.empty())
+    {
+        os << "null";
+        return;
+    }
+
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+    const auto percentile = [&values](double p) { return values[static_cast<size_t>(p * (values.size() - 1) + 0.5)]; };
+
+    os << "{ \"mean\": " << sum / values.size()
+       << ", \"p50\": " << percentile(0.5)
+       << ", \"p99\": " << percentile(0.99)
+       << ", \"max\": " << values.back() << " }";
+}
+
+// writes the sample count, median, 99th percentile and maximum of a stage of the spawn latency tracer as a JSON object
+static void write_latency_json(std::ostream& os, metrics::SpawnLatencyTracer::stage_t stage)
+{
+    const metrics::SpawnLatencyTracer::statistics_t statistics = metrics::spawn_latency().statistics(stage);
+    if (statistics.count == 0)
+    {
+        os << "null";
+        return;
+    }
+    os << "{ \"samples\": " << statistics.count
+       << ", \"p50\": " << statistics.p50_ms
+       << ", \"p99\": " << statistics.p99_ms
+       << ", \"max\": " << statistics.max_ms << " }";
 }
 
 ParticlesApp::ParticlesApp(void)
@@ -36,6 +98,7 @@ ParticlesApp::~ParticlesApp(void)
 
 void ParticlesApp::load_models(void)
 {
+    PROFILE_ZONE("ParticlesApp::load_models");
     this->load_floor();
     this->load_fountain();
 }
@@ -75,6 +138,7 @@ void ParticlesApp::load_fountain(void)
 
 void ParticlesApp::init_lights(void)
 {
+    PROFILE_ZONE("ParticlesApp::init_lights");
     this->directional_light.direction = glm::normalize(glm::vec3( -2.0f, -1.0f, 1.5f ));
     this->directional_light.intensity = glm::vec3(30.0f);
 }
@@ -83,6 +147,7 @@ void ParticlesApp::init_lights(void)
 
 void ParticlesApp::init_glfw(void)
 {
+    PROFILE_ZONE("ParticlesApp::init_glfw");
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -116,15 +181,20 @@ void ParticlesApp::destry_glfw(void)
 
 void ParticlesApp::init_vulkan(void)
 {
+    PROFILE_ZONE("ParticlesApp::init_vulkan");
     this->create_app_info();
     this->create_instance();
-    this->create_surface();
+    if (!this->headless)
+        this->create_surface();
 
     this->create_physical_device();
     this->create_queues();
     this->create_device();
 
-    this->onscreen_renderpass.init(this->physical_device, this->device, this->surface, this->graphics_queue_family_index, this->width, this->height);
+    if (this->headless)
+        this->offscreen_renderpass.init(this->physical_device, this->device, this->graphics_queue_family_index, this->width, this->height);
+    else
+        this->onscreen_renderpass.init(this->physical_device, this->device, this->surface, this->graphics_queue_family_index, this->width, this->height);
     this->directional_shadow_map.init(this->physical_device, this->device, this->graphics_queue_family_index, ParticlesConstants::SHADOW_MAP_RESOLUTION);
 
     this->create_command_pool();
@@ -142,6 +212,8 @@ void ParticlesApp::init_vulkan(void)
     this->create_shadow_pipelines();
 
     this->create_semaphores();
+    this->create_query_pools();
+    this->create_readback_buffers();
 
     this->init_particles();
     
@@ -185,10 +257,13 @@ void ParticlesApp::reshape(void)
         renderer_ri.viewport.maxDepth = 1.0f;
         renderer_ri.scissor.offset = { 0, 0 };
         renderer_ri.scissor.extent = { static_cast<uint32_t>(this->width), static_cast<uint32_t>(this->height) };
+        renderer_ri.pipeline_statistics = this->pipeline_statistics ? PIPELINE_STATISTICS : 0;
 
-        this->record_static_scene();
+        for (uint32_t i = 0; i < this->frames_in_flight; i++)
+            this->record_static_scene(i);
         this->particle_renderer.record(renderer_ri);
-        this->record_primary_commands();
+        for (uint32_t i = 0; i < this->frames_in_flight; i++)
+            this->record_primary_commands(i);
     }
 }
 
@@ -201,20 +276,24 @@ void ParticlesApp::create_app_info(void)
     this->app_info.applicationVersion = VK_MAKE_VERSION(0, 0, 0);
     this->app_info.pEngineName = "";
     this->app_info.engineVersion = 0;
-    this->app_info.apiVersion = 0;
+    this->app_info.apiVersion = VK_API_VERSION_1_2;    // timeline semaphores
 }
 
 void ParticlesApp::create_instance(void)
 {
+    PROFILE_ZONE("ParticlesApp::create_instance");
+    // the monitor layer shows the frame rate in the window title, the headless mode has no window
     std::vector<const char*> layers;
-    layers.push_back("VK_LAYER_LUNARG_monitor");
+    if (!this->headless)
+        layers.push_back("VK_LAYER_LUNARG_monitor");
 #if VALIDATION_LAYERS
     layers.push_back("VK_LAYER_LUNARG_standard_validation");
     layers.push_back("VK_LAYER_KHRONOS_validation");
 #endif
 
     std::vector<const char*> extensions;
-    vka::get_requiered_glfw_extensions(extensions);
+    if (!this->headless)
+        vka::get_requiered_glfw_extensions(extensions);
 #if VALIDATION_LAYERS
     extensions.push_back("VK_EXT_debug_utils");
 #endif
@@ -280,7 +359,7 @@ void ParticlesApp::create_physical_device(void)
                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT };
     filter.reqDeviceTypeHirachy = { VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU };
-    filter.pSurface = &this->surface;
+    filter.pSurface = this->headless ? nullptr : &this->surface;    // no surface requierements in headless mode
     filter.reqMinImageCount = ParticlesConstants::SWAPCHAIN_IMAGES;
     filter.reqMaxImageCount = ParticlesConstants::SWAPCHAIN_IMAGES;
     filter.reqSurfaceImageUsageFlags = ParticlesConstants::SWAPCHAIN_IMAGE_USAGE;
@@ -328,6 +407,7 @@ void ParticlesApp::create_queues(void)
 
 void ParticlesApp::create_device(void)
 {
+    PROFILE_ZONE("ParticlesApp::create_device");
     float priority = 1.0f;
 
     VkDeviceQueueCreateInfo queue_create_info = {};
@@ -339,7 +419,8 @@ void ParticlesApp::create_device(void)
     queue_create_info.pQueuePriorities = &priority;
 
     std::vector<const char*> extensions;
-    extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!this->headless)
+        extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
     if (!vka::are_device_extensions_supported(this->physical_device, extensions))
     {
@@ -354,9 +435,43 @@ void ParticlesApp::create_device(void)
     features.samplerAnisotropy = VK_TRUE;
     features.depthBiasClamp = VK_TRUE;
 
+    // the pipeline statistics query is active while the secondary command buffers are executed
+    this->pipeline_statistics = false;
+    if (_config.pipeline_statistics)
+    {
+        VkPhysicalDeviceFeatures supported;
+        vkGetPhysicalDeviceFeatures(this->physical_device, &supported);
+        this->pipeline_statistics = supported.pipelineStatisticsQuery && supported.inheritedQueries;
+        if (!this->pipeline_statistics)
+            std::cout << "Pipeline statistics are not supported by the device, they are disabled." << std::endl;
+        features.pipelineStatisticsQuery = this->pipeline_statistics;
+        features.inheritedQueries = this->pipeline_statistics;
+    }
+
+    // the particle renderer counts the frames that read its buffer with a timeline semaphore (core in Vulkan 1.2)
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(this->physical_device, &device_properties);
+    if (device_properties.apiVersion < VK_API_VERSION_1_2)
+        throw std::runtime_error("The device does not support Vulkan 1.2, which is requiered for timeline semaphores.");
+
+    VkPhysicalDeviceVulkan12Features supported_features12 = {};
+    supported_features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supported_features12.pNext = nullptr;
+    VkPhysicalDeviceFeatures2 supported_features2 = {};
+    supported_features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported_features2.pNext = &supported_features12;
+    vkGetPhysicalDeviceFeatures2(this->physical_device, &supported_features2);
+    if (!supported_features12.timelineSemaphore)
+        throw std::runtime_error("Timeline semaphores are not supported by the device.");
+
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = nullptr;
+    features12.timelineSemaphore = VK_TRUE;
+
     VkDeviceCreateInfo device_create_info = {};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    device_create_info.pNext = nullptr;
+    device_create_info.pNext = &features12;
     device_create_info.flags = 0;
     device_create_info.queueCreateInfoCount = 1;
     device_create_info.pQueueCreateInfos = &queue_create_info;
@@ -369,12 +484,15 @@ void ParticlesApp::create_device(void)
     VkResult result = vkCreateDevice(this->physical_device, &device_create_info, nullptr, &this->device);
     VULKAN_ASSERT(result);
 
-    VkBool32 support = false;
-    result = vkGetPhysicalDeviceSurfaceSupportKHR(this->physical_device, this->graphics_queue_family_index, this->surface, &support);
-    VULKAN_ASSERT(result);
+    if (!this->headless)
+    {
+        VkBool32 support = false;
+        result = vkGetPhysicalDeviceSurfaceSupportKHR(this->physical_device, this->graphics_queue_family_index, this->surface, &support);
+        VULKAN_ASSERT(result);
 
-    if (!support)
-        throw std::runtime_error("Surface not supported!");
+        if (!support)
+            throw std::runtime_error("Surface not supported!");
+    }
 
     vkGetDeviceQueue(this->device, this->graphics_queue_family_index, 0, &this->graphics_queue);
 }
@@ -382,32 +500,35 @@ void ParticlesApp::create_device(void)
 
 void ParticlesApp::init_main_descriptor_manager(void)
 {
+    PROFILE_ZONE("ParticlesApp::init_main_descriptor_manager");
     this->main_descr_manager.set_device(this->device);
     this->main_descr_manager.set_number_of_sets(1);
 
-    this->main_descr_manager.add_binding(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,           1, VK_SHADER_STAGE_VERTEX_BIT);
-    this->main_descr_manager.add_binding(0, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,           1, VK_SHADER_STAGE_FRAGMENT_BIT);
+    // the uniforms that are written every frame are dynamic, their offsets select the slot of the frame
+    this->main_descr_manager.add_binding(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,   1, VK_SHADER_STAGE_VERTEX_BIT);
+    this->main_descr_manager.add_binding(0, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,   1, VK_SHADER_STAGE_FRAGMENT_BIT);
     this->main_descr_manager.add_binding(0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,   2, VK_SHADER_STAGE_FRAGMENT_BIT);
     this->main_descr_manager.add_binding(0, 3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,           1, VK_SHADER_STAGE_FRAGMENT_BIT);
-    this->main_descr_manager.add_binding(0, 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,           1, VK_SHADER_STAGE_FRAGMENT_BIT);
+    this->main_descr_manager.add_binding(0, 4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,   1, VK_SHADER_STAGE_FRAGMENT_BIT);
     this->main_descr_manager.add_binding(0, 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,   1, VK_SHADER_STAGE_FRAGMENT_BIT);
 
     VULKAN_ASSERT(this->main_descr_manager.init());
 
+    // the infos are read by DescriptorManager::update
     VkDescriptorBufferInfo buffer_info[4];
-    buffer_info[0].buffer = this->tm_buffer.handle();
+    buffer_info[0].buffer = this->uniform_ring.handle();
     buffer_info[0].offset = 0;
     buffer_info[0].range = sizeof(TransformMatrices);
 
-    buffer_info[1].buffer = this->directional_light_buffer.handle();
+    buffer_info[1].buffer = this->uniform_ring.handle();
     buffer_info[1].offset = 0;
     buffer_info[1].range = ParticlesConstants::N_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight);
 
-    buffer_info[2].buffer = this->material_buffer.handle();
+    buffer_info[2].buffer = this->uniform_ring.handle();
     buffer_info[2].offset = 0;
-    buffer_info[2].range = ParticlesConstants::N_MATERIALS * sizeof(Material);
+    buffer_info[2].range = ParticlesConstants::N_MATERIALS * shader_sizeof(Material);
 
-    buffer_info[3].buffer = this->fragment_variables_buffer.handle();
+    buffer_info[3].buffer = this->uniform_ring.handle();
     buffer_info[3].offset = 0;
     buffer_info[3].range = sizeof(FragmentVariables);
 
@@ -443,14 +564,15 @@ void ParticlesApp::init_main_descriptor_manager(void)
 
 void ParticlesApp::init_dir_shadow_descriptor_manager(void)
 {
+    PROFILE_ZONE("ParticlesApp::init_dir_shadow_descriptor_manager");
     this->dir_shadow_descr_manager.set_device(this->device);
     this->dir_shadow_descr_manager.set_number_of_sets(1);
 
-    this->dir_shadow_descr_manager.add_binding(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT);
+    this->dir_shadow_descr_manager.add_binding(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT);
     VULKAN_ASSERT(this->dir_shadow_descr_manager.init());
 
     VkDescriptorBufferInfo descriptor_buffer_info = {};
-    descriptor_buffer_info.buffer = this->tm_buffer_dir_shadow.handle();
+    descriptor_buffer_info.buffer = this->uniform_ring.handle();
     descriptor_buffer_info.offset = 0;
     descriptor_buffer_info.range = sizeof(ShadowTransformMatrices);
 
@@ -459,7 +581,7 @@ void ParticlesApp::init_dir_shadow_descriptor_manager(void)
 }
 
 
-void ParticlesApp::get_vertex323_descriptions(std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes)
+void ParticlesApp::get_vertex323_descriptions(std::pmr::vector<VkVertexInputBindingDescription>& bindings, std::pmr::vector<VkVertexInputAttributeDescription>& attributes)
 {
     bindings.resize(1, {});
     attributes.resize(3, {});
@@ -489,6 +611,7 @@ void ParticlesApp::get_vertex323_descriptions(std::vector<VkVertexInputBindingDe
 
 void ParticlesApp::create_pipeline(void)
 {
+    PROFILE_ZONE("ParticlesApp::create_pipeline");
     vka::Shader vertex(this->device), fragment(this->device);
     vertex.load(ParticlesConstants::SHADER_STATIC_SCENE_VERTEX_PATH, VK_SHADER_STAGE_VERTEX_BIT);
     fragment.load(ParticlesConstants::SHADER_STATIC_SCENE_FRAGMENT_PATH, VK_SHADER_STAGE_FRAGMENT_BIT);
@@ -497,8 +620,8 @@ void ParticlesApp::create_pipeline(void)
     shader.attach(vertex);
     shader.attach(fragment);
     
-    std::vector<VkVertexInputBindingDescription> bindings;
-    std::vector<VkVertexInputAttributeDescription> attributes;
+    std::pmr::vector<VkVertexInputBindingDescription> bindings(&particles::FrameArena::local());
+    std::pmr::vector<VkVertexInputAttributeDescription> attributes(&particles::FrameArena::local());
     ParticlesApp::get_vertex323_descriptions(bindings, attributes);
 
     VkPipelineVertexInputStateCreateInfo vertex_input_create_info = {};
@@ -612,14 +735,19 @@ void ParticlesApp::create_pipeline(void)
     dynamic_state_create_info.dynamicStateCount = 2;
     dynamic_state_create_info.pDynamicStates = dynamic_states;
 
+    VkPushConstantRange push_constant_range = {};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(DrawConstants);
+
     VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
     pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipeline_layout_create_info.pNext = nullptr;
     pipeline_layout_create_info.flags = 0;
-    pipeline_layout_create_info.setLayoutCount = this->main_descr_manager.get_layouts().size();
+    pipeline_layout_create_info.setLayoutCount = 1;
     pipeline_layout_create_info.pSetLayouts = this->main_descr_manager.get_layouts().data();
-    pipeline_layout_create_info.pushConstantRangeCount = 0;
-    pipeline_layout_create_info.pPushConstantRanges = nullptr;
+    pipeline_layout_create_info.pushConstantRangeCount = 1;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
 
     VULKAN_ASSERT(vkCreatePipelineLayout(this->device, &pipeline_layout_create_info, nullptr, &this->pipeline_layout));
 
@@ -649,13 +777,14 @@ void ParticlesApp::create_pipeline(void)
 
 void ParticlesApp::create_shadow_pipelines(void)
 {
+    PROFILE_ZONE("ParticlesApp::create_shadow_pipelines");
     vka::Shader dir_shadow_vert(this->device);
     dir_shadow_vert.load(ParticlesConstants::DIRECTIONAL_SHADOW_VERTEX_PATH, VK_SHADER_STAGE_VERTEX_BIT);
     vka::ShaderProgram dir_shadow_program;
     dir_shadow_program.attach(dir_shadow_vert);
 
-    std::vector<VkVertexInputBindingDescription> bindings;
-    std::vector<VkVertexInputAttributeDescription> attributes;
+    std::pmr::vector<VkVertexInputBindingDescription> bindings(&particles::FrameArena::local());
+    std::pmr::vector<VkVertexInputAttributeDescription> attributes(&particles::FrameArena::local());
     ParticlesApp::get_vertex323_descriptions(bindings, attributes);
 
     VkPipelineVertexInputStateCreateInfo dir_shadow_vert_inp_state = {};
@@ -752,7 +881,7 @@ void ParticlesApp::create_shadow_pipelines(void)
     dir_shadow_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     dir_shadow_layout.pNext = nullptr;
     dir_shadow_layout.flags = 0;
-    dir_shadow_layout.setLayoutCount = this->dir_shadow_descr_manager.get_layouts().size();
+    dir_shadow_layout.setLayoutCount = 1;
     dir_shadow_layout.pSetLayouts = this->dir_shadow_descr_manager.get_layouts().data();
     dir_shadow_layout.pushConstantRangeCount = 0;
     dir_shadow_layout.pPushConstantRanges = nullptr;
@@ -797,15 +926,15 @@ void ParticlesApp::create_command_pool(void)
 
 void ParticlesApp::create_command_buffers(void)
 {
-    this->primary_command_buffers.resize(ParticlesConstants::SWAPCHAIN_IMAGES);
+    // every frame in flight has one primary command buffer per framebuffer
+    const uint32_t n_primary = this->headless ? 1 : ParticlesConstants::SWAPCHAIN_IMAGES;
 
     VkCommandBufferAllocateInfo command_buffer_alloc_info = {};
     command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     command_buffer_alloc_info.pNext = nullptr;
     command_buffer_alloc_info.commandPool = this->command_pool;
     command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    command_buffer_alloc_info.commandBufferCount = this->primary_command_buffers.size();
-    VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &command_buffer_alloc_info, this->primary_command_buffers.data()));
+    command_buffer_alloc_info.commandBufferCount = n_primary;
 
     VkCommandBufferAllocateInfo static_scene_cbo_alloc_info = {};
     static_scene_cbo_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -813,8 +942,15 @@ void ParticlesApp::create_command_buffers(void)
     static_scene_cbo_alloc_info.commandPool = this->command_pool;
     static_scene_cbo_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
     static_scene_cbo_alloc_info.commandBufferCount = 1;
-    VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &static_scene_cbo_alloc_info, &this->static_scene_command_buffer));
-    VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &static_scene_cbo_alloc_info, &this->dir_shadow_command_buffer));
+
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        FrameResources& frame = this->frame_resources[i];
+        frame.primary_command_buffers.resize(n_primary);
+        VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &command_buffer_alloc_info, frame.primary_command_buffers.data()));
+        VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &static_scene_cbo_alloc_info, &frame.static_scene_command_buffer));
+        VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &static_scene_cbo_alloc_info, &frame.dir_shadow_command_buffer));
+    }
 }
 
 
@@ -914,80 +1050,47 @@ void ParticlesApp::create_index_buffers(void)
 
 void ParticlesApp::create_uniform_buffers(void)
 {
-    // main pipelines's vertex shader's transformation matrices
-    this->tm_buffer.set_physical_device(this->physical_device);
-    this->tm_buffer.set_device(this->device);
-    this->tm_buffer.set_create_flags(0);
-    this->tm_buffer.set_create_queue_families(&this->graphics_queue_family_index, 1);
-    this->tm_buffer.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
-    this->tm_buffer.set_create_size(sizeof(TransformMatrices));
-    this->tm_buffer.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    this->tm_buffer.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-    this->tm_buffer.create();
-
-    void* map = this->tm_buffer.map(sizeof(TransformMatrices), 0);
-    memset(map, 0, sizeof(TransformMatrices));
-    this->tm_buffer.unmap();
-
-    // buffer for direcional lights (main pipeline)
-    this->directional_light_buffer.set_physical_device(this->physical_device);
-    this->directional_light_buffer.set_device(this->device);
-    this->directional_light_buffer.set_create_flags(0);
-    this->directional_light_buffer.set_create_queue_families(&this->graphics_queue_family_index, 1);
-    this->directional_light_buffer.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
-    this->directional_light_buffer.set_create_size(ParticlesConstants::N_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight));
-    this->directional_light_buffer.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    this->directional_light_buffer.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-    this->directional_light_buffer.create();
-
-    map = this->directional_light_buffer.map(ParticlesConstants::N_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight), 0);
-    memset(map, 0, ParticlesConstants::N_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight));
-    this->directional_light_buffer.unmap();
-
-    // buffer for materials (main pipeline)
-    this->material_buffer.set_physical_device(this->physical_device);
-    this->material_buffer.set_device(this->device);
-    this->material_buffer.set_create_flags(0);
-    this->material_buffer.set_create_queue_families(&this->graphics_queue_family_index, 1);
-    this->material_buffer.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
-    this->material_buffer.set_create_size(ParticlesConstants::N_MATERIALS * sizeof(Material));
-    this->material_buffer.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    this->material_buffer.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-    this->material_buffer.create();
-
-    map = this->material_buffer.map(ParticlesConstants::N_MATERIALS * sizeof(Material), 0);
-    memset(map, 0, ParticlesConstants::N_MATERIALS * sizeof(Material));
-    this->material_buffer.unmap();
-
-    // buffer for additional values for the fragment shader (main pipeline)
-    this->fragment_variables_buffer.set_physical_device(this->physical_device);
-    this->fragment_variables_buffer.set_device(this->device);
-    this->fragment_variables_buffer.set_create_flags(0);
-    this->fragment_variables_buffer.set_create_queue_families(&this->graphics_queue_family_index, 1);
-    this->fragment_variables_buffer.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
-    this->fragment_variables_buffer.set_create_size(sizeof(FragmentVariables));
-    this->fragment_variables_buffer.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    this->fragment_variables_buffer.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-    this->fragment_variables_buffer.create();
-
-    map = this->fragment_variables_buffer.map(sizeof(FragmentVariables), 0);
-    memset(map, 0, sizeof(FragmentVariables));
-    this->fragment_variables_buffer.unmap();
-
-    // transformation matrices for the directional shadow map pipeline
-    this->tm_buffer_dir_shadow.set_physical_device(this->physical_device);
-    this->tm_buffer_dir_shadow.set_device(this->device);
-    this->tm_buffer_dir_shadow.set_create_flags(0);
-    this->tm_buffer_dir_shadow.set_create_queue_families(&this->graphics_queue_family_index, 1);
-    this->tm_buffer_dir_shadow.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
-    this->tm_buffer_dir_shadow.set_create_size(sizeof(ShadowTransformMatrices));
-    this->tm_buffer_dir_shadow.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    this->tm_buffer_dir_shadow.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
-    this->tm_buffer_dir_shadow.create();
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(this->physical_device, &properties);
+    const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+    // every entry of a slot is bound at its own dynamic offset, so every entry must be aligned
+    const VkDeviceSize entry_sizes[UNIFORM_SLOT_ENTRIES] = {
+        sizeof(TransformMatrices),
+        ParticlesConstants::N_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight),
+        sizeof(FragmentVariables),
+        sizeof(ShadowTransformMatrices)
+    };
+    this->uniform_slot_stride = 0;
+    for (uint32_t i = 0; i < UNIFORM_SLOT_ENTRIES; i++)
+    {
+        this->uniform_entry_offsets[i] = this->uniform_slot_stride;
+        this->uniform_slot_stride += (entry_sizes[i] + alignment - 1) / alignment * alignment;
+    }
+
+    // the materials are at the beginning of the ring, followed by the slots of the frames in flight
+    const VkDeviceSize materials_size = ParticlesConstants::N_MATERIALS * shader_sizeof(Material);
+    this->uniform_slot_base = (materials_size + alignment - 1) / alignment * alignment;
+    const VkDeviceSize ring_size = this->uniform_slot_base + this->frames_in_flight * this->uniform_slot_stride;
+
+    this->uniform_ring.set_physical_device(this->physical_device);
+    this->uniform_ring.set_device(this->device);
+    this->uniform_ring.set_create_flags(0);
+    this->uniform_ring.set_create_queue_families(&this->graphics_queue_family_index, 1);
+    this->uniform_ring.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
+    this->uniform_ring.set_create_size(ring_size);
+    this->uniform_ring.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    this->uniform_ring.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    this->uniform_ring.create();
+
+    // leave the ring mapped, it gets unmapped in ParticlesApp::destroy_vulkan
+    this->uniform_map = (uint8_t*)this->uniform_ring.map(ring_size, 0);
+    memset(this->uniform_map, 0, ring_size);
 }
 
 void ParticlesApp::create_textures(void)
 {
+    PROFILE_ZONE("ParticlesApp::create_textures");
     using namespace __internal_random;
 
     // floor texture
@@ -1092,20 +1195,97 @@ void ParticlesApp::create_semaphores(void)
     sem_create_info.pNext = nullptr;
     sem_create_info.flags = 0;
     
-    VULKAN_ASSERT(vkCreateSemaphore(this->device, &sem_create_info, nullptr, &this->image_ready));
-    VULKAN_ASSERT(vkCreateSemaphore(this->device, &sem_create_info, nullptr, &this->rendering_done));
-
+    // the fences are created signaled, so that waiting for a frame that has never been submitted returns immediately
     VkFenceCreateInfo fence_info = {};
     fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fence_info.pNext = nullptr;
-    fence_info.flags = 0;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        VULKAN_ASSERT(vkCreateSemaphore(this->device, &sem_create_info, nullptr, &this->frame_resources[i].image_ready));
+        VULKAN_ASSERT(vkCreateSemaphore(this->device, &sem_create_info, nullptr, &this->frame_resources[i].rendering_done));
+        VULKAN_ASSERT(vkCreateFence(this->device, &fence_info, nullptr, &this->frame_resources[i].fence));
+    }
+}
+
+void ParticlesApp::create_query_pools(void)
+{
+    this->timestamp_pool = VK_NULL_HANDLE;
+    this->statistics_pool = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        this->frame_resources[i].queries_used = false;
+        this->frame_resources[i].latency_token = 0;
+    }
+    this->gpu_statistics_valid = false;
+    this->gpu_statistics_time = 0.0;
+
+    // GPU times are only reported if the queue supports timestamps
+    std::vector<VkQueueFamilyProperties> queue_properties;
+    vka::get_queue_family_properties(this->physical_device, queue_properties);
+    const uint32_t valid_bits = queue_properties[this->graphics_queue_family_index].timestampValidBits;
+    if (valid_bits == 0)
+        return;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(this->physical_device, &properties);
+    this->timestamp_period = properties.limits.timestampPeriod;
+    this->timestamp_mask = (valid_bits >= 64) ? ~uint64_t(0) : ((uint64_t(1) << valid_bits) - 1);
+
+    VkQueryPoolCreateInfo query_pool_create_info = {};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.pNext = nullptr;
+    query_pool_create_info.flags = 0;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = N_TIMESTAMPS * this->frames_in_flight;
+    query_pool_create_info.pipelineStatistics = 0;
+
+    VULKAN_ASSERT(vkCreateQueryPool(this->device, &query_pool_create_info, nullptr, &this->timestamp_pool));
+
+    if (this->pipeline_statistics)
+    {
+        query_pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        query_pool_create_info.queryCount = this->frames_in_flight;
+        query_pool_create_info.pipelineStatistics = PIPELINE_STATISTICS;
+
+        VULKAN_ASSERT(vkCreateQueryPool(this->device, &query_pool_create_info, nullptr, &this->statistics_pool));
+    }
+}
+
+void ParticlesApp::create_readback_buffers(void)
+{
+    if (!this->exporting) return;
+
+    // the buffers stay mapped, the exporter reads the frames directly from them
+    const VkDeviceSize size = static_cast<VkDeviceSize>(this->width) * this->height * 4;
+    for (uint32_t i = 0; i < ParticlesConstants::READBACK_SLOTS; i++)
+    {
+        this->readback_buffers[i].set_physical_device(this->physical_device);
+        this->readback_buffers[i].set_device(this->device);
+        this->readback_buffers[i].set_create_flags(0);
+        this->readback_buffers[i].set_create_queue_families(&this->graphics_queue_family_index, 1);
+        this->readback_buffers[i].set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
+        this->readback_buffers[i].set_create_size(size);
+        this->readback_buffers[i].set_create_usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+        this->readback_buffers[i].set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        VULKAN_ASSERT(this->readback_buffers[i].create());
+        this->readback_maps[i] = static_cast<const uint8_t*>(this->readback_buffers[i].map(size, 0));
+    }
 
-    VULKAN_ASSERT(vkCreateFence(this->device, &fence_info, nullptr, &this->render_fence));
+    VkCommandBufferAllocateInfo command_buffer_alloc_info = {};
+    command_buffer_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_alloc_info.pNext = nullptr;
+    command_buffer_alloc_info.commandPool = this->command_pool;
+    command_buffer_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_alloc_info.commandBufferCount = ParticlesConstants::READBACK_SLOTS;
+    VULKAN_ASSERT(vkAllocateCommandBuffers(this->device, &command_buffer_alloc_info, this->readback_command_buffers));
 }
 
 
 void ParticlesApp::init_particles(void)
 {
+    PROFILE_ZONE("ParticlesApp::init_particles");
     particles::ParticleRendererInitInfo renderer_ii = {};
     renderer_ii.vertex_shader_path = ParticlesConstants::PARTICLE_VERTEX_PATH;
     renderer_ii.geometry_shader_path = ParticlesConstants::PARTICLE_GEOMETRY_PATH;
@@ -1113,21 +1293,23 @@ void ParticlesApp::init_particles(void)
     renderer_ii.particle_texture_path = ParticlesConstants::TEXTURE_PARTICLE;
     renderer_ii.physical_device = this->physical_device;
     renderer_ii.device = this->device;
-    renderer_ii.render_pass = this->onscreen_renderpass.render_pass;
+    renderer_ii.render_pass = this->main_render_pass();
     renderer_ii.sub_pass = 0;
     renderer_ii.external_command_pool = true;
     renderer_ii.command_pool = this->command_pool;
     renderer_ii.queue_family_index = this->graphics_queue_family_index;
     renderer_ii.queue = this->graphics_queue;
     renderer_ii.buffer_capacity = 1000000;
+    renderer_ii.frames_in_flight = this->frames_in_flight;
 
     VULKAN_ASSERT(this->particle_renderer.init(renderer_ii));
 }
 
 void ParticlesApp::record_commands(void)
 {
+    PROFILE_ZONE("ParticlesApp::record_commands");
     particles::ParticleRendererRecordInfo renderer_ri = {};
-    renderer_ri.render_pass = this->onscreen_renderpass.render_pass;
+    renderer_ri.render_pass = this->main_render_pass();
     renderer_ri.sub_pass = 0;
     renderer_ri.framebuffer = VK_NULL_HANDLE;   // it is not clear in which framebuffer the commands get executed, there are actually 3 different framebuffers
     renderer_ri.viewport.width = static_cast<uint32_t>(this->width);
@@ -1138,24 +1320,43 @@ void ParticlesApp::record_commands(void)
     renderer_ri.viewport.maxDepth = 1.0f;
     renderer_ri.scissor.offset = { 0, 0 };
     renderer_ri.scissor.extent = { static_cast<uint32_t>(this->width), static_cast<uint32_t>(this->height) };
+    renderer_ri.pipeline_statistics = this->pipeline_statistics ? PIPELINE_STATISTICS : 0;
 
-    this->record_dir_shadow_map();
-    this->record_static_scene();
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        this->record_dir_shadow_map(i);
+        this->record_static_scene(i);
+    }
     this->particle_renderer.record(renderer_ri);
-    this->record_primary_commands();
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+        this->record_primary_commands(i);
+    this->record_readback_commands();
 }
 
-void ParticlesApp::record_primary_commands(void)
+void ParticlesApp::record_primary_commands(uint32_t frame)
 {
+    const FrameResources& resources = this->frame_resources[frame];
+    const std::vector<VkCommandBuffer>& command_buffers = resources.primary_command_buffers;
+
     VkCommandBufferBeginInfo command_begin_info = {};
     command_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     command_begin_info.pNext = nullptr;
     command_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
     command_begin_info.pInheritanceInfo = nullptr;
 
-    for (size_t i = 0; i < this->onscreen_renderpass.views.size(); i++)
+    for (size_t i = 0; i < command_buffers.size(); i++)
     {
-        VULKAN_ASSERT(vkBeginCommandBuffer(this->primary_command_buffers[i], &command_begin_info));
+        VULKAN_ASSERT(vkBeginCommandBuffer(command_buffers[i], &command_begin_info));
+
+        // every frame in flight has its own query region
+        const uint32_t first_timestamp = frame * N_TIMESTAMPS;
+        if (this->timestamp_pool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(command_buffers[i], this->timestamp_pool, first_timestamp, N_TIMESTAMPS);
+            vkCmdWriteTimestamp(command_buffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, this->timestamp_pool, first_timestamp);
+        }
+        if (this->statistics_pool != VK_NULL_HANDLE)
+            vkCmdResetQueryPool(command_buffers[i], this->statistics_pool, frame, 1);
 
         // draw directional shadow map
         VkRect2D dir_shadow_render_area = {};
@@ -1174,9 +1375,12 @@ void ParticlesApp::record_primary_commands(void)
         dir_shadow_render_pass_begin_info.clearValueCount = 1;
         dir_shadow_render_pass_begin_info.pClearValues = &dir_shadow_clear_value;
 
-        vkCmdBeginRenderPass(this->primary_command_buffers[i], &dir_shadow_render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-        vkCmdExecuteCommands(this->primary_command_buffers[i], 1, &this->dir_shadow_command_buffer);
-        vkCmdEndRenderPass(this->primary_command_buffers[i]);
+        vkCmdBeginRenderPass(command_buffers[i], &dir_shadow_render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(command_buffers[i], 1, &resources.dir_shadow_command_buffer);
+        vkCmdEndRenderPass(command_buffers[i]);
+
+        if (this->timestamp_pool != VK_NULL_HANDLE)
+            vkCmdWriteTimestamp(command_buffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, this->timestamp_pool, first_timestamp + 1);
 
         // draw main scene
         VkRect2D render_area = {};
@@ -1192,34 +1396,90 @@ void ParticlesApp::record_primary_commands(void)
         VkRenderPassBeginInfo render_pass_begin_info = {};
         render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         render_pass_begin_info.pNext = nullptr;
-        render_pass_begin_info.renderPass = this->onscreen_renderpass.render_pass;
-        render_pass_begin_info.framebuffer = this->onscreen_renderpass.fbos[i];
+        render_pass_begin_info.renderPass = this->main_render_pass();
+        render_pass_begin_info.framebuffer = this->headless ? this->offscreen_renderpass.fbo : this->onscreen_renderpass.fbos[i];
         render_pass_begin_info.renderArea = render_area;
         render_pass_begin_info.clearValueCount = 2;
         render_pass_begin_info.pClearValues = clear_values;
 
-        vkCmdBeginRenderPass(this->primary_command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        // The subpass contents are secondary command buffers, so no query can be recorded between
+        // the static scene and the particles. The statistics cover the whole main pass.
+        if (this->statistics_pool != VK_NULL_HANDLE)
+            vkCmdBeginQuery(command_buffers[i], this->statistics_pool, frame, 0);
+
+        vkCmdBeginRenderPass(command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
         // execute commands
-        VkCommandBuffer particle_cbos[2] = { this->static_scene_command_buffer, this->particle_renderer.get_command_buffer() };
-        vkCmdExecuteCommands(this->primary_command_buffers[i], 2, particle_cbos);
+        VkCommandBuffer particle_cbos[2] = { resources.static_scene_command_buffer, this->particle_renderer.get_command_buffer(frame) };
+        vkCmdExecuteCommands(command_buffers[i], 2, particle_cbos);
+
+        vkCmdEndRenderPass(command_buffers[i]);
+
+        if (this->statistics_pool != VK_NULL_HANDLE)
+            vkCmdEndQuery(command_buffers[i], this->statistics_pool, frame);
+        if (this->timestamp_pool != VK_NULL_HANDLE)
+            vkCmdWriteTimestamp(command_buffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, this->timestamp_pool, first_timestamp + 2);
+        VULKAN_ASSERT(vkEndCommandBuffer(command_buffers[i]));
+    }
+}
+
+void ParticlesApp::record_readback_commands(void)
+{
+    if (!this->exporting) return;
+
+    VkCommandBufferBeginInfo command_begin_info = {};
+    command_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    command_begin_info.pNext = nullptr;
+    command_begin_info.flags = 0;
+    command_begin_info.pInheritanceInfo = nullptr;
 
-        vkCmdEndRenderPass(this->primary_command_buffers[i]);
-        VULKAN_ASSERT(vkEndCommandBuffer(this->primary_command_buffers[i]));
+    // the render pass leaves the color attachment in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { static_cast<uint32_t>(this->width), static_cast<uint32_t>(this->height), 1 };
+
+    for (uint32_t i = 0; i < ParticlesConstants::READBACK_SLOTS; i++)
+    {
+        VULKAN_ASSERT(vkBeginCommandBuffer(this->readback_command_buffers[i], &command_begin_info));
+        vkCmdCopyImageToBuffer(this->readback_command_buffers[i], this->offscreen_renderpass.color_attachment.image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, this->readback_buffers[i].handle(), 1, &region);
+
+        // make the copy visible to the host
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = this->readback_buffers[i].handle();
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(this->readback_command_buffers[i], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        VULKAN_ASSERT(vkEndCommandBuffer(this->readback_command_buffers[i]));
     }
 }
 
-void ParticlesApp::record_static_scene(void)
+void ParticlesApp::record_static_scene(uint32_t frame)
 {
+    const VkCommandBuffer command_buffer = this->frame_resources[frame].static_scene_command_buffer;
+
     VkCommandBufferInheritanceInfo inheritance_info = {};
     inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
     inheritance_info.pNext = nullptr;
-    inheritance_info.renderPass = this->onscreen_renderpass.render_pass;
+    inheritance_info.renderPass = this->main_render_pass();
     inheritance_info.subpass = 0;
     inheritance_info.framebuffer = VK_NULL_HANDLE;
     inheritance_info.occlusionQueryEnable = VK_FALSE;
     inheritance_info.queryFlags = 0;
-    inheritance_info.pipelineStatistics = 0;
+    inheritance_info.pipelineStatistics = this->pipeline_statistics ? PIPELINE_STATISTICS : 0;
 
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1227,7 +1487,7 @@ void ParticlesApp::record_static_scene(void)
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
     begin_info.pInheritanceInfo = &inheritance_info;
 
-    VULKAN_ASSERT(vkBeginCommandBuffer(this->static_scene_command_buffer, &begin_info));
+    VULKAN_ASSERT(vkBeginCommandBuffer(command_buffer, &begin_info));
 
     VkViewport viewport = {};
     viewport.x = 0.0f;
@@ -1241,32 +1501,45 @@ void ParticlesApp::record_static_scene(void)
     scissor.offset = { 0, 0 };
     scissor.extent = { static_cast<uint32_t>(this->width), static_cast<uint32_t>(this->height) };
 
-    vkCmdBindPipeline(this->static_scene_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
-    vkCmdSetViewport(this->static_scene_command_buffer, 0, 1, &viewport);
-    vkCmdSetScissor(this->static_scene_command_buffer, 0, 1, &scissor);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
     // draw floor
     VkBuffer buffers[2] = { this->floor_vertex_buffer.handle(), this->fountain_vertex_buffer.handle() };
     VkDeviceSize offsets[2] = { 0, 0 };
-    vkCmdBindVertexBuffers(this->static_scene_command_buffer, 0, 1, buffers + 0, offsets + 0);
-    vkCmdBindIndexBuffer(this->static_scene_command_buffer, this->floor_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
-    vkCmdBindDescriptorSets(this->static_scene_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_layout, 0, this->main_descr_manager.get_sets().size(), this->main_descr_manager.get_sets().data(), 0, nullptr);
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers + 0, offsets + 0);
+    vkCmdBindIndexBuffer(command_buffer, this->floor_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
+    // the dynamic offsets select the slot of the frame, they are in the order of the bindings (0, 2, 4)
+    const uint32_t dynamic_offsets[3] = {
+        this->uniform_offset(frame, UNIFORM_TM),
+        this->uniform_offset(frame, UNIFORM_DIRECTIONAL_LIGHTS),
+        this->uniform_offset(frame, UNIFORM_FRAGMENT_VARIABLES)
+    };
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_layout, 0, 1, this->main_descr_manager.get_sets().data(), 3, dynamic_offsets);
 
-    vkCmdDrawIndexed(this->static_scene_command_buffer, this->floor_indices.size(), 1, 0, 0, 0);
+    DrawConstants draw_constants;
+    draw_constants.material = 0;
+    vkCmdPushConstants(command_buffer, this->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &draw_constants);
+    vkCmdDrawIndexed(command_buffer, this->floor_indices.size(), 1, 0, 0, 0);
 
 #if !DISPLAY_SHADOW_MAP
     // draw fountain
-    vkCmdBindVertexBuffers(this->static_scene_command_buffer, 0, 1, buffers + 1, offsets + 1);
-    vkCmdBindIndexBuffer(this->static_scene_command_buffer, this->fountain_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers + 1, offsets + 1);
+    vkCmdBindIndexBuffer(command_buffer, this->fountain_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
 
-    vkCmdDrawIndexed(this->static_scene_command_buffer, this->fountain_indices.size(), 1, 0, 0, 1);
+    draw_constants.material = 1;
+    vkCmdPushConstants(command_buffer, this->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &draw_constants);
+    vkCmdDrawIndexed(command_buffer, this->fountain_indices.size(), 1, 0, 0, 0);
 #endif
 
-    VULKAN_ASSERT(vkEndCommandBuffer(this->static_scene_command_buffer));
+    VULKAN_ASSERT(vkEndCommandBuffer(command_buffer));
 }
 
-void ParticlesApp::record_dir_shadow_map(void)
+void ParticlesApp::record_dir_shadow_map(uint32_t frame)
 {
+    const VkCommandBuffer command_buffer = this->frame_resources[frame].dir_shadow_command_buffer;
+
     VkCommandBufferInheritanceInfo inheritance_info = {};
     inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
     inheritance_info.pNext = nullptr;
@@ -1283,7 +1556,7 @@ void ParticlesApp::record_dir_shadow_map(void)
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
     begin_info.pInheritanceInfo = &inheritance_info;
 
-    VULKAN_ASSERT(vkBeginCommandBuffer(this->dir_shadow_command_buffer, &begin_info));
+    VULKAN_ASSERT(vkBeginCommandBuffer(command_buffer, &begin_info));
 
     VkViewport viewport = {};
     viewport.x = 0.0f;
@@ -1301,74 +1574,271 @@ void ParticlesApp::record_dir_shadow_map(void)
     float max_depth_bias = 200.0f;
     float depth_slope_factor = 0.0f;
 
-    vkCmdBindPipeline(this->dir_shadow_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_dir_shadow);
-    vkCmdSetViewport(this->dir_shadow_command_buffer, 0, 1, &viewport);
-    vkCmdSetScissor(this->dir_shadow_command_buffer, 0, 1, &scissor);
-    vkCmdSetDepthBias(this->dir_shadow_command_buffer, min_depth_bias, max_depth_bias, depth_slope_factor);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_dir_shadow);
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    vkCmdSetDepthBias(command_buffer, min_depth_bias, max_depth_bias, depth_slope_factor);
 
     // draw floor to shadow map
     VkBuffer buffers[2] = { this->floor_vertex_buffer.handle(), this->fountain_vertex_buffer.handle() };
     VkDeviceSize offsets[2] = { 0, 0 };
-    vkCmdBindVertexBuffers(this->dir_shadow_command_buffer, 0, 1, buffers + 0, offsets + 0);
-    vkCmdBindIndexBuffer(this->dir_shadow_command_buffer, this->floor_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
-    vkCmdBindDescriptorSets(this->dir_shadow_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_layout_dir_shadow, 0, this->dir_shadow_descr_manager.get_sets().size(), this->dir_shadow_descr_manager.get_sets().data(), 0, nullptr);
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers + 0, offsets + 0);
+    vkCmdBindIndexBuffer(command_buffer, this->floor_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
+    const uint32_t dynamic_offset = this->uniform_offset(frame, UNIFORM_TM_DIR_SHADOW);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_layout_dir_shadow, 0, 1, this->dir_shadow_descr_manager.get_sets().data(), 1, &dynamic_offset);
 
 #if !DISPLAY_SHADOW_MAP
-    vkCmdDrawIndexed(this->dir_shadow_command_buffer, this->floor_indices.size(), 1, 0, 0, 0);
+    vkCmdDrawIndexed(command_buffer, this->floor_indices.size(), 1, 0, 0, 0);
 #endif
 
     // draw fountain to shadow map
-    vkCmdBindVertexBuffers(this->dir_shadow_command_buffer, 0, 1, buffers + 1, offsets + 1);
-    vkCmdBindIndexBuffer(this->dir_shadow_command_buffer, this->fountain_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers + 1, offsets + 1);
+    vkCmdBindIndexBuffer(command_buffer, this->fountain_index_buffer.handle(), 0, VK_INDEX_TYPE_UINT32);
 
-    vkCmdDrawIndexed(this->dir_shadow_command_buffer, this->fountain_indices.size(), 1, 0, 0, 1);
+    vkCmdDrawIndexed(command_buffer, this->fountain_indices.size(), 1, 0, 0, 0);
 
-    VULKAN_ASSERT(vkEndCommandBuffer(this->dir_shadow_command_buffer));
+    VULKAN_ASSERT(vkEndCommandBuffer(command_buffer));
 }
 
 
+void ParticlesApp::wait_frame(void)
+{
+    PROFILE_ZONE("ParticlesApp::wait_frame");
+    // only the frame whose resources are reused is waited for, the other frames in flight keep the GPU busy
+    FrameResources& frame = this->frame_resources[this->frame_index];
+    VULKAN_ASSERT(vkWaitForFences(this->device, 1, &frame.fence, VK_TRUE, UINT64_MAX));
+
+    if (frame.latency_token != 0)
+    {
+        metrics::spawn_latency().completed(frame.latency_token);
+        frame.latency_token = 0;
+    }
+
+    // the frame is finished, so waiting for its queries does not stall
+    if (this->read_gpu_queries(this->frame_index, true, this->gpu_statistics))
+        this->gpu_statistics_valid = true;
+
+    this->particle_renderer.set_frame(this->frame_index);
+}
+
 void ParticlesApp::draw_frame(void)
 {
+    PROFILE_ZONE("ParticlesApp::draw_frame");
+    FrameResources& frame = this->frame_resources[this->frame_index];
     uint32_t img_index;
-    VULKAN_ASSERT(vkAcquireNextImageKHR(this->device, this->onscreen_renderpass.swapchain, ~(0UI64), this->image_ready, VK_NULL_HANDLE, &img_index));
+    VULKAN_ASSERT(vkAcquireNextImageKHR(this->device, this->onscreen_renderpass.swapchain, ~(0UI64), frame.image_ready, VK_NULL_HANDLE, &img_index));
+
+    // the binary semaphore is waited for by the presentation, the frame timeline by the producers of particles
+    particles::FrameTimeline& timeline = this->particle_renderer.timeline();
+    const uint64_t timeline_value = timeline.next();
+    const uint64_t signal_values[2] = { 0, timeline_value };    // the value of a binary semaphore is ignored
+    const VkSemaphore signal_semaphores[2] = { frame.rendering_done, timeline.handle() };
+
+    VkTimelineSemaphoreSubmitInfo timeline_submit_info = {};
+    timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_submit_info.pNext = nullptr;
+    timeline_submit_info.waitSemaphoreValueCount = 0;
+    timeline_submit_info.pWaitSemaphoreValues = nullptr;
+    timeline_submit_info.signalSemaphoreValueCount = 2;
+    timeline_submit_info.pSignalSemaphoreValues = signal_values;
 
     VkPipelineStageFlags stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     VkSubmitInfo static_scene_submit_info = {};
     static_scene_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    static_scene_submit_info.pNext = nullptr;
+    static_scene_submit_info.pNext = &timeline_submit_info;
     static_scene_submit_info.waitSemaphoreCount = 1;
-    static_scene_submit_info.pWaitSemaphores = &this->image_ready;
+    static_scene_submit_info.pWaitSemaphores = &frame.image_ready;
     static_scene_submit_info.pWaitDstStageMask = &stage_mask;
     static_scene_submit_info.commandBufferCount = 1;
-    static_scene_submit_info.pCommandBuffers = &this->primary_command_buffers[img_index];
-    static_scene_submit_info.signalSemaphoreCount = 1;
-    static_scene_submit_info.pSignalSemaphores = &this->rendering_done;
-
-
-    VULKAN_ASSERT(vkQueueSubmit(this->graphics_queue, 1, &static_scene_submit_info, VK_NULL_HANDLE));
-    if(this->render_time > 0.006)   // 0.006s -> 6ms
-        vkQueueWaitIdle(this->graphics_queue);
+    static_scene_submit_info.pCommandBuffers = &frame.primary_command_buffers[img_index];
+    static_scene_submit_info.signalSemaphoreCount = 2;
+    static_scene_submit_info.pSignalSemaphores = signal_semaphores;
+
+    // late latch: the GPU has not started the frame yet, so the camera can still be written into its uniform slot,
+    // the input is sampled after the acquisition, which is where the render thread blocks if the GPU is ahead
+    if (_config.late_latch)
+        this->latch_camera();
+
+    // spawns that have returned until now are in the particle buffer that this frame draws
+    metrics::SpawnLatencyTracer& latency_tracer = metrics::spawn_latency();
+    if (latency_tracer.enabled())
+        frame.latency_token = latency_tracer.submit();
+    VULKAN_ASSERT(vkResetFences(this->device, 1, &frame.fence));
+    VULKAN_ASSERT(vkQueueSubmit(this->graphics_queue, 1, &static_scene_submit_info, frame.fence));
+    timeline.mark_submitted(timeline_value);
+    frame.queries_used = true;
+
+    static metrics::Histogram& input_to_submit_us = metrics::registry().histogram("input_to_submit_us");
+    input_to_submit_us.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->camera_sample_time).count());
 
     VkPresentInfoKHR present_info = {};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     present_info.pNext = nullptr;
     present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = &this->rendering_done;
+    present_info.pWaitSemaphores = &frame.rendering_done;
     present_info.swapchainCount = 1;
     present_info.pSwapchains = &this->onscreen_renderpass.swapchain;
     present_info.pImageIndices = &img_index;
     present_info.pResults = nullptr;
 
     VULKAN_ASSERT(vkQueuePresentKHR(this->graphics_queue, &present_info));
+    latency_tracer.presented(frame.latency_token);
+    this->poll_spawn_latency();
+
+    this->frame_index = (this->frame_index + 1) % this->frames_in_flight;
+}
+
+double ParticlesApp::draw_frame_headless(uint32_t readback_slot)
+{
+    PROFILE_ZONE("ParticlesApp::draw_frame_headless");
+    // the readback is submitted after the frame in the same batch
+    // there is only one frame in flight
+    FrameResources& frame = this->frame_resources[0];
+    VkCommandBuffer command_buffers[2] = { frame.primary_command_buffers[0], VK_NULL_HANDLE };
+    if (readback_slot != NO_READBACK)
+        command_buffers[1] = this->readback_command_buffers[readback_slot];
+
+    particles::FrameTimeline& timeline = this->particle_renderer.timeline();
+    const uint64_t timeline_value = timeline.next();
+    const VkSemaphore timeline_semaphore = timeline.handle();
+
+    VkTimelineSemaphoreSubmitInfo timeline_submit_info = {};
+    timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_submit_info.pNext = nullptr;
+    timeline_submit_info.waitSemaphoreValueCount = 0;
+    timeline_submit_info.pWaitSemaphoreValues = nullptr;
+    timeline_submit_info.signalSemaphoreValueCount = 1;
+    timeline_submit_info.pSignalSemaphoreValues = &timeline_value;
+
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_submit_info;
+    submit_info.waitSemaphoreCount = 0;
+    submit_info.pWaitSemaphores = nullptr;
+    submit_info.pWaitDstStageMask = nullptr;
+    submit_info.commandBufferCount = (readback_slot != NO_READBACK) ? 2 : 1;
+    submit_info.pCommandBuffers = command_buffers;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &timeline_semaphore;
+
+    // there is no input, but a scenario camera is latched the same way as onscreen
+    if (_config.late_latch)
+        this->latch_camera();
+
+    metrics::SpawnLatencyTracer& latency_tracer = metrics::spawn_latency();
+    const uint64_t latency_token = latency_tracer.enabled() ? latency_tracer.submit() : 0;
+    VULKAN_ASSERT(vkResetFences(this->device, 1, &frame.fence));
+    VULKAN_ASSERT(vkQueueSubmit(this->graphics_queue, 1, &submit_info, frame.fence));
+    timeline.mark_submitted(timeline_value);
+    frame.queries_used = true;
+
+    // there is only one offscreen image, so the frame must be finished before the next one is drawn
+    const auto t0 = std::chrono::steady_clock::now();
+    VULKAN_ASSERT(vkWaitForFences(this->device, 1, &frame.fence, VK_TRUE, UINT64_MAX));
+    const auto t1 = std::chrono::steady_clock::now();
+    latency_tracer.completed(latency_token);    // nothing is presented
+
+    // the frame is finished, so waiting for the queries does not stall
+    this->gpu_statistics_valid = this->read_gpu_queries(0, true, this->gpu_statistics);
+
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+bool ParticlesApp::read_gpu_queries(uint32_t region, bool wait, GpuFrameStatistics& statistics)
+{
+    if (this->timestamp_pool == VK_NULL_HANDLE || !this->frame_resources[region].queries_used)
+        return false;
+
+    const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | (wait ? VK_QUERY_RESULT_WAIT_BIT : 0);
+    uint64_t timestamps[N_TIMESTAMPS];
+    VkResult result = vkGetQueryPoolResults(this->device, this->timestamp_pool, region * N_TIMESTAMPS, N_TIMESTAMPS, sizeof(timestamps), timestamps, sizeof(uint64_t), flags);
+    if (result == VK_NOT_READY)
+        return false;
+    VULKAN_ASSERT(result);
+
+    const double ns_to_ms = this->timestamp_period * 1e-6;
+    statistics.shadow_ms = ((timestamps[1] - timestamps[0]) & this->timestamp_mask) * ns_to_ms;
+    statistics.main_ms = ((timestamps[2] - timestamps[1]) & this->timestamp_mask) * ns_to_ms;
+    statistics.total_ms = ((timestamps[2] - timestamps[0]) & this->timestamp_mask) * ns_to_ms;
+
+    static metrics::Histogram& gpu_frame_us = metrics::registry().histogram("gpu_frame_us");
+    gpu_frame_us.record(static_cast<uint64_t>(statistics.total_ms * 1e3));
+
+    // the statistics are ready at the latest shortly after the timestamps
+    statistics.has_invocations = false;
+    if (this->statistics_pool != VK_NULL_HANDLE)
+    {
+        result = vkGetQueryPoolResults(this->device, this->statistics_pool, region, 1, sizeof(statistics.invocations), statistics.invocations, sizeof(statistics.invocations), flags);
+        if (result != VK_NOT_READY)
+        {
+            VULKAN_ASSERT(result);
+            statistics.has_invocations = true;
+        }
+    }
+    return true;
+}
+
+void ParticlesApp::poll_spawn_latency(void)
+{
+    // the fence of a frame is signaled when the GPU has finished it, the frame that is reused next
+    // is completed at the latest when its fence is waited for
+    metrics::SpawnLatencyTracer& latency_tracer = metrics::spawn_latency();
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        FrameResources& frame = this->frame_resources[i];
+        if (frame.latency_token == 0)
+            continue;
+
+        const VkResult result = vkGetFenceStatus(this->device, frame.fence);
+        if (result == VK_NOT_READY)
+            continue;
+        VULKAN_ASSERT(result);
+        latency_tracer.completed(frame.latency_token);
+        frame.latency_token = 0;
+    }
+}
+
+void ParticlesApp::show_gpu_statistics(void)
+{
+    const double t = glfwGetTime();
+    if (!this->gpu_statistics_valid || t - this->gpu_statistics_time < ParticlesConstants::GPU_STATISTICS_INTERVAL)
+        return;
+    this->gpu_statistics_time = t;
+
+    char title[256];
+    int n = std::snprintf(title, sizeof(title), "Particles vulkan | GPU: shadow map %.2f ms, main pass %.2f ms, total %.2f ms",
+        this->gpu_statistics.shadow_ms, this->gpu_statistics.main_ms, this->gpu_statistics.total_ms);
+    if (this->gpu_statistics.has_invocations && n > 0 && n < static_cast<int>(sizeof(title)))
+    {
+        std::snprintf(title + n, sizeof(title) - n, " | invocations: VS %llu, GS %llu, FS %llu",
+            static_cast<unsigned long long>(this->gpu_statistics.invocations[0]),
+            static_cast<unsigned long long>(this->gpu_statistics.invocations[1]),
+            static_cast<unsigned long long>(this->gpu_statistics.invocations[2]));
+    }
+    glfwSetWindowTitle(this->window, title);
 }
 
 void ParticlesApp::destroy_vulkan(void)
 {
     vkDeviceWaitIdle(this->device);
 
-    vkDestroyFence(this->device, this->render_fence, nullptr);
-    vkDestroySemaphore(this->device, this->image_ready, nullptr);
-    vkDestroySemaphore(this->device, this->rendering_done, nullptr);
+    vkDestroyQueryPool(this->device, this->timestamp_pool, nullptr);
+    vkDestroyQueryPool(this->device, this->statistics_pool, nullptr);
+    if (this->exporting)
+    {
+        vkFreeCommandBuffers(this->device, this->command_pool, ParticlesConstants::READBACK_SLOTS, this->readback_command_buffers);
+        for (vka::Buffer& buffer : this->readback_buffers)
+        {
+            buffer.unmap();
+            buffer.clear();
+        }
+    }
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        vkDestroySemaphore(this->device, this->frame_resources[i].image_ready, nullptr);
+        vkDestroySemaphore(this->device, this->frame_resources[i].rendering_done, nullptr);
+        vkDestroyFence(this->device, this->frame_resources[i].fence, nullptr);
+    }
 
     this->particle_renderer.clear(this->device);
 
@@ -1386,22 +1856,28 @@ void ParticlesApp::destroy_vulkan(void)
     this->fountain_vertex_buffer.clear();
     this->fountain_index_buffer.clear();
     this->fountain_texture.clear();
-    this->tm_buffer.clear();
-    this->tm_buffer_dir_shadow.clear();
-    this->directional_light_buffer.clear();
-    this->material_buffer.clear();
-    this->fragment_variables_buffer.clear();
-
-    vkFreeCommandBuffers(this->device, this->command_pool, this->primary_command_buffers.size(), this->primary_command_buffers.data());
-    vkFreeCommandBuffers(this->device, this->command_pool, 1, &this->static_scene_command_buffer);
-    vkFreeCommandBuffers(this->device, this->command_pool, 1, &this->dir_shadow_command_buffer);
+    this->uniform_ring.unmap();
+    this->uniform_ring.clear();
+    this->uniform_map = nullptr;
+
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        FrameResources& frame = this->frame_resources[i];
+        vkFreeCommandBuffers(this->device, this->command_pool, frame.primary_command_buffers.size(), frame.primary_command_buffers.data());
+        vkFreeCommandBuffers(this->device, this->command_pool, 1, &frame.static_scene_command_buffer);
+        vkFreeCommandBuffers(this->device, this->command_pool, 1, &frame.dir_shadow_command_buffer);
+    }
     vkDestroyCommandPool(this->device, this->command_pool, nullptr);
 
     this->directional_shadow_map.clear(this->device);
-    this->onscreen_renderpass.clear(this->device);
+    if (this->headless)
+        this->offscreen_renderpass.clear(this->device);
+    else
+        this->onscreen_renderpass.clear(this->device);
 
     vkDestroyDevice(this->device, nullptr);
-    vkDestroySurfaceKHR(this->instance, this->surface, nullptr);
+    if (!this->headless)
+        vkDestroySurfaceKHR(this->instance, this->surface, nullptr);
     vkDestroyInstance(this->instance, nullptr);
 }
 
@@ -1477,19 +1953,56 @@ void ParticlesApp::move_action(GLFWwindow* window, glm::vec3& pos, const glm::ve
 
 void ParticlesApp::update_frame_contents(void)
 {
-    _config.cam.velocity = this->handle_move_keys(_config.movement_speed, _config.cam.yaw, ParticlesConstants::MOVE_KEY_MAP);
-    this->mouse_action(this->window, this->width, this->height, _config.cam.yaw, _config.cam.pitch, _config.sesitivity);
-    this->move_action(this->window, _config.cam.pos, _config.cam.velocity);
-
+    PROFILE_ZONE("ParticlesApp::update_frame_contents");
+    // the fence of the frame has been waited for, so its slot of the uniform ring is not read by the GPU anymore
     // shadow map MVP matrix
     glm::mat4 dir_shadow_view = glm::lookAt(-this->directional_light.direction * 5.0f, { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f });
     glm::mat4 dir_shadow_projection = glm::ortho(-2.5f, 2.5f, -2.5f, 2.5f, 0.0f, 15.0f);
 
-    ShadowTransformMatrices dir_shadow_tm;
-    dir_shadow_tm.MVP = dir_shadow_projection * dir_shadow_view;
-    void* map = this->tm_buffer_dir_shadow.map(sizeof(ShadowTransformMatrices), 0);
-    memcpy(map, &dir_shadow_tm, sizeof(ShadowTransformMatrices));
-    this->tm_buffer_dir_shadow.unmap();
+    ShadowTransformMatrices* dir_shadow_tm = this->uniform_slot<ShadowTransformMatrices>(this->frame_index, UNIFORM_TM_DIR_SHADOW);
+    dir_shadow_tm->MVP = dir_shadow_projection * dir_shadow_view;
+
+    // main shader light matrix, the camera matrix is written by ParticlesApp::latch_camera
+    TransformMatrices* tm = this->uniform_slot<TransformMatrices>(this->frame_index, UNIFORM_TM);
+#if DISPLAY_SHADOW_MAP
+    tm->light_MVP = glm::mat4(1.0f);
+#else
+    tm->light_MVP = dir_shadow_projection * dir_shadow_view;
+#endif
+
+    // main shader fragment variables
+    FragmentVariables* fv = this->uniform_slot<FragmentVariables>(this->frame_index, UNIFORM_FRAGMENT_VARIABLES);
+    fv->shadow_penumbra_size = 0.003f;
+    fv->shadow_samples = 16;
+
+    // every slot has its own lights
+    this->update_lights();
+
+    // without the late latch, the camera is sampled together with the other contents of the frame
+    if (!_config.late_latch)
+        this->latch_camera();
+}
+
+void ParticlesApp::latch_camera(void)
+{
+    PROFILE_ZONE("ParticlesApp::latch_camera");
+    // there is no input in headless mode, the camera stays where it has been configured,
+    // a scenario moves the camera along its path
+    if (this->scripted)
+    {
+        this->scenario_runner.camera(_config.cam.pos, _config.cam.yaw, _config.cam.pitch);
+    }
+    else if (!this->headless)
+    {
+        // GLFW only allows polling the input on the main thread, which is the render thread,
+        // the key states are updated by the events that arrived since the beginning of the frame
+        if (_config.late_latch)
+            glfwPollEvents();
+        _config.cam.velocity = this->handle_move_keys(_config.movement_speed, _config.cam.yaw, ParticlesConstants::MOVE_KEY_MAP);
+        this->mouse_action(this->window, this->width, this->height, _config.cam.yaw, _config.cam.pitch, _config.sesitivity);
+        this->move_action(this->window, _config.cam.pos, _config.cam.velocity);
+    }
+    this->camera_sample_time = std::chrono::steady_clock::now();
 
     // main shader MVP matrix
     glm::mat4 model(1.0f);
@@ -1499,44 +2012,49 @@ void ParticlesApp::update_frame_contents(void)
                                             _config.cam.pos.z + cos(_config.cam.yaw) * cos(_config.cam.pitch)),
                                  glm::dvec3(0.0, -1.0, 0.0));
     glm::mat4 projection = glm::perspective(glm::radians(100.0f), static_cast<float>(this->width) / static_cast<float>(this->height), 0.001f, 100.0f);
+    {
+        std::lock_guard<std::mutex> lock(this->camera_mtx);
+        this->camera_pos = _config.cam.pos;
+        this->camera_vp = projection * view;
+    }
 
-    TransformMatrices tm;
+    TransformMatrices* tm = this->uniform_slot<TransformMatrices>(this->frame_index, UNIFORM_TM);
 #if DISPLAY_SHADOW_MAP
-    tm.MVP = glm::mat4(1.0f);
-    tm.light_MVP = glm::mat4(1.0f);
+    tm->MVP = glm::mat4(1.0f);
 #else
-    tm.MVP = projection * view * model;
-    tm.light_MVP = dir_shadow_projection * dir_shadow_view;
+    tm->MVP = projection * view * model;
 #endif
-    map = this->tm_buffer.map(sizeof(TransformMatrices), 0);
-    memcpy(map, &tm, sizeof(TransformMatrices));
-    this->tm_buffer.unmap();
 
-    // particle shader transformation matrices
+    // particle shader transformation matrices, they are in the persistently mapped slot of the same frame
     this->particle_renderer.set_view_projection(view, projection);
 
-    // main shader fragment variables
-    FragmentVariables* fv = (FragmentVariables*)this->fragment_variables_buffer.map(sizeof(FragmentVariables), 0);
+    FragmentVariables* fv = this->uniform_slot<FragmentVariables>(this->frame_index, UNIFORM_FRAGMENT_VARIABLES);
     fv->cam_pos = _config.cam.pos;
-    fv->shadow_penumbra_size = 0.003f;
-    fv->shadow_samples = 16;
-    this->fragment_variables_buffer.unmap();
 }
 
 
-void ParticlesApp::update_lights(void)
+glm::vec3 ParticlesApp::camera_position(void) const
+{
+    std::lock_guard<std::mutex> lock(this->camera_mtx);
+    return this->camera_pos;
+}
+
+glm::mat4 ParticlesApp::camera_view_projection(void) const
 {
-    int8_t* map = (int8_t*)this->directional_light_buffer.map(ParticlesConstants::N_DIRECTIONAL_LIGHTS * sizeof(DirectionalLight), 0);
+    std::lock_guard<std::mutex> lock(this->camera_mtx);
+    return this->camera_vp;
+}
 
-    DirectionalLight* light = shader_at(DirectionalLight, map, 0);
+void ParticlesApp::update_lights(void)
+{
+    DirectionalLight* light = this->uniform_slot<DirectionalLight>(this->frame_index, UNIFORM_DIRECTIONAL_LIGHTS);
     *light = this->directional_light;
-    this->directional_light_buffer.unmap();
 }
 
 void ParticlesApp::update_materials(void)
 {
-    // get byte pointer of mapped memory
-    int8_t* map = (int8_t*)this->material_buffer.map(ParticlesConstants::N_MATERIALS * sizeof(Material), 0);
+    // the materials are at the beginning of the uniform ring
+    uint8_t* map = this->uniform_map;
 
     // floor material
     Material* material = shader_at(Material, map, 0); // first mateial
@@ -1551,8 +2069,6 @@ void ParticlesApp::update_materials(void)
     material->roughness = 0.2;
     material->metallic = 0.0f;
     material->alpha = 1.0f;
-
-    this->material_buffer.unmap();
 }
 
 
@@ -1569,42 +2085,282 @@ void ParticlesApp::start_application_thread(void)
 
 void ParticlesApp::stop_application_thread(void)
 {
-    this->application_thread.join();
+    if (this->application_thread.joinable())
+        this->application_thread.join();
+}
+
+void ParticlesApp::init_scenario(void)
+{
+    PROFILE_ZONE("ParticlesApp::init_scenario");
+    particles::scenario_t scenario;
+    particles::load_scenario(_config.scenario_path, scenario);
+
+    this->scenario_pool.init(this->particle_renderer);
+    this->scenario_engine.init(this->scenario_pool);
+    this->scenario_engine.start();
+    this->scenario_runner.init(this->scenario_engine, scenario);
+    if (_config.timing_path != nullptr)
+        this->scenario_runner.open_timing(_config.timing_path);
+    this->scenario_runner.start();
+}
+
+void ParticlesApp::end_scenario_frame(double frame_time, double cpu_time, double gpu_ms)
+{
+    // there is no application thread that publishes the particle count
+    static metrics::Gauge& particle_count = metrics::registry().gauge("particles");
+    static metrics::Gauge& fragmentation = metrics::registry().gauge("pool_fragmentation");
+    particle_count.set(this->scenario_pool.count());
+    fragmentation.set(this->scenario_pool.fragmentation());
+
+    this->scenario_runner.record_frame(frame_time * 1e3, cpu_time * 1e3, gpu_ms);
+    this->scenario_runner.advance();
 }
 
 
 void ParticlesApp::ParticlesApp::run(void)
 {
+    if (this->headless)
+    {
+        this->run_headless();
+        return;
+    }
+
+    metrics::Histogram& frame_us = metrics::registry().histogram("frame_us");
+    metrics::Counter& frames = metrics::registry().counter("frames");
+    particles::FrameArena& arena = particles::FrameArena::local();
     while (!glfwGetKey(this->window, GLFW_KEY_ESCAPE) && !glfwWindowShouldClose(this->window))
     {
         double t0 = glfwGetTime();
+        arena.reset();
         glfwPollEvents();
         this->reshape();
+
+        // events (e.g. F9) and swapchain recreation are not part of the steady-state frame
+        this->alloc_frames.begin_frame();
+        this->wait_frame();
         this->update_frame_contents();
         this->draw_frame();
+        this->show_gpu_statistics();
         double t1 = glfwGetTime();
         this->render_time = t1 - t0;
+        frame_us.record(static_cast<uint64_t>(this->render_time * 1e6));
+        frames.add();
+
+        // onscreen there is no separate CPU timing, the GPU time is the one of the latest frame that has been read back
+        if (this->scripted)
+        {
+            this->end_scenario_frame(this->render_time, this->render_time, this->gpu_statistics_valid ? this->gpu_statistics.total_ms : -1.0);
+        }
+        this->alloc_frames.end_frame();
+        if (this->scripted && this->scenario_runner.finished()) break;
     }
 }
 
+void ParticlesApp::run_headless(void)
+{
+    // a scenario ends the run early, if it is shorter than the requested number of frames
+    const uint32_t n_frames = this->scripted ? std::min(_config.headless_frames, this->scenario_runner.frame_count()) : _config.headless_frames;
+    std::vector<double> frame_ms, cpu_ms, gpu_shadow_ms, gpu_main_ms, gpu_total_ms, export_wait_ms;
+    std::vector<double> invocations[N_PIPELINE_STATISTICS];
+    metrics::Histogram& frame_us = metrics::registry().histogram("frame_us");
+    metrics::Counter& frames = metrics::registry().counter("frames");
+    particles::FrameArena& arena = particles::FrameArena::local();
+    frame_ms.reserve(n_frames);
+    cpu_ms.reserve(n_frames);
+
+    // the swapchain format is BGRA
+    if (this->exporting)
+        this->frame_exporter.open(_config.export_path, this->width, this->height, ParticlesConstants::READBACK_SLOTS, true, ParticlesConstants::EXPORT_FRAME_RATE);
+
+    // the same passes as onscreen, but every frame is waited for instead of presented
+    const auto t_begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n_frames; i++)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        arena.reset();
+        this->alloc_frames.begin_frame();
+
+        // only waits if every readback buffer is still being encoded
+        uint32_t slot = NO_READBACK;
+        double export_wait_time = 0.0;
+        if (this->exporting)
+        {
+            slot = this->frame_exporter.acquire();
+            export_wait_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            export_wait_ms.push_back(export_wait_time * 1e3);
+        }
+
+        this->update_frame_contents();
+        const double wait_time = this->draw_frame_headless(slot);
+        if (this->exporting)
+            this->frame_exporter.submit(slot, this->readback_maps[slot]);
+        const auto t1 = std::chrono::steady_clock::now();
+
+        const double frame_time = std::chrono::duration<double>(t1 - t0).count();
+        this->render_time = frame_time;
+        frame_ms.push_back(frame_time * 1e3);
+        frame_us.record(static_cast<uint64_t>(frame_time * 1e6));
+        frames.add();
+        cpu_ms.push_back((frame_time - wait_time - export_wait_time) * 1e3);
+
+        if (this->gpu_statistics_valid)
+        {
+            gpu_shadow_ms.push_back(this->gpu_statistics.shadow_ms);
+            gpu_main_ms.push_back(this->gpu_statistics.main_ms);
+            gpu_total_ms.push_back(this->gpu_statistics.total_ms);
+            for (uint32_t j = 0; j < N_PIPELINE_STATISTICS && this->gpu_statistics.has_invocations; j++)
+                invocations[j].push_back(static_cast<double>(this->gpu_statistics.invocations[j]));
+        }
+        if (this->scripted)
+            this->end_scenario_frame(frame_time, frame_time - wait_time - export_wait_time, this->gpu_statistics_valid ? this->gpu_statistics.total_ms : -1.0);
+        this->alloc_frames.end_frame();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_begin).count();
+
+    // encoding of the last frames, reported separately from the render loop
+    if (this->exporting)
+        this->frame_exporter.close();
+    const double export_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_begin).count();
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(this->physical_device, &properties);
+
+    std::ofstream file;
+    if (_config.report_path != nullptr)
+    {
+        file.open(_config.report_path);
+        if (!file)
+            throw std::runtime_error("Failed to create headless report \"" + std::string(_config.report_path) + "\".");
+    }
+    std::ostream& os = file.is_open() ? file : std::cout;
+
+    os << "{\n";
+    os << "    \"device\": \"" << properties.deviceName << "\",\n";
+    os << "    \"width\": " << this->width << ",\n";
+    os << "    \"height\": " << this->height << ",\n";
+    os << "    \"frames\": " << n_frames << ",\n";
+    os << "    \"seconds\": " << seconds << ",\n";
+    os << "    \"fps\": " << ((seconds > 0.0) ? n_frames / seconds : 0.0) << ",\n";
+    os << "    \"frame_ms\": "; write_statistics_json(os, frame_ms); os << ",\n";
+    os << "    \"cpu_ms\": "; write_statistics_json(os, cpu_ms); os << ",\n";
+    if (this->exporting)
+    {
+        os << "    \"export_path\": \"" << _config.export_path << "\",\n";
+        os << "    \"export_seconds\": " << export_seconds << ",\n";
+        os << "    \"export_wait_ms\": "; write_statistics_json(os, export_wait_ms); os << ",\n";
+    }
+    if (this->statistics_pool != VK_NULL_HANDLE)
+    {
+        os << "    \"invocations\": {\n";
+        os << "        \"vertex\": "; write_statistics_json(os, invocations[0]); os << ",\n";
+        os << "        \"geometry\": "; write_statistics_json(os, invocations[1]); os << ",\n";
+        os << "        \"fragment\": "; write_statistics_json(os, invocations[2]); os << "\n";
+        os << "    },\n";
+    }
+    if (_config.alloc_report)
+    {
+        os << "    \"allocations\": "; this->alloc_frames.write_json(os); os << ",\n";
+    }
+    if (metrics::spawn_latency().enabled())
+    {
+        os << "    \"spawn_latency_ms\": {\n";
+        os << "        \"submit\": "; write_latency_json(os, metrics::SpawnLatencyTracer::STAGE_SUBMIT); os << ",\n";
+        os << "        \"gpu_done\": "; write_latency_json(os, metrics::SpawnLatencyTracer::STAGE_GPU_DONE); os << "\n";
+        os << "    },\n";
+    }
+    if (this->timestamp_pool != VK_NULL_HANDLE)
+    {
+        os << "    \"gpu_ms\": {\n";
+        os << "        \"shadow_map\": "; write_statistics_json(os, gpu_shadow_ms); os << ",\n";
+        os << "        \"main_pass\": "; write_statistics_json(os, gpu_main_ms); os << ",\n";
+        os << "        \"total\": "; write_statistics_json(os, gpu_total_ms); os << "\n";
+        os << "    }\n";
+    }
+    else
+    {
+        os << "    \"gpu_ms\": null\n";
+    }
+    os << "}" << std::endl;
+}
+
 void ParticlesApp::init(void)
 {
+    PROFILE_THREAD("render");
+    PROFILE_ZONE("ParticlesApp::init");
+    ALLOC_THREAD(profiler::ALLOC_RENDER);
     this->renderer_shutdown = false;
+    this->camera_pos = _config.cam.pos;
+    this->camera_vp = glm::mat4(1.0f);
+    this->headless = (_config.headless_frames > 0);
+    this->exporting = (_config.export_path != nullptr);
+    if (this->exporting && !this->headless)
+        throw std::invalid_argument("Exporting frames requieres the headless mode.");
+    this->scripted = (_config.scenario_path != nullptr);
+    if (!this->headless && (_config.frames_in_flight < ParticlesConstants::MIN_FRAMES_IN_FLIGHT || _config.frames_in_flight > ParticlesConstants::MAX_FRAMES_IN_FLIGHT))
+        throw std::invalid_argument("Frames in flight must be in the range [" + std::to_string(ParticlesConstants::MIN_FRAMES_IN_FLIGHT) + ", " + std::to_string(ParticlesConstants::MAX_FRAMES_IN_FLIGHT) + "].");
+    this->frames_in_flight = this->headless ? 1 : _config.frames_in_flight;
+    this->frame_index = 0;
+    if ((_config.alloc_report || _config.alloc_steady_frame > 0) && !profiler::alloc_tracking())
+        throw std::invalid_argument("Tracking allocations requieres a build with PARTICLES_ALLOC_TRACKER.");
+    this->alloc_frames.init(_config.alloc_steady_frame);
+    if (_config.metrics_name != nullptr)
+        this->metrics_publisher.create(_config.metrics_name, metrics::registry());
+    metrics::spawn_latency().enable(_config.latency_interval);
     this->load_models();
     this->init_lights();
-    this->init_glfw();
+    if (this->headless)
+    {
+        this->window = nullptr;
+        this->width = ParticlesConstants::HEADLESS_WIDTH;
+        this->height = ParticlesConstants::HEADLESS_HEIGHT;
+    }
+    else
+    {
+        this->init_glfw();
+    }
     this->init_vulkan();
 
-    this->update_lights();
+    // the lights are written with the other uniforms of a frame
     this->update_materials();
 
-    this->start_application_thread();
+    // the scenario replaces the interactive scene of the application thread
+    if (this->scripted)
+        this->init_scenario();
+    else
+        this->start_application_thread();
 }
 
 void ParticlesApp::shutdown(void)
 {
     this->renderer_shutdown = true;
     this->stop_application_thread();
+    if (this->scripted)
+    {
+        this->scenario_runner.stop();
+        this->scenario_engine.stop();
+        this->scenario_pool.clear();
+    }
     this->destroy_vulkan();
-    this->destry_glfw();
+    if (!this->headless)
+        this->destry_glfw();
+
+    if (_config.trace_path != nullptr)
+        profiler::dump_chrome_trace(_config.trace_path);
+    this->metrics_publisher.destroy();
+
+    // the headless mode has the allocations and latencies in its report
+    if (!this->headless && _config.alloc_report)
+        this->alloc_frames.report(std::cout);
+    if (!this->headless && metrics::spawn_latency().enabled())
+    {
+        const char* names[metrics::SpawnLatencyTracer::STAGE_COUNT] = { "submit", "present", "GPU done" };
+        std::cout << "Spawn latency:" << std::endl;
+        for (uint32_t i = 0; i < metrics::SpawnLatencyTracer::STAGE_COUNT; i++)
+        {
+            const metrics::SpawnLatencyTracer::statistics_t statistics = metrics::spawn_latency().statistics(static_cast<metrics::SpawnLatencyTracer::stage_t>(i));
+            std::printf("    %-10s %8llu samples, p50 %8.3f ms, p99 %8.3f ms, max %8.3f ms\n", names[i],
+                static_cast<unsigned long long>(statistics.count), statistics.p50_ms, statistics.p99_ms, statistics.max_ms);
+        }
+        std::fflush(stdout);
+    }
 }
\ No newline at end of file
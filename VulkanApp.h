@@ -9,13 +9,21 @@
 #include <glm/glm.hpp>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <mutex>
 
 #include "particles/particles.h"
+#include "particles/frame_exporter.h"
+#include "particles/scenario.h"
+#include "metrics/metrics_shm.h"
+#include "profiler/alloc_tracker.h"
 
 namespace ParticlesConstants
 {
     /* CONSTANTS */
     constexpr static uint32_t SWAPCHAIN_IMAGES = 3;
+    constexpr static uint32_t MIN_FRAMES_IN_FLIGHT = 2;
+    constexpr static uint32_t MAX_FRAMES_IN_FLIGHT = particles::ParticleRenderer::MAX_FRAMES_IN_FLIGHT;
     constexpr static VkImageUsageFlags SWAPCHAIN_IMAGE_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     constexpr static VkFormat SWAPCHAIN_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
     constexpr static VkColorSpaceKHR SWAPCHAIN_COLOR_SPACE = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
@@ -29,6 +37,14 @@ namespace ParticlesConstants
     constexpr static uint32_t SHADOW_MAP_SAMPLES = 16;
     constexpr static uint32_t SHADOW_MAP_SAMPLES_DIV_2 = SHADOW_MAP_SAMPLES / 2;
     constexpr static float SHADOW_PENUMBRA_SIZE = 2.0f;
+    constexpr static uint32_t HEADLESS_WIDTH = 1920;
+    constexpr static uint32_t HEADLESS_HEIGHT = 1080;
+    constexpr static VkImageUsageFlags OFFSCREEN_IMAGE_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    constexpr static uint32_t READBACK_SLOTS = 4;      // frames that can be encoded while the GPU renders the next ones
+    constexpr static uint32_t EXPORT_FRAME_RATE = 60;
+    constexpr static char DEFAULT_TRACE_PATH[] = "particles_trace.json";
+    constexpr static char DEFAULT_CHECKPOINT_PATH[] = "particles_checkpoint.pchk";
+    constexpr static double GPU_STATISTICS_INTERVAL = 0.5;    // seconds between two updates of the GPU times in the window title
 
     // shader paths
     constexpr static char SHADER_STATIC_SCENE_VERTEX_PATH[] = "../../../assets/shaders/out/static_scene.vert.spv";
@@ -48,6 +64,9 @@ namespace ParticlesConstants
 
     // keys
     constexpr static int MOVE_KEY_MAP[6] = { 'W', 'D', 'S', 'A', GLFW_KEY_SPACE, GLFW_KEY_LEFT_SHIFT };
+    constexpr static int PROFILE_DUMP_KEY = GLFW_KEY_F9;
+    constexpr static int CHECKPOINT_SAVE_KEY = GLFW_KEY_F5;
+    constexpr static int CHECKPOINT_RESTORE_KEY = GLFW_KEY_F6;
 };
 
 struct OnscreenRenderPass
@@ -72,6 +91,24 @@ private:
     void destroy_views(VkDevice device);
 };
 
+// render target of the headless mode, same formats as the onscreen render pass but without a swapchain
+// the color attachment ends in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, so that it can be read back
+struct OffscreenRenderPass
+{
+    vka::AttachmentImage color_attachment;
+    vka::AttachmentImage depth_attachment;
+    VkRenderPass render_pass;
+    VkFramebuffer fbo;
+
+    void init(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_fam_index, uint32_t width, uint32_t height);
+    void clear(VkDevice device);
+
+private:
+    void init_attachments(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_fam_index, uint32_t width, uint32_t height);
+    void init_render_pass(VkDevice device);
+    void init_fbo(VkDevice device, uint32_t width, uint32_t height);
+};
+
 struct ShadowMap
 {
     vka::AttachmentImage depth_attachment;
@@ -155,6 +192,27 @@ public:
         Camera cam;
         float movement_speed;
         float sesitivity;
+        const char* record_path;    // path of the session file to record, nullptr = no recording
+        const char* shm_feed;       // name of a shared memory particle feed to ingest, nullptr = no feed
+        const char* point_cloud;    // path of a chunked point cloud to stream, nullptr = no point cloud
+        const char* paged_path;     // path of a page file to page into the pool, nullptr = no paging
+        uint32_t fountain_particles;// particles of the simulated fountain, 0 = no fountain
+        const char* bake_path;      // baked cache the pool is captured into every application tick, nullptr = no baking
+        const char* playback_path;  // baked cache to play back in a loop, nullptr = no playback
+        uint32_t headless_frames;   // number of frames to render offscreen without a window, 0 = onscreen
+        const char* report_path;    // path of the JSON report of the headless mode, nullptr = stdout
+        const char* export_path;    // image pattern or Y4M file of the headless frames, nullptr = no export
+        const char* scenario_path;  // scenario that replaces the interactive scene and camera, nullptr = interactive
+        const char* timing_path;    // CSV file with the timing of every scenario frame, nullptr = no timing
+        const char* trace_path;     // Chrome trace of the profiler, written at shutdown and on F9, nullptr = only on F9
+        bool pipeline_statistics;   // query shader invocations of the main pass, if the device supports it
+        const char* metrics_name;   // shared memory segment the live metrics are published into, nullptr = not published
+        uint32_t latency_interval;  // every n-th spawn is traced until its frame is visible, 0 = no tracing
+        bool alloc_report;          // report the allocations per subsystem and frame, requires PARTICLES_ALLOC_TRACKER
+        uint32_t alloc_steady_frame;// first frame that must not allocate on the render thread, 0 = allocations are allowed
+        uint32_t frames_in_flight;  // frames the CPU may record ahead of the GPU (2 or 3), the headless mode renders one frame at a time
+        bool late_latch;            // sample the camera right before the frame is submitted instead of at the beginning of the frame
+        const char* checkpoint_path;// checkpoint of the pool and the static scene, saved on F5 and restored on F6, nullptr = default path
     };
 
     struct DirectionalLight
@@ -189,16 +247,31 @@ public:
         glm::mat4 light_MVP;
     };
 
+    // values of a single draw of the static scene, they are pushed as push constants
+    struct DrawConstants
+    {
+        uint32_t material;          // index of the material and the texture
+    };
+
+    enum CheckpointRequest : uint32_t
+    {
+        CHECKPOINT_NONE = 0,
+        CHECKPOINT_SAVE = 1,
+        CHECKPOINT_RESTORE = 2
+    };
+
 private:
 
     /* STATIC PRIVATE MEMBERS */
     inline static Config _config;   // config must be global and there will only be one instance
+    inline static std::atomic<uint32_t> checkpoint_request{ CHECKPOINT_NONE };  // handled by the application thread between two ticks
 
     /* GLFW VARIABLES */
     const GLFWvidmode* vmode;
     GLFWwindow* window;
     int width, height, posx, posy;
     double render_time = 0.0;
+    std::chrono::steady_clock::time_point camera_sample_time;   // the age of the camera at the submission is recorded as "input_to_submit_us"
 
     /* VULKAN VARIABLES */
     VkApplicationInfo app_info;
@@ -211,8 +284,11 @@ private:
     VkQueue graphics_queue;
 
     OnscreenRenderPass onscreen_renderpass;
+    OffscreenRenderPass offscreen_renderpass;
+    bool headless;
     ShadowMap directional_shadow_map;
 
+    // one descriptor set each, the frames in flight bind their slot of the uniform ring with dynamic offsets
     DescriptorManager main_descr_manager;
     DescriptorManager dir_shadow_descr_manager;
 
@@ -224,9 +300,6 @@ private:
     VkPipeline pipeline_dir_shadow;
 
     VkCommandPool command_pool;
-    std::vector<VkCommandBuffer> primary_command_buffers;
-    VkCommandBuffer static_scene_command_buffer;
-    VkCommandBuffer dir_shadow_command_buffer;
 
     // floor
     std::vector<vka::vertex323_t> floor_vertices;
@@ -240,21 +313,95 @@ private:
     vka::Buffer fountain_vertex_buffer, fountain_index_buffer;
     vka::Texture fountain_texture;
 
-    // uniform buffers
-    vka::Buffer tm_buffer;  // transform matrices buffer
-    vka::Buffer directional_light_buffer;
-    vka::Buffer material_buffer;
-    vka::Buffer fragment_variables_buffer;
-    vka::Buffer tm_buffer_dir_shadow;
+    // Uniform ring: one persistently mapped buffer with the materials at the beginning, they are only written at
+    // initialization, followed by one slot per frame in flight with the uniforms that are written every frame.
+    // A slot is only written after the fence of its frame has been waited for.
+    enum UniformSlotEntry : uint32_t
+    {
+        UNIFORM_TM = 0,                 // TransformMatrices
+        UNIFORM_DIRECTIONAL_LIGHTS,     // DirectionalLight[N_DIRECTIONAL_LIGHTS]
+        UNIFORM_FRAGMENT_VARIABLES,     // FragmentVariables
+        UNIFORM_TM_DIR_SHADOW,          // ShadowTransformMatrices
+        UNIFORM_SLOT_ENTRIES
+    };
+    vka::Buffer uniform_ring;
+    uint8_t* uniform_map;
+    VkDeviceSize uniform_slot_base;                             // offset of the slot of the first frame
+    VkDeviceSize uniform_slot_stride;
+    VkDeviceSize uniform_entry_offsets[UNIFORM_SLOT_ENTRIES];   // offsets inside of a slot, aligned to minUniformBufferOffsetAlignment
+
+    // Resources of a frame in flight. The CPU records up to 'frames_in_flight' frames ahead of the GPU and
+    // only waits for the fence of the frame whose resources are reused.
+    struct FrameResources
+    {
+        VkSemaphore image_ready, rendering_done;
+        VkFence fence;                  // signaled when the GPU has finished the frame
+        std::vector<VkCommandBuffer> primary_command_buffers;   // one per framebuffer
+        VkCommandBuffer static_scene_command_buffer;
+        VkCommandBuffer dir_shadow_command_buffer;
+        bool queries_used;              // the query region can only be read back after it has been submitted once
+        uint64_t latency_token;         // frame of the spawn latency tracer, 0 = no traced spawns in flight
+    };
+    FrameResources frame_resources[ParticlesConstants::MAX_FRAMES_IN_FLIGHT];
+    uint32_t frames_in_flight;
+    uint32_t frame_index;               // frame in flight that is recorded next
+
+    // GPU queries: every frame in flight has its own query region with the timestamps (begin, shadow map done,
+    // main pass done) and optionally a pipeline statistics query of the main pass.
+    // A region is read back after the fence of its frame has been waited for, right before the frame is reused.
+    constexpr static uint32_t N_TIMESTAMPS = 3;
+    constexpr static uint32_t N_PIPELINE_STATISTICS = 3;
+    constexpr static VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    struct GpuFrameStatistics
+    {
+        double shadow_ms;           // directional shadow map pass
+        double main_ms;             // main pass, static scene and particles
+        double total_ms;
+        bool has_invocations;       // 'false' if the pipeline statistics are disabled or not available yet
+        uint64_t invocations[N_PIPELINE_STATISTICS];   // vertex, geometry (particles only) and fragment shader invocations of the main pass
+    };
 
-    VkSemaphore image_ready, rendering_done;
-    VkFence render_fence;
+    VkQueryPool timestamp_pool;
+    VkQueryPool statistics_pool;
+    bool pipeline_statistics;   // the device supports pipeline statistics and inherited queries and they are enabled
+    float timestamp_period;     // nanoseconds per timestamp tick
+    uint64_t timestamp_mask;    // valid bits of a timestamp
+    GpuFrameStatistics gpu_statistics;      // latest frame that has been read back
+    bool gpu_statistics_valid;
+    double gpu_statistics_time;             // last update of the window title
+
+    // headless mode: the color attachment is copied into a ring of host visible buffers and encoded asynchronously
+    constexpr static uint32_t NO_READBACK = UINT32_MAX;
+    bool exporting;
+    vka::Buffer readback_buffers[ParticlesConstants::READBACK_SLOTS];
+    const uint8_t* readback_maps[ParticlesConstants::READBACK_SLOTS];
+    VkCommandBuffer readback_command_buffers[ParticlesConstants::READBACK_SLOTS];
+    particles::FrameExporter frame_exporter;
+
+    // scripted mode: the scenario is played on the render thread in lockstep with the frames,
+    // the application thread is not started
+    bool scripted;
+    particles::ParticlePool scenario_pool;
+    particles::StaticParticleEngine scenario_engine;
+    particles::ScenarioRunner scenario_runner;
+
+    metrics::ShmMetricsPublisher metrics_publisher;
+    profiler::AllocFrameTracker alloc_frames;
 
     DirectionalLight directional_light;
     particles::ParticleRenderer particle_renderer;
     std::thread application_thread;
     std::atomic_bool renderer_shutdown;
 
+    // the camera is moved by the render thread, the application thread reads the copy that is published after every latch
+    mutable std::mutex camera_mtx;
+    glm::vec3 camera_pos;
+    glm::mat4 camera_vp;                    // projection * view
+
     void load_models(void);
     void load_floor(void);
     void load_fountain(void);
@@ -277,7 +424,7 @@ private:
     void init_main_descriptor_manager(void);
     void init_dir_shadow_descriptor_manager(void);
 
-    static void get_vertex323_descriptions(std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes);
+    static void get_vertex323_descriptions(std::pmr::vector<VkVertexInputBindingDescription>& bindings, std::pmr::vector<VkVertexInputAttributeDescription>& attributes);
     void create_pipeline(void);
     void create_shadow_pipelines(void);
 
@@ -290,24 +437,43 @@ private:
     void create_textures(void);
 
     void create_semaphores(void);
+    void create_query_pools(void);
+    void create_readback_buffers(void);
 
     void init_particles(void);
 
     void record_commands(void);
-    void record_static_scene(void);
-    void record_dir_shadow_map(void);
-    void record_primary_commands(void);
-
+    void record_static_scene(uint32_t frame);
+    void record_dir_shadow_map(uint32_t frame);
+    void record_primary_commands(uint32_t frame);
+    void record_readback_commands(void);
+    uint32_t uniform_offset(uint32_t frame, UniformSlotEntry entry) const noexcept { return static_cast<uint32_t>(this->uniform_slot_base + frame * this->uniform_slot_stride + this->uniform_entry_offsets[entry]); }
+    template<typename T>
+    T* uniform_slot(uint32_t frame, UniformSlotEntry entry) const noexcept { return reinterpret_cast<T*>(this->uniform_map + this->uniform_offset(frame, entry)); }
+    VkRenderPass main_render_pass(void) const noexcept { return this->headless ? this->offscreen_renderpass.render_pass : this->onscreen_renderpass.render_pass; }
+
+    void wait_frame(void);
     void draw_frame(void);
+    double draw_frame_headless(uint32_t readback_slot);
+    bool read_gpu_queries(uint32_t region, bool wait, GpuFrameStatistics& statistics);
+    void poll_spawn_latency(void);
+    void show_gpu_statistics(void);
+    void run_headless(void);
     void destroy_vulkan(void);
 
     glm::vec3 handle_move_keys(float speed, float yaw, const int keymap[6]);
     void mouse_action(GLFWwindow* window, int width, int height, double& yaw, double& pitch, float sensetivity);
     void move_action(GLFWwindow* window, glm::vec3& pos, const glm::vec3 velocity);
     void update_frame_contents(void);
+    void latch_camera(void);
+    glm::vec3 camera_position(void) const;  // thread safe
+    glm::mat4 camera_view_projection(void) const;   // thread safe
+
+    void init_scenario(void);
+    void end_scenario_frame(double frame_time, double cpu_time, double gpu_ms);
 
-    void update_lights(void);
-    void update_materials(void);
+    void update_lights(void);       // writes the lights into the slot of the current frame
+    void update_materials(void);    // MUST only be called while no frame is in flight
 
     static float get_depth_bias(float bias, uint32_t depth_bits);
 
@@ -327,4 +493,7 @@ public:
     void shutdown(void);
 
     inline static Config& config(void) { return _config; };
+
+    /** @brief Saves or restores a checkpoint at the next tick of the application thread, can be called from any thread. */
+    inline static void request_checkpoint(CheckpointRequest request) { checkpoint_request = request; }
 };
@@ -0,0 +1,145 @@
+#include "../VulkanApp.h"
+
+void OffscreenRenderPass::init_attachments(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_fam_index, uint32_t width, uint32_t height)
+{
+    this->color_attachment.set_image_format(ParticlesConstants::SWAPCHAIN_FORMAT);
+    this->color_attachment.set_image_extent({ width, height });
+    this->color_attachment.set_image_samples(VK_SAMPLE_COUNT_1_BIT);
+    this->color_attachment.set_image_usage(ParticlesConstants::OFFSCREEN_IMAGE_USAGE);
+    this->color_attachment.set_image_queue_family_index(queue_fam_index);
+    this->color_attachment.set_view_format(ParticlesConstants::SWAPCHAIN_FORMAT);
+    this->color_attachment.set_view_components({});
+    this->color_attachment.set_view_aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT);
+    this->color_attachment.set_physical_device(physical_device);
+    this->color_attachment.set_device(device);
+    VULKAN_ASSERT(this->color_attachment.create());
+
+    this->depth_attachment.set_image_format(ParticlesConstants::DEPTH_FORMAT);
+    this->depth_attachment.set_image_extent({ width, height });
+    this->depth_attachment.set_image_samples(VK_SAMPLE_COUNT_1_BIT);
+    this->depth_attachment.set_image_usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    this->depth_attachment.set_image_queue_family_index(queue_fam_index);
+    this->depth_attachment.set_view_format(ParticlesConstants::DEPTH_FORMAT);
+    this->depth_attachment.set_view_components({});
+    this->depth_attachment.set_view_aspect_mask(VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT);
+    this->depth_attachment.set_physical_device(physical_device);
+    this->depth_attachment.set_device(device);
+    VULKAN_ASSERT(this->depth_attachment.create());
+}
+
+void OffscreenRenderPass::init_render_pass(VkDevice device)
+{
+    constexpr static size_t ATTACHMENT_COUNT = 2;
+    constexpr static size_t DEPENDENCY_COUNT = 2;
+
+    VkAttachmentDescription attachment_descr[ATTACHMENT_COUNT];
+    attachment_descr[0] = {};
+    attachment_descr[0].flags = 0;
+    attachment_descr[0].format = ParticlesConstants::SWAPCHAIN_FORMAT;
+    attachment_descr[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment_descr[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment_descr[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment_descr[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment_descr[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment_descr[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment_descr[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    attachment_descr[1] = {};
+    attachment_descr[1].flags = 0;
+    attachment_descr[1].format = ParticlesConstants::DEPTH_FORMAT;
+    attachment_descr[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment_descr[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment_descr[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment_descr[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment_descr[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment_descr[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment_descr[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference attachment_references[ATTACHMENT_COUNT];
+    attachment_references[0].attachment = 0;
+    attachment_references[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    attachment_references[1].attachment = 1;
+    attachment_references[1].layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.flags = 0;
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.inputAttachmentCount = 0;
+    subpass.pInputAttachments = nullptr;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = attachment_references + 0;
+    subpass.pResolveAttachments = nullptr;
+    subpass.pDepthStencilAttachment = attachment_references + 1;
+    subpass.preserveAttachmentCount = 0;
+    subpass.pPreserveAttachments = nullptr;
+
+    // the previous frame may still read the color attachment (readback), the next transfer waits for the frame
+    VkSubpassDependency subpass_dependencies[DEPENDENCY_COUNT];
+    subpass_dependencies[0] = {};
+    subpass_dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    subpass_dependencies[0].dstSubpass = 0;
+    subpass_dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    subpass_dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    subpass_dependencies[0].srcAccessMask = 0;
+    subpass_dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    subpass_dependencies[0].dependencyFlags = 0;
+
+    subpass_dependencies[1] = {};
+    subpass_dependencies[1].srcSubpass = 0;
+    subpass_dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    subpass_dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpass_dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    subpass_dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpass_dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    subpass_dependencies[1].dependencyFlags = 0;
+
+    VkRenderPassCreateInfo renderpass_create_info = {};
+    renderpass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderpass_create_info.pNext = nullptr;
+    renderpass_create_info.flags = 0;
+    renderpass_create_info.attachmentCount = ATTACHMENT_COUNT;
+    renderpass_create_info.pAttachments = attachment_descr;
+    renderpass_create_info.subpassCount = 1;
+    renderpass_create_info.pSubpasses = &subpass;
+    renderpass_create_info.dependencyCount = DEPENDENCY_COUNT;
+    renderpass_create_info.pDependencies = subpass_dependencies;
+
+    VULKAN_ASSERT(vkCreateRenderPass(device, &renderpass_create_info, nullptr, &this->render_pass));
+}
+
+void OffscreenRenderPass::init_fbo(VkDevice device, uint32_t width, uint32_t height)
+{
+    VkImageView attachments[2] = {
+        this->color_attachment.view(),
+        this->depth_attachment.view()
+    };
+
+    VkFramebufferCreateInfo fbo_create_info = {};
+    fbo_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fbo_create_info.pNext = nullptr;
+    fbo_create_info.flags = 0;
+    fbo_create_info.renderPass = this->render_pass;
+    fbo_create_info.attachmentCount = 2;
+    fbo_create_info.pAttachments = attachments;
+    fbo_create_info.width = width;
+    fbo_create_info.height = height;
+    fbo_create_info.layers = 1;
+
+    VULKAN_ASSERT(vkCreateFramebuffer(device, &fbo_create_info, nullptr, &this->fbo));
+}
+
+void OffscreenRenderPass::init(VkPhysicalDevice physical_device, VkDevice device, uint32_t queue_fam_index, uint32_t width, uint32_t height)
+{
+    this->init_attachments(physical_device, device, queue_fam_index, width, height);
+    this->init_render_pass(device);
+    this->init_fbo(device, width, height);
+}
+
+void OffscreenRenderPass::clear(VkDevice device)
+{
+    vkDestroyFramebuffer(device, this->fbo, nullptr);
+    vkDestroyRenderPass(device, this->render_pass, nullptr);
+    this->depth_attachment.clear();
+    this->color_attachment.clear();
+}
\ No newline at end of file
@@ -91,12 +91,13 @@ void OnscreenRenderPass::init_render_pass(VkDevice device)
     subpass.preserveAttachmentCount = 0;
     subpass.pPreserveAttachments = nullptr;
 
+    // the depth attachment is shared by the frames in flight, the previous frame may still write it
     VkSubpassDependency subpass_dependency = {};
     subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     subpass_dependency.dstSubpass = 0;
-    subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
     subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    subpass_dependency.srcAccessMask = 0;
+    subpass_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
     subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
     subpass_dependency.dependencyFlags = 0;
 
@@ -118,7 +119,7 @@ void OnscreenRenderPass::init_fbos(VkDevice device, uint32_t width, uint32_t hei
 {
     for (size_t i = 0; i < this->views.size(); i++)
     {
-        std::vector<VkImageView> attachments = {
+        const VkImageView attachments[2] = {
             this->views[i],
             this->depth_attachment.view()
         };
@@ -128,8 +129,8 @@ void OnscreenRenderPass::init_fbos(VkDevice device, uint32_t width, uint32_t hei
         fbo_create_info.pNext = nullptr;
         fbo_create_info.flags = 0;
         fbo_create_info.renderPass = this->render_pass;
-        fbo_create_info.attachmentCount = attachments.size();
-        fbo_create_info.pAttachments = attachments.data();
+        fbo_create_info.attachmentCount = 2;
+        fbo_create_info.pAttachments = attachments;
         fbo_create_info.width = width;
         fbo_create_info.height = height;
         fbo_create_info.layers = 1;
@@ -69,14 +69,27 @@ void ShadowMap::init_render_pass(VkDevice device)
     shadow_subpass.preserveAttachmentCount = 0;
     shadow_subpass.pPreserveAttachments = nullptr;
 
-    VkSubpassDependency shadow_dependency = {};
-    shadow_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    shadow_dependency.dstSubpass = 0;
-    shadow_dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    shadow_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    shadow_dependency.srcAccessMask = 0;
-    shadow_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    shadow_dependency.dependencyFlags = 0;
+    // There is only one shadow map for all frames in flight: the previous frame may still write or sample it,
+    // and the main pass of the same frame must wait until it is written.
+    constexpr static size_t DEPENDENCY_COUNT = 2;
+    VkSubpassDependency shadow_dependencies[DEPENDENCY_COUNT];
+    shadow_dependencies[0] = {};
+    shadow_dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    shadow_dependencies[0].dstSubpass = 0;
+    shadow_dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    shadow_dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    shadow_dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    shadow_dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    shadow_dependencies[0].dependencyFlags = 0;
+
+    shadow_dependencies[1] = {};
+    shadow_dependencies[1].srcSubpass = 0;
+    shadow_dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    shadow_dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    shadow_dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    shadow_dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    shadow_dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    shadow_dependencies[1].dependencyFlags = 0;
 
     VkRenderPassCreateInfo shadow_renderpass_create_info = {};
     shadow_renderpass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -86,8 +99,8 @@ void ShadowMap::init_render_pass(VkDevice device)
     shadow_renderpass_create_info.pAttachments = &attachment;
     shadow_renderpass_create_info.subpassCount = 1;
     shadow_renderpass_create_info.pSubpasses = &shadow_subpass;
-    shadow_renderpass_create_info.dependencyCount = 1;
-    shadow_renderpass_create_info.pDependencies = &shadow_dependency;
+    shadow_renderpass_create_info.dependencyCount = DEPENDENCY_COUNT;
+    shadow_renderpass_create_info.pDependencies = shadow_dependencies;
 
     VULKAN_ASSERT(vkCreateRenderPass(device, &shadow_renderpass_create_info, nullptr, &this->render_pass));
 }
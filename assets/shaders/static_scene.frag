@@ -24,7 +24,6 @@ struct Material
 layout (location = 0) in vec3 f_pos;
 layout (location = 1) in vec2 f_texcoord;
 layout (location = 2) in vec3 f_normal;
-layout (location = 3) in flat uint f_instanceID;
 layout (location = 4) in vec4 f_light_space_pos;
 
 // ---------------------------- OUTPUT ----------------------------
@@ -33,6 +32,12 @@ layout (location = 0) out vec4 out_color;
 
 // ---------------------------- UNIFORMS ----------------------------
 
+// values of the current draw
+layout (push_constant) uniform DrawConstants
+{
+    uint material;
+} draw;
+
 // samplers
 layout (set = 0, binding = 1) uniform sampler2D tex[2];
 
@@ -190,18 +195,18 @@ float shadow_value(vec4 light_space_pos, int samples, float penumbra_size, float
 void main()
 {
 #if DISPLAY_SHADOW_MAP
-    out_color = vec4(texture(tex[f_instanceID], f_texcoord).rrr, 1.0f);
+    out_color = vec4(texture(tex[draw.material], f_texcoord).rrr, 1.0f);
 #else
-    vec4 tex_color = texture(tex[f_instanceID], f_texcoord);
+    vec4 tex_color = texture(tex[draw.material], f_texcoord);
     vec3 view_vec = fragment_variables.cam_pos - f_pos;
     float NdotL = dot(f_normal, normalize(-dlu.lights[0].direction));
 
     float shadow = shadow_value(f_light_space_pos, fragment_variables.shadow_samples, fragment_variables.shadow_penumbra_size, NdotL);
 
-    vec3 light_intensity = directional_light(dlu.lights[0], mtlu.materials[f_instanceID], view_vec, f_normal) * shadow;
-    vec3 hdr_color = (light_intensity + mtlu.materials[f_instanceID].albedo) * tex_color.rgb;
+    vec3 light_intensity = directional_light(dlu.lights[0], mtlu.materials[draw.material], view_vec, f_normal) * shadow;
+    vec3 hdr_color = (light_intensity + mtlu.materials[draw.material].albedo) * tex_color.rgb;
     vec3 ldr_color = hdr_color / (hdr_color + vec3(1.0f));
 
-    out_color = vec4(ldr_color, tex_color.a * mtlu.materials[f_instanceID].alpha);
+    out_color = vec4(ldr_color, tex_color.a * mtlu.materials[draw.material].alpha);
 #endif
 }
\ No newline at end of file
@@ -8,7 +8,6 @@ layout (location = 2) in vec3 a_normal;
 layout (location = 0) out vec3 f_pos;
 layout (location = 1) out vec2 f_texcoord;
 layout (location = 2) out vec3 f_normal;
-layout (location = 3) out flat uint f_instanceID;
 layout (location = 4) out vec4 f_light_space_pos;
 
 layout (set = 0, binding = 0) uniform TransformMatrices
@@ -24,5 +23,4 @@ void main()
     f_pos = a_pos;
     f_texcoord = a_texcoord;
     f_normal = a_normal;
-    f_instanceID = gl_InstanceIndex;
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "VulkanApp.h"
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
-int main()
+int main(int argc, char** argv)
 {
     ParticlesApp app;
     ParticlesApp::Config cfg;
@@ -13,6 +15,96 @@ int main()
     cfg.cam.pitch = 0.0;
     cfg.movement_speed = 3.0f;
     cfg.sesitivity = 0.0008f;
+    cfg.record_path = nullptr;
+    cfg.shm_feed = nullptr;
+    cfg.point_cloud = nullptr;
+    cfg.paged_path = nullptr;
+    cfg.fountain_particles = 0;
+    cfg.bake_path = nullptr;
+    cfg.playback_path = nullptr;
+    cfg.headless_frames = 0;
+    cfg.report_path = nullptr;
+    cfg.export_path = nullptr;
+    cfg.scenario_path = nullptr;
+    cfg.timing_path = nullptr;
+    cfg.trace_path = nullptr;
+    cfg.pipeline_statistics = false;
+    cfg.metrics_name = nullptr;
+    cfg.latency_interval = 0;
+    cfg.alloc_report = false;
+    cfg.alloc_steady_frame = 0;
+    cfg.frames_in_flight = 2;
+    cfg.late_latch = true;
+    cfg.checkpoint_path = nullptr;
+
+    // --record <file>: records the session, it can be replayed headless with 'particles_replay'
+    // --shm <name>:    ingests particles from a shared memory feed, e.g. from 'particles_shm_producer'
+    // --points <file>: streams a chunked point cloud, e.g. from 'particles_ply_convert'
+    // --paged <file>:  pages a particle dataset for the view of the camera, e.g. from 'particles_ply_convert --pages'
+    // --fountain <n>:  simulates a fountain of n particles with gravity, drag and the floor as collider
+    // --bake <file>:   captures the particles of every application tick into a baked cache
+    // --playback <file>: plays a baked cache in a loop, e.g. from '--bake'
+    // --headless <n>:  renders n frames offscreen without a window and reports the timings as JSON
+    // --report <file>: writes the JSON report of the headless mode to a file instead of stdout
+    // --export <path>: exports the headless frames, "<file>.y4m" or an image pattern like "frame_%05u.png"
+    // --scenario <file>: plays a scenario file with scripted emitters and camera path instead of the interactive scene
+    // --timing <file>: writes the timing of every scenario frame as CSV
+    // --trace <file>:  writes the profiler zones as Chrome trace at shutdown, F9 writes them at any time
+    // --pipeline-stats: queries the shader invocations of the main pass (window title or headless report)
+    // --metrics <name>: publishes live metrics into shared memory, they can be read with 'particles_metrics'
+    // --latency <n>:   traces every n-th spawn until its frame is submitted, presented and done on the GPU, reports p50/p99
+    // --alloc-report:  reports the allocations per subsystem and frame (build with PARTICLES_ALLOC_TRACKER)
+    // --no-alloc <n>:  aborts at the first allocation of the render thread in a frame after the first n frames
+    // --frames-in-flight <n>: frames the CPU may record ahead of the GPU, 2 (default) or 3
+    // --no-late-latch: samples the camera at the beginning of the frame instead of right before its submission
+    // --checkpoint <file>: checkpoint of the pool and the static scene, F5 saves it and F6 restores it (in a session with the same options)
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--pipeline-stats") == 0)
+            cfg.pipeline_statistics = true;
+        else if (std::strcmp(argv[i], "--alloc-report") == 0)
+            cfg.alloc_report = true;
+        else if (std::strcmp(argv[i], "--no-late-latch") == 0)
+            cfg.late_latch = false;
+        else if (i + 1 == argc)
+            break;
+        else if (std::strcmp(argv[i], "--record") == 0)
+            cfg.record_path = argv[++i];
+        else if (std::strcmp(argv[i], "--shm") == 0)
+            cfg.shm_feed = argv[++i];
+        else if (std::strcmp(argv[i], "--points") == 0)
+            cfg.point_cloud = argv[++i];
+        else if (std::strcmp(argv[i], "--paged") == 0)
+            cfg.paged_path = argv[++i];
+        else if (std::strcmp(argv[i], "--fountain") == 0)
+            cfg.fountain_particles = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--bake") == 0)
+            cfg.bake_path = argv[++i];
+        else if (std::strcmp(argv[i], "--playback") == 0)
+            cfg.playback_path = argv[++i];
+        else if (std::strcmp(argv[i], "--headless") == 0)
+            cfg.headless_frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--report") == 0)
+            cfg.report_path = argv[++i];
+        else if (std::strcmp(argv[i], "--export") == 0)
+            cfg.export_path = argv[++i];
+        else if (std::strcmp(argv[i], "--scenario") == 0)
+            cfg.scenario_path = argv[++i];
+        else if (std::strcmp(argv[i], "--timing") == 0)
+            cfg.timing_path = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0)
+            cfg.trace_path = argv[++i];
+        else if (std::strcmp(argv[i], "--metrics") == 0)
+            cfg.metrics_name = argv[++i];
+        else if (std::strcmp(argv[i], "--latency") == 0)
+            cfg.latency_interval = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--no-alloc") == 0)
+            cfg.alloc_steady_frame = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0)
+            cfg.frames_in_flight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--checkpoint") == 0)
+            cfg.checkpoint_path = argv[++i];
+    }
 
     try
     {
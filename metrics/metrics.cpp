@@ -0,0 +1,153 @@
+#include "metrics.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace metrics;
+
+namespace
+{
+    uint32_t highest_bit(uint64_t x) noexcept
+    {
+        uint32_t bit = 0;
+        while (x >>= 1) bit++;
+        return bit;
+    }
+};
+
+uint32_t metrics::histogram_bucket(uint64_t value) noexcept
+{
+    // values below HISTOGRAM_SUB_BUCKETS have their own bucket, bigger values keep HISTOGRAM_SUB_BITS significant bits
+    value = std::min(value, HISTOGRAM_MAX_VALUE);
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return static_cast<uint32_t>(value);
+    const uint32_t shift = highest_bit(value) - HISTOGRAM_SUB_BITS;
+    return shift * HISTOGRAM_SUB_BUCKETS + static_cast<uint32_t>(value >> shift);
+}
+
+uint64_t metrics::histogram_bucket_lower(uint32_t bucket) noexcept
+{
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+    const uint32_t shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    return static_cast<uint64_t>(bucket - shift * HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+uint64_t metrics::histogram_bucket_upper(uint32_t bucket) noexcept
+{
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+    const uint32_t shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    return (static_cast<uint64_t>(bucket - shift * HISTOGRAM_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+uint64_t metrics::histogram_percentile(const uint64_t* buckets, double p) noexcept
+{
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        count += buckets[i];
+    if (count == 0)
+        return 0;
+
+    // rank of the percentile, 1-based
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::min(std::max(p, 0.0), 1.0) * count + 0.5));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return histogram_bucket_upper(i);
+    }
+    return HISTOGRAM_MAX_VALUE;
+}
+
+Histogram::Histogram(void) noexcept
+{
+    for (std::atomic<uint64_t>& bucket : this->buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    this->_count.store(0, std::memory_order_relaxed);
+    this->_sum.store(0, std::memory_order_relaxed);
+    this->_max.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::record(uint64_t value) noexcept
+{
+    value = std::min(value, HISTOGRAM_MAX_VALUE);
+    this->buckets[histogram_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    this->_count.fetch_add(1, std::memory_order_relaxed);
+    this->_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = this->_max.load(std::memory_order_relaxed);
+    while (value > max && !this->_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+void Histogram::snapshot(uint64_t* buckets, uint64_t& count, uint64_t& sum, uint64_t& max) const noexcept
+{
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        buckets[i] = this->buckets[i].load(std::memory_order_relaxed);
+    count = this->_count.load(std::memory_order_relaxed);
+    sum = this->_sum.load(std::memory_order_relaxed);
+    max = this->_max.load(std::memory_order_relaxed);
+}
+
+void* Registry::find(const char* name, metric_kind_t kind) const
+{
+    for (const entry_t& entry : this->entries)
+    {
+        if (entry.name != name) continue;
+        if (entry.kind != kind)
+            throw std::invalid_argument("Metric \"" + std::string(name) + "\" has already been registered with another kind.");
+        return const_cast<void*>(entry.metric);
+    }
+    if (std::string(name).size() > MAX_NAME_LENGTH)
+        throw std::invalid_argument("Name of metric \"" + std::string(name) + "\" is too long.");
+    return nullptr;
+}
+
+Counter& Registry::counter(const char* name)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (void* metric = this->find(name, KIND_COUNTER))
+        return *static_cast<Counter*>(metric);
+    this->counters.emplace_back();
+    this->entries.push_back({ name, KIND_COUNTER, &this->counters.back() });
+    return this->counters.back();
+}
+
+Gauge& Registry::gauge(const char* name)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (void* metric = this->find(name, KIND_GAUGE))
+        return *static_cast<Gauge*>(metric);
+    this->gauges.emplace_back();
+    this->entries.push_back({ name, KIND_GAUGE, &this->gauges.back() });
+    return this->gauges.back();
+}
+
+Histogram& Registry::histogram(const char* name)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (void* metric = this->find(name, KIND_HISTOGRAM))
+        return *static_cast<Histogram*>(metric);
+    this->histograms.emplace_back();
+    this->entries.push_back({ name, KIND_HISTOGRAM, &this->histograms.back() });
+    return this->histograms.back();
+}
+
+void Registry::list(std::vector<entry_t>& entries) const
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    entries = this->entries;
+}
+
+size_t Registry::size(void) const
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->entries.size();
+}
+
+Registry& metrics::registry(void)
+{
+    // never destroyed, metrics may still be updated during static destruction
+    static Registry* r = new Registry;
+    return *r;
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+*   Live metrics of the process: counters, gauges and HDR histograms.
+*   Metrics are registered once (with a lock), afterwards they are updated lock-free from any thread, e.g.
+*       static metrics::Histogram& frame_us = metrics::registry().histogram("frame_us");
+*       frame_us.record(us);
+*   The registry is published into shared memory by a metrics::ShmMetricsPublisher (see metrics_shm.h).
+*/
+namespace metrics
+{
+    enum metric_kind_t : uint32_t
+    {
+        KIND_COUNTER = 1,       // monotonic unsigned integer
+        KIND_GAUGE = 2,         // double that is set to the current value
+        KIND_HISTOGRAM = 3      // distribution of unsigned integers, e.g. durations in microseconds
+    };
+
+    /** @brief Maximum length of the name of a metric. */
+    constexpr uint32_t MAX_NAME_LENGTH = 47;
+
+    /**
+    *   Histograms are log-linear like HDR histograms: every power of 2 is split into 2^HISTOGRAM_SUB_BITS
+    *   buckets, so the relative error of a value is below 2^-HISTOGRAM_SUB_BITS (about 3%).
+    *   Values are clamped to 32 bits, e.g. about 71 minutes in microseconds.
+    */
+    constexpr uint32_t HISTOGRAM_SUB_BITS = 5;
+    constexpr uint32_t HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+    constexpr uint32_t HISTOGRAM_BUCKETS = (33 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB_BUCKETS;
+    constexpr uint64_t HISTOGRAM_MAX_VALUE = UINT32_MAX;
+
+    /** @return The bucket of @param value. */
+    uint32_t histogram_bucket(uint64_t value) noexcept;
+
+    /** @return The smallest value of @param bucket. */
+    uint64_t histogram_bucket_lower(uint32_t bucket) noexcept;
+
+    /** @return The biggest value of @param bucket. */
+    uint64_t histogram_bucket_upper(uint32_t bucket) noexcept;
+
+    /**
+    *   @brief Computes a percentile of a histogram.
+    *   @param buckets: HISTOGRAM_BUCKETS bucket counts
+    *   @param p: Percentile in the range [0, 1]
+    *   @return The upper bound of the bucket that contains the percentile, 0 if the histogram is empty.
+    */
+    uint64_t histogram_percentile(const uint64_t* buckets, double p) noexcept;
+
+    class Counter
+    {
+    private:
+        std::atomic<uint64_t> _value;
+
+    public:
+        Counter(void) noexcept : _value(0) {}
+
+        void add(uint64_t n = 1) noexcept       { this->_value.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t value(void) const noexcept     { return this->_value.load(std::memory_order_relaxed); }
+    };
+
+    class Gauge
+    {
+    private:
+        std::atomic<double> _value;
+
+    public:
+        Gauge(void) noexcept : _value(0.0) {}
+
+        void set(double value) noexcept         { this->_value.store(value, std::memory_order_relaxed); }
+        double value(void) const noexcept       { return this->_value.load(std::memory_order_relaxed); }
+    };
+
+    class Histogram
+    {
+    private:
+        std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _sum;
+        std::atomic<uint64_t> _max;
+
+    public:
+        Histogram(void) noexcept;
+
+        /** @brief Records @param value, it is clamped to HISTOGRAM_MAX_VALUE. */
+        void record(uint64_t value) noexcept;
+
+        /**
+        *   @brief Copies the histogram. The copy is not atomic, values that are recorded during the copy
+        *          may be counted in the buckets but not in the count or vice versa.
+        *   @param buckets: Returns HISTOGRAM_BUCKETS bucket counts
+        */
+        void snapshot(uint64_t* buckets, uint64_t& count, uint64_t& sum, uint64_t& max) const noexcept;
+
+        uint64_t count(void) const noexcept     { return this->_count.load(std::memory_order_relaxed); }
+    };
+
+    /**
+    *   Class: ScopedTimer
+    *   @brief Records the microseconds between its construction and destruction into a histogram.
+    */
+    class ScopedTimer
+    {
+    private:
+        Histogram& histogram;
+        std::chrono::steady_clock::time_point begin;
+
+    public:
+        explicit ScopedTimer(Histogram& histogram) noexcept : histogram(histogram), begin(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer(void)  { this->histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->begin).count()); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator= (const ScopedTimer&) = delete;
+    };
+
+    /**
+    *   Class: Registry
+    *   @brief Owns the metrics of the process, metrics live as long as the registry.
+    *          Registering a metric that already exists returns the existing one.
+    */
+    class Registry
+    {
+    public:
+        struct entry_t
+        {
+            std::string name;
+            metric_kind_t kind;
+            const void* metric;     // Counter, Gauge or Histogram depending on 'kind'
+        };
+
+    private:
+        mutable std::mutex mtx;
+        std::deque<Counter> counters;
+        std::deque<Gauge> gauges;
+        std::deque<Histogram> histograms;
+        std::vector<entry_t> entries;
+
+        void* find(const char* name, metric_kind_t kind) const;
+
+    public:
+        Counter& counter(const char* name);
+        Gauge& gauge(const char* name);
+        Histogram& histogram(const char* name);
+
+        /** @brief Copies the entries of every registered metric into @param entries, in registration order. */
+        void list(std::vector<entry_t>& entries) const;
+
+        /** @return The number of registered metrics. */
+        size_t size(void) const;
+    };
+
+    /** @return The registry of the process. */
+    Registry& registry(void);
+};
\ No newline at end of file
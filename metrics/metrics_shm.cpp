@@ -0,0 +1,313 @@
+#include "metrics_shm.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace metrics;
+
+namespace
+{
+    constexpr char SHM_METRICS_MAGIC[4] = { 'P', 'M', 'E', 'T' };
+    constexpr uint32_t SHM_METRICS_VERSION = 1;
+    constexpr size_t SHM_METRICS_ALIGNMENT = 64;
+    constexpr uint32_t MAX_READ_ATTEMPTS = 16;
+
+    size_t align_up(size_t x, size_t alignment) { return (x + alignment - 1) & ~(alignment - 1); }
+
+    size_t metrics_offset(void) { return align_up(sizeof(shm_metrics_header_t), SHM_METRICS_ALIGNMENT); }
+
+    size_t histograms_offset(uint32_t max_metrics)
+    {
+        return align_up(metrics_offset() + max_metrics * sizeof(shm_metric_t), SHM_METRICS_ALIGNMENT);
+    }
+};
+
+size_t metrics::shm_metrics_size(uint32_t max_metrics, uint32_t max_histograms)
+{
+    return histograms_offset(max_metrics) + max_histograms * sizeof(shm_histogram_t);
+}
+
+// ------------------------ PUBLISHER ------------------------
+
+ShmMetricsPublisher::ShmMetricsPublisher(void)
+{
+    this->memory = nullptr;
+    this->size = 0;
+    this->header = nullptr;
+    this->registry = nullptr;
+    this->sequence = 0;
+    this->stopping = false;
+}
+
+ShmMetricsPublisher::~ShmMetricsPublisher(void)
+{
+    this->destroy();
+}
+
+void ShmMetricsPublisher::create(const char* name, const Registry& registry, uint32_t interval_ms, uint32_t max_metrics, uint32_t max_histograms)
+{
+#ifdef _WIN32
+    throw std::runtime_error("ShmMetricsPublisher requires POSIX shared memory.");
+#else
+    if (this->header != nullptr)
+        throw std::runtime_error("ShmMetricsPublisher has already been created.");
+    if (max_metrics == 0)
+        throw std::invalid_argument("Maximum number of metrics of ShmMetricsPublisher::create must be bigger than 0.");
+
+    const size_t size = shm_metrics_size(max_metrics, max_histograms);
+    const int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create shared memory \"" + std::string(name) + "\".");
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(name);
+        throw std::runtime_error("Failed to resize shared memory \"" + std::string(name) + "\".");
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name);
+        throw std::runtime_error("Failed to map shared memory \"" + std::string(name) + "\".");
+    }
+
+    this->name = name;
+    this->memory = memory;
+    this->size = size;
+    this->registry = &registry;
+    this->header = new (memory) shm_metrics_header_t;
+    this->header->version = SHM_METRICS_VERSION;
+    this->header->max_metrics = max_metrics;
+    this->header->max_histograms = max_histograms;
+    this->header->sequence.store(0, std::memory_order_relaxed);
+    this->header->publish_time = 0;
+    this->header->n_metrics = 0;
+    this->header->pid = static_cast<uint32_t>(getpid());
+    this->sequence = 0;
+
+    // the magic is written last, a reader only accepts a completely initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(this->header->magic, SHM_METRICS_MAGIC, sizeof(SHM_METRICS_MAGIC));
+
+    this->publish();
+    if (interval_ms > 0)
+    {
+        this->stopping = false;
+        this->publish_thread = std::thread(&ShmMetricsPublisher::publish_main, this, interval_ms);
+    }
+#endif
+}
+
+void ShmMetricsPublisher::destroy(void)
+{
+#ifndef _WIN32
+    if (this->publish_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->stopping = true;
+        }
+        this->stop_cv.notify_all();
+        this->publish_thread.join();
+    }
+    if (this->header != nullptr)
+    {
+        munmap(this->memory, this->size);
+        shm_unlink(this->name.c_str());
+        this->memory = nullptr;
+        this->header = nullptr;
+        this->registry = nullptr;
+        this->size = 0;
+    }
+#endif
+}
+
+void ShmMetricsPublisher::publish_main(uint32_t interval_ms)
+{
+    std::unique_lock<std::mutex> lock(this->mtx);
+    while (!this->stop_cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [this]() { return this->stopping; }))
+        this->publish();
+}
+
+void ShmMetricsPublisher::publish(void)
+{
+    if (this->header == nullptr)
+        throw std::runtime_error("ShmMetricsPublisher must be created before metrics can be published.");
+
+    // the registry is listed before the seqlock is taken, so the segment is odd as briefly as possible
+    std::vector<Registry::entry_t> entries;
+    this->registry->list(entries);
+
+    shm_metric_t* metrics = reinterpret_cast<shm_metric_t*>(static_cast<uint8_t*>(this->memory) + metrics_offset());
+    shm_histogram_t* histograms = reinterpret_cast<shm_histogram_t*>(static_cast<uint8_t*>(this->memory) + histograms_offset(this->header->max_metrics));
+
+    ++this->sequence;
+    this->header->sequence.store(2 * this->sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t n_metrics = 0, n_histograms = 0;
+    for (const Registry::entry_t& entry : entries)
+    {
+        if (n_metrics == this->header->max_metrics) break;
+        if (entry.kind == KIND_HISTOGRAM && n_histograms == this->header->max_histograms) continue;
+
+        shm_metric_t& metric = metrics[n_metrics++];
+        std::memset(metric.name, 0, sizeof(metric.name));
+        std::strncpy(metric.name, entry.name.c_str(), MAX_NAME_LENGTH);
+        metric.kind = entry.kind;
+        metric.histogram = 0;
+        metric.sum = 0;
+        metric.max = 0;
+        switch (entry.kind)
+        {
+        case KIND_COUNTER:
+            metric.value = static_cast<const Counter*>(entry.metric)->value();
+            break;
+        case KIND_GAUGE:
+        {
+            const double value = static_cast<const Gauge*>(entry.metric)->value();
+            std::memcpy(&metric.value, &value, sizeof(value));
+            break;
+        }
+        case KIND_HISTOGRAM:
+            metric.histogram = n_histograms;
+            static_cast<const Histogram*>(entry.metric)->snapshot(histograms[n_histograms++].buckets, metric.value, metric.sum, metric.max);
+            break;
+        }
+    }
+    this->header->n_metrics = n_metrics;
+    this->header->publish_time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+    this->header->sequence.store(2 * this->sequence, std::memory_order_release);
+}
+
+// ------------------------ READER ------------------------
+
+ShmMetricsReader::ShmMetricsReader(void)
+{
+    this->memory = nullptr;
+    this->size = 0;
+    this->header = nullptr;
+}
+
+ShmMetricsReader::~ShmMetricsReader(void)
+{
+    this->close();
+}
+
+void ShmMetricsReader::open(const char* name)
+{
+#ifdef _WIN32
+    throw std::runtime_error("ShmMetricsReader requires POSIX shared memory.");
+#else
+    if (this->header != nullptr)
+        throw std::runtime_error("ShmMetricsReader has already been opened.");
+
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open shared memory \"" + std::string(name) + "\".");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shm_metrics_header_t))
+    {
+        ::close(fd);
+        throw std::runtime_error("Shared memory \"" + std::string(name) + "\" is not a metrics segment.");
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Failed to map shared memory \"" + std::string(name) + "\".");
+
+    const shm_metrics_header_t* header = static_cast<const shm_metrics_header_t*>(memory);
+    if (std::memcmp(header->magic, SHM_METRICS_MAGIC, sizeof(SHM_METRICS_MAGIC)) != 0)
+    {
+        munmap(memory, size);
+        throw std::runtime_error("Shared memory \"" + std::string(name) + "\" is not a metrics segment.");
+    }
+    if (header->version != SHM_METRICS_VERSION)
+    {
+        munmap(memory, size);
+        throw std::runtime_error("Metrics segment \"" + std::string(name) + "\" has an unsupported version.");
+    }
+    if (shm_metrics_size(header->max_metrics, header->max_histograms) > size)
+    {
+        munmap(memory, size);
+        throw std::runtime_error("Metrics segment \"" + std::string(name) + "\" is truncated.");
+    }
+
+    this->memory = memory;
+    this->size = size;
+    this->header = header;
+#endif
+}
+
+void ShmMetricsReader::close(void)
+{
+#ifndef _WIN32
+    if (this->header != nullptr)
+    {
+        munmap(this->memory, this->size);
+        this->memory = nullptr;
+        this->header = nullptr;
+        this->size = 0;
+    }
+#endif
+}
+
+bool ShmMetricsReader::read(metrics_snapshot_t& snapshot) const
+{
+    if (this->header == nullptr)
+        throw std::runtime_error("ShmMetricsReader must be opened before metrics can be read.");
+
+    const shm_metric_t* metrics = reinterpret_cast<const shm_metric_t*>(static_cast<const uint8_t*>(this->memory) + metrics_offset());
+    const shm_histogram_t* histograms = reinterpret_cast<const shm_histogram_t*>(static_cast<const uint8_t*>(this->memory) + histograms_offset(this->header->max_metrics));
+
+    for (uint32_t attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++)
+    {
+        const uint64_t before = this->header->sequence.load(std::memory_order_acquire);
+        if (before == 0)
+            return false;
+        if (before & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const uint32_t n = std::min(this->header->n_metrics, this->header->max_metrics);
+        snapshot.sequence = before / 2;
+        snapshot.publish_time = this->header->publish_time;
+        snapshot.pid = this->header->pid;
+        snapshot.metrics.resize(n);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const shm_metric_t& src = metrics[i];
+            metric_snapshot_t& dst = snapshot.metrics[i];
+            dst.name.assign(src.name, strnlen(src.name, MAX_NAME_LENGTH));
+            dst.kind = static_cast<metric_kind_t>(src.kind);
+            dst.counter = src.value;
+            std::memcpy(&dst.gauge, &src.value, sizeof(dst.gauge));
+            dst.count = src.value;
+            dst.sum = src.sum;
+            dst.max = src.max;
+            if (dst.kind == KIND_HISTOGRAM && src.histogram < this->header->max_histograms)
+                dst.buckets.assign(histograms[src.histogram].buckets, histograms[src.histogram].buckets + HISTOGRAM_BUCKETS);
+            else
+                dst.buckets.clear();
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (this->header->sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace metrics
+{
+    /**
+    *   Layout of a shared memory metrics segment (POSIX shm_open / mmap):
+    *       header:         shm_metrics_header_t
+    *       metrics:        max_metrics x shm_metric_t
+    *       histograms:     max_histograms x shm_histogram_t
+    *
+    *   The publisher copies a snapshot of the registry into the segment. 'sequence' works like a seqlock:
+    *   it is odd while the snapshot is written and even afterwards. A reader copies the segment and retries
+    *   if the sequence was odd or has changed during the copy, so the publisher never waits for a reader.
+    */
+    struct shm_metrics_header_t
+    {
+        char magic[4];
+        uint32_t version;                   // layout version
+        uint32_t max_metrics;
+        uint32_t max_histograms;
+        std::atomic<uint64_t> sequence;
+        uint64_t publish_time;              // system time of the snapshot in milliseconds since the epoch
+        uint32_t n_metrics;
+        uint32_t pid;                       // process id of the publisher
+    };
+
+    struct shm_metric_t
+    {
+        char name[MAX_NAME_LENGTH + 1];
+        uint32_t kind;                      // metric_kind_t
+        uint32_t histogram;                 // index of the histogram, only for KIND_HISTOGRAM
+        uint64_t value;                     // counter value, bits of the gauge's double or count of the histogram
+        uint64_t sum;                       // histogram only
+        uint64_t max;                       // histogram only
+    };
+
+    struct shm_histogram_t
+    {
+        uint64_t buckets[HISTOGRAM_BUCKETS];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The shared memory metrics require lock-free 64-bit atomics.");
+
+    /** @brief A metric that has been read from a shared memory segment. */
+    struct metric_snapshot_t
+    {
+        std::string name;
+        metric_kind_t kind;
+        uint64_t counter;
+        double gauge;
+        uint64_t count, sum, max;           // histogram only
+        std::vector<uint64_t> buckets;      // histogram only, HISTOGRAM_BUCKETS bucket counts
+    };
+
+    struct metrics_snapshot_t
+    {
+        uint64_t sequence;                  // number of snapshots that have been published
+        uint64_t publish_time;              // milliseconds since the epoch
+        uint32_t pid;
+        std::vector<metric_snapshot_t> metrics;
+    };
+
+    /** @return The size of a shared memory metrics segment in bytes. */
+    size_t shm_metrics_size(uint32_t max_metrics, uint32_t max_histograms);
+
+    /**
+    *   Class: ShmMetricsPublisher
+    *   @brief Creates a shared memory metrics segment and periodically publishes a registry into it
+    *          on its own thread. Metrics that do not fit into the segment are not published.
+    */
+    class ShmMetricsPublisher
+    {
+    private:
+        std::string name;
+        void* memory;
+        size_t size;
+        shm_metrics_header_t* header;
+        const Registry* registry;
+        uint64_t sequence;
+
+        std::thread publish_thread;
+        std::mutex mtx;
+        std::condition_variable stop_cv;
+        bool stopping;
+
+        void publish_main(uint32_t interval_ms);
+
+    public:
+        constexpr static uint32_t DEFAULT_MAX_METRICS = 128;
+        constexpr static uint32_t DEFAULT_MAX_HISTOGRAMS = 32;
+        constexpr static uint32_t DEFAULT_INTERVAL_MS = 250;
+
+        ShmMetricsPublisher(void);
+        virtual ~ShmMetricsPublisher(void);
+
+        /**
+        *   @brief Creates the shared memory segment and starts publishing.
+        *   @param name: Name of the shared memory object, e.g. "/particles_metrics"
+        *   @param registry: Registry to publish, it must outlive the publisher
+        *   @param interval_ms: Milliseconds between two snapshots, 0 = only 'ShmMetricsPublisher::publish'
+        */
+        void create(const char* name, const Registry& registry, uint32_t interval_ms = DEFAULT_INTERVAL_MS,
+                    uint32_t max_metrics = DEFAULT_MAX_METRICS, uint32_t max_histograms = DEFAULT_MAX_HISTOGRAMS);
+
+        /** @brief Stops publishing, unmaps and unlinks the shared memory segment. */
+        void destroy(void);
+
+        /** @brief Publishes a snapshot immediately, must not be called concurrently. */
+        void publish(void);
+
+        /** @return 'true' if the segment has been created. */
+        bool created(void) const noexcept   { return (this->header != nullptr); }
+    };
+
+    /**
+    *   Class: ShmMetricsReader
+    *   @brief Maps an existing shared memory metrics segment read-only, e.g. in a monitoring tool.
+    */
+    class ShmMetricsReader
+    {
+    private:
+        void* memory;
+        size_t size;
+        const shm_metrics_header_t* header;
+
+    public:
+        ShmMetricsReader(void);
+        virtual ~ShmMetricsReader(void);
+
+        /** @brief Maps the segment with the name @param name, it must have been created by a publisher. */
+        void open(const char* name);
+
+        /** @brief Unmaps the segment. */
+        void close(void);
+
+        /**
+        *   @brief Copies the latest snapshot.
+        *   @param snapshot: Returns the snapshot
+        *   @return 'false' if nothing has been published yet or the publisher was writing during every attempt.
+        */
+        bool read(metrics_snapshot_t& snapshot) const;
+
+        /** @return 'true' if a segment is mapped. */
+        bool is_open(void) const noexcept   { return (this->header != nullptr); }
+    };
+};
\ No newline at end of file
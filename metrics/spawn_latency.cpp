@@ -0,0 +1,124 @@
+#include "spawn_latency.h"
+#include <algorithm>
+
+using namespace metrics;
+
+namespace
+{
+    constexpr const char* STAGE_HISTOGRAMS[SpawnLatencyTracer::STAGE_COUNT] = {
+        "spawn_to_submit_us",
+        "spawn_to_present_us",
+        "spawn_to_gpu_done_us"
+    };
+};
+
+SpawnLatencyTracer::SpawnLatencyTracer(void) : interval(0), spawns(0), next_token(1)
+{
+    for (uint32_t i = 0; i < STAGE_COUNT; i++)
+        this->histograms[i] = &registry().histogram(STAGE_HISTOGRAMS[i]);
+    for (frame_t& frame : this->frames)
+        frame.token = 0;
+}
+
+void SpawnLatencyTracer::enable(uint32_t sample_interval)
+{
+    // the pending stamps are swapped with the stamps of a frame slot, so every vector needs the full capacity
+    if (sample_interval != 0)
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->pending.reserve(MAX_PENDING);
+        for (frame_t& frame : this->frames)
+            frame.spawns.reserve(MAX_PENDING);
+    }
+    this->interval.store(sample_interval, std::memory_order_relaxed);
+}
+
+void SpawnLatencyTracer::record(const std::vector<time_point>& spawns, stage_t stage, time_point t) noexcept
+{
+    for (time_point spawn : spawns)
+        this->histograms[stage]->record(static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(t - spawn).count())));
+}
+
+void SpawnLatencyTracer::stamp(time_point t) noexcept
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->pending.size() < this->pending.capacity())
+        this->pending.push_back(t);     // does not allocate, the capacity is MAX_PENDING once the tracer is enabled
+}
+
+uint64_t SpawnLatencyTracer::submit(void) noexcept
+{
+    const time_point t = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->pending.empty())
+        return 0;
+
+    // a free slot, or the oldest frame if all slots are in use
+    frame_t* slot = &this->frames[0];
+    for (frame_t& frame : this->frames)
+    {
+        if (frame.token < slot->token)
+            slot = &frame;
+    }
+
+    // the slot's stamps are empty and have the full capacity, so the pending stamps do not allocate afterwards
+    slot->spawns.clear();
+    slot->spawns.swap(this->pending);
+    slot->token = this->next_token++;
+    this->record(slot->spawns, STAGE_SUBMIT, t);
+    return slot->token;
+}
+
+void SpawnLatencyTracer::presented(uint64_t token) noexcept
+{
+    if (token == 0) return;
+    const time_point t = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(this->mtx);
+    for (const frame_t& frame : this->frames)
+    {
+        if (frame.token == token)
+        {
+            this->record(frame.spawns, STAGE_PRESENT, t);
+            return;
+        }
+    }
+}
+
+void SpawnLatencyTracer::completed(uint64_t token) noexcept
+{
+    if (token == 0) return;
+    const time_point t = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(this->mtx);
+    for (frame_t& frame : this->frames)
+    {
+        if (frame.token == token)
+        {
+            this->record(frame.spawns, STAGE_GPU_DONE, t);
+            frame.spawns.clear();
+            frame.token = 0;
+            return;
+        }
+    }
+}
+
+SpawnLatencyTracer::statistics_t SpawnLatencyTracer::statistics(stage_t stage) const noexcept
+{
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count, sum, max;
+    this->histograms[stage]->snapshot(buckets, count, sum, max);
+
+    // the upper bound of a bucket may be bigger than the biggest recorded value
+    statistics_t statistics;
+    statistics.count = count;
+    statistics.p50_ms = std::min(histogram_percentile(buckets, 0.5), max) * 1e-3;
+    statistics.p99_ms = std::min(histogram_percentile(buckets, 0.99), max) * 1e-3;
+    statistics.max_ms = max * 1e-3;
+    return statistics;
+}
+
+SpawnLatencyTracer& metrics::spawn_latency(void)
+{
+    // never destroyed like the registry, spawns may still be stamped during static destruction
+    static SpawnLatencyTracer* tracer = new SpawnLatencyTracer;
+    return *tracer;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace metrics
+{
+    /**
+    *   Class: SpawnLatencyTracer
+    *   @brief Measures the latency from a spawn until the particle is visible. Every n-th spawn is stamped,
+    *          the stamps are assigned to the next frame that is submitted, because the particle is in the
+    *          mapped particle buffer and its draw count when the spawn returns. The latencies until the
+    *          submission, the presentation and the completion of that frame on the GPU are recorded into
+    *          the histograms "spawn_to_submit_us", "spawn_to_present_us" and "spawn_to_gpu_done_us".
+    *   NOTE: Spawns may be stamped from any thread, the frame methods must be called from the render thread.
+    */
+    class SpawnLatencyTracer
+    {
+    public:
+        using time_point = std::chrono::steady_clock::time_point;
+
+        enum stage_t
+        {
+            STAGE_SUBMIT = 0,
+            STAGE_PRESENT = 1,
+            STAGE_GPU_DONE = 2,
+            STAGE_COUNT = 3
+        };
+
+        struct statistics_t
+        {
+            uint64_t count;
+            double p50_ms, p99_ms, max_ms;
+        };
+
+        /** @brief Stamped spawns that are kept until a frame is submitted, further spawns are not stamped. */
+        constexpr static size_t MAX_PENDING = 4096;
+
+        /**
+        *   @brief Submitted frames that are tracked until they are completed, the oldest frame is dropped if
+        *          a further frame is submitted. Frames that never complete, e.g. because the swapchain has been
+        *          recreated, are dropped this way.
+        */
+        constexpr static size_t MAX_FRAMES = 8;
+
+    private:
+        struct frame_t
+        {
+            uint64_t token;                     // 0 = the slot is free
+            std::vector<time_point> spawns;
+        };
+
+        std::atomic<uint32_t> interval;         // every n-th spawn is stamped, 0 = disabled
+        std::atomic<uint64_t> spawns;
+        std::mutex mtx;
+        std::vector<time_point> pending;
+        frame_t frames[MAX_FRAMES];             // submitted frames that are not completed yet
+        uint64_t next_token;
+        Histogram* histograms[STAGE_COUNT];
+
+        void record(const std::vector<time_point>& spawns, stage_t stage, time_point t) noexcept;
+
+    public:
+        SpawnLatencyTracer(void);
+
+        /**
+        *   @brief Stamps every @param sample_interval-th spawn, 0 disables the tracer.
+        *          Enabling the tracer allocates MAX_PENDING stamps per frame once, afterwards it does not allocate.
+        */
+        void enable(uint32_t sample_interval);
+
+        /** @return 'true' if spawns are stamped. */
+        bool enabled(void) const noexcept                   { return this->interval.load(std::memory_order_relaxed) != 0; }
+
+        /** @brief Called when a spawn returns, only every n-th spawn takes the lock. */
+        void stamp_spawn(void) noexcept
+        {
+            const uint32_t n = this->interval.load(std::memory_order_relaxed);
+            if (n != 0 && this->spawns.fetch_add(1, std::memory_order_relaxed) % n == 0)
+                this->stamp(std::chrono::steady_clock::now());
+        }
+
+        /** @brief Stamps a spawn at the time @param t. */
+        void stamp(time_point t) noexcept;
+
+        /**
+        *   @brief Assigns the pending stamps to the frame that is submitted next, must be called right before vkQueueSubmit.
+        *          The stamps are swapped into a free frame slot, so this does not allocate.
+        *   @return The token of the frame, 0 if there are no pending stamps.
+        */
+        uint64_t submit(void) noexcept;
+
+        /** @brief The frame with @param token has been handed to the presentation engine. */
+        void presented(uint64_t token) noexcept;
+
+        /** @brief The GPU has finished the frame with @param token, the frame is not tracked anymore. */
+        void completed(uint64_t token) noexcept;
+
+        /** @return The latencies of a stage. */
+        statistics_t statistics(stage_t stage) const noexcept;
+    };
+
+    /** @return The spawn latency tracer of the process, it is disabled by default. */
+    SpawnLatencyTracer& spawn_latency(void);
+};
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "baked_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace particles;
+
+namespace
+{
+    constexpr char BAKED_CACHE_MAGIC[4] = { 'P', 'B', 'A', 'K' };
+    constexpr uint32_t BAKED_CACHE_VERSION = 1;
+    constexpr uint32_t N_CHANNELS = 8;      // x, y, z, size, r, g, b, a
+    constexpr uint8_t FRAME_INTRA = 0;      // deltas along the particles
+    constexpr uint8_t FRAME_TEMPORAL = 1;   // deltas against the previous frame
+
+    uint16_t quantize(float v, float lo, float hi)
+    {
+        if (!(hi > lo)) return 0;
+        const float t = std::min(std::max((v - lo) / (hi - lo), 0.0f), 1.0f);
+        return static_cast<uint16_t>(std::lround(t * 65535.0f));
+    }
+
+    float dequantize(uint16_t q, float lo, float hi)
+    {
+        return lo + static_cast<float>(q) * ((hi - lo) / 65535.0f);
+    }
+
+    // 'long' is 32 bits on Windows, caches can be bigger than 2 GB
+    int seek64(std::FILE* file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    }
+
+    uint64_t tell64(std::FILE* file)
+    {
+#ifdef _WIN32
+        return static_cast<uint64_t>(_ftelli64(file));
+#else
+        return static_cast<uint64_t>(ftello(file));
+#endif
+    }
+
+    uint16_t quantize_color(float c)
+    {
+        return static_cast<uint16_t>(std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f));
+    }
+
+    void write_varint(std::vector<uint8_t>& out, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint32_t read_varint(const std::vector<uint8_t>& in, size_t& pos)
+    {
+        uint32_t value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7)
+        {
+            if (pos >= in.size())
+                throw std::runtime_error("Baked cache chunk is truncated.");
+            const uint8_t byte = in[pos++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        throw std::runtime_error("Baked cache chunk contains an invalid varint.");
+    }
+
+    // zigzag maps small negative and positive deltas to small unsigned values
+    uint32_t zigzag(int32_t x)          { return (static_cast<uint32_t>(x) << 1) ^ static_cast<uint32_t>(x >> 31); }
+    int32_t unzigzag(uint32_t x)        { return static_cast<int32_t>(x >> 1) ^ -static_cast<int32_t>(x & 1); }
+};
+
+// ------------------------ BAKED CACHE WRITER ------------------------
+
+BakedCacheWriter::BakedCacheWriter(void)
+{
+    this->file = nullptr;
+    this->header = {};
+    this->frames_per_chunk = DEFAULT_FRAMES_PER_CHUNK;
+    this->n_chunk_frames = 0;
+}
+
+BakedCacheWriter::~BakedCacheWriter(void)
+{
+    try
+    {
+        this->close();
+    }
+    catch (std::runtime_error&) {}
+}
+
+void BakedCacheWriter::open(const char* path, float frame_rate, uint32_t frames_per_chunk)
+{
+    if (this->file != nullptr)
+        throw std::runtime_error("BakedCacheWriter has already been opened.");
+    if (frame_rate <= 0.0f)
+        throw std::invalid_argument("Frame rate of BakedCacheWriter::open must be bigger than 0.");
+    if (frames_per_chunk == 0)
+        throw std::invalid_argument("Frames per chunk of BakedCacheWriter::open must be bigger than 0.");
+
+    this->file = std::fopen(path, "wb");
+    if (this->file == nullptr)
+        throw std::runtime_error("Failed to create baked cache file \"" + std::string(path) + "\".");
+
+    this->header = {};
+    std::memcpy(this->header.magic, BAKED_CACHE_MAGIC, sizeof(BAKED_CACHE_MAGIC));
+    this->header.version = BAKED_CACHE_VERSION;
+    this->header.frame_rate = frame_rate;
+    this->frames_per_chunk = frames_per_chunk;
+    this->chunk_frames.resize(frames_per_chunk);
+    this->n_chunk_frames = 0;
+    this->index.clear();
+
+    // the header is rewritten on close, when the frame index is known
+    if (std::fwrite(&this->header, sizeof(this->header), 1, this->file) != 1)
+    {
+        std::fclose(this->file);
+        this->file = nullptr;
+        throw std::runtime_error("Failed to write baked cache file \"" + std::string(path) + "\".");
+    }
+}
+
+void BakedCacheWriter::close(void)
+{
+    if (this->file == nullptr) return;
+
+    // a cache without its index cannot be read, so the index is only written if every chunk has been written
+    bool written = true;
+    try
+    {
+        if (this->n_chunk_frames > 0)
+            this->flush_chunk();
+    }
+    catch (std::runtime_error&)
+    {
+        written = false;
+    }
+    if (written)
+    {
+        this->header.n_chunks = static_cast<uint32_t>(this->index.size());
+        this->header.index_offset = tell64(this->file);
+        written = this->header.index_offset != UINT64_MAX &&
+                  std::fwrite(this->index.data(), sizeof(baked_cache_chunk_t), this->index.size(), this->file) == this->index.size() &&
+                  seek64(this->file, 0) == 0 &&
+                  std::fwrite(&this->header, sizeof(this->header), 1, this->file) == 1;
+    }
+    if (std::fclose(this->file) != 0)   // flushes the buffered writes
+        written = false;
+
+    this->file = nullptr;
+    this->n_chunk_frames = 0;
+    this->index.clear();
+    if (!written)
+        throw std::runtime_error("Failed to write baked cache file.");
+}
+
+void BakedCacheWriter::capture(const ParticlePool& pool)
+{
+    // every allocated particle lies in the drawn range, free particles are skipped by their NAN-position
+    this->capture(pool.base_address(), pool.drawn());
+}
+
+void BakedCacheWriter::capture(const particle_t* particles, uint32_t n)
+{
+    if (this->file == nullptr)
+        throw std::runtime_error("BakedCacheWriter must be opened before frames can be captured.");
+
+    std::vector<particle_t>& frame = this->chunk_frames[this->n_chunk_frames++];
+    frame.clear();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (!std::isnan(particles[i].pos.x))
+            frame.push_back(particles[i]);
+    }
+
+    this->header.max_particles = std::max(this->header.max_particles, static_cast<uint32_t>(frame.size()));
+    ++this->header.n_frames;
+
+    if (this->n_chunk_frames == this->frames_per_chunk)
+        this->flush_chunk();
+}
+
+void BakedCacheWriter::flush_chunk(void)
+{
+    // quantization ranges of the whole chunk, so that temporal deltas stay small
+    float bounds[8] = {
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()
+    };
+    for (uint32_t f = 0; f < this->n_chunk_frames; f++)
+    {
+        for (const particle_t& p : this->chunk_frames[f])
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                bounds[i] = std::min(bounds[i], p.pos[i]);
+                bounds[3 + i] = std::max(bounds[3 + i], p.pos[i]);
+            }
+            bounds[6] = std::min(bounds[6], p.size);
+            bounds[7] = std::max(bounds[7], p.size);
+        }
+    }
+
+    this->encoded.resize(sizeof(bounds));
+    std::memcpy(this->encoded.data(), bounds, sizeof(bounds));
+
+    for (uint32_t f = 0; f < this->n_chunk_frames; f++)
+    {
+        const std::vector<particle_t>& frame = this->chunk_frames[f];
+        const size_t n = frame.size();
+        for (uint32_t c = 0; c < N_CHANNELS; c++)
+            this->current[c].resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            const particle_t& p = frame[i];
+            this->current[0][i] = quantize(p.pos.x, bounds[0], bounds[3]);
+            this->current[1][i] = quantize(p.pos.y, bounds[1], bounds[4]);
+            this->current[2][i] = quantize(p.pos.z, bounds[2], bounds[5]);
+            this->current[3][i] = quantize(p.size, bounds[6], bounds[7]);
+            this->current[4][i] = quantize_color(p.color.x);
+            this->current[5][i] = quantize_color(p.color.y);
+            this->current[6][i] = quantize_color(p.color.z);
+            this->current[7][i] = quantize_color(p.color.w);
+        }
+
+        const bool temporal = (f > 0 && this->previous[0].size() == n);
+        write_varint(this->encoded, static_cast<uint32_t>(n));
+        this->encoded.push_back(temporal ? FRAME_TEMPORAL : FRAME_INTRA);
+        for (uint32_t c = 0; c < N_CHANNELS; c++)
+        {
+            int32_t last = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                const int32_t reference = temporal ? this->previous[c][i] : last;
+                write_varint(this->encoded, zigzag(static_cast<int32_t>(this->current[c][i]) - reference));
+                last = this->current[c][i];
+            }
+            std::swap(this->current[c], this->previous[c]);
+        }
+    }
+
+    baked_cache_chunk_t entry = {};
+    entry.offset = tell64(this->file);
+    entry.size = static_cast<uint32_t>(this->encoded.size());
+    entry.first_frame = this->header.n_frames - this->n_chunk_frames;
+    entry.n_frames = this->n_chunk_frames;
+    this->n_chunk_frames = 0;
+    if (std::fwrite(this->encoded.data(), 1, this->encoded.size(), this->file) != this->encoded.size())
+    {
+        // the frames of the chunk are lost, the index stays valid for the previous chunks
+        this->header.n_frames = entry.first_frame;
+        throw std::runtime_error("Failed to write baked cache chunk.");
+    }
+    this->index.push_back(entry);
+}
+
+// ------------------------ BAKED CACHE READER ------------------------
+
+BakedCacheReader::BakedCacheReader(void)
+{
+    this->file = nullptr;
+    this->header = {};
+    this->chunk = UINT32_MAX;
+    this->chunk_pos = 0;
+    this->next_frame = 0;
+    std::fill(this->bounds, this->bounds + 8, 0.0f);
+}
+
+BakedCacheReader::~BakedCacheReader(void)
+{
+    this->close();
+}
+
+void BakedCacheReader::open(const char* path)
+{
+    if (this->file != nullptr)
+        throw std::runtime_error("BakedCacheReader has already been opened.");
+
+    this->file = std::fopen(path, "rb");
+    if (this->file == nullptr)
+        throw std::runtime_error("Failed to open baked cache file \"" + std::string(path) + "\".");
+
+    if (std::fread(&this->header, sizeof(this->header), 1, this->file) != 1 ||
+        std::memcmp(this->header.magic, BAKED_CACHE_MAGIC, sizeof(BAKED_CACHE_MAGIC)) != 0)
+    {
+        this->close();
+        throw std::runtime_error("File \"" + std::string(path) + "\" is not a baked cache file.");
+    }
+    if (this->header.version != BAKED_CACHE_VERSION)
+    {
+        this->close();
+        throw std::runtime_error("Baked cache file \"" + std::string(path) + "\" has an unsupported version.");
+    }
+
+    this->index.resize(this->header.n_chunks);
+    if (seek64(this->file, this->header.index_offset) != 0 ||
+        std::fread(this->index.data(), sizeof(baked_cache_chunk_t), this->index.size(), this->file) != this->index.size())
+    {
+        this->close();
+        throw std::runtime_error("Baked cache file \"" + std::string(path) + "\" is truncated.");
+    }
+    this->chunk = UINT32_MAX;
+}
+
+void BakedCacheReader::close(void)
+{
+    if (this->file != nullptr)
+    {
+        std::fclose(this->file);
+        this->file = nullptr;
+        this->index.clear();
+        this->chunk = UINT32_MAX;
+    }
+}
+
+void BakedCacheReader::load_chunk(uint32_t chunk)
+{
+    const baked_cache_chunk_t& entry = this->index[chunk];
+    this->chunk_data.resize(entry.size);
+    if (seek64(this->file, entry.offset) != 0 ||
+        std::fread(this->chunk_data.data(), 1, entry.size, this->file) != entry.size || entry.size < sizeof(this->bounds))
+        throw std::runtime_error("Failed to read baked cache chunk.");
+
+    std::memcpy(this->bounds, this->chunk_data.data(), sizeof(this->bounds));
+    this->chunk_pos = sizeof(this->bounds);
+    this->next_frame = entry.first_frame;
+    this->chunk = chunk;
+    for (uint32_t c = 0; c < N_CHANNELS; c++)
+        this->quantized[c].clear();
+}
+
+void BakedCacheReader::decode_next(void)
+{
+    const uint32_t n = read_varint(this->chunk_data, this->chunk_pos);
+    if (this->chunk_pos >= this->chunk_data.size())
+        throw std::runtime_error("Baked cache chunk is truncated.");
+    const bool temporal = (this->chunk_data[this->chunk_pos++] == FRAME_TEMPORAL);
+    if (temporal && this->quantized[0].size() != n)
+        throw std::runtime_error("Baked cache chunk contains an invalid frame.");
+
+    for (uint32_t c = 0; c < N_CHANNELS; c++)
+    {
+        std::vector<uint16_t>& q = this->quantized[c];
+        q.resize(n);
+        int32_t last = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const int32_t reference = temporal ? q[i] : last;
+            q[i] = static_cast<uint16_t>(reference + unzigzag(read_varint(this->chunk_data, this->chunk_pos)));
+            last = q[i];
+        }
+    }
+    ++this->next_frame;
+}
+
+void BakedCacheReader::read(uint32_t frame, std::vector<particle_t>& particles)
+{
+    if (this->file == nullptr)
+        throw std::runtime_error("BakedCacheReader must be opened before frames can be read.");
+    if (frame >= this->header.n_frames)
+        throw std::out_of_range("Frame of BakedCacheReader::read is out of range.");
+
+    // chunks are ordered by their first frame
+    const uint32_t chunk = static_cast<uint32_t>(std::upper_bound(this->index.begin(), this->index.end(), frame,
+        [](uint32_t f, const baked_cache_chunk_t& entry) { return f < entry.first_frame; }) - this->index.begin()) - 1;
+    if (chunk != this->chunk || frame < this->next_frame)
+        this->load_chunk(chunk);
+    while (this->next_frame <= frame)
+        this->decode_next();
+
+    const size_t n = this->quantized[0].size();
+    particles.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        particle_t& p = particles[i];
+        p.pos.x = dequantize(this->quantized[0][i], this->bounds[0], this->bounds[3]);
+        p.pos.y = dequantize(this->quantized[1][i], this->bounds[1], this->bounds[4]);
+        p.pos.z = dequantize(this->quantized[2][i], this->bounds[2], this->bounds[5]);
+        p.size = dequantize(this->quantized[3][i], this->bounds[6], this->bounds[7]);
+        p.color.x = static_cast<float>(this->quantized[4][i]) * (1.0f / 255.0f);
+        p.color.y = static_cast<float>(this->quantized[5][i]) * (1.0f / 255.0f);
+        p.color.z = static_cast<float>(this->quantized[6][i]) * (1.0f / 255.0f);
+        p.color.w = static_cast<float>(this->quantized[7][i]) * (1.0f / 255.0f);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "particle_pool.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Baked cache file layout, little endian:
+    *       header:     baked_cache_header_t
+    *       chunks:     every chunk holds up to 'frames_per_chunk' consecutive frames
+    *       index:      baked_cache_chunk_t[n_chunks]
+    *
+    *   A chunk starts with the quantization ranges of its frames (position AABB, min/max size).
+    *   Positions and sizes are quantized to 16 bits within these ranges, colors to 8 bits per channel.
+    *   Every frame stores its particle count, a flag and 8 channel streams (x, y, z, size, r, g, b, a)
+    *   of zigzag varints. The first frame of a chunk and frames whose particle count differs from the
+    *   previous frame are delta encoded along the particles, the other frames against the previous frame.
+    *   Therefore every chunk can be decoded on its own and seeking decodes at most one chunk.
+    */
+    struct baked_cache_header_t
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t n_frames;
+        uint32_t n_chunks;
+        uint32_t max_particles;     // maximum particle count of all frames
+        float frame_rate;
+        uint64_t index_offset;
+    };
+
+    struct baked_cache_chunk_t
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t first_frame;
+        uint32_t n_frames;
+        uint32_t reserved;
+    };
+
+    /**
+    *   Class: BakedCacheWriter
+    *   @brief Captures the particles of a pool frame by frame into a baked cache file.
+    *          Only allocated particles (with a valid position) are stored, in the order of the particle-buffer.
+    *          The frames of a chunk are kept in memory until the chunk is complete, their buffers are
+    *          reused by the next chunk, so that capturing does not allocate once the biggest frame has been seen.
+    *   NOTE: Colors are clamped to [0, 1].
+    */
+    class BakedCacheWriter
+    {
+    private:
+        std::FILE* file;
+        baked_cache_header_t header;
+        uint32_t frames_per_chunk;
+        std::vector<std::vector<particle_t>> chunk_frames;  // one buffer per frame of a chunk
+        uint32_t n_chunk_frames;                            // captured frames of the current chunk
+        std::vector<baked_cache_chunk_t> index;
+        std::vector<uint8_t> encoded;
+        std::vector<uint16_t> current[8], previous[8];      // quantized channels of the encoded frames
+
+        void flush_chunk(void);
+
+    public:
+        /** @brief Default number of frames per chunk, it is also the maximum number of frames that seeking has to decode. */
+        constexpr static uint32_t DEFAULT_FRAMES_PER_CHUNK = 30;
+
+        /**
+        *   @brief The default constructor does not open a file.
+        *   In order to write a cache 'BakedCacheWriter::open' must be called.
+        */
+        BakedCacheWriter(void);
+
+        /** @brief Closes the file if it is open, errors can only be reported by 'BakedCacheWriter::close'. */
+        virtual ~BakedCacheWriter(void);
+
+        /**
+        *   @brief Creates the cache file.
+        *   @param path: Path of the cache file, an existing file is overwritten
+        *   @param frame_rate: Number of frames per second of the playback
+        *   @param frames_per_chunk: Number of frames per chunk
+        */
+        void open(const char* path, float frame_rate, uint32_t frames_per_chunk = DEFAULT_FRAMES_PER_CHUNK);
+
+        /**
+        *   @brief Writes the last chunk and the frame index and closes the file.
+        *          The file is closed even if writing fails, a std::runtime_error is thrown then.
+        */
+        void close(void);
+
+        /** @brief Captures every allocated particle of @param pool (its drawn range) as the next frame. */
+        void capture(const ParticlePool& pool);
+
+        /** @brief Captures @param n particles as the next frame, particles with a NAN-position are skipped. */
+        void capture(const particle_t* particles, uint32_t n);
+
+        /** @return The number of frames that have been captured. */
+        uint32_t frame_count(void) const noexcept   { return this->header.n_frames; }
+
+        /** @return 'true' if a file is open. */
+        bool is_open(void) const noexcept           { return (this->file != nullptr); }
+    };
+
+    /**
+    *   Class: BakedCacheReader
+    *   @brief Decodes the frames of a baked cache file. Consecutive frames are decoded incrementally,
+    *          any other frame is decoded from the start of its chunk.
+    */
+    class BakedCacheReader
+    {
+    private:
+        std::FILE* file;
+        baked_cache_header_t header;
+        std::vector<baked_cache_chunk_t> index;
+
+        // decoder state
+        uint32_t chunk;                         // currently loaded chunk, UINT32_MAX if none
+        std::vector<uint8_t> chunk_data;
+        size_t chunk_pos;                       // read position of the next frame in the chunk
+        uint32_t next_frame;                    // frame that is decoded next from the chunk
+        std::vector<uint16_t> quantized[8];     // quantized channels of the last decoded frame
+        float bounds[8];                        // pos min xyz, pos max xyz, size min, size max
+
+        void load_chunk(uint32_t chunk);
+        void decode_next(void);
+
+    public:
+        /**
+        *   @brief The default constructor does not open a file.
+        *   In order to read a cache 'BakedCacheReader::open' must be called.
+        */
+        BakedCacheReader(void);
+
+        /** @brief Closes the file if it is open. */
+        virtual ~BakedCacheReader(void);
+
+        /** @brief Opens a cache file and reads its frame index. */
+        void open(const char* path);
+
+        /** @brief Closes the file. */
+        void close(void);
+
+        /**
+        *   @brief Decodes a frame.
+        *   @param frame: Index of the frame to decode
+        *   @param particles: Returns the particles of the frame
+        */
+        void read(uint32_t frame, std::vector<particle_t>& particles);
+
+        /** @return The number of frames in the cache. */
+        uint32_t frame_count(void) const noexcept   { return this->header.n_frames; }
+
+        /** @return The maximum particle count of all frames. */
+        uint32_t max_particles(void) const noexcept { return this->header.max_particles; }
+
+        /** @return The number of frames per second of the playback. */
+        float frame_rate(void) const noexcept       { return this->header.frame_rate; }
+
+        /** @return 'true' if a file is open. */
+        bool is_open(void) const noexcept           { return (this->file != nullptr); }
+    };
+};
\ No newline at end of file
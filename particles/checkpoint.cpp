@@ -0,0 +1,126 @@
+#include "checkpoint.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace particles;
+
+namespace
+{
+    constexpr char CHECKPOINT_MAGIC[4] = { 'P', 'C', 'K', 'P' };
+    constexpr uint32_t CHECKPOINT_VERSION = 1;
+    constexpr uint64_t CHECKPOINT_PAGE_SIZE = 4096;
+
+    uint64_t align_up(uint64_t x, uint64_t alignment) { return (x + alignment - 1) & ~(alignment - 1); }
+
+    /** @return 'true' if @param count elements of @param element_size bytes at @param offset end at or before @param end, without overflowing. */
+    bool section_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t end)
+    {
+        return offset <= end && count <= (end - offset) / element_size;
+    }
+
+    void write_padding(std::FILE* file, uint64_t& offset, uint64_t alignment)
+    {
+        static const uint8_t zeros[CHECKPOINT_PAGE_SIZE] = {};
+        const uint64_t padding = align_up(offset, alignment) - offset;
+        std::fwrite(zeros, 1, padding, file);
+        offset += padding;
+    }
+};
+
+void particles::save_checkpoint(const char* path, const ParticlePool& pool, const std::vector<const ParticleEngine*>& engines)
+{
+    if (!pool.initialized())
+        throw std::invalid_argument("ParticlePool must be initialized, requiered from particles::save_checkpoint.");
+
+    std::vector<uint32_t> allocated;
+    pool.get_allocated_indices(allocated);
+
+    std::vector<std::vector<uint8_t>> states(engines.size());
+    for (size_t i = 0; i < engines.size(); i++)
+        engines[i]->save_state(states[i]);
+
+    checkpoint_header_t header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.capacity = pool.capacity();
+    header.n_allocated = static_cast<uint32_t>(allocated.size());
+    header.n_engines = static_cast<uint32_t>(engines.size());
+    header.allocated_offset = CHECKPOINT_PAGE_SIZE;
+    header.particles_offset = align_up(header.allocated_offset + allocated.size() * sizeof(uint32_t), CHECKPOINT_PAGE_SIZE);
+    header.engines_offset = align_up(header.particles_offset + static_cast<uint64_t>(header.capacity) * sizeof(particle_t), CHECKPOINT_PAGE_SIZE);
+    header.file_size = header.engines_offset;
+    for (const std::vector<uint8_t>& state : states)
+        header.file_size += align_up(sizeof(uint64_t) + state.size(), sizeof(uint64_t));
+
+    std::FILE* file = std::fopen(path, "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Failed to create checkpoint file \"" + std::string(path) + "\".");
+
+    uint64_t offset = 0;
+    offset += std::fwrite(&header, 1, sizeof(header), file);
+    write_padding(file, offset, CHECKPOINT_PAGE_SIZE);
+    offset += std::fwrite(allocated.data(), 1, allocated.size() * sizeof(uint32_t), file);
+    write_padding(file, offset, CHECKPOINT_PAGE_SIZE);
+    offset += std::fwrite(pool.base_address(), 1, static_cast<size_t>(header.capacity) * sizeof(particle_t), file);
+    write_padding(file, offset, CHECKPOINT_PAGE_SIZE);
+    for (const std::vector<uint8_t>& state : states)
+    {
+        const uint64_t size = state.size();
+        offset += std::fwrite(&size, 1, sizeof(size), file);
+        offset += std::fwrite(state.data(), 1, state.size(), file);
+        write_padding(file, offset, sizeof(uint64_t));
+    }
+
+    const bool failed = (std::fclose(file) != 0 || offset != header.file_size);
+    if (failed)
+        throw std::runtime_error("Failed to write checkpoint file \"" + std::string(path) + "\".");
+}
+
+void particles::load_checkpoint(const char* path, ParticlePool& pool, const std::vector<ParticleEngine*>& engines)
+{
+    if (!pool.initialized())
+        throw std::invalid_argument("ParticlePool must be initialized, requiered from particles::load_checkpoint.");
+
+    const MappedFile view(path, true);     // the whole file is copied anyway, prefault it with one call
+
+    checkpoint_header_t header;
+    if (view.size() < sizeof(header))
+        throw std::runtime_error("File \"" + std::string(path) + "\" is not a checkpoint file.");
+    std::memcpy(&header, view.data(), sizeof(header));
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 || header.file_size != view.size())
+        throw std::runtime_error("File \"" + std::string(path) + "\" is not a checkpoint file or is truncated.");
+    if (header.version != CHECKPOINT_VERSION)
+        throw std::runtime_error("Checkpoint file \"" + std::string(path) + "\" has an unsupported version.");
+    if (header.capacity != pool.capacity())
+        throw std::invalid_argument("Capacity of the ParticlePool of particles::load_checkpoint does not match the checkpoint.");
+    if (header.n_engines != engines.size())
+        throw std::invalid_argument("Number of engines of particles::load_checkpoint does not match the checkpoint.");
+
+    // the offsets are read from the file, every section must lie in the file before it is accessed
+    if (header.allocated_offset < sizeof(header) ||
+        header.allocated_offset % sizeof(uint32_t) != 0 || header.particles_offset % alignof(particle_t) != 0 ||
+        !section_fits(header.allocated_offset, header.n_allocated, sizeof(uint32_t), header.particles_offset) ||
+        !section_fits(header.particles_offset, header.capacity, sizeof(particle_t), header.engines_offset) ||
+        header.engines_offset > header.file_size)
+        throw std::runtime_error("Checkpoint file \"" + std::string(path) + "\" is corrupt.");
+
+    // The sections are page aligned, so the allocated indices and the particles can be used in place.
+    pool.restore(reinterpret_cast<const particle_t*>(view.data() + header.particles_offset), header.capacity,
+                 reinterpret_cast<const uint32_t*>(view.data() + header.allocated_offset), header.n_allocated);
+
+    uint64_t offset = header.engines_offset;
+    for (ParticleEngine* engine : engines)
+    {
+        uint64_t size;
+        if (!section_fits(offset, 1, sizeof(size), header.file_size))
+            throw std::runtime_error("Checkpoint file \"" + std::string(path) + "\" is truncated.");
+        std::memcpy(&size, view.data() + offset, sizeof(size));
+        if (!section_fits(offset + sizeof(size), size, 1, header.file_size))
+            throw std::runtime_error("Checkpoint file \"" + std::string(path) + "\" is truncated.");
+        engine->restore_state(view.data() + offset + sizeof(size), static_cast<size_t>(size));
+        offset += align_up(sizeof(size) + size, sizeof(uint64_t));
+    }
+}
\ No newline at end of file
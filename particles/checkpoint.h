@@ -0,0 +1,50 @@
+#pragma once
+
+#include "particle_pool.h"
+#include "particle_engine.h"
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Checkpoint file layout, every section starts at a page boundary (4096 bytes) so that
+    *   the file can be mapped and copied from directly:
+    *       header:     checkpoint_header_t
+    *       allocated:  uint32_t[n_allocated], allocated indices in ascending order
+    *       particles:  particle_t[capacity], raw particle-buffer
+    *       engines:    per engine: uint64_t size + state, 8-byte aligned
+    */
+    struct checkpoint_header_t
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t n_allocated;
+        uint32_t n_engines;
+        uint32_t reserved;
+        uint64_t allocated_offset;
+        uint64_t particles_offset;
+        uint64_t engines_offset;
+        uint64_t file_size;
+    };
+
+    /**
+    *   @brief Writes a checkpoint of a pool and the engines that use it into one file.
+    *   @param path: Path of the checkpoint file, an existing file is overwritten
+    *   @param pool: The pool to checkpoint, it must be initialized
+    *   @param engines: The engines to checkpoint, their states are stored in the given order
+    *   NOTE: The engines must not spawn or kill particles while the checkpoint is written.
+    */
+    void save_checkpoint(const char* path, const ParticlePool& pool, const std::vector<const ParticleEngine*>& engines);
+
+    /**
+    *   @brief Restores a pool and its engines from a checkpoint file. The file is mapped into memory,
+    *          the particles are bulk-copied into the pool's particle-buffer and the allocation tables
+    *          of the pool and the engines are rebuilt. Nothing is re-simulated.
+    *   @param path: Path of the checkpoint file
+    *   @param pool: The pool to restore, it must be initialized with the capacity of the checkpointed pool
+    *   @param engines: The engines to restore, in the same order as they have been checkpointed
+    *   NOTE: The engines must not spawn or kill particles while the checkpoint is restored.
+    */
+    void load_checkpoint(const char* path, ParticlePool& pool, const std::vector<ParticleEngine*>& engines);
+};
\ No newline at end of file
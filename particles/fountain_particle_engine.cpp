@@ -0,0 +1,187 @@
+#include "particle_engine.h"
+#include "../profiler/profiler.h"
+#include "../metrics/metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+using namespace particles;
+
+FountainParticleEngine::FountainParticleEngine(void)
+{
+    this->pool = nullptr;
+    this->range = nullptr;
+    this->range_size = 0;
+    this->active = 0;
+    this->emit_budget = 0.0;
+    this->nozzle = glm::vec3(0.0f);
+    this->direction = glm::vec3(0.0f, 1.0f, 0.0f);
+    this->spread = 0.2f;
+    this->speed = 8.0f;
+    this->lifetime = 3.0f;
+    this->color = glm::vec4(0.0f, 1.0f, 1.0f, 1.0f);
+    this->size = 0.05f;
+    this->_contacts = 0;
+}
+
+FountainParticleEngine::FountainParticleEngine(ParticlePool& pool, uint32_t n_particles) : FountainParticleEngine()
+{
+    this->init(pool, n_particles);
+}
+
+FountainParticleEngine::~FountainParticleEngine(void)
+{
+    this->stop();
+}
+
+void FountainParticleEngine::init(ParticlePool& pool, uint32_t n_particles)
+{
+    if (this->base_running())
+        throw std::runtime_error("Cannot reinitialize running particle engine (FountainParticleEngine).");
+    if (n_particles == 0)
+        throw std::invalid_argument("FountainParticleEngine requieres at least one particle.");
+
+    this->pool = &pool;
+    this->range_size = n_particles;
+}
+
+void FountainParticleEngine::set_nozzle(const glm::vec3& position, const glm::vec3& direction, float spread, float speed)
+{
+    this->nozzle = position;
+    this->direction = glm::normalize(direction);
+    this->spread = spread;
+    this->speed = speed;
+}
+
+void FountainParticleEngine::set_lifetime(float seconds)
+{
+    if (seconds <= 0.0f)
+        throw std::invalid_argument("Lifetime of FountainParticleEngine must be positive.");
+    this->lifetime = seconds;
+}
+
+void FountainParticleEngine::set_appearance(const glm::vec4& color, float size)
+{
+    this->color = color;
+    this->size = size;
+}
+
+void FountainParticleEngine::start(void)
+{
+    if (this->pool == nullptr)
+        throw std::runtime_error("Cannot start uninitialized particle engine (FountainParticleEngine).");
+    if (this->base_running()) return;
+
+    this->range = this->pool->allocate_range(this->range_size);
+    if (this->range == nullptr)
+        throw std::bad_alloc();
+
+    // particles that have not been emitted yet are not visible
+    particle_t hidden;
+    hidden.pos = glm::vec3(NAN);
+    hidden.color = this->color;
+    hidden.size = this->size;
+    for (uint32_t i = 0; i < this->range_size; i++)
+        this->range[i] = hidden;
+
+    this->pos_x.assign(this->range_size, 0.0f);
+    this->pos_y.assign(this->range_size, 0.0f);
+    this->pos_z.assign(this->range_size, 0.0f);
+    this->vel_x.assign(this->range_size, 0.0f);
+    this->vel_y.assign(this->range_size, 0.0f);
+    this->vel_z.assign(this->range_size, 0.0f);
+    this->age.assign(this->range_size, 0.0f);
+    this->active = 0;
+    this->emit_budget = 0.0;
+    this->_contacts = 0;
+    this->start_base(this);
+}
+
+void FountainParticleEngine::stop(void)
+{
+    this->stop_base();  // stop the simulation first, then the particles can be freed
+    if (this->range != nullptr)
+    {
+        this->pool->free_range(this->range, this->range_size);
+        this->range = nullptr;
+        this->active = 0;
+    }
+}
+
+void FountainParticleEngine::emit(uint32_t i)
+{
+    // uniformly distributed direction within the cone around the nozzle's direction
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float cos_theta = 1.0f - unit(this->rng) * (1.0f - std::cos(this->spread));
+    const float sin_theta = std::sqrt(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+    const float phi = unit(this->rng) * 6.28318530718f;
+
+    const glm::vec3 helper = (std::abs(this->direction.y) < 0.99f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    const glm::vec3 tangent = glm::normalize(glm::cross(helper, this->direction));
+    const glm::vec3 bitangent = glm::cross(this->direction, tangent);
+    const glm::vec3 v = (tangent * (sin_theta * std::cos(phi)) + bitangent * (sin_theta * std::sin(phi)) + this->direction * cos_theta) * this->speed;
+
+    this->pos_x[i] = this->nozzle.x;
+    this->pos_y[i] = this->nozzle.y;
+    this->pos_z[i] = this->nozzle.z;
+    this->vel_x[i] = v.x;
+    this->vel_y[i] = v.y;
+    this->vel_z[i] = v.z;
+    this->age[i] = 0.0f;
+}
+
+void FountainParticleEngine::run(const std::atomic_bool& running, void* param)
+{
+    PROFILE_THREAD("FountainParticleEngine");
+    metrics::Histogram& tick_us = metrics::registry().histogram("fountain_tick_us");
+    metrics::Counter& contacts = metrics::registry().counter("fountain_contacts");
+
+    constexpr float dt = TICK_US * 1e-6f;
+    auto next_tick = std::chrono::steady_clock::now();
+    while (running)
+    {
+        next_tick += std::chrono::microseconds(TICK_US);
+        const auto t0 = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE("FountainParticleEngine::tick");
+
+            // all particles are emitted over one lifetime, afterwards they are emitted again when they expire
+            for (uint32_t i = 0; i < this->active; i++)
+            {
+                this->age[i] += dt;
+                if (this->age[i] >= this->lifetime)
+                    this->emit(i);
+            }
+            this->emit_budget += static_cast<double>(this->range_size) * dt / this->lifetime;
+            while (this->emit_budget >= 1.0 && this->active < this->range_size)
+            {
+                this->emit(this->active++);
+                this->emit_budget -= 1.0;
+            }
+            if (this->active == this->range_size)
+                this->emit_budget = 0.0;
+
+            ParticleBatch batch = {
+                this->pos_x.data(), this->pos_y.data(), this->pos_z.data(),
+                this->vel_x.data(), this->vel_y.data(), this->vel_z.data(),
+                this->active
+            };
+            this->_forces.apply(batch, dt);
+            for (uint32_t i = 0; i < this->active; i++)
+            {
+                this->pos_x[i] += this->vel_x[i] * dt;
+                this->pos_y[i] += this->vel_y[i] * dt;
+                this->pos_z[i] += this->vel_z[i] * dt;
+            }
+            const uint32_t n_contacts = this->_colliders.resolve(batch);
+            this->_contacts += n_contacts;
+            contacts.add(n_contacts);
+
+            for (uint32_t i = 0; i < this->active; i++)
+                this->range[i].pos = glm::vec3(this->pos_x[i], this->pos_y[i], this->pos_z[i]);
+        }
+        tick_us.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count());
+        std::this_thread::sleep_until(next_tick);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <new>
+
+using namespace particles;
+
+FrameArena::FrameArena(size_t capacity)
+{
+    this->current = 0;
+    this->offset = 0;
+    this->_used = 0;
+    this->_high_water = 0;
+    this->add_block(std::max<size_t>(capacity, 1));
+}
+
+void FrameArena::add_block(size_t size)
+{
+    block_t block;
+    block.memory.reset(new uint8_t[size]);
+    block.size = size;
+    this->blocks.push_back(std::move(block));
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+    // the blocks are allocated with new, so they are aligned to at least __STDCPP_DEFAULT_NEW_ALIGNMENT__
+    while (true)
+    {
+        block_t& block = this->blocks[this->current];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+        const uintptr_t p = (base + this->offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        const size_t end = static_cast<size_t>(p - base) + bytes;
+        if (end <= block.size)
+        {
+            this->_used += end - this->offset;
+            this->_high_water = std::max(this->_high_water, this->_used);
+            this->offset = end;
+            return reinterpret_cast<void*>(p);
+        }
+
+        // the rest of the current block is wasted, the next block is at least twice as big
+        const size_t size = block.size;
+        if (this->current + 1 == this->blocks.size())
+            this->add_block(std::max(2 * size, bytes + alignment));
+        this->_used += size - this->offset;
+        this->current++;
+        this->offset = 0;
+    }
+}
+
+void FrameArena::reset(void) noexcept
+{
+    this->current = 0;
+    this->offset = 0;
+    this->_used = 0;
+}
+
+size_t FrameArena::capacity(void) const noexcept
+{
+    size_t size = 0;
+    for (const block_t& block : this->blocks)
+        size += block.size;
+    return size;
+}
+
+FrameArena& FrameArena::local(void)
+{
+    thread_local FrameArena arena;
+    return arena;
+}
\ No newline at end of file
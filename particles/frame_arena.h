@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Class: FrameArena
+    *   @brief Linear (bump) allocator for transient data of one frame or engine pass, e.g.
+    *              FrameArena& arena = FrameArena::local();
+    *              std::pmr::vector<float> distance(n, &arena);
+    *          Deallocation does nothing, the memory is released at once by 'FrameArena::reset'.
+    *          If a frame needs more than the capacity, another block is taken from the heap. The blocks are
+    *          kept across resets, so after the first frames the arena does not allocate anymore.
+    *   NOTE: An arena is not thread safe, every thread uses its own arena (see 'FrameArena::local').
+    */
+    class FrameArena : public std::pmr::memory_resource
+    {
+    public:
+        constexpr static size_t DEFAULT_CAPACITY = 1 << 20;
+
+    private:
+        struct block_t
+        {
+            std::unique_ptr<uint8_t[]> memory;
+            size_t size;
+        };
+
+        std::vector<block_t> blocks;
+        size_t current;         // block that is allocated from
+        size_t offset;          // used bytes of the current block
+        size_t _used;           // used bytes since the last reset, including padding
+        size_t _high_water;     // maximum of used bytes between two resets
+
+        void add_block(size_t size);
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void*, size_t, size_t) override     {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override   { return this == &other; }
+
+    public:
+        explicit FrameArena(size_t capacity = DEFAULT_CAPACITY);
+        virtual ~FrameArena(void) = default;
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator= (const FrameArena&) = delete;
+
+        /**
+        *   @brief Releases everything that has been allocated from the arena.
+        *   NOTE: No container may use memory of the arena anymore, e.g. reset at the begin of a frame.
+        */
+        void reset(void) noexcept;
+
+        /** @return Used bytes since the last reset. */
+        size_t used(void) const noexcept        { return this->_used; }
+
+        /** @return Maximum of used bytes between two resets. */
+        size_t high_water(void) const noexcept  { return this->_high_water; }
+
+        /** @return Bytes of every block of the arena. */
+        size_t capacity(void) const noexcept;
+
+        /** @return The arena of the calling thread, it is created by the first call of the thread. */
+        static FrameArena& local(void);
+    };
+};
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "frame_exporter.h"
+#include "image_writer.h"
+#include "../profiler/alloc_tracker.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace particles;
+
+namespace
+{
+    bool ends_with(const std::string& str, const char* suffix)
+    {
+        const size_t n = std::strlen(suffix);
+        return str.size() >= n && str.compare(str.size() - n, n, suffix) == 0;
+    }
+
+    // the pattern is the format string of snprintf, so it must contain exactly one conversion for an unsigned int,
+    // e.g. "%u" or "%05u", literal percent signs must be written as "%%"
+    bool is_frame_pattern(const std::string& pattern)
+    {
+        uint32_t conversions = 0;
+        for (size_t i = 0; i < pattern.size(); i++)
+        {
+            if (pattern[i] != '%') continue;
+            if (++i < pattern.size() && pattern[i] == '%') continue;
+
+            while (i < pattern.size() && std::strchr("-+ #0", pattern[i]) != nullptr) i++;
+            while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9') i++;
+            if (i < pattern.size() && pattern[i] == '.')
+            {
+                i++;
+                while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9') i++;
+            }
+            if (i == pattern.size() || pattern[i] != 'u')
+                return false;
+            conversions++;
+        }
+        return conversions == 1;
+    }
+
+    uint8_t clamp_u8(int32_t x)
+    {
+        return static_cast<uint8_t>(std::min(std::max(x, 0), 255));
+    }
+
+    // full range BT.601 in 8.8 fixed point, the chroma offset of 128 is added before the shift
+    uint8_t rgb_to_y(int32_t r, int32_t g, int32_t b) { return clamp_u8((77 * r + 150 * g + 29 * b + 128) >> 8); }
+    uint8_t rgb_to_u(int32_t r, int32_t g, int32_t b) { return clamp_u8((-43 * r - 85 * g + 128 * b + 32896) >> 8); }
+    uint8_t rgb_to_v(int32_t r, int32_t g, int32_t b) { return clamp_u8((128 * r - 107 * g - 21 * b + 32896) >> 8); }
+}
+
+FrameExporter::FrameExporter(void)
+{
+    this->format = FORMAT_IMAGES;
+    this->width = 0;
+    this->height = 0;
+    this->bgra = false;
+    this->stream = nullptr;
+    this->submitted = 0;
+    this->shutdown = false;
+    this->failed = false;
+    this->written = 0;
+}
+
+FrameExporter::~FrameExporter(void)
+{
+    try
+    {
+        this->close();
+    }
+    catch (std::exception&)
+    {
+        // errors of the workers are only reported by an explicit 'FrameExporter::close'
+    }
+}
+
+void FrameExporter::open(const char* path, uint32_t width, uint32_t height, uint32_t n_slots, bool bgra, uint32_t frame_rate, uint32_t n_threads)
+{
+    if (this->is_open())
+        throw std::runtime_error("FrameExporter has already been opened.");
+    if (width == 0 || height == 0)
+        throw std::invalid_argument("Frame size of FrameExporter::open must be bigger than 0.");
+    if (n_slots == 0)
+        throw std::invalid_argument("Number of slots of FrameExporter::open must be bigger than 0.");
+    if (frame_rate == 0)
+        throw std::invalid_argument("Frame rate of FrameExporter::open must be bigger than 0.");
+
+    this->path = path;
+    this->format = ends_with(this->path, ".y4m") ? FORMAT_Y4M : FORMAT_IMAGES;
+    if (this->format == FORMAT_IMAGES && !is_frame_pattern(this->path))
+        throw std::invalid_argument("Path of FrameExporter::open must be a \".y4m\" file or contain the frame number exactly once as unsigned integer, e.g. \"frame_%05u.png\" (literal percent signs as \"%%\").");
+
+    if (this->format == FORMAT_Y4M)
+    {
+        this->stream = std::fopen(path, "wb");
+        if (this->stream == nullptr)
+            throw std::runtime_error("Failed to create Y4M file \"" + this->path + "\".");
+        std::fprintf(this->stream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, frame_rate);
+    }
+
+    this->width = width;
+    this->height = height;
+    this->bgra = bgra;
+    this->slot_busy.assign(n_slots, false);
+    this->jobs.clear();
+    this->submitted = 0;
+    this->written = 0;
+    this->shutdown = false;
+    this->failed = false;
+    this->error.clear();
+
+    if (n_threads == 0)
+        n_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    for (uint32_t i = 0; i < n_threads; i++)
+        this->workers.emplace_back(&FrameExporter::worker_main, this);
+}
+
+void FrameExporter::close(void)
+{
+    if (!this->is_open()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->shutdown = true;
+    }
+    this->job_cv.notify_all();
+    for (std::thread& worker : this->workers)
+        worker.join();
+    this->workers.clear();
+
+    if (this->stream != nullptr)
+    {
+        if (std::fclose(this->stream) != 0)
+            this->fail("Failed to close Y4M file \"" + this->path + "\".");
+        this->stream = nullptr;
+    }
+    if (this->failed)
+        throw std::runtime_error("Frame export failed: " + this->error);
+}
+
+uint32_t FrameExporter::acquire(void)
+{
+    if (!this->is_open())
+        throw std::runtime_error("Cannot acquire a slot of a closed FrameExporter.");
+
+    std::unique_lock<std::mutex> lock(this->mtx);
+    std::vector<bool>::iterator free_slot;
+    this->slot_cv.wait(lock, [this, &free_slot]() {
+        free_slot = std::find(this->slot_busy.begin(), this->slot_busy.end(), false);
+        return this->failed || free_slot != this->slot_busy.end();
+    });
+    if (this->failed)
+        throw std::runtime_error("Frame export failed: " + this->error);
+
+    *free_slot = true;
+    return static_cast<uint32_t>(free_slot - this->slot_busy.begin());
+}
+
+void FrameExporter::submit(uint32_t slot, const uint8_t* pixels)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (slot >= this->slot_busy.size() || !this->slot_busy[slot])
+        throw std::invalid_argument("Slot of FrameExporter::submit has not been acquired.");
+
+    this->jobs.push_back({ slot, this->submitted++, pixels });
+    this->job_cv.notify_one();
+}
+
+void FrameExporter::worker_main(void)
+{
+    ALLOC_THREAD(profiler::ALLOC_EXPORT);
+    std::vector<uint8_t> scratch;
+    std::unique_lock<std::mutex> lock(this->mtx);
+    while (true)
+    {
+        this->job_cv.wait(lock, [this]() { return this->shutdown || !this->jobs.empty(); });
+        if (this->jobs.empty())
+            return;     // shutdown and every frame is encoded
+        const job_t job = this->jobs.front();
+        this->jobs.pop_front();
+        lock.unlock();
+
+        // convert out of the slot first, then it can be reused while the frame is written
+        try
+        {
+            this->convert(job, scratch);
+        }
+        catch (std::exception& e)
+        {
+            this->fail(e.what());
+        }
+
+        lock.lock();
+        this->slot_busy[job.slot] = false;
+        this->slot_cv.notify_all();
+        lock.unlock();
+
+        try
+        {
+            this->write(job, scratch);
+        }
+        catch (std::exception& e)
+        {
+            this->fail(e.what());
+        }
+        lock.lock();
+    }
+}
+
+void FrameExporter::convert(const job_t& job, std::vector<uint8_t>& scratch) const
+{
+    const uint32_t r_index = this->bgra ? 2 : 0;
+    const uint32_t b_index = this->bgra ? 0 : 2;
+    const uint8_t* src = job.pixels;
+    const size_t n_pixels = static_cast<size_t>(this->width) * this->height;
+
+    if (this->format == FORMAT_IMAGES)
+    {
+        scratch.resize(n_pixels * 4);
+        for (size_t i = 0; i < n_pixels; i++)
+        {
+            scratch[4 * i + 0] = src[4 * i + r_index];
+            scratch[4 * i + 1] = src[4 * i + 1];
+            scratch[4 * i + 2] = src[4 * i + b_index];
+            scratch[4 * i + 3] = src[4 * i + 3];
+        }
+        return;
+    }
+
+    // Y4M: full resolution luma plane followed by the 2x2 averaged chroma planes
+    const uint32_t cw = (this->width + 1) / 2;
+    const uint32_t ch = (this->height + 1) / 2;
+    const size_t n_chroma = static_cast<size_t>(cw) * ch;
+    scratch.resize(n_pixels + 2 * n_chroma);
+    uint8_t* y_plane = scratch.data();
+    uint8_t* u_plane = y_plane + n_pixels;
+    uint8_t* v_plane = u_plane + n_chroma;
+
+    for (size_t i = 0; i < n_pixels; i++)
+        y_plane[i] = rgb_to_y(src[4 * i + r_index], src[4 * i + 1], src[4 * i + b_index]);
+
+    for (uint32_t cy = 0; cy < ch; cy++)
+    {
+        const uint32_t y0 = 2 * cy;
+        const uint32_t y1 = std::min(y0 + 1, this->height - 1);
+        for (uint32_t cx = 0; cx < cw; cx++)
+        {
+            const uint32_t x0 = 2 * cx;
+            const uint32_t x1 = std::min(x0 + 1, this->width - 1);
+            const uint8_t* p[4] = {
+                src + 4 * (static_cast<size_t>(y0) * this->width + x0),
+                src + 4 * (static_cast<size_t>(y0) * this->width + x1),
+                src + 4 * (static_cast<size_t>(y1) * this->width + x0),
+                src + 4 * (static_cast<size_t>(y1) * this->width + x1)
+            };
+            const int32_t r = (p[0][r_index] + p[1][r_index] + p[2][r_index] + p[3][r_index] + 2) / 4;
+            const int32_t g = (p[0][1] + p[1][1] + p[2][1] + p[3][1] + 2) / 4;
+            const int32_t b = (p[0][b_index] + p[1][b_index] + p[2][b_index] + p[3][b_index] + 2) / 4;
+            u_plane[static_cast<size_t>(cy) * cw + cx] = rgb_to_u(r, g, b);
+            v_plane[static_cast<size_t>(cy) * cw + cx] = rgb_to_v(r, g, b);
+        }
+    }
+}
+
+void FrameExporter::write(const job_t& job, const std::vector<uint8_t>& scratch)
+{
+    if (this->format == FORMAT_IMAGES)
+    {
+        if (this->failed) return;
+        std::vector<char> file_path(this->path.size() + 32);
+        std::snprintf(file_path.data(), file_path.size(), this->path.c_str(), static_cast<unsigned int>(job.frame));
+        write_image(file_path.data(), scratch.data(), this->width, this->height);
+        return;
+    }
+
+    // every frame takes its turn, also after an error, so that no worker waits forever
+    std::unique_lock<std::mutex> lock(this->write_mtx);
+    this->write_cv.wait(lock, [this, &job]() { return this->written == job.frame; });
+    if (!this->failed)
+    {
+        std::fputs("FRAME\n", this->stream);
+        if (std::fwrite(scratch.data(), 1, scratch.size(), this->stream) != scratch.size())
+            this->fail("Failed to write Y4M file \"" + this->path + "\".");
+    }
+    this->written++;
+    this->write_cv.notify_all();
+}
+
+void FrameExporter::fail(const std::string& what)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (!this->failed)
+        this->error = what;
+    this->failed = true;
+    this->slot_cv.notify_all();
+}
\ No newline at end of file
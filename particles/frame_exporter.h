@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Class: FrameExporter
+    *   @brief Encodes rendered frames on worker threads, either as an image sequence (PNG or PPM)
+    *          or as a single raw Y4M stream (YUV 4:2:0, full range BT.601).
+    *          The pixels of a frame live in one of 'n_slots' slots that are owned by the caller,
+    *          e.g. persistently mapped readback buffers. A slot is acquired before the frame is
+    *          copied into it and is released by the worker as soon as the pixels have been converted,
+    *          so the renderer only waits if all slots are still being encoded.
+    *   NOTE: Y4M frames are written in submission order, images are written in any order.
+    */
+    class FrameExporter
+    {
+    public:
+        enum format_t
+        {
+            FORMAT_IMAGES,      // one image per frame, format chosen by the extension (see particles::write_image)
+            FORMAT_Y4M          // one YUV4MPEG2 stream
+        };
+
+    private:
+        struct job_t
+        {
+            uint32_t slot;
+            uint64_t frame;
+            const uint8_t* pixels;
+        };
+
+        std::string path;
+        format_t format;
+        uint32_t width, height;
+        bool bgra;
+        std::FILE* stream;                  // Y4M stream, nullptr for image sequences
+
+        std::vector<bool> slot_busy;
+        std::deque<job_t> jobs;
+        std::vector<std::thread> workers;
+        std::mutex mtx;
+        std::condition_variable job_cv, slot_cv;
+        uint64_t submitted;                 // number of submitted frames
+        bool shutdown;
+        std::atomic_bool failed;
+        std::string error;                  // first error of a worker, guarded by 'mtx'
+
+        // the Y4M stream is written without 'mtx', so that acquiring a slot never waits for the disk
+        std::mutex write_mtx;
+        std::condition_variable write_cv;
+        uint64_t written;                   // number of frames written to the Y4M stream
+
+        void worker_main(void);
+        void convert(const job_t& job, std::vector<uint8_t>& scratch) const;
+        void write(const job_t& job, const std::vector<uint8_t>& scratch);
+        void fail(const std::string& what);
+
+    public:
+        /**
+        *   @brief The default constructor does not open an export.
+        *   In order to export frames 'FrameExporter::open' must be called.
+        */
+        FrameExporter(void);
+
+        /** @brief Finishes the export if it is open. */
+        virtual ~FrameExporter(void);
+
+        /**
+        *   @brief Starts an export. Paths ending with ".y4m" create a Y4M stream, any other path is a
+        *          printf-pattern of the image files that gets the frame number, e.g. "frame_%05u.png".
+        *          The pattern must contain exactly one "%u" conversion (with optional flags, width and precision),
+        *          other percent signs must be written as "%%".
+        *   @param path: Path of the stream or pattern of the image files
+        *   @param width: Width of the frames
+        *   @param height: Height of the frames
+        *   @param n_slots: Number of slots of the caller, must be at least 1
+        *   @param bgra: 'true' if the pixels are BGRA8, 'false' if they are RGBA8
+        *   @param frame_rate: Frames per second of the Y4M stream
+        *   @param n_threads: Number of worker threads, 0 = number of hardware threads
+        */
+        void open(const char* path, uint32_t width, uint32_t height, uint32_t n_slots, bool bgra, uint32_t frame_rate = 60, uint32_t n_threads = 0);
+
+        /** @brief Waits until every submitted frame is encoded, stops the workers and closes the stream. */
+        void close(void);
+
+        /**
+        *   @brief Waits until a slot is free and reserves it.
+        *   @return The index of the reserved slot.
+        */
+        uint32_t acquire(void);
+
+        /**
+        *   @brief Queues a frame for encoding.
+        *   @param slot: Slot that has been reserved by 'FrameExporter::acquire'
+        *   @param pixels: Pixels of the frame, row by row from the top, they must stay valid until the slot is released
+        */
+        void submit(uint32_t slot, const uint8_t* pixels);
+
+        /** @return The number of frames that have been submitted. */
+        uint64_t frame_count(void) const noexcept   { return this->submitted; }
+
+        /** @return 'true' if an export is open. */
+        bool is_open(void) const noexcept           { return !this->workers.empty(); }
+    };
+};
\ No newline at end of file
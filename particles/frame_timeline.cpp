@@ -0,0 +1,82 @@
+#include "frame_timeline.h"
+#include <stdexcept>
+
+using namespace particles;
+
+FrameTimeline::FrameTimeline(void) : _submitted(0)
+{
+    this->device = VK_NULL_HANDLE;
+    this->semaphore = VK_NULL_HANDLE;
+}
+
+FrameTimeline::~FrameTimeline(void)
+{
+    if (this->semaphore != VK_NULL_HANDLE)
+        throw std::runtime_error("FrameTimeline must be cleared before destructor gets called.");
+}
+
+VkResult FrameTimeline::init(VkDevice device)
+{
+    if (this->semaphore != VK_NULL_HANDLE)
+        throw std::runtime_error("FrameTimeline has already been initialized.");
+    if (device == VK_NULL_HANDLE)
+        throw std::invalid_argument("Device of FrameTimeline::init is a VK_NULL_HANDLE.");
+
+    VkSemaphoreTypeCreateInfo type_ci = {};
+    type_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_ci.pNext = nullptr;
+    type_ci.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_ci.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_ci = {};
+    semaphore_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_ci.pNext = &type_ci;
+    semaphore_ci.flags = 0;
+
+    VkResult res = vkCreateSemaphore(device, &semaphore_ci, nullptr, &this->semaphore);
+    if (res != VK_SUCCESS) return res;
+
+    this->device = device;
+    this->_submitted.store(0, std::memory_order_relaxed);
+    return VK_SUCCESS;
+}
+
+void FrameTimeline::clear(void)
+{
+    if (this->semaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(this->device, this->semaphore, nullptr);
+        this->semaphore = VK_NULL_HANDLE;
+        this->device = VK_NULL_HANDLE;
+        this->_submitted.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t FrameTimeline::completed(void) const
+{
+    uint64_t value = 0;
+    if (this->semaphore != VK_NULL_HANDLE && vkGetSemaphoreCounterValue(this->device, this->semaphore, &value) != VK_SUCCESS)
+        throw std::runtime_error("Failed to read the value of the frame timeline.");
+    return value;
+}
+
+bool FrameTimeline::wait(uint64_t frame, uint64_t timeout_ns) const
+{
+    if (this->semaphore == VK_NULL_HANDLE)
+        return false;
+
+    VkSemaphoreWaitInfo wait_info = {};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.pNext = nullptr;
+    wait_info.flags = 0;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &this->semaphore;
+    wait_info.pValues = &frame;
+
+    const VkResult res = vkWaitSemaphores(this->device, &wait_info, timeout_ns);
+    if (res == VK_TIMEOUT)
+        return false;
+    if (res != VK_SUCCESS)
+        throw std::runtime_error("Failed to wait for the frame timeline.");
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan_absraction.h>
+#include "particle_sink.h"
+#include <atomic>
+
+namespace particles
+{
+    /**
+    *   Class: FrameTimeline
+    *   @brief Frame counter of the GPU, implemented with a timeline semaphore (Vulkan 1.2 or VK_KHR_timeline_semaphore).
+    *          The render thread signals the semaphore with the number of the frame in every submission that reads
+    *          the particle buffer, so that producers can query or wait for frames without a round trip through
+    *          the render thread. Waiting only blocks the calling thread.
+    *   NOTE: The device must have been created with the 'timelineSemaphore' feature enabled.
+    */
+    class FrameTimeline : public FrameCounter
+    {
+    private:
+        VkDevice device;
+        VkSemaphore semaphore;
+        std::atomic<uint64_t> _submitted;
+
+    public:
+        FrameTimeline(void);
+        virtual ~FrameTimeline(void);
+
+        FrameTimeline(const FrameTimeline&) = delete;
+        FrameTimeline& operator= (const FrameTimeline&) = delete;
+
+        /** @brief Creates the timeline semaphore with the value 0. */
+        VkResult init(VkDevice device);
+
+        /** @brief Destroys the semaphore, no thread may wait for it anymore. */
+        void clear(void);
+
+        /** @return The value that the next submitted frame must signal, only called by the render thread. */
+        uint64_t next(void) const noexcept              { return this->_submitted.load(std::memory_order_relaxed) + 1; }
+
+        /**
+        *   @brief Publishes that the frame @param frame has been submitted, must be called by the render thread
+        *          after the vkQueueSubmit that signals the semaphore with @param frame.
+        */
+        void mark_submitted(uint64_t frame) noexcept    { this->_submitted.store(frame, std::memory_order_release); }
+
+        uint64_t submitted(void) const noexcept override { return this->_submitted.load(std::memory_order_acquire); }
+        uint64_t completed(void) const override;
+        bool wait(uint64_t frame, uint64_t timeout_ns) const override;
+
+        /** @return The timeline semaphore, it is signaled in the submissions of the render thread. */
+        VkSemaphore handle(void) const noexcept         { return this->semaphore; }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "host_particle_sink.h"
+#include <stdexcept>
+
+using namespace particles;
+
+HostParticleSink::HostParticleSink(void)
+{
+    this->draw_count = 0;
+}
+
+HostParticleSink::HostParticleSink(uint32_t capacity) : HostParticleSink()
+{
+    this->init(capacity);
+}
+
+HostParticleSink::~HostParticleSink(void)
+{
+    this->clear();
+}
+
+void HostParticleSink::init(uint32_t capacity)
+{
+    if (this->_initialized)
+        throw std::runtime_error("HostParticleSink has already been initialized.");
+    if (capacity == 0)
+        throw std::invalid_argument("Capacity of HostParticleSink::init must be bigger than 0.");
+
+    this->particles.resize(capacity);
+    this->draw_count = 0;
+    this->_initialized = true;
+}
+
+void HostParticleSink::clear(void)
+{
+    if (this->_initialized)
+    {
+        this->_initialized = false;
+        this->particles.clear();
+        this->particles.shrink_to_fit();
+        this->draw_count = 0;
+    }
+}
\ No newline at end of file
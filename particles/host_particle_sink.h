@@ -0,0 +1,60 @@
+#pragma once
+
+#include "particle_sink.h"
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Class: HostParticleSink
+    *   @brief A particle sink in plain host memory, it needs neither Vulkan nor a window.
+    *          Used to run the pool and the engines headless, e.g. on servers without a GPU,
+    *          in tests and in benchmarks.
+    */
+    class HostParticleSink : public ParticleSink
+    {
+    private:
+        std::vector<particle_t> particles;
+        uint32_t draw_count;
+
+        particle_t* get_particle_buffer(void) noexcept override    { return this->particles.data(); }
+        uint32_t* get_draw_count(void) noexcept override            { return &this->draw_count; }
+
+    public:
+        /**
+        *   @brief The default constructor does not initialize the HostParticleSink.
+        *   In order to initialize the sink 'HostParticleSink::init' must be called.
+        */
+        HostParticleSink(void);
+
+        /**
+        *   @brief Constructor that initializes the sink.
+        *   @param capacity: The maximum number of particles the sink can store.
+        */
+        explicit HostParticleSink(uint32_t capacity);
+
+        /** @brief Destructs the object, a HostParticleSink does not need to be cleared explicitly. */
+        virtual ~HostParticleSink(void);
+
+        /**
+        *   @brief Completely initializes the HostParticleSink.
+        *   @param capacity: The maximum number of particles the sink can store.
+        */
+        void init(uint32_t capacity);
+
+        /**
+        *   @brief Completely deinitializes the HostParticleSink.
+        *   NOTE: A pool that uses the sink can no longer allocate or free particles afterwards.
+        */
+        void clear(void);
+
+        /** @return The maximum number of particles the particle-buffer can store. */
+        uint32_t capacity(void) const noexcept override { return static_cast<uint32_t>(this->particles.size()); }
+
+        /** @return A pointer to the first particle, free particles have a NAN-position. */
+        const particle_t* data(void) const noexcept     { return this->particles.data(); }
+
+        /** @return The number of particles that would be drawn (highest allocated index + 1). */
+        uint32_t count(void) const noexcept             { return this->draw_count; }
+    };
+};
\ No newline at end of file
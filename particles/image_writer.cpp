@@ -0,0 +1,48 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "image_writer.h"
+#include <stb/stb_image_write.h>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void particles::write_ppm(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    std::FILE* file = std::fopen(path, "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Failed to create image file \"" + std::string(path) + "\".");
+
+    std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* src = rgba + static_cast<size_t>(y) * width * 4;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            row[3 * x + 0] = src[4 * x + 0];
+            row[3 * x + 1] = src[4 * x + 1];
+            row[3 * x + 2] = src[4 * x + 2];
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    const bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed)
+        throw std::runtime_error("Failed to write image file \"" + std::string(path) + "\".");
+}
+
+void particles::write_png(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    if (stbi_write_png(path, static_cast<int>(width), static_cast<int>(height), 4, rgba, static_cast<int>(width * 4)) == 0)
+        throw std::runtime_error("Failed to write image file \"" + std::string(path) + "\".");
+}
+
+void particles::write_image(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    const size_t len = std::strlen(path);
+    if (len >= 4 && std::strcmp(path + len - 4, ".png") == 0)
+        write_png(path, rgba, width, height);
+    else
+        write_ppm(path, rgba, width, height);
+}
\ No newline at end of file
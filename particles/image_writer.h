@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace particles
+{
+    /**
+    *   @brief Writes an RGBA8 image as binary PPM (P6), the alpha channel is dropped.
+    *   @param path: Path of the image file, an existing file is overwritten
+    *   @param rgba: Pixels, row by row from the top, 4 bytes per pixel
+    *   @param width: Width of the image
+    *   @param height: Height of the image
+    */
+    void write_ppm(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    /** @brief Writes an RGBA8 image as PNG, see 'particles::write_ppm' for the parameters. */
+    void write_png(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    /** @brief Writes an RGBA8 image as PNG if @param path ends with ".png" and as PPM otherwise. */
+    void write_image(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height);
+};
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace particles;
+
+MappedFile::MappedFile(void)
+{
+    this->_data = nullptr;
+    this->_size = 0;
+#ifdef _WIN32
+    this->file_handle = INVALID_HANDLE_VALUE;
+    this->mapping_handle = nullptr;
+#endif
+}
+
+MappedFile::MappedFile(const char* path, bool populate) : MappedFile()
+{
+    this->open(path, populate);
+}
+
+MappedFile::~MappedFile(void)
+{
+    this->close();
+}
+
+void MappedFile::open(const char* path, bool populate)
+{
+    if (this->is_open())
+        throw std::runtime_error("MappedFile has already been opened.");
+
+#ifdef _WIN32
+    // there is no MAP_POPULATE, the pages are faulted in on access
+    (void)populate;
+    this->file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->file_handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open file \"" + std::string(path) + "\".");
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(this->file_handle, &size) || size.QuadPart == 0)
+    {
+        this->close();
+        throw std::runtime_error("Failed to map file \"" + std::string(path) + "\", it is empty.");
+    }
+    this->mapping_handle = CreateFileMappingA(this->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = (this->mapping_handle != nullptr) ? MapViewOfFile(this->mapping_handle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        this->close();
+        throw std::runtime_error("Failed to map file \"" + std::string(path) + "\".");
+    }
+    this->_size = static_cast<size_t>(size.QuadPart);
+    this->_data = static_cast<const uint8_t*>(view);
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open file \"" + std::string(path) + "\".");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Failed to map file \"" + std::string(path) + "\", it is empty.");
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (populate) flags |= MAP_POPULATE;
+#else
+    (void)populate;
+#endif
+    void* mapping = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    ::close(fd);    // the mapping keeps the file open
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("Failed to map file \"" + std::string(path) + "\".");
+    this->_size = size;
+    this->_data = static_cast<const uint8_t*>(mapping);
+#endif
+}
+
+void MappedFile::close(void)
+{
+#ifdef _WIN32
+    if (this->_data != nullptr)
+        UnmapViewOfFile(this->_data);
+    if (this->mapping_handle != nullptr)
+        CloseHandle(this->mapping_handle);
+    if (this->file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(this->file_handle);
+    this->file_handle = INVALID_HANDLE_VALUE;
+    this->mapping_handle = nullptr;
+#else
+    if (this->_data != nullptr)
+        munmap(const_cast<uint8_t*>(this->_data), this->_size);
+#endif
+    this->_data = nullptr;
+    this->_size = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const noexcept
+{
+    if (this->_data == nullptr || offset >= this->_size) return;
+    if (size > this->_size - offset) size = this->_size - offset;
+
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(this->_data + offset);
+    range.NumberOfBytes = size;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // madvise needs a page aligned address
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset & ~(page - 1);
+    madvise(const_cast<uint8_t*>(this->_data + begin), size + (offset - begin), MADV_WILLNEED);
+#endif
+}
\ No newline at end of file
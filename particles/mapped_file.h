@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particles
+{
+    /**
+    *   Class: MappedFile
+    *   @brief Read-only memory mapping of a whole file (mmap, MapViewOfFile on windows).
+    *          Pages are only read from disk when they are accessed, so files that are much bigger
+    *          than the memory can be mapped as well.
+    */
+    class MappedFile
+    {
+    private:
+        const uint8_t* _data;
+        size_t _size;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#endif
+
+    public:
+        /**
+        *   @brief The default constructor does not map a file.
+        *   In order to map a file 'MappedFile::open' must be called.
+        */
+        MappedFile(void);
+
+        /** @brief Constructor that maps the file at @param path, see 'MappedFile::open'. */
+        explicit MappedFile(const char* path, bool populate = false);
+
+        /** @brief Unmaps the file if it is mapped. */
+        virtual ~MappedFile(void);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+        *   @brief Maps a file read-only.
+        *   @param path: Path of the file, it must not be empty
+        *   @param populate: If 'true', the whole file is read ahead with the mapping (MAP_POPULATE).
+        *                    Use it if the whole file is copied anyway, it saves a page fault per page.
+        */
+        void open(const char* path, bool populate = false);
+
+        /** @brief Unmaps the file. */
+        void close(void);
+
+        /**
+        *   @brief Hints that a part of the file is accessed soon, so that it is read asynchronously.
+        *   @param offset: Offset of the part in bytes
+        *   @param size: Size of the part in bytes
+        */
+        void prefetch(size_t offset, size_t size) const noexcept;
+
+        const uint8_t* data(void) const noexcept    { return this->_data; }
+        size_t size(void) const noexcept            { return this->_size; }
+        bool is_open(void) const noexcept           { return (this->_data != nullptr); }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "page_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace particles;
+
+namespace
+{
+    constexpr char PAGE_FILE_MAGIC[4] = { 'P', 'P', 'A', 'G' };
+    constexpr uint32_t PAGE_FILE_VERSION = 1;
+    constexpr uint64_t PAGE_FILE_ALIGNMENT = 4096;
+
+    uint64_t align_up(uint64_t x, uint64_t alignment) { return (x + alignment - 1) & ~(alignment - 1); }
+
+    page_file_page_t empty_page(void)
+    {
+        page_file_page_t page = {};
+        for (int i = 0; i < 3; i++)
+        {
+            page.bounds_min[i] = std::numeric_limits<float>::max();
+            page.bounds_max[i] = -std::numeric_limits<float>::max();
+        }
+        page.importance = 1.0f;
+        return page;
+    }
+};
+
+ParticlePageFile::ParticlePageFile(void)
+{
+    this->file = nullptr;
+    this->header = {};
+}
+
+ParticlePageFile::~ParticlePageFile(void)
+{
+    this->close();
+}
+
+void ParticlePageFile::create(const char* path, uint64_t n_particles, uint32_t page_size)
+{
+    if (this->file != nullptr)
+        throw std::runtime_error("ParticlePageFile has already been opened.");
+    if (page_size == 0)
+        throw std::invalid_argument("Page size of ParticlePageFile::create must be bigger than 0.");
+    if (n_particles == 0 || (n_particles + page_size - 1) / page_size > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("Particle count of ParticlePageFile::create must be in the range [1, 2^32 pages].");
+
+    this->file = std::fopen(path, "w+b");
+    if (this->file == nullptr)
+        throw std::runtime_error("Failed to create page file \"" + std::string(path) + "\".");
+
+    std::memcpy(this->header.magic, PAGE_FILE_MAGIC, sizeof(PAGE_FILE_MAGIC));
+    this->header.version = PAGE_FILE_VERSION;
+    this->header.page_size = page_size;
+    this->header.n_pages = static_cast<uint32_t>((n_particles + page_size - 1) / page_size);
+    this->header.n_particles = n_particles;
+    this->header.data_offset = align_up(sizeof(page_file_header_t) + this->header.n_pages * sizeof(page_file_page_t), PAGE_FILE_ALIGNMENT);
+    this->table.assign(this->header.n_pages, empty_page());
+    this->flush();
+}
+
+void ParticlePageFile::open(const char* path)
+{
+    if (this->file != nullptr)
+        throw std::runtime_error("ParticlePageFile has already been opened.");
+
+    this->file = std::fopen(path, "r+b");
+    if (this->file == nullptr)
+        throw std::runtime_error("Failed to open page file \"" + std::string(path) + "\".");
+
+    page_file_header_t header;
+    const bool valid = std::fread(&header, sizeof(header), 1, this->file) == 1 &&
+        std::memcmp(header.magic, PAGE_FILE_MAGIC, sizeof(PAGE_FILE_MAGIC)) == 0 &&
+        header.version == PAGE_FILE_VERSION && header.page_size > 0 &&
+        header.n_pages == (header.n_particles + header.page_size - 1) / header.page_size;
+    if (valid)
+    {
+        this->table.resize(header.n_pages);
+        if (std::fread(this->table.data(), sizeof(page_file_page_t), header.n_pages, this->file) == header.n_pages)
+        {
+            this->header = header;
+            return;
+        }
+    }
+    std::fclose(this->file);
+    this->file = nullptr;
+    this->table.clear();
+    throw std::runtime_error("File \"" + std::string(path) + "\" is not a valid page file.");
+}
+
+void ParticlePageFile::close(void)
+{
+    if (this->file != nullptr)
+    {
+        this->flush();
+        std::fclose(this->file);
+        this->file = nullptr;
+        this->header = {};
+        this->table.clear();
+    }
+}
+
+void ParticlePageFile::flush(void)
+{
+    if (this->file == nullptr) return;
+    this->seek(0);
+    std::fwrite(&this->header, sizeof(this->header), 1, this->file);
+    std::fwrite(this->table.data(), sizeof(page_file_page_t), this->table.size(), this->file);
+    if (std::fflush(this->file) != 0 || std::ferror(this->file) != 0)
+        throw std::runtime_error("Failed to write page file.");
+}
+
+void ParticlePageFile::seek(uint64_t offset)
+{
+#ifdef _WIN32
+    const int result = _fseeki64(this->file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    const int result = fseeko(this->file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    if (result != 0)
+        throw std::runtime_error("Failed to seek in page file.");
+}
+
+uint64_t ParticlePageFile::page_offset(uint32_t page) const noexcept
+{
+    return this->header.data_offset + static_cast<uint64_t>(page) * this->header.page_size * sizeof(particle_t);
+}
+
+uint32_t ParticlePageFile::page_particles(uint32_t page) const noexcept
+{
+    const uint64_t first = static_cast<uint64_t>(page) * this->header.page_size;
+    return static_cast<uint32_t>(std::min<uint64_t>(this->header.page_size, this->header.n_particles - first));
+}
+
+void ParticlePageFile::initialize_page(uint32_t page)
+{
+    if (this->table[page].written) return;
+    particle_t free_particle = {};
+    free_particle.pos = glm::vec3(NAN);
+    const std::vector<particle_t> particles(this->page_particles(page), free_particle);
+    this->seek(this->page_offset(page));
+    if (std::fwrite(particles.data(), sizeof(particle_t), particles.size(), this->file) != particles.size())
+        throw std::runtime_error("Failed to write page file.");
+    this->table[page].written = 1;
+}
+
+void ParticlePageFile::read_page(uint32_t page, particle_t* particles)
+{
+    if (page >= this->header.n_pages)
+        throw std::out_of_range("Page of ParticlePageFile::read_page is out of range.");
+
+    const uint32_t n = this->page_particles(page);
+    if (!this->table[page].written)
+    {
+        for (uint32_t i = 0; i < n; i++)
+            particles[i].pos = glm::vec3(NAN);
+        return;
+    }
+    this->seek(this->page_offset(page));
+    if (std::fread(particles, sizeof(particle_t), n, this->file) != n)
+        throw std::runtime_error("Failed to read page file, it is truncated.");
+}
+
+void ParticlePageFile::write_page(uint32_t page, const particle_t* particles)
+{
+    if (page >= this->header.n_pages)
+        throw std::out_of_range("Page of ParticlePageFile::write_page is out of range.");
+
+    const uint32_t n = this->page_particles(page);
+    this->seek(this->page_offset(page));
+    if (std::fwrite(particles, sizeof(particle_t), n, this->file) != n)
+        throw std::runtime_error("Failed to write page file.");
+
+    // the whole page is known, so the bounding box can shrink as well
+    const float importance = this->table[page].importance;
+    this->table[page] = empty_page();
+    this->table[page].importance = importance;
+    this->table[page].written = 1;
+    this->extend_bounds(page, particles, n);
+}
+
+void ParticlePageFile::read(uint64_t first, particle_t* particles, uint32_t n)
+{
+    if (first + n > this->header.n_particles)
+        throw std::out_of_range("Particles of ParticlePageFile::read are out of range.");
+
+    while (n > 0)
+    {
+        const uint32_t page = static_cast<uint32_t>(first / this->header.page_size);
+        const uint32_t offset = static_cast<uint32_t>(first % this->header.page_size);
+        const uint32_t count = std::min(n, this->header.page_size - offset);
+        if (this->table[page].written)
+        {
+            this->seek(this->page_offset(page) + offset * sizeof(particle_t));
+            if (std::fread(particles, sizeof(particle_t), count, this->file) != count)
+                throw std::runtime_error("Failed to read page file, it is truncated.");
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; i++)
+                particles[i].pos = glm::vec3(NAN);
+        }
+        first += count;
+        particles += count;
+        n -= count;
+    }
+}
+
+void ParticlePageFile::write(uint64_t first, const particle_t* particles, uint32_t n)
+{
+    if (first + n > this->header.n_particles)
+        throw std::out_of_range("Particles of ParticlePageFile::write are out of range.");
+
+    while (n > 0)
+    {
+        const uint32_t page = static_cast<uint32_t>(first / this->header.page_size);
+        const uint32_t offset = static_cast<uint32_t>(first % this->header.page_size);
+        const uint32_t count = std::min(n, this->header.page_size - offset);
+        if (offset == 0 && count == this->page_particles(page))
+        {
+            this->write_page(page, particles);
+        }
+        else
+        {
+            this->initialize_page(page);
+            this->seek(this->page_offset(page) + offset * sizeof(particle_t));
+            if (std::fwrite(particles, sizeof(particle_t), count, this->file) != count)
+                throw std::runtime_error("Failed to write page file.");
+            this->extend_bounds(page, particles, count);
+        }
+        first += count;
+        particles += count;
+        n -= count;
+    }
+}
+
+void ParticlePageFile::extend_bounds(uint32_t page, const particle_t* particles, uint32_t n) noexcept
+{
+    page_file_page_t& entry = this->table[page];
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const glm::vec3& pos = particles[i].pos;
+        if (std::isnan(pos.x)) continue;
+        for (int a = 0; a < 3; a++)
+        {
+            entry.bounds_min[a] = std::min(entry.bounds_min[a], pos[a]);
+            entry.bounds_max[a] = std::max(entry.bounds_max[a], pos[a]);
+        }
+    }
+}
+
+void ParticlePageFile::set_importance(uint32_t page, float importance)
+{
+    if (page >= this->header.n_pages)
+        throw std::out_of_range("Page of ParticlePageFile::set_importance is out of range.");
+    this->table[page].importance = importance;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "particle_types.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Particle page file layout, little endian:
+    *       header:     page_file_header_t
+    *       table:      page_file_page_t[n_pages]
+    *       pages:      particle_t[page_size] per page, starting at 'data_offset' (page aligned)
+    *
+    *   The file is the backing store of a particle dataset that is bigger than the particle-buffer.
+    *   Pages that have never been written have no data on disk and their particles read as free (NAN-position).
+    */
+    struct page_file_header_t
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t page_size;         // number of particles per page
+        uint32_t n_pages;
+        uint64_t n_particles;
+        uint64_t data_offset;
+    };
+
+    struct page_file_page_t
+    {
+        float bounds_min[3];        // bounding box of the valid particles, empty if min > max
+        float bounds_max[3];
+        float importance;           // user-defined weight for paging, 0 = never resident
+        uint32_t written;           // 1 if the page has data on disk
+    };
+
+    /**
+    *   Class: ParticlePageFile
+    *   @brief Reads and writes whole pages or particle ranges of a page file. The page table
+    *          with the bounding box of every page is kept in memory and written by 'ParticlePageFile::flush'.
+    *   NOTE: The class is not thread-safe.
+    */
+    class ParticlePageFile
+    {
+    private:
+        std::FILE* file;
+        page_file_header_t header;
+        std::vector<page_file_page_t> table;
+
+        void seek(uint64_t offset);
+        uint64_t page_offset(uint32_t page) const noexcept;
+
+        /** @brief Writes free particles into a page that has never been written. */
+        void initialize_page(uint32_t page);
+
+    public:
+        /** @brief Default number of particles per page (512 KiB). */
+        constexpr static uint32_t DEFAULT_PAGE_SIZE = 16384;
+
+        /**
+        *   @brief The default constructor does not open a file.
+        *   In order to use a page file 'ParticlePageFile::create' or 'ParticlePageFile::open' must be called.
+        */
+        ParticlePageFile(void);
+
+        /** @brief Flushes and closes the file if it is open. */
+        virtual ~ParticlePageFile(void);
+
+        /**
+        *   @brief Creates an empty page file, an existing file is overwritten.
+        *   @param path: Path of the page file
+        *   @param n_particles: Number of particles in the dataset
+        *   @param page_size: Number of particles per page
+        */
+        void create(const char* path, uint64_t n_particles, uint32_t page_size = DEFAULT_PAGE_SIZE);
+
+        /** @brief Opens an existing page file for reading and writing. */
+        void open(const char* path);
+
+        /** @brief Writes the page table and closes the file. */
+        void close(void);
+
+        /** @brief Writes the page table and flushes the file. */
+        void flush(void);
+
+        /**
+        *   @brief Reads a whole page.
+        *   @param page: Index of the page
+        *   @param particles: Destination with space for 'page_particles(page)' particles
+        */
+        void read_page(uint32_t page, particle_t* particles);
+
+        /** @brief Writes a whole page and recomputes its bounding box. */
+        void write_page(uint32_t page, const particle_t* particles);
+
+        /**
+        *   @brief Reads a range of particles, the range may span multiple pages.
+        *   @param first: Index of the first particle in the dataset
+        *   @param particles: Destination with space for @param n particles
+        */
+        void read(uint64_t first, particle_t* particles, uint32_t n);
+
+        /** @brief Writes a range of particles and extends the bounding boxes of the written pages. */
+        void write(uint64_t first, const particle_t* particles, uint32_t n);
+
+        /** @brief Extends the bounding box of @param page by @param n particles, free particles are skipped. */
+        void extend_bounds(uint32_t page, const particle_t* particles, uint32_t n) noexcept;
+
+        /** @brief Sets the importance of a page, pages with a higher importance are paged in first. */
+        void set_importance(uint32_t page, float importance);
+
+        /** @return The number of particles of @param page, only the last page can be smaller than the page size. */
+        uint32_t page_particles(uint32_t page) const noexcept;
+
+        const page_file_page_t& page(uint32_t page) const noexcept  { return this->table[page]; }
+        uint32_t page_count(void) const noexcept                    { return this->header.n_pages; }
+        uint32_t page_size(void) const noexcept                     { return this->header.page_size; }
+        uint64_t particle_count(void) const noexcept                { return this->header.n_particles; }
+        bool is_open(void) const noexcept                           { return (this->file != nullptr); }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "particle_engine.h"
+#include "../profiler/profiler.h"
+#include "../metrics/metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace particles;
+
+namespace
+{
+    /** @return 'false' if the bounding box is completely outside of one of the frustum planes of @param vp. */
+    bool frustum_visible(const glm::mat4& vp, const page_file_page_t& page)
+    {
+        // Planes of the clip space (Gribb-Hartmann), the near plane of OpenGL is used because
+        // it is further away from the camera than the one of Vulkan, so the test is conservative.
+        for (int plane = 0; plane < 5; plane++)
+        {
+            const int row = plane / 2;
+            const float sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+            float n[4];
+            for (int col = 0; col < 4; col++)
+                n[col] = vp[col][3] + sign * vp[col][row];
+
+            // the corner of the box that is the furthest in the direction of the plane normal
+            float d = n[3];
+            for (int a = 0; a < 3; a++)
+                d += n[a] * ((n[a] >= 0.0f) ? page.bounds_max[a] : page.bounds_min[a]);
+            if (d < 0.0f) return false;
+        }
+        return true;
+    }
+
+    float page_distance(const page_file_page_t& page, const glm::vec3& pos)
+    {
+        float d2 = 0.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            const float d = std::max(std::max(page.bounds_min[i] - pos[i], pos[i] - page.bounds_max[i]), 0.0f);
+            d2 += d * d;
+        }
+        return std::sqrt(d2);
+    }
+};
+
+PagedParticleEngine::PagedParticleEngine(void)
+{
+    this->pool = nullptr;
+    this->range = nullptr;
+    this->n_slots = 0;
+    this->budget = 0;
+    this->pass = 0;
+    this->_page_ins = 0;
+    this->_page_outs = 0;
+    this->_resident_pages = 0;
+    this->io_failed = false;
+    this->view_projection = glm::mat4(1.0f);
+    this->camera = glm::vec3(0.0f);
+    this->has_view = false;
+    this->view_changed = false;
+}
+
+PagedParticleEngine::PagedParticleEngine(ParticlePool& pool, const char* path, uint32_t budget) : PagedParticleEngine()
+{
+    this->init(pool, path, budget);
+}
+
+PagedParticleEngine::~PagedParticleEngine(void)
+{
+    this->stop();
+}
+
+void PagedParticleEngine::init(ParticlePool& pool, const char* path, uint32_t budget)
+{
+    if (this->base_running())
+        throw std::runtime_error("Cannot reinitialize running particle engine (PagedParticleEngine).");
+
+    this->file.close();
+    this->file.open(path);
+    if (budget < this->file.page_size())
+    {
+        this->file.close();
+        throw std::invalid_argument("Budget of PagedParticleEngine::init must be at least one page.");
+    }
+    this->pool = &pool;
+    this->budget = budget;
+    this->pages.assign(this->file.page_count(), page_state_t{ NOT_RESIDENT, false, 0 });
+}
+
+void PagedParticleEngine::init(ParticlePool& pool, const char* path, uint32_t budget, uint64_t n_particles, uint32_t page_size)
+{
+    if (this->base_running())
+        throw std::runtime_error("Cannot reinitialize running particle engine (PagedParticleEngine).");
+    if (budget < page_size)
+        throw std::invalid_argument("Budget of PagedParticleEngine::init must be at least one page.");
+
+    this->file.close();
+    this->file.create(path, n_particles, page_size);
+    this->pool = &pool;
+    this->budget = budget;
+    this->pages.assign(this->file.page_count(), page_state_t{ NOT_RESIDENT, false, 0 });
+}
+
+void PagedParticleEngine::start(void)
+{
+    if (this->pool == nullptr)
+        throw std::runtime_error("Cannot start uninitialized particle engine (PagedParticleEngine).");
+    if (this->base_running()) return;
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->n_slots = std::min(this->budget / this->file.page_size(), this->file.page_count());
+    this->range = this->pool->allocate_range(this->n_slots * this->file.page_size());
+    if (this->range == nullptr)
+    {
+        this->n_slots = 0;
+        throw std::bad_alloc();
+    }
+    this->slot_pages.assign(this->n_slots, NOT_RESIDENT);
+
+    // free slots are not visible
+    for (size_t i = 0; i < static_cast<size_t>(this->n_slots) * this->file.page_size(); i++)
+        this->range[i].pos = glm::vec3(NAN);
+    this->pass = 0;
+    this->_resident_pages = 0;
+    this->io_failed = false;
+    {
+        std::lock_guard<std::mutex> view_lock(this->view_mtx);
+        this->view_changed = true;
+    }
+    this->start_base(this);
+}
+
+void PagedParticleEngine::stop(void)
+{
+    this->stop_base();  // stop paging first, then the dirty pages can be written back
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->range != nullptr)
+    {
+        for (uint32_t slot = 0; slot < this->n_slots; slot++)
+        {
+            if (this->slot_pages[slot] != NOT_RESIDENT)
+                this->page_out(this->slot_pages[slot]);
+        }
+        this->pool->free_range(this->range, this->n_slots * this->file.page_size());
+        this->range = nullptr;
+        this->n_slots = 0;
+        this->slot_pages.clear();
+    }
+    if (this->file.is_open())
+        this->file.flush();
+}
+
+void PagedParticleEngine::page_out(uint32_t page)
+{
+    page_state_t& state = this->pages[page];
+    particle_t* slot = this->slot_address(state.slot);
+    const uint32_t n = this->file.page_particles(page);
+
+    // The page is written back before the slot is hidden, if the write fails the page stays resident and dirty.
+    // The slot is not modified during the write, writes to the page are blocked by the lock.
+    if (state.dirty)
+        this->file.write_page(page, slot);
+    for (uint32_t i = 0; i < n; i++)
+        slot[i].pos = glm::vec3(NAN);
+
+    this->slot_pages[state.slot] = NOT_RESIDENT;
+    state.slot = NOT_RESIDENT;
+    state.dirty = false;
+    ++this->_page_outs;
+    --this->_resident_pages;
+}
+
+void PagedParticleEngine::page_in(uint32_t page, uint32_t slot)
+{
+    // The page is read directly into the slot. The renderer may see a part of the page while it is read,
+    // those are particles of the page. If the read fails, the slot is hidden again and stays free.
+    particle_t* particles = this->slot_address(slot);
+    const uint32_t n = this->file.page_particles(page);
+    try
+    {
+        this->file.read_page(page, particles);
+    }
+    catch (std::exception&)
+    {
+        for (uint32_t i = 0; i < n; i++)
+            particles[i].pos = glm::vec3(NAN);
+        throw;
+    }
+
+    this->slot_pages[slot] = page;
+    this->pages[page].slot = slot;
+    this->pages[page].dirty = false;
+    ++this->_page_ins;
+    ++this->_resident_pages;
+}
+
+void PagedParticleEngine::choose_pages(const glm::mat4& view_projection, const glm::vec3& camera, bool has_view, std::vector<uint32_t>& wanted)
+{
+    std::pmr::vector<std::pair<float, uint32_t>> ranked(&FrameArena::local());
+    ranked.reserve(this->file.page_count());
+    for (uint32_t i = 0; i < this->file.page_count(); i++)
+    {
+        const page_file_page_t& page = this->file.page(i);
+        const bool empty = page.bounds_min[0] > page.bounds_max[0];
+        if (empty || !(page.importance > 0.0f)) continue;
+        if (has_view && !frustum_visible(view_projection, page)) continue;
+        const float priority = has_view ? page.importance / (1.0f + page_distance(page, camera)) : page.importance;
+        ranked.emplace_back(priority, i);
+    }
+
+    // only as many pages as there are slots can be resident
+    const size_t n = std::min<size_t>(ranked.size(), this->n_slots);
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+        [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+    wanted.resize(n);
+    for (size_t i = 0; i < n; i++)
+        wanted[i] = ranked[i].second;
+}
+
+void PagedParticleEngine::run(const std::atomic_bool& running, void* param)
+{
+    PROFILE_THREAD("PagedParticleEngine");
+    metrics::Histogram& pass_us = metrics::registry().histogram("paged_pass_us");
+    std::vector<uint32_t> wanted;
+    bool converged = true;
+    while (running)
+    {
+        glm::mat4 view_projection;
+        glm::vec3 camera;
+        bool has_view;
+        {
+            // wait for a new view, unless the last pass did not page in every wanted page
+            std::unique_lock<std::mutex> lock(this->view_mtx);
+            if (converged && !this->view_changed)
+                this->view_cv.wait_for(lock, std::chrono::milliseconds(20));
+            if (converged && !this->view_changed)
+                continue;
+            view_projection = this->view_projection;
+            camera = this->camera;
+            has_view = this->has_view;
+            this->view_changed = false;
+        }
+        PROFILE_ZONE("PagedParticleEngine pass");
+        metrics::ScopedTimer pass_timer(pass_us);
+        FrameArena::local().reset();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            this->choose_pages(view_projection, camera, has_view, wanted);
+            ++this->pass;
+            for (uint32_t page : wanted)
+                this->pages[page].last_wanted = this->pass;
+        }
+
+        // Every page is paged in with its own lock, so that writes are not blocked for a whole pass.
+        // The victim is the free slot or the resident page that has not been wanted for the longest time.
+        uint32_t paged_in = 0;
+        converged = true;
+        for (uint32_t page : wanted)
+        {
+            std::lock_guard<std::mutex> lock(this->mtx);
+            if (this->pages[page].slot != NOT_RESIDENT) continue;
+            if (paged_in == MAX_PAGES_PER_PASS)
+            {
+                converged = false;
+                break;
+            }
+
+            uint32_t victim = NOT_RESIDENT;
+            for (uint32_t slot = 0; slot < this->n_slots; slot++)
+            {
+                const uint32_t resident = this->slot_pages[slot];
+                if (resident == NOT_RESIDENT)
+                {
+                    victim = slot;
+                    break;
+                }
+                if (this->pages[resident].last_wanted < this->pass &&
+                    (victim == NOT_RESIDENT || this->pages[resident].last_wanted < this->pages[this->slot_pages[victim]].last_wanted))
+                    victim = slot;
+            }
+            if (victim == NOT_RESIDENT) break;  // cannot happen, there are at most as many wanted pages as slots
+
+            try
+            {
+                if (this->slot_pages[victim] != NOT_RESIDENT)
+                    this->page_out(this->slot_pages[victim]);
+                this->page_in(page, victim);
+            }
+            catch (std::exception&)
+            {
+                // reported by 'PagedParticleEngine::failed', the resident pages stay as they are
+                this->io_failed = true;
+                return;
+            }
+            ++paged_in;
+        }
+    }
+}
+
+void PagedParticleEngine::write(uint64_t first, const particle_t* particles, uint32_t n)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (!this->file.is_open())
+        throw std::runtime_error("Cannot write particles of uninitialized particle engine (PagedParticleEngine).");
+    if (first + n > this->file.particle_count())
+        throw std::out_of_range("Particles of PagedParticleEngine::write are out of range.");
+
+    const uint32_t page_size = this->file.page_size();
+    while (n > 0)
+    {
+        const uint32_t page = static_cast<uint32_t>(first / page_size);
+        const uint32_t offset = static_cast<uint32_t>(first % page_size);
+        const uint32_t count = std::min(n, page_size - offset);
+        page_state_t& state = this->pages[page];
+        if (state.slot != NOT_RESIDENT)
+        {
+            std::memcpy(this->slot_address(state.slot) + offset, particles, count * sizeof(particle_t));
+            this->file.extend_bounds(page, particles, count);
+            state.dirty = true;
+        }
+        else
+        {
+            this->file.write(first, particles, count);
+        }
+        first += count;
+        particles += count;
+        n -= count;
+    }
+
+    // the bounding boxes may have changed
+    std::lock_guard<std::mutex> view_lock(this->view_mtx);
+    this->view_changed = true;
+}
+
+void PagedParticleEngine::read(uint64_t first, particle_t* particles, uint32_t n)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (!this->file.is_open())
+        throw std::runtime_error("Cannot read particles of uninitialized particle engine (PagedParticleEngine).");
+    if (first + n > this->file.particle_count())
+        throw std::out_of_range("Particles of PagedParticleEngine::read are out of range.");
+
+    const uint32_t page_size = this->file.page_size();
+    while (n > 0)
+    {
+        const uint32_t page = static_cast<uint32_t>(first / page_size);
+        const uint32_t offset = static_cast<uint32_t>(first % page_size);
+        const uint32_t count = std::min(n, page_size - offset);
+        if (this->pages[page].slot != NOT_RESIDENT)
+            std::memcpy(particles, this->slot_address(this->pages[page].slot) + offset, count * sizeof(particle_t));
+        else
+            this->file.read(first, particles, count);
+        first += count;
+        particles += count;
+        n -= count;
+    }
+}
+
+void PagedParticleEngine::set_importance(uint32_t page, float importance)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->file.set_importance(page, importance);
+    }
+    std::lock_guard<std::mutex> view_lock(this->view_mtx);
+    this->view_changed = true;
+}
+
+void PagedParticleEngine::set_view(const glm::mat4& view_projection, const glm::vec3& camera)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->view_mtx);
+        this->view_projection = view_projection;
+        this->camera = camera;
+        this->has_view = true;
+        this->view_changed = true;
+    }
+    this->view_cv.notify_one();
+}
+
+void PagedParticleEngine::flush(void)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    for (uint32_t slot = 0; slot < this->n_slots; slot++)
+    {
+        const uint32_t page = this->slot_pages[slot];
+        if (page == NOT_RESIDENT || !this->pages[page].dirty) continue;
+        this->file.write_page(page, this->slot_address(slot));
+        this->pages[page].dirty = false;
+    }
+    this->file.flush();
+}
\ No newline at end of file
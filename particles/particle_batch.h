@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace particles
+{
+    /**
+    *   @brief Structure-of-arrays view of simulated particles that is used by the SIMD kernels
+    *          (colliders, force fields). The arrays are owned by the engine and must contain at least
+    *          @param count elements each. There is no alignment or padding requirement, the kernels
+    *          handle the last incomplete block of 8 particles separately.
+    *   @param pos_x, pos_y, pos_z: Particle positions
+    *   @param vel_x, vel_y, vel_z: Particle velocities
+    *   @param count: Number of particles in the batch
+    */
+    struct ParticleBatch
+    {
+        float* pos_x;
+        float* pos_y;
+        float* pos_z;
+        float* vel_x;
+        float* vel_y;
+        float* vel_z;
+        uint32_t count;
+    };
+};
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include "particle_colliders.h"
+#include "../simd/simd.h"
+#include <stdexcept>
+#include <cmath>
+
+using namespace particles;
+
+namespace
+{
+    using namespace simd;
+
+    // 8 particles loaded into registers
+    struct block_t
+    {
+        float8 px, py, pz;
+        float8 vx, vy, vz;
+    };
+
+    /**
+    *   @brief Pushes the particles with a contact out of the collider and applies restitution and friction.
+    *   @param hit: Particles that penetrate the collider
+    *   @param nx, ny, nz: Contact normal pointing out of the collider
+    *   @param depth: Penetration depth along the contact normal
+    *   @return Number of particles with a contact.
+    */
+    inline uint32_t respond(block_t& b, mask8 hit, float8 nx, float8 ny, float8 nz, float8 depth, const collider_material_t& material) noexcept
+    {
+        if (!any(hit)) return 0;
+
+        b.px = select(hit, fmadd(nx, depth, b.px), b.px);
+        b.py = select(hit, fmadd(ny, depth, b.py), b.py);
+        b.pz = select(hit, fmadd(nz, depth, b.pz), b.pz);
+
+        // Only particles that move into the collider get a velocity response,
+        // particles that already separate keep their velocity.
+        const float8 vn = dot3(b.vx, b.vy, b.vz, nx, ny, nz);
+        const mask8 approaching = hit & (vn < zero());
+
+        // v = v_tangential * (1 - friction) - v_normal * restitution
+        const float8 tangential_scale = set1(1.0f - material.friction);
+        const float8 normal_scale = vn * set1(-material.restitution);
+        const float8 vx = fmadd(nx, normal_scale, (b.vx - nx * vn) * tangential_scale);
+        const float8 vy = fmadd(ny, normal_scale, (b.vy - ny * vn) * tangential_scale);
+        const float8 vz = fmadd(nz, normal_scale, (b.vz - nz * vn) * tangential_scale);
+
+        b.vx = select(approaching, vx, b.vx);
+        b.vy = select(approaching, vy, b.vy);
+        b.vz = select(approaching, vz, b.vz);
+        return count(hit);
+    }
+
+    /**
+    *   @brief Contact of the particles with a solid sphere around a point per lane (used by spheres and capsules).
+    *   @param cx, cy, cz: Closest point of the collider's core to the particle
+    *   @param radius: Sphere radius + particle radius
+    */
+    inline uint32_t sphere_contact(block_t& b, float8 cx, float8 cy, float8 cz, float radius, const collider_material_t& material) noexcept
+    {
+        const float8 dx = b.px - cx;
+        const float8 dy = b.py - cy;
+        const float8 dz = b.pz - cz;
+        const float8 d2 = dot3(dx, dy, dz, dx, dy, dz);
+        const mask8 hit = d2 < set1(radius * radius);
+        if (!any(hit)) return 0;
+
+        // if the particle is exactly at the center, push it upwards
+        const float8 len = sqrt(d2);
+        const mask8 degenerate = len <= set1(1e-12f);
+        const float8 inv_len = set1(1.0f) / max(len, set1(1e-12f));
+        const float8 nx = select(degenerate, zero(), dx * inv_len);
+        const float8 ny = select(degenerate, set1(1.0f), dy * inv_len);
+        const float8 nz = select(degenerate, zero(), dz * inv_len);
+
+        return respond(b, hit, nx, ny, nz, set1(radius) - len, material);
+    }
+};
+
+ColliderSet::ColliderSet(void)
+{
+    this->particle_radius = 0.0f;
+}
+
+ColliderSet::~ColliderSet(void)
+{
+    this->clear();
+}
+
+void ColliderSet::add_plane(const glm::vec3& normal, float distance, const collider_material_t& material)
+{
+    if (glm::dot(normal, normal) == 0.0f)
+        throw std::invalid_argument("Normal of ColliderSet::add_plane must not be a zero vector.");
+    this->planes.push_back({ glm::normalize(normal), distance, material });
+}
+
+void ColliderSet::add_sphere(const glm::vec3& center, float radius, const collider_material_t& material)
+{
+    if (radius < 0.0f)
+        throw std::invalid_argument("Radius of ColliderSet::add_sphere must not be negative.");
+    this->spheres.push_back({ center, radius, material });
+}
+
+void ColliderSet::add_aabb(const glm::vec3& min, const glm::vec3& max, const collider_material_t& material)
+{
+    if (min.x > max.x || min.y > max.y || min.z > max.z)
+        throw std::invalid_argument("Minimum corner of ColliderSet::add_aabb must not be bigger than the maximum corner.");
+
+    box_t box;
+    box.center = (min + max) * 0.5f;
+    box.half_extent = (max - min) * 0.5f;
+    box.axes[0] = glm::vec3(1.0f, 0.0f, 0.0f);
+    box.axes[1] = glm::vec3(0.0f, 1.0f, 0.0f);
+    box.axes[2] = glm::vec3(0.0f, 0.0f, 1.0f);
+    box.material = material;
+    this->aabbs.push_back(box);
+}
+
+void ColliderSet::add_obb(const glm::vec3& center, const glm::mat3& orientation, const glm::vec3& half_extent, const collider_material_t& material)
+{
+    if (half_extent.x < 0.0f || half_extent.y < 0.0f || half_extent.z < 0.0f)
+        throw std::invalid_argument("Half extent of ColliderSet::add_obb must not be negative.");
+
+    // Gram-Schmidt, the resolve-kernel relies on orthonormal axes
+    box_t box;
+    box.center = center;
+    box.half_extent = half_extent;
+    box.axes[0] = glm::normalize(orientation[0]);
+    box.axes[1] = glm::normalize(orientation[1] - box.axes[0] * glm::dot(box.axes[0], orientation[1]));
+    box.axes[2] = glm::cross(box.axes[0], box.axes[1]);
+    box.material = material;
+    this->obbs.push_back(box);
+}
+
+void ColliderSet::add_capsule(const glm::vec3& a, const glm::vec3& b, float radius, const collider_material_t& material)
+{
+    if (radius < 0.0f)
+        throw std::invalid_argument("Radius of ColliderSet::add_capsule must not be negative.");
+    this->capsules.push_back({ a, b, radius, material });
+}
+
+void ColliderSet::clear(void)
+{
+    this->planes.clear();
+    this->spheres.clear();
+    this->aabbs.clear();
+    this->obbs.clear();
+    this->capsules.clear();
+}
+
+void ColliderSet::set_particle_radius(float radius)
+{
+    if (radius < 0.0f)
+        throw std::invalid_argument("Particle radius of ColliderSet::set_particle_radius must not be negative.");
+    this->particle_radius = radius;
+}
+
+uint32_t ColliderSet::resolve_block(float* px, float* py, float* pz, float* vx, float* vy, float* vz, uint32_t n) const noexcept
+{
+    // Lanes beyond n get a NAN-position. Every comparison with NAN is false,
+    // so those lanes never produce a contact.
+    block_t b;
+    if (n == WIDTH)
+    {
+        b.px = load(px); b.py = load(py); b.pz = load(pz);
+        b.vx = load(vx); b.vy = load(vy); b.vz = load(vz);
+    }
+    else
+    {
+        b.px = load_partial(px, n, NAN); b.py = load_partial(py, n, NAN); b.pz = load_partial(pz, n, NAN);
+        b.vx = load_partial(vx, n, 0.0f); b.vy = load_partial(vy, n, 0.0f); b.vz = load_partial(vz, n, 0.0f);
+    }
+
+    uint32_t contacts = 0;
+    const float r = this->particle_radius;
+
+    for (const plane_t& plane : this->planes)
+    {
+        const float8 nx = set1(plane.normal.x), ny = set1(plane.normal.y), nz = set1(plane.normal.z);
+        const float8 dist = dot3(b.px, b.py, b.pz, nx, ny, nz) - set1(plane.distance);
+        const mask8 hit = dist < set1(r);
+        contacts += respond(b, hit, nx, ny, nz, set1(r) - dist, plane.material);
+    }
+
+    for (const sphere_t& sphere : this->spheres)
+        contacts += sphere_contact(b, set1(sphere.center.x), set1(sphere.center.y), set1(sphere.center.z), sphere.radius + r, sphere.material);
+
+    // Boxes: transform the particle into the box's local space and push it out along the
+    // axis with the smallest penetration. AABBs skip the rotation as their axes are the world axes.
+    auto box_contact = [&b, r](const box_t& box, bool aligned) -> uint32_t
+    {
+        const float8 dx = b.px - set1(box.center.x);
+        const float8 dy = b.py - set1(box.center.y);
+        const float8 dz = b.pz - set1(box.center.z);
+
+        float8 l[3];
+        if (aligned)
+        {
+            l[0] = dx; l[1] = dy; l[2] = dz;
+        }
+        else
+        {
+            for (int i = 0; i < 3; i++)
+                l[i] = dot3(dx, dy, dz, set1(box.axes[i].x), set1(box.axes[i].y), set1(box.axes[i].z));
+        }
+
+        // penetration depth along every local axis, positive on all three axes means a contact
+        float8 pen[3];
+        mask8 hit = all_lanes();
+        for (int i = 0; i < 3; i++)
+        {
+            pen[i] = set1(box.half_extent[i] + r) - abs(l[i]);
+            hit = hit & (pen[i] > zero());
+        }
+        if (!any(hit)) return 0;
+
+        // select axis of minimum penetration, the normal points to the side the particle is on
+        float8 depth = pen[0];
+        float8 axis_sign[3];
+        for (int i = 0; i < 3; i++)
+            axis_sign[i] = select(l[i] < zero(), set1(-1.0f), set1(1.0f));
+        float8 nl[3] = { axis_sign[0], zero(), zero() };
+        for (int i = 1; i < 3; i++)
+        {
+            const mask8 smaller = pen[i] < depth;
+            depth = select(smaller, pen[i], depth);
+            for (int j = 0; j < 3; j++)
+                nl[j] = select(smaller, (i == j) ? axis_sign[j] : zero(), nl[j]);
+        }
+
+        if (aligned)
+            return respond(b, hit, nl[0], nl[1], nl[2], depth, box.material);
+
+        // local normal to world space
+        const float8 nx = fmadd(nl[0], set1(box.axes[0].x), fmadd(nl[1], set1(box.axes[1].x), nl[2] * set1(box.axes[2].x)));
+        const float8 ny = fmadd(nl[0], set1(box.axes[0].y), fmadd(nl[1], set1(box.axes[1].y), nl[2] * set1(box.axes[2].y)));
+        const float8 nz = fmadd(nl[0], set1(box.axes[0].z), fmadd(nl[1], set1(box.axes[1].z), nl[2] * set1(box.axes[2].z)));
+        return respond(b, hit, nx, ny, nz, depth, box.material);
+    };
+
+    for (const box_t& box : this->aabbs)
+        contacts += box_contact(box, true);
+    for (const box_t& box : this->obbs)
+        contacts += box_contact(box, false);
+
+    for (const capsule_t& capsule : this->capsules)
+    {
+        // closest point on the capsule's segment: a + (b - a) * clamp(dot(p - a, b - a) / |b - a|^2, 0, 1)
+        const glm::vec3 ab = capsule.b - capsule.a;
+        const float len2 = glm::dot(ab, ab);
+        const float inv_len2 = (len2 > 0.0f) ? 1.0f / len2 : 0.0f;
+
+        const float8 t = clamp(dot3(b.px - set1(capsule.a.x), b.py - set1(capsule.a.y), b.pz - set1(capsule.a.z),
+                                    set1(ab.x), set1(ab.y), set1(ab.z)) * set1(inv_len2), zero(), set1(1.0f));
+        const float8 cx = fmadd(t, set1(ab.x), set1(capsule.a.x));
+        const float8 cy = fmadd(t, set1(ab.y), set1(capsule.a.y));
+        const float8 cz = fmadd(t, set1(ab.z), set1(capsule.a.z));
+        contacts += sphere_contact(b, cx, cy, cz, capsule.radius + r, capsule.material);
+    }
+
+    if (contacts > 0)
+    {
+        if (n == WIDTH)
+        {
+            store(px, b.px); store(py, b.py); store(pz, b.pz);
+            store(vx, b.vx); store(vy, b.vy); store(vz, b.vz);
+        }
+        else
+        {
+            store_partial(px, b.px, n); store_partial(py, b.py, n); store_partial(pz, b.pz, n);
+            store_partial(vx, b.vx, n); store_partial(vy, b.vy, n); store_partial(vz, b.vz, n);
+        }
+    }
+    return contacts;
+}
+
+uint32_t ColliderSet::resolve(ParticleBatch& batch) const noexcept
+{
+    if (this->empty()) return 0;
+
+    // Every block of 8 particles is loaded once and tested against all colliders,
+    // so that positions and velocities stay in registers.
+    uint32_t contacts = 0;
+    for (uint32_t i = 0; i < batch.count; i += WIDTH)
+    {
+        const uint32_t n = (batch.count - i < WIDTH) ? batch.count - i : WIDTH;
+        contacts += this->resolve_block(batch.pos_x + i, batch.pos_y + i, batch.pos_z + i,
+                                        batch.vel_x + i, batch.vel_y + i, batch.vel_z + i, n);
+    }
+    return contacts;
+}
\ No newline at end of file
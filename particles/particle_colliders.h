@@ -0,0 +1,125 @@
+#pragma once
+
+#include "particle_batch.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   @brief Collision response of a collider.
+    *   @param restitution: Fraction of the normal velocity that is reflected (0 = no bounce, 1 = perfect bounce)
+    *   @param friction: Fraction of the tangential velocity that is removed on contact (0 = frictionless, 1 = sticky)
+    */
+    struct collider_material_t
+    {
+        float restitution;
+        float friction;
+    };
+
+    /**
+    *   @brief A set of simple analytic colliders (planes, spheres, axis aligned boxes, oriented boxes and capsules)
+    *          that an engine can attach to resolve its particles against. Particles are tested in batches of 8 in
+    *          structure-of-arrays form (see particles::ParticleBatch). Every particle is treated as a sphere with
+    *          the radius set by 'ColliderSet::set_particle_radius'.
+    *          Penetrating particles are pushed out to the surface, and their velocity is split into a normal and
+    *          a tangential part. The normal part gets reflected and scaled by the restitution, the tangential part
+    *          gets scaled by (1 - friction).
+    *   NOTE: Planes are one-sided half spaces, particles behind a plane are pushed to its front side.
+    *         All other colliders are solid, particles are pushed outside of them.
+    */
+    class ColliderSet
+    {
+    private:
+        struct plane_t
+        {
+            glm::vec3 normal;
+            float distance;
+            collider_material_t material;
+        };
+
+        struct sphere_t
+        {
+            glm::vec3 center;
+            float radius;
+            collider_material_t material;
+        };
+
+        struct box_t
+        {
+            glm::vec3 center;
+            glm::vec3 axes[3];      // orthonormal axes of the box, for AABBs the world axes
+            glm::vec3 half_extent;
+            collider_material_t material;
+        };
+
+        struct capsule_t
+        {
+            glm::vec3 a, b;         // end points of the capsule's segment
+            float radius;
+            collider_material_t material;
+        };
+
+        std::vector<plane_t> planes;
+        std::vector<sphere_t> spheres;
+        std::vector<box_t> aabbs;
+        std::vector<box_t> obbs;
+        std::vector<capsule_t> capsules;
+        float particle_radius;
+
+        /**
+        *   @brief Resolves 8 particles (one SIMD register) against all colliders.
+        *   @param px, py, pz, vx, vy, vz: Pointers to the first particle of the block.
+        *   @param n: Number of valid particles in the block (1-8).
+        *   @return The number of particle-collider contacts in the block.
+        */
+        uint32_t resolve_block(float* px, float* py, float* pz, float* vx, float* vy, float* vz, uint32_t n) const noexcept;
+
+    public:
+        ColliderSet(void);
+        virtual ~ColliderSet(void);
+
+        /**
+        *   @brief Adds a plane (half space) collider. Points with dot(normal, p) < distance are behind the plane.
+        *   @param normal: Normal of the plane, gets normalized
+        *   @param distance: Signed distance of the plane from the origin along its normal
+        */
+        void add_plane(const glm::vec3& normal, float distance, const collider_material_t& material);
+
+        /** @brief Adds a solid sphere collider. */
+        void add_sphere(const glm::vec3& center, float radius, const collider_material_t& material);
+
+        /** @brief Adds a solid axis aligned box collider from its minimum and maximum corner. */
+        void add_aabb(const glm::vec3& min, const glm::vec3& max, const collider_material_t& material);
+
+        /**
+        *   @brief Adds a solid oriented box collider.
+        *   @param orientation: Rotation matrix whose columns are the box's local axes, gets orthonormalized
+        *   @param half_extent: Half size of the box along each of its local axes
+        */
+        void add_obb(const glm::vec3& center, const glm::mat3& orientation, const glm::vec3& half_extent, const collider_material_t& material);
+
+        /** @brief Adds a solid capsule collider: all points within @param radius of the segment [a, b]. */
+        void add_capsule(const glm::vec3& a, const glm::vec3& b, float radius, const collider_material_t& material);
+
+        /** @brief Removes every collider from the set. */
+        void clear(void);
+
+        /** @brief Sets the collision radius of the particles, default is 0. */
+        void set_particle_radius(float radius);
+
+        /**
+        *   @brief Tests every particle of the batch against every collider and resolves the contacts
+        *          by correcting position and velocity in place.
+        *   @return The number of particle-collider contacts that have been resolved.
+        */
+        uint32_t resolve(ParticleBatch& batch) const noexcept;
+
+        /** @return The total number of colliders in the set. */
+        size_t size(void) const noexcept    { return this->planes.size() + this->spheres.size() + this->aabbs.size() + this->obbs.size() + this->capsules.size(); }
+
+        /** @return 'true' if there is no collider in the set. */
+        bool empty(void) const noexcept     { return (this->size() == 0); }
+    };
+};
\ No newline at end of file
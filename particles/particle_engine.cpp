@@ -1,4 +1,5 @@
 #include "particle_engine.h"
+#include "../profiler/alloc_tracker.h"
 
 using namespace particles;
 
@@ -32,5 +33,6 @@ void ParticleEngine::stop_base(void)
 
 void ParticleEngine::engine_func(ParticleEngine* engine, void* param)
 {
+    ALLOC_THREAD(profiler::ALLOC_ENGINE);
     engine->run(engine->running, param);
 }
\ No newline at end of file
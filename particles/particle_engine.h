@@ -1,12 +1,27 @@
 #pragma once
 
 #include "particle_pool.h"
+#include "baked_cache.h"
+#include "shm_feed.h"
+#include "point_cloud.h"
+#include "page_file.h"
+#include "frame_arena.h"
+#include "particle_colliders.h"
+#include "particle_forces.h"
 #include <thread>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
 #include <set>
+#include <vector>
 
 namespace particles
 {
+    // forward class declarations
+    class SessionRecorder;
+
     class ParticleEngine
     {
     private:
@@ -24,6 +39,20 @@ namespace particles
         virtual ~ParticleEngine(void);
 
         virtual void run(const std::atomic_bool& running, void* param) = 0;
+
+        /**
+        *   @brief Serializes the private state of the engine for a checkpoint (see 'particles::save_checkpoint').
+        *          The default implementation has no state.
+        *   @param state: Returns the serialized state.
+        */
+        virtual void save_state(std::vector<uint8_t>& state) const  { state.clear(); }
+
+        /**
+        *   @brief Restores the private state from a checkpoint, the pool of the engine must have been restored before.
+        *   @param state: The state that has been serialized by 'ParticleEngine::save_state'.
+        *   @param size: Size of @param state in bytes.
+        */
+        virtual void restore_state(const uint8_t*, size_t) {}
     };
 
     class StaticParticleEngine : public ParticleEngine
@@ -32,6 +61,7 @@ namespace particles
     private:
         ParticlePool* pool;
         std::set<particle_t*> particles;
+        SessionRecorder* recorder;
 
     public:
         StaticParticleEngine(void);
@@ -40,9 +70,17 @@ namespace particles
 
         void init(ParticlePool& pool);
 
+        /**
+        *   @brief Attaches a recorder that logs every spawn and kill of the engine.
+        *   @param recorder: The recorder to attach, a nullptr detaches the current recorder.
+        */
+        void set_recorder(SessionRecorder* recorder) noexcept { this->recorder = recorder; }
+
         void start(void);
         void stop(void);
         void run(const std::atomic_bool& running, void* param);
+        void save_state(std::vector<uint8_t>& state) const override;
+        void restore_state(const uint8_t* state, size_t size) override;
 
         uint64_t spawn(const particle_t& particle);
         void kill(uint64_t uid);
@@ -51,4 +89,421 @@ namespace particles
         uint32_t count(void) const noexcept { return this->particles.size(); }
         bool running(void) const noexcept   { return this->base_running(); }
     };
+
+    /**
+    *   Class: PlaybackParticleEngine
+    *   @brief Plays a baked cache (see particles::BakedCacheWriter) back into a pool.
+    *          The engine allocates one consecutive range of particles for the biggest frame, so presenting
+    *          a frame is a single copy. Frames are decoded ahead on the engine thread, seeking to any
+    *          frame restarts the read-ahead at the chunk of that frame.
+    */
+    class PlaybackParticleEngine : public ParticleEngine
+    {
+    private:
+        struct decoded_frame_t
+        {
+            uint32_t frame;
+            std::vector<particle_t> particles;
+        };
+
+        ParticlePool* pool;
+        particle_t* range;                      // allocated particles of the engine
+        uint32_t range_size;
+        uint32_t presented_size;                // particle count of the presented frame
+
+        BakedCacheReader reader;
+        std::mutex mtx;
+        std::condition_variable decoded_cv;
+        std::deque<decoded_frame_t> decoded;    // decoded frames, ascending and consecutive
+        std::vector<decoded_frame_t> unused;    // recycled frames, so that decoding does not allocate
+        uint32_t decode_frame;                  // next frame to decode
+        bool decode_failed;
+
+        uint32_t _current_frame;
+        double time;
+        bool loop;
+
+    public:
+        /** @brief Number of frames that are decoded ahead. */
+        constexpr static uint32_t READ_AHEAD = 8;
+
+        PlaybackParticleEngine(void);
+        PlaybackParticleEngine(ParticlePool& pool, const char* path);
+        ~PlaybackParticleEngine(void);
+
+        /** @brief Opens the baked cache at @param path for playback into @param pool. */
+        void init(ParticlePool& pool, const char* path);
+
+        /** @brief Allocates the particles and starts the read-ahead thread at the current frame. */
+        void start(void);
+
+        /** @brief Stops the read-ahead thread and frees the particles. */
+        void stop(void);
+
+        void run(const std::atomic_bool& running, void* param);
+
+        /** @brief Sets the playback time to the start of @param frame and presents it. */
+        void seek(uint32_t frame);
+
+        /**
+        *   @brief Advances the playback time by @param dt and presents the frame of the new time.
+        *          At the end of the cache, the playback loops or stays at the last frame.
+        */
+        void advance(float dt);
+
+        /**
+        *   @brief Copies a frame into the particles of the engine. Blocks until the frame is decoded,
+        *          which only happens after a seek or if decoding is slower than playback.
+        */
+        void present(uint32_t frame);
+
+        /** @brief Sets if the playback should loop, the default is 'true'. */
+        void set_loop(bool loop) noexcept           { this->loop = loop; }
+
+        uint32_t frame_count(void) const noexcept   { return this->reader.frame_count(); }
+        float frame_rate(void) const noexcept       { return this->reader.frame_rate(); }
+        uint32_t current_frame(void) const noexcept { return this->_current_frame; }
+        uint32_t count(void) const noexcept         { return this->presented_size; }
+        bool running(void) const noexcept           { return this->base_running(); }
+    };
+
+    /**
+    *   Class: ShmParticleEngine
+    *   @brief Ingests particles from an external process through a shared memory feed
+    *          (see particles::ShmFeedProducer). The engine thread polls the feed and copies the latest
+    *          complete frame into one consecutive range of the pool. The frame is validated in a staging
+    *          buffer of the consumer first, so the pool never contains a torn frame (see particles::ShmFeedConsumer).
+    */
+    class ShmParticleEngine : public ParticleEngine
+    {
+    private:
+        ParticlePool* pool;
+        particle_t* range;                  // allocated particles of the engine
+        uint32_t range_size;
+        std::atomic<uint32_t> presented_size;
+        std::atomic<uint64_t> frames;       // number of ingested frames
+        ShmFeedConsumer consumer;
+
+    public:
+        /** @brief Time between two polls of the feed if there was no new frame. */
+        constexpr static uint32_t POLL_INTERVAL_US = 250;
+
+        ShmParticleEngine(void);
+        ShmParticleEngine(ParticlePool& pool, const char* name);
+        ~ShmParticleEngine(void);
+
+        /** @brief Maps the feed with the shared memory name @param name for ingestion into @param pool. */
+        void init(ParticlePool& pool, const char* name);
+
+        /** @brief Allocates the particles for the capacity of the feed and starts polling it. */
+        void start(void);
+
+        /** @brief Stops polling the feed and frees the particles. */
+        void stop(void);
+
+        void run(const std::atomic_bool& running, void* param);
+
+        /** @return The number of particles of the latest ingested frame. */
+        uint32_t count(void) const noexcept             { return this->presented_size; }
+
+        /** @return The number of frames that have been ingested. */
+        uint64_t frame_count(void) const noexcept       { return this->frames; }
+
+        /** @return The sequence number of the latest ingested frame. */
+        uint64_t sequence(void) const noexcept          { return this->consumer.sequence(); }
+
+        bool running(void) const noexcept               { return this->base_running(); }
+    };
+
+    /**
+    *   Class: PointCloudParticleEngine
+    *   @brief Streams a chunked point cloud (see particles::build_point_cloud) into a pool, the cloud can have
+    *          far more points than the pool. The engine allocates one range of particles as its budget and
+    *          divides it into blocks. The engine thread chooses a level of detail for every chunk by its
+    *          distance to the camera, the nearest chunks first until the budget is used up, and copies the
+    *          missing points of a chunk from the mapped file into free blocks. The render loop only sets
+    *          the camera position and never waits for the disk.
+    */
+    class PointCloudParticleEngine : public ParticleEngine
+    {
+    private:
+        struct chunk_state_t
+        {
+            std::vector<uint32_t> blocks;   // blocks of the resident points, point i is in block i / BLOCK_SIZE
+            uint32_t resident;              // number of resident points, always a prefix of the chunk
+            uint32_t target;                // number of points of the chosen level of detail
+        };
+
+        ParticlePool* pool;
+        particle_t* range;                  // allocated particles of the engine
+        uint32_t range_size;
+        uint32_t budget;                    // requested maximum number of particles
+        PointCloudFile cloud;
+        std::vector<chunk_state_t> chunks;
+        std::vector<uint32_t> free_blocks;
+        std::atomic<uint32_t> resident_points;
+
+        std::mutex mtx;
+        std::condition_variable camera_cv;
+        glm::vec3 camera;
+        float lod_distance;
+        bool camera_changed;
+
+        /**
+        *   @brief Chooses the level of detail of every chunk.
+        *   @param camera: The camera position
+        *   @param lod_distance: Distance up to which the full detail is used
+        *   @param order: Returns the chunk indices sorted by distance
+        */
+        void choose_targets(const glm::vec3& camera, float lod_distance, std::vector<uint32_t>& order);
+
+        /** @brief Frees the points of a chunk beyond its target. */
+        void shrink(chunk_state_t& chunk);
+
+        /** @brief Copies at most @param max_points missing points of a chunk, @return the number of copied points. */
+        uint32_t grow(uint32_t chunk, uint32_t max_points);
+
+    public:
+        /** @brief Number of particles per block. */
+        constexpr static uint32_t BLOCK_SIZE = 1024;
+
+        /** @brief Maximum number of points that are copied before the camera is checked again. */
+        constexpr static uint32_t MAX_POINTS_PER_PASS = 1u << 18;
+
+        PointCloudParticleEngine(void);
+        PointCloudParticleEngine(ParticlePool& pool, const char* path, uint32_t budget);
+        ~PointCloudParticleEngine(void);
+
+        /**
+        *   @brief Maps the point cloud file at @param path for streaming into @param pool.
+        *   @param budget: Maximum number of particles the engine allocates, it is used in whole blocks
+        */
+        void init(ParticlePool& pool, const char* path, uint32_t budget);
+
+        /**
+        *   @brief Allocates the particles of the budget and starts streaming.
+        *          With a budget of less than one block no points can be resident, the engine is not started then.
+        */
+        void start(void);
+
+        /** @brief Stops streaming and frees the particles. */
+        void stop(void);
+
+        void run(const std::atomic_bool& running, void* param);
+
+        /** @brief Sets the camera position the levels of detail are chosen for, it does not block. */
+        void set_camera(const glm::vec3& pos);
+
+        /**
+        *   @brief Sets the distance up to which chunks are streamed with full detail, the default is 4.
+        *          Every doubling of the distance beyond it uses the next coarser level.
+        */
+        void set_lod_distance(float distance);
+
+        /** @return The number of points that are currently resident in the pool. */
+        uint32_t count(void) const noexcept         { return this->resident_points; }
+        uint64_t point_count(void) const noexcept   { return this->cloud.point_count(); }
+        bool running(void) const noexcept           { return this->base_running(); }
+    };
+
+    /**
+    *   Class: PagedParticleEngine
+    *   @brief Pages a particle dataset that is bigger than the pool between a page file and the pool.
+    *          The engine allocates a fixed number of page slots from the pool, so the memory use is bounded
+    *          by the budget regardless of the dataset size. The engine thread ranks the pages by visibility
+    *          in the view frustum, importance and distance to the camera, pages in the wanted ones and evicts
+    *          the least recently wanted resident pages. Dirty pages are written back before their slot is hidden
+    *          and reused. Pages are read directly into their slot, so the renderer may see a page while it is
+    *          paged in, but never particles of another page.
+    */
+    class PagedParticleEngine : public ParticleEngine
+    {
+    private:
+        struct page_state_t
+        {
+            uint32_t slot;                  // slot of the resident page, NOT_RESIDENT if the page is not resident
+            bool dirty;                     // the slot has been written since the page was paged in
+            uint64_t last_wanted;           // pass in which the page was wanted the last time
+        };
+
+        ParticlePool* pool;
+        particle_t* range;                  // allocated particles of the engine, 'n_slots' pages
+        uint32_t n_slots;
+        uint32_t budget;                    // requested maximum number of particles
+        ParticlePageFile file;
+        std::vector<page_state_t> pages;
+        std::vector<uint32_t> slot_pages;   // page of every slot, NOT_RESIDENT if the slot is free
+        uint64_t pass;
+        std::atomic<uint64_t> _page_ins;
+        std::atomic<uint64_t> _page_outs;
+        std::atomic<uint32_t> _resident_pages;
+        std::atomic_bool io_failed;
+
+        std::mutex mtx;                     // guards the pages, the slots and the file
+        std::mutex view_mtx;                // guards the view, the render loop never waits for the disk
+        std::condition_variable view_cv;
+        glm::mat4 view_projection;
+        glm::vec3 camera;
+        bool has_view;
+        bool view_changed;
+
+        particle_t* slot_address(uint32_t slot) noexcept { return this->range + static_cast<size_t>(slot) * this->file.page_size(); }
+
+        /** @brief Chooses the pages that should be resident, in descending priority. */
+        void choose_pages(const glm::mat4& view_projection, const glm::vec3& camera, bool has_view, std::vector<uint32_t>& wanted);
+
+        /** @brief Writes a resident page back if it is dirty and frees its slot. */
+        void page_out(uint32_t page);
+
+        /** @brief Reads a page into a free slot. */
+        void page_in(uint32_t page, uint32_t slot);
+
+    public:
+        /** @brief Slot or page index of no page. */
+        constexpr static uint32_t NOT_RESIDENT = UINT32_MAX;
+
+        /** @brief Maximum number of pages that are paged in before the view is checked again. */
+        constexpr static uint32_t MAX_PAGES_PER_PASS = 8;
+
+        PagedParticleEngine(void);
+        PagedParticleEngine(ParticlePool& pool, const char* path, uint32_t budget);
+        ~PagedParticleEngine(void);
+
+        /**
+        *   @brief Opens an existing page file for paging into @param pool.
+        *   @param budget: Maximum number of particles the engine allocates, at least one page
+        */
+        void init(ParticlePool& pool, const char* path, uint32_t budget);
+
+        /**
+        *   @brief Creates a new page file for a dataset of @param n_particles particles, see 'PagedParticleEngine::init'.
+        *          The dataset is filled with 'PagedParticleEngine::write'.
+        */
+        void init(ParticlePool& pool, const char* path, uint32_t budget, uint64_t n_particles, uint32_t page_size = ParticlePageFile::DEFAULT_PAGE_SIZE);
+
+        /** @brief Allocates the page slots and starts paging. */
+        void start(void);
+
+        /** @brief Stops paging, writes the dirty pages back and frees the particles. */
+        void stop(void);
+
+        void run(const std::atomic_bool& running, void* param);
+
+        /**
+        *   @brief Writes particles into the dataset. Resident pages are updated in place and written back
+        *          when they are paged out, other pages are written to the file directly.
+        *   @param first: Index of the first particle in the dataset
+        *   @param particles: The particles to write
+        *   @param n: Number of particles
+        */
+        void write(uint64_t first, const particle_t* particles, uint32_t n);
+
+        /** @brief Reads @param n particles of the dataset starting at @param first into @param particles. */
+        void read(uint64_t first, particle_t* particles, uint32_t n);
+
+        /** @brief Sets the importance of a page, 0 excludes the page from paging. The default is 1. */
+        void set_importance(uint32_t page, float importance);
+
+        /** @brief Sets the view the pages are ranked for, it does not block. */
+        void set_view(const glm::mat4& view_projection, const glm::vec3& camera);
+
+        /** @brief Writes the dirty pages and the page table to the file, the pages stay resident. */
+        void flush(void);
+
+        uint32_t page_count(void) const noexcept        { return this->file.page_count(); }
+        uint32_t page_size(void) const noexcept         { return this->file.page_size(); }
+        uint32_t slot_count(void) const noexcept        { return this->n_slots; }
+        uint32_t resident_pages(void) const noexcept    { return this->_resident_pages; }
+        uint64_t page_ins(void) const noexcept          { return this->_page_ins; }
+        uint64_t page_outs(void) const noexcept         { return this->_page_outs; }
+
+        /** @return 'true' if paging stopped because the page file could not be read or written. */
+        bool failed(void) const noexcept                { return this->io_failed; }
+        bool running(void) const noexcept               { return this->base_running(); }
+    };
+
+    /**
+    *   Class: FountainParticleEngine
+    *   @brief Simulates a fountain: particles are emitted from a nozzle into a cone, accelerated by a set of
+    *          force fields and resolved against a set of colliders (see particles::ForceFieldSet and
+    *          particles::ColliderSet). The engine allocates one consecutive range of particles and simulates
+    *          them in structure-of-arrays form with a fixed time step, only the positions are copied into the
+    *          pool. A particle is emitted again at the nozzle when its lifetime has ended.
+    *   NOTE: The force fields and colliders are not synchronized, they must be set up before 'start'.
+    */
+    class FountainParticleEngine : public ParticleEngine
+    {
+    private:
+        ParticlePool* pool;
+        particle_t* range;                  // allocated particles of the engine
+        uint32_t range_size;
+        std::vector<float> pos_x, pos_y, pos_z;
+        std::vector<float> vel_x, vel_y, vel_z;
+        std::vector<float> age;             // seconds since the particle has been emitted
+        uint32_t active;                    // number of emitted particles, always a prefix of the range
+        double emit_budget;                 // fraction of a particle that is emitted in the next tick
+
+        ForceFieldSet _forces;
+        ColliderSet _colliders;
+        glm::vec3 nozzle;
+        glm::vec3 direction;
+        float spread;                       // half angle of the cone in radians
+        float speed;
+        float lifetime;
+        glm::vec4 color;
+        float size;
+        std::minstd_rand rng;
+        std::atomic<uint64_t> _contacts;
+
+        /** @brief Emits particle @param i at the nozzle. */
+        void emit(uint32_t i);
+
+    public:
+        /** @brief Fixed time step of the simulation. */
+        constexpr static uint32_t TICK_US = 16667;
+
+        FountainParticleEngine(void);
+        FountainParticleEngine(ParticlePool& pool, uint32_t n_particles);
+        ~FountainParticleEngine(void);
+
+        /** @brief Simulates @param n_particles particles of @param pool, they are emitted over one lifetime. */
+        void init(ParticlePool& pool, uint32_t n_particles);
+
+        /**
+        *   @brief Sets the nozzle, the default is a vertical nozzle at the origin.
+        *   @param position: Position the particles are emitted at
+        *   @param direction: Axis of the cone the particles are emitted into, gets normalized
+        *   @param spread: Half angle of the cone in radians
+        *   @param speed: Initial speed of the particles
+        */
+        void set_nozzle(const glm::vec3& position, const glm::vec3& direction, float spread, float speed);
+
+        /** @brief Sets the lifetime of a particle in seconds, the default is 3 seconds. */
+        void set_lifetime(float seconds);
+
+        /** @brief Sets the appearance of the emitted particles. */
+        void set_appearance(const glm::vec4& color, float size);
+
+        /** @brief Seeds the random directions of the emitted particles. */
+        void seed(uint32_t seed)                        { this->rng.seed(seed); }
+
+        /** @return The force fields that accelerate the particles, they must only be modified before 'start'. */
+        ForceFieldSet& forces(void) noexcept            { return this->_forces; }
+
+        /** @return The colliders the particles are resolved against, they must only be modified before 'start'. */
+        ColliderSet& colliders(void) noexcept           { return this->_colliders; }
+
+        /** @brief Allocates the particles and starts the simulation. */
+        void start(void);
+
+        /** @brief Stops the simulation and frees the particles. */
+        void stop(void);
+
+        void run(const std::atomic_bool& running, void* param);
+
+        /** @return The number of particle-collider contacts that have been resolved. */
+        uint64_t contacts(void) const noexcept          { return this->_contacts; }
+        uint32_t count(void) const noexcept             { return this->range_size; }
+        bool running(void) const noexcept               { return this->base_running(); }
+    };
 };
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "particle_forces.h"
+#include "../simd/simd.h"
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+using namespace particles;
+
+ForceFieldSet::ForceFieldSet(void)
+{
+    this->time = 0.0f;
+}
+
+ForceFieldSet::~ForceFieldSet(void)
+{
+    this->clear();
+}
+
+void ForceFieldSet::add_gravity(const glm::vec3& acceleration)
+{
+    field_t field = {};
+    field.type = FIELD_GRAVITY;
+    field.vector = acceleration;
+    field.global = true;
+    this->fields.push_back(field);
+}
+
+void ForceFieldSet::add_drag(float linear, float quadratic)
+{
+    if (linear < 0.0f || quadratic < 0.0f)
+        throw std::invalid_argument("Coefficients of ForceFieldSet::add_drag must not be negative.");
+
+    field_t field = {};
+    field.type = FIELD_DRAG;
+    field.strength = linear;
+    field.param0 = quadratic;
+    field.global = true;
+    this->fields.push_back(field);
+}
+
+void ForceFieldSet::add_attractor(const glm::vec3& position, float strength, float radius, uint32_t falloff)
+{
+    if (radius <= 0.0f)
+        throw std::invalid_argument("Radius of ForceFieldSet::add_attractor must be bigger than 0.");
+
+    field_t field = {};
+    field.type = FIELD_ATTRACTOR;
+    field.vector = position;
+    field.strength = strength;
+    field.radius = radius;
+    field.falloff = falloff;
+    field.global = false;
+    field.bounds_min = position - glm::vec3(radius);
+    field.bounds_max = position + glm::vec3(radius);
+    this->fields.push_back(field);
+}
+
+void ForceFieldSet::add_vortex(const glm::vec3& center, const glm::vec3& axis, float strength, float radius)
+{
+    if (radius <= 0.0f)
+        throw std::invalid_argument("Radius of ForceFieldSet::add_vortex must be bigger than 0.");
+    if (glm::dot(axis, axis) == 0.0f)
+        throw std::invalid_argument("Axis of ForceFieldSet::add_vortex must not be a zero vector.");
+
+    field_t field = {};
+    field.type = FIELD_VORTEX;
+    field.vector = center;
+    field.axis = glm::normalize(axis);
+    field.strength = strength;
+    field.radius = radius;
+
+    // The vortex is an infinite cylinder, it is only bounded along the world axes that are perpendicular to its axis.
+    field.global = false;
+    for (int i = 0; i < 3; i++)
+    {
+        const bool along_axis = std::fabs(field.axis[i]) > 1e-6f;
+        field.bounds_min[i] = along_axis ? -std::numeric_limits<float>::infinity() : center[i] - radius;
+        field.bounds_max[i] = along_axis ? +std::numeric_limits<float>::infinity() : center[i] + radius;
+    }
+    this->fields.push_back(field);
+}
+
+void ForceFieldSet::add_wind(const glm::vec3& velocity, float coupling, float gust_amplitude, float gust_frequency)
+{
+    if (coupling < 0.0f)
+        throw std::invalid_argument("Coupling of ForceFieldSet::add_wind must not be negative.");
+
+    field_t field = {};
+    field.type = FIELD_WIND;
+    field.vector = velocity;
+    field.strength = coupling;
+    field.param0 = gust_amplitude;
+    field.param1 = gust_frequency;
+    field.global = true;
+    this->fields.push_back(field);
+}
+
+void ForceFieldSet::add_wind(const glm::vec3& velocity, float coupling, float gust_amplitude, float gust_frequency,
+                             const glm::vec3& bounds_min, const glm::vec3& bounds_max)
+{
+    if (bounds_min.x > bounds_max.x || bounds_min.y > bounds_max.y || bounds_min.z > bounds_max.z)
+        throw std::invalid_argument("Minimum bounds of ForceFieldSet::add_wind must not be bigger than the maximum bounds.");
+
+    this->add_wind(velocity, coupling, gust_amplitude, gust_frequency);
+    this->fields.back().global = false;
+    this->fields.back().bounds_min = bounds_min;
+    this->fields.back().bounds_max = bounds_max;
+}
+
+void ForceFieldSet::clear(void)
+{
+    this->fields.clear();
+    this->tile_fields.clear();
+    this->gust.clear();
+    this->time = 0.0f;
+}
+
+void ForceFieldSet::apply(ParticleBatch& batch, float dt)
+{
+    using namespace simd;
+
+    if (this->fields.empty()) return;
+
+    // the gust factor is the same for every particle and only computed once per call
+    this->gust.resize(this->fields.size());
+    for (size_t i = 0; i < this->fields.size(); i++)
+    {
+        if (this->fields[i].type == FIELD_WIND)
+            this->gust[i] = 1.0f + this->fields[i].param0 * std::sin(2.0f * static_cast<float>(M_PI) * this->fields[i].param1 * this->time);
+        else
+            this->gust[i] = 1.0f;
+    }
+
+    // accumulates the acceleration of one field for 8 particles
+    auto evaluate = [](const field_t& field, float gust, mask8 valid,
+                       float8 px, float8 py, float8 pz, float8 vx, float8 vy, float8 vz,
+                       float8& ax, float8& ay, float8& az)
+    {
+        switch (field.type)
+        {
+        case FIELD_GRAVITY:
+            ax = ax + field.vector.x;
+            ay = ay + field.vector.y;
+            az = az + field.vector.z;
+            break;
+
+        case FIELD_DRAG:
+        {
+            // a = -v * (linear + quadratic * |v|)
+            const float8 speed = sqrt(dot3(vx, vy, vz, vx, vy, vz));
+            const float8 k = fmadd(speed, set1(field.param0), set1(field.strength));
+            ax = ax - vx * k;
+            ay = ay - vy * k;
+            az = az - vz * k;
+            break;
+        }
+
+        case FIELD_ATTRACTOR:
+        {
+            const float8 dx = set1(field.vector.x) - px;
+            const float8 dy = set1(field.vector.y) - py;
+            const float8 dz = set1(field.vector.z) - pz;
+            const float8 dist = sqrt(dot3(dx, dy, dz, dx, dy, dz));
+            const mask8 inside = valid & (dist < set1(field.radius)) & (dist > set1(1e-6f));
+            if (!any(inside)) break;
+
+            // strength * (1 - dist / radius)^falloff, divided by dist to normalize the direction
+            const float8 w = set1(1.0f) - dist * set1(1.0f / field.radius);
+            float8 s = set1(field.strength);
+            for (uint32_t i = 0; i < field.falloff; i++)
+                s = s * w;
+            s = select(inside, s / dist, zero());
+            ax = fmadd(dx, s, ax);
+            ay = fmadd(dy, s, ay);
+            az = fmadd(dz, s, az);
+            break;
+        }
+
+        case FIELD_VORTEX:
+        {
+            // tangent = cross(axis, p - center), its length is the distance to the axis
+            const float8 dx = px - set1(field.vector.x);
+            const float8 dy = py - set1(field.vector.y);
+            const float8 dz = pz - set1(field.vector.z);
+            const float8 tx = set1(field.axis.y) * dz - set1(field.axis.z) * dy;
+            const float8 ty = set1(field.axis.z) * dx - set1(field.axis.x) * dz;
+            const float8 tz = set1(field.axis.x) * dy - set1(field.axis.y) * dx;
+            const float8 dist = sqrt(dot3(tx, ty, tz, tx, ty, tz));
+            const mask8 inside = valid & (dist < set1(field.radius)) & (dist > set1(1e-6f));
+            if (!any(inside)) break;
+
+            const float8 w = set1(1.0f) - dist * set1(1.0f / field.radius);
+            const float8 s = select(inside, set1(field.strength) * w / dist, zero());
+            ax = fmadd(tx, s, ax);
+            ay = fmadd(ty, s, ay);
+            az = fmadd(tz, s, az);
+            break;
+        }
+
+        case FIELD_WIND:
+        {
+            mask8 inside = valid;
+            if (!field.global)
+            {
+                inside = inside & (px >= set1(field.bounds_min.x)) & (px <= set1(field.bounds_max.x))
+                                & (py >= set1(field.bounds_min.y)) & (py <= set1(field.bounds_max.y))
+                                & (pz >= set1(field.bounds_min.z)) & (pz <= set1(field.bounds_max.z));
+                if (!any(inside)) break;
+            }
+
+            // a = (wind * gust - v) * coupling
+            const float8 k = select(inside, set1(field.strength), zero());
+            ax = fmadd(set1(field.vector.x * gust) - vx, k, ax);
+            ay = fmadd(set1(field.vector.y * gust) - vy, k, ay);
+            az = fmadd(set1(field.vector.z * gust) - vz, k, az);
+            break;
+        }
+        }
+    };
+
+    const float8 dt8 = set1(dt);
+    for (uint32_t tile = 0; tile < batch.count; tile += TILE_SIZE)
+    {
+        const uint32_t tile_count = (batch.count - tile < TILE_SIZE) ? batch.count - tile : TILE_SIZE;
+
+        // bounding box of the tile, NAN-positions (free particles) are ignored by the comparisons
+        glm::vec3 tile_min(std::numeric_limits<float>::infinity());
+        glm::vec3 tile_max(-std::numeric_limits<float>::infinity());
+        for (uint32_t i = tile; i < tile + tile_count; i++)
+        {
+            const float p[3] = { batch.pos_x[i], batch.pos_y[i], batch.pos_z[i] };
+            for (int j = 0; j < 3; j++)
+            {
+                tile_min[j] = (p[j] < tile_min[j]) ? p[j] : tile_min[j];
+                tile_max[j] = (p[j] > tile_max[j]) ? p[j] : tile_max[j];
+            }
+        }
+
+        // cull the fields against the tile
+        this->tile_fields.clear();
+        for (uint32_t i = 0; i < this->fields.size(); i++)
+        {
+            const field_t& field = this->fields[i];
+            if (field.global || (tile_min.x <= field.bounds_max.x && tile_max.x >= field.bounds_min.x &&
+                                 tile_min.y <= field.bounds_max.y && tile_max.y >= field.bounds_min.y &&
+                                 tile_min.z <= field.bounds_max.z && tile_max.z >= field.bounds_min.z))
+                this->tile_fields.push_back(i);
+        }
+        if (this->tile_fields.empty()) continue;
+
+        for (uint32_t i = tile; i < tile + tile_count; i += WIDTH)
+        {
+            const uint32_t n = (tile + tile_count - i < WIDTH) ? tile + tile_count - i : WIDTH;
+            const mask8 valid = first_lanes(n);
+
+            float8 px, py, pz, vx, vy, vz;
+            if (n == WIDTH)
+            {
+                px = load(batch.pos_x + i); py = load(batch.pos_y + i); pz = load(batch.pos_z + i);
+                vx = load(batch.vel_x + i); vy = load(batch.vel_y + i); vz = load(batch.vel_z + i);
+            }
+            else
+            {
+                px = load_partial(batch.pos_x + i, n, 0.0f); py = load_partial(batch.pos_y + i, n, 0.0f); pz = load_partial(batch.pos_z + i, n, 0.0f);
+                vx = load_partial(batch.vel_x + i, n, 0.0f); vy = load_partial(batch.vel_y + i, n, 0.0f); vz = load_partial(batch.vel_z + i, n, 0.0f);
+            }
+
+            float8 ax = zero(), ay = zero(), az = zero();
+            for (uint32_t idx : this->tile_fields)
+                evaluate(this->fields[idx], this->gust[idx], valid, px, py, pz, vx, vy, vz, ax, ay, az);
+
+            // v += a * dt
+            vx = fmadd(ax, dt8, vx);
+            vy = fmadd(ay, dt8, vy);
+            vz = fmadd(az, dt8, vz);
+
+            if (n == WIDTH)
+            {
+                store(batch.vel_x + i, vx); store(batch.vel_y + i, vy); store(batch.vel_z + i, vz);
+            }
+            else
+            {
+                store_partial(batch.vel_x + i, vx, n); store_partial(batch.vel_y + i, vy, n); store_partial(batch.vel_z + i, vz, n);
+            }
+        }
+    }
+
+    this->time += dt;
+}
\ No newline at end of file
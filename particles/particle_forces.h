@@ -0,0 +1,108 @@
+#pragma once
+
+#include "particle_batch.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   @brief A composable set of force fields that accelerate simulated particles:
+    *          uniform gravity, linear/quadratic drag, point attractors/repulsors with falloff,
+    *          vortices and directional wind with gusting.
+    *          The fields are stored in one flat array and evaluated over particles::ParticleBatch
+    *          in blocks of 8 with SIMD, there are no per-particle virtual calls.
+    *          Every field has a bounding box. The batch is split into tiles of consecutive particles and
+    *          only the fields whose bounding box overlaps a tile's bounding box are evaluated for it,
+    *          within a tile the fields are additionally masked per particle.
+    *          Gravity and drag are global, attractors and vortices are bounded by their radius,
+    *          wind is global unless bounds are given.
+    */
+    class ForceFieldSet
+    {
+    private:
+        enum field_type_t
+        {
+            FIELD_GRAVITY,
+            FIELD_DRAG,
+            FIELD_ATTRACTOR,
+            FIELD_VORTEX,
+            FIELD_WIND
+        };
+
+        struct field_t
+        {
+            field_type_t type;
+            glm::vec3 vector;       // gravity: acceleration, attractor/vortex: center, wind: wind velocity
+            glm::vec3 axis;         // vortex: rotation axis
+            float strength;         // drag: linear coefficient, wind: coupling coefficient
+            float radius;           // attractor/vortex: radius of influence
+            float param0;           // drag: quadratic coefficient, wind: gust amplitude
+            float param1;           // wind: gust frequency in Hz
+            uint32_t falloff;       // attractor: falloff exponent
+            bool global;            // global fields are never culled
+            glm::vec3 bounds_min;
+            glm::vec3 bounds_max;
+        };
+
+        std::vector<field_t> fields;
+        std::vector<uint32_t> tile_fields;      // indices of the fields that overlap the current tile
+        std::vector<float> gust;                // gust factor of every field in the current call, 1 for non-wind fields
+        float time;
+
+    public:
+        /** @brief Number of consecutive particles that share one culling test. */
+        constexpr static uint32_t TILE_SIZE = 64;
+
+        ForceFieldSet(void);
+        virtual ~ForceFieldSet(void);
+
+        /** @brief Adds a uniform acceleration, e.g. (0, -9.81, 0). */
+        void add_gravity(const glm::vec3& acceleration);
+
+        /** @brief Adds drag that decelerates with: a = -v * (linear + quadratic * |v|). */
+        void add_drag(float linear, float quadratic);
+
+        /**
+        *   @brief Adds a point attractor. The acceleration towards @param position is
+        *          strength * (1 - distance / radius)^falloff and zero outside of @param radius.
+        *          A negative @param strength turns the attractor into a repulsor.
+        *   @param falloff: 0 = constant, 1 = linear, 2 = quadratic, ...
+        */
+        void add_attractor(const glm::vec3& position, float strength, float radius, uint32_t falloff);
+
+        /**
+        *   @brief Adds a vortex that accelerates particles tangentially around the line through @param center
+        *          along @param axis (right-handed). The acceleration is strength * (1 - distance / radius)
+        *          and zero outside of @param radius.
+        */
+        void add_vortex(const glm::vec3& center, const glm::vec3& axis, float strength, float radius);
+
+        /**
+        *   @brief Adds global directional wind. Particles are accelerated towards the wind velocity with
+        *          a = (wind * gust - v) * coupling, where gust = 1 + gust_amplitude * sin(2 * pi * gust_frequency * t).
+        */
+        void add_wind(const glm::vec3& velocity, float coupling, float gust_amplitude, float gust_frequency);
+
+        /** @brief Adds directional wind that only acts inside the box [bounds_min, bounds_max]. */
+        void add_wind(const glm::vec3& velocity, float coupling, float gust_amplitude, float gust_frequency,
+                      const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+
+        /** @brief Removes every force field from the set and resets the time. */
+        void clear(void);
+
+        /**
+        *   @brief Evaluates all force fields for every particle of the batch and integrates
+        *          the velocities by @param dt (v += a * dt). The positions are not modified.
+        *          Advances the internal time that drives the wind gusts by @param dt.
+        */
+        void apply(ParticleBatch& batch, float dt);
+
+        /** @return The number of force fields in the set. */
+        size_t size(void) const noexcept    { return this->fields.size(); }
+
+        /** @return 'true' if there is no force field in the set. */
+        bool empty(void) const noexcept     { return this->fields.empty(); }
+    };
+};
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "particle_pool.h"
+#include "../profiler/profiler.h"
+#include "../profiler/alloc_tracker.h"
 #include <stdexcept>
 #include <algorithm> 
 #include <sstream>
@@ -11,10 +13,10 @@ ParticlePool::ParticlePool(void)
     this->_clear();
 }
 
-ParticlePool::ParticlePool(ParticleRenderer& renderer) : ParticlePool()
+ParticlePool::ParticlePool(ParticleSink& sink) : ParticlePool()
 {
     // initialize partilcle pool
-    this->init(renderer);
+    this->init(sink);
 }
 
 ParticlePool::~ParticlePool(void)
@@ -22,29 +24,31 @@ ParticlePool::~ParticlePool(void)
     this->clear();
 }
 
-void ParticlePool::init(ParticleRenderer& renderer)
+void ParticlePool::init(ParticleSink& sink)
 {
     if (this->_initialized)
         throw std::runtime_error("ParticlePool has already been initialized.");
-    if (!renderer.initialized())
-        throw std::invalid_argument("ParticleRenderer must be initialized, requiered from ParticlePool::init.");
-
-    this->particle_buffer = renderer.get_particle_buffer();
-    this->particle_capacity = renderer.capacity();
-    this->particle_count = 0;                   // at initialization there are no particles allocated...
-    this->indirect_command = renderer.get_indirect_command();
-    this->indirect_command->vertexCount = 0;    // and there should no particles be drawn
+    if (!sink.initialized())
+        throw std::invalid_argument("ParticleSink must be initialized, requiered from ParticlePool::init.");
+
+    this->particle_buffer = sink.get_particle_buffer();
+    this->particle_capacity = sink.capacity();
+    this->particle_count = 0;       // at initialization there are no particles allocated...
+    this->draw_count = sink.get_draw_count();
+    *this->draw_count = 0;          // and there should no particles be drawn
     this->clear_memory();
 
-    this->_renderer_initialized = &renderer._initialized;
+    this->_sink_initialized = &sink._initialized;
+    this->_frame_counter = sink.frame_counter();
     this->_initialized = true;
 }
 
 void ParticlePool::_clear(void)
 {
     this->_initialized = false;
-    this->_renderer_initialized = nullptr;
-    this->indirect_command = nullptr;
+    this->_sink_initialized = nullptr;
+    this->_frame_counter = nullptr;
+    this->draw_count = nullptr;
     this->particle_capacity = 0;
     this->particle_count = 0;
     this->particle_buffer = nullptr;
@@ -54,7 +58,7 @@ void ParticlePool::clear(void)
 {
     if (this->_initialized)
     {
-        this->indirect_command->vertexCount = 0;    // set vertex count to 0, so that no particles will be drawn if pool gets destroyed
+        *this->draw_count = 0;      // set draw count to 0, so that no particles will be drawn if pool gets destroyed
         this->_clear();
     }
 }
@@ -74,35 +78,65 @@ void ParticlePool::clear_memory(void)
 
 void ParticlePool::push_heap(uint32_t idx)
 {
+    // remove the freed index from the set of allocated indices
+    this->allocated_particles.erase(idx);
+
+    // The heap can still hold the index if it has been allocated by 'allocate_range', then it is pushed twice.
+    // The heap is rebuilt before the stale indices outnumber the capacity, so they cost O(1) amortized.
+    if (this->particle_heap.size() >= 2 * static_cast<size_t>(this->particle_capacity))
+    {
+        this->rebuild_heap();
+        return;
+    }
+
     // add the freed index to the particle heap
     this->particle_heap.push_back(idx);
     std::push_heap(this->particle_heap.begin(), this->particle_heap.end(), std::greater<>{});
-
-    // remove the freed index from the set of allocated indices
-    this->allocated_particles.erase(idx);
 }
 
 uint32_t ParticlePool::pop_heap(void)
 {
-    // pop the allocated index from the particle heap
-    uint32_t idx = this->particle_heap[0];
-    std::pop_heap(this->particle_heap.begin(), this->particle_heap.end(), std::greater<>{});
-    this->particle_heap.pop_back();
+    // pop the lowest free index from the particle heap, indices allocated by 'allocate_range' are skipped
+    uint32_t idx;
+    do
+    {
+        idx = this->particle_heap[0];
+        std::pop_heap(this->particle_heap.begin(), this->particle_heap.end(), std::greater<>{});
+        this->particle_heap.pop_back();
+    }
+    while (this->allocated_particles.count(idx) > 0);
 
     // add the allocated index to the set of allocated indices
     this->allocated_particles.insert(idx);
     return idx;
 }
 
+void ParticlePool::rebuild_heap(void)
+{
+    // the free indices are collected in ascending order, a sorted array is already a valid min-heap
+    this->particle_heap.clear();
+    uint32_t next = 0;
+    for (uint32_t idx : this->allocated_particles)
+    {
+        for (; next < idx; next++)
+            this->particle_heap.push_back(next);
+        next = idx + 1;
+    }
+    for (; next < this->particle_capacity; next++)
+        this->particle_heap.push_back(next);
+}
+
 particle_t* ParticlePool::allocate(void)
 {
+    PROFILE_ZONE("ParticlePool::allocate");
+    ALLOC_SCOPE(profiler::ALLOC_POOL);
     if (!this->_initialized)
         throw std::runtime_error("Failed to allocate particle.\nParticlePool must be initialized in order to allocate particles.");
-    if (!*this->_renderer_initialized)
-        throw std::runtime_error("Failed to allocate particle.\nParticleRenderer must be a valid object in order to allocate particles.");
+    if (!*this->_sink_initialized)
+        throw std::runtime_error("Failed to allocate particle.\nParticleSink must be a valid object in order to allocate particles.");
 
     // particle pool out of memory
-    if (this->particle_heap.size() == 0)
+    if (this->full())
         return nullptr;
 
     // pop the allocated index from heap
@@ -111,7 +145,7 @@ particle_t* ParticlePool::allocate(void)
     // vertex count is the highest allocated index + 1, because the index starts at 0
     // A std::set is a sorted binary tree, where the smallest element is the first element
     // and the highest element is the last element, or the first element in reversed order.
-    this->indirect_command->vertexCount = (*this->allocated_particles.rbegin()) + 1;
+    *this->draw_count = (*this->allocated_particles.rbegin()) + 1;
     ++this->particle_count;
 
     return this->particle_buffer + particle_index;   // particle address = particle memory base address + index
@@ -119,10 +153,12 @@ particle_t* ParticlePool::allocate(void)
 
 void ParticlePool::free(particle_t* p_particle)
 {
+    PROFILE_ZONE("ParticlePool::free");
+    ALLOC_SCOPE(profiler::ALLOC_POOL);
     if (!this->_initialized)
         throw std::runtime_error("Failed to free particle.\nParticlePool must be initialized in order to free particles.");
-    if (!*this->_renderer_initialized)
-        throw std::runtime_error("Failed to free particle.\nParticleRenderer must be a valid object in order to free particles.");
+    if (!*this->_sink_initialized)
+        throw std::runtime_error("Failed to free particle.\nParticleSink must be a valid object in order to free particles.");
     if (p_particle == nullptr) return;
     
     // range check, if the particle to free is not part of the pool
@@ -153,10 +189,85 @@ void ParticlePool::free(particle_t* p_particle)
     // vertex count is the highest allocated index + 1, because the index starts at 0
     // A std::set is a sorted binary tree, where the smallest element is the first element
     // and the highest element is the last element, or the first element in reversed order.
-    this->indirect_command->vertexCount = (this->allocated_particles.size() > 0) ? (*this->allocated_particles.rbegin()) + 1 : 0;
+    *this->draw_count = (this->allocated_particles.size() > 0) ? (*this->allocated_particles.rbegin()) + 1 : 0;
     --this->particle_count;
 }
 
+void ParticlePool::get_allocated_indices(std::vector<uint32_t>& indices) const
+{
+    indices.assign(this->allocated_particles.begin(), this->allocated_particles.end());
+}
+
+void ParticlePool::restore(const particle_t* particles, uint32_t n_particles, const uint32_t* allocated, uint32_t n_allocated)
+{
+    if (!this->_initialized)
+        throw std::runtime_error("Failed to restore particles.\nParticlePool must be initialized in order to restore particles.");
+    if (!*this->_sink_initialized)
+        throw std::runtime_error("Failed to restore particles.\nParticleSink must be a valid object in order to restore particles.");
+    if (n_particles > this->particle_capacity)
+        throw std::invalid_argument("Number of particles of ParticlePool::restore must not be bigger than the capacity of the pool.");
+    for (uint32_t i = 0; i < n_allocated; i++)
+    {
+        if (allocated[i] >= n_particles || (i > 0 && allocated[i] <= allocated[i - 1]))
+            throw std::invalid_argument("Allocated indices of ParticlePool::restore must be strictly ascending and in range of the particles.");
+    }
+
+    // bulk copy, the particles beyond the checkpoint are free
+    std::copy(particles, particles + n_particles, this->particle_buffer);
+    for (uint32_t i = n_particles; i < this->particle_capacity; i++)
+        (this->particle_buffer + i)->pos = glm::vec3(NAN);
+
+    // the indices are sorted, so every insertion is at the end of the set and the hint makes it O(1)
+    this->allocated_particles.clear();
+    for (uint32_t i = 0; i < n_allocated; i++)
+        this->allocated_particles.insert(this->allocated_particles.end(), allocated[i]);
+    this->rebuild_heap();
+
+    this->particle_count = n_allocated;
+    *this->draw_count = (n_allocated > 0) ? allocated[n_allocated - 1] + 1 : 0;
+}
+
+particle_t* ParticlePool::allocate_range(uint32_t n)
+{
+    PROFILE_ZONE("ParticlePool::allocate_range");
+    ALLOC_SCOPE(profiler::ALLOC_POOL);
+    if (!this->_initialized)
+        throw std::runtime_error("Failed to allocate particles.\nParticlePool must be initialized in order to allocate particles.");
+    if (!*this->_sink_initialized)
+        throw std::runtime_error("Failed to allocate particles.\nParticleSink must be a valid object in order to allocate particles.");
+    if (n == 0 || n > this->particle_capacity - this->particle_count)
+        return nullptr;
+
+    // search the lowest gap between the allocated indices that is big enough
+    uint32_t first = 0;
+    for (uint32_t idx : this->allocated_particles)
+    {
+        if (idx - first >= n) break;
+        first = idx + 1;
+    }
+    if (this->particle_capacity - first < n)
+        return nullptr;
+
+    // The allocated indices are at the end of the gap, so inserting them in ascending order before the
+    // next allocated index is O(1) per index. The indices stay in the heap, 'pop_heap' skips them.
+    const auto hint = this->allocated_particles.lower_bound(first);
+    for (uint32_t i = first; i < first + n; i++)
+        this->allocated_particles.insert(hint, i);
+
+    *this->draw_count = (*this->allocated_particles.rbegin()) + 1;
+    this->particle_count += n;
+
+    return this->particle_buffer + first;
+}
+
+void ParticlePool::free_range(particle_t* p_first, uint32_t n)
+{
+    PROFILE_ZONE("ParticlePool::free_range");
+    ALLOC_SCOPE(profiler::ALLOC_POOL);
+    for (uint32_t i = 0; i < n; i++)
+        this->free(p_first + i);
+}
+
 bool ParticlePool::is_allocated(const particle_t* p_particle) const noexcept
 {
     if (!this->_initialized || p_particle == nullptr) return false;
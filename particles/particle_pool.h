@@ -1,9 +1,8 @@
 #pragma once
 
 #include "particle_types.h"
-#include "particle_renderer.h"
+#include "particle_sink.h"
 
-#include <vulkan/vulkan.h>
 #include <vector>
 #include <set>
 
@@ -11,9 +10,9 @@ namespace particles
 {
     /**
     *   @brief Manages allocattion and deallocation of particles.
-    *          The ParticlePool needs a ParticleRenderer which provides the particle buffer.
-    *          Additionally, a check is implemented if the ParticleRenderer is still valid. 
-               If the ParticleRenderer is not valid any more for whatever reason,
+    *          The ParticlePool needs a ParticleSink (e.g. a ParticleRenderer) which provides the particle buffer.
+    *          Additionally, a check is implemented if the ParticleSink is still valid. 
+               If the ParticleSink is not valid any more for whatever reason,
     *          particles cannot be allocated or deallocated.
     */
     class ParticlePool
@@ -22,12 +21,13 @@ namespace particles
         particle_t* particle_buffer;                // base address of buffer
         uint32_t particle_capacity;                 // maximum number of particles the particle-buffer can store
         uint32_t particle_count;                    // count of how many particles are allocated
-        std::vector<uint32_t> particle_heap;        // heap where the free particle indices are stored
+        std::vector<uint32_t> particle_heap;        // heap where the free particle indices are stored, allocated indices are removed lazily
         std::set<uint32_t> allocated_particles;     // set where the allocated particle indices are stored
-        VkDrawIndirectCommand* indirect_command;    // indirect command struct for vkCmdDrawIndirect
+        uint32_t* draw_count;                       // draw count of the sink, e.g. the vertex count for vkCmdDrawIndirect
+        const FrameCounter* _frame_counter;         // frames of the sink's consumer, nullptr = consumed synchronously
 
         bool _initialized;
-        const bool* _renderer_initialized;
+        const bool* _sink_initialized;
 
         /**
         *   @brief Marks every particle in the particle-buffer as free.
@@ -49,6 +49,12 @@ namespace particles
         */
         uint32_t pop_heap(void);
 
+        /**
+        *   @brief Rebuilds the heap from the free indices.
+        *          Used if the heap holds too many indices that have already been allocated by 'ParticlePool::allocate_range'.
+        */
+        void rebuild_heap(void);
+
         /** @brief Sets every internal (private) member object to initial state. */
         void _clear(void);
 
@@ -61,18 +67,18 @@ namespace particles
 
         /**
         *   @brief Constructor that initializes the ParticlePool.
-        *   @param renderer: The ParticleRenderer that the ParticlePool should use.
+        *   @param sink: The ParticleSink that the ParticlePool should use.
         */
-        ParticlePool(ParticleRenderer& renderer);
+        ParticlePool(ParticleSink& sink);
 
         /** @brief Destroys the ParticlePool. */
         virtual ~ParticlePool(void);
 
         /**
         *   @brief Completely initailizes the ParticlePool.
-        *   @param renderer: The ParticleRenderer that the ParticlePool should use.
+        *   @param sink: The ParticleSink that the ParticlePool should use.
         */
-        void init(ParticleRenderer& renderer);
+        void init(ParticleSink& sink);
 
         /** @brief Completely deinitializes the ParticlePool. */
         void clear(void);
@@ -89,6 +95,42 @@ namespace particles
         */
         void free(particle_t* p_particle);
 
+        /**
+        *   @brief Allocates @param n consecutive particles, e.g. to update them with a single copy.
+        *          The lowest free range that is big enough is used.
+        *   NOTE: This method is O(allocated particles), it is meant for long-living allocations.
+        *         The allocated indices stay in the heap and are skipped when they are popped.
+        *   @return A pointer to the first allocated particle or a nullptr if there is no free range that is big enough.
+        */
+        particle_t* allocate_range(uint32_t n);
+
+        /**
+        *   @brief Deallocates @param n consecutive particles.
+        *   @param p_first: A pointer to the first particle that should be deallocated.
+        */
+        void free_range(particle_t* p_first, uint32_t n);
+
+        /**
+        *   @brief Writes the indices of all allocated particles in ascending order into @param indices.
+        *          Used together with the particle-buffer to checkpoint the pool.
+        */
+        void get_allocated_indices(std::vector<uint32_t>& indices) const;
+
+        /**
+        *   @brief Restores the pool from a checkpoint. Every currently allocated particle is
+        *          discarded, the particles are bulk-copied into the particle-buffer and the
+        *          allocation tables are rebuilt from the allocated indices.
+        *   @param particles: The checkpointed particle-buffer
+        *   @param n_particles: Number of particles in @param particles, must not be bigger than the capacity.
+        *                       The remaining particles of the pool are marked as free.
+        *   @param allocated: The allocated indices of the checkpoint in strictly ascending order
+        *   @param n_allocated: Number of allocated indices
+        */
+        void restore(const particle_t* particles, uint32_t n_particles, const uint32_t* allocated, uint32_t n_allocated);
+
+        /** @return A pointer to the particle with index @param idx in the particle-buffer, there is no range check. */
+        particle_t* at(uint32_t idx) noexcept               { return this->particle_buffer + idx; }
+
         /** @return The maximum number of particles the ParticlePool can allocate. */
         uint32_t capacity(void) const noexcept              { return this->particle_capacity; }
 
@@ -116,10 +158,29 @@ namespace particles
         /** @return 'true' if the ParticlePool is initialized. */
         bool initialized(void) const noexcept   { return this->_initialized; }
 
+        /**
+        *   @return The frame counter of the sink's consumer, a nullptr if the particles are consumed synchronously.
+        *           Engines use it to find out which writes the consumer has finished reading (see particles::FrameCounter).
+        */
+        const FrameCounter* frame_counter(void) const noexcept  { return this->_frame_counter; }
+
         /** @return 'true' if no particle has been allocated. */
         bool empty(void) const noexcept         { return (this->particle_count == 0); }
 
+        /**
+        *   @return The fraction of free particles in the drawn range of the particle-buffer (0 to the highest allocated index),
+        *           free particles in that range are still processed by the sink.
+        */
+        float fragmentation(void) const noexcept
+        {
+            const uint32_t drawn = this->drawn();
+            return (drawn > 0) ? 1.0f - static_cast<float>(this->particle_count) / drawn : 0.0f;
+        }
+
+        /** @return The number of particles the sink draws, the highest allocated index + 1. */
+        uint32_t drawn(void) const noexcept     { return (this->draw_count != nullptr) ? *this->draw_count : 0; }
+
         /** @return 'true' if the ParticlePool is out of memory. */
-        bool full(void) const noexcept          { return (this->particle_heap.size() == 0); }
+        bool full(void) const noexcept          { return (this->particle_count == this->particle_capacity); }
     };
 }
\ No newline at end of file
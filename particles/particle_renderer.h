@@ -1,33 +1,96 @@
 #pragma once
 
 #include <vulkan/vulkan_absraction.h>
-#include "particle_types.h"
+#include "particle_sink.h"
+#include "frame_timeline.h"
 
 namespace particles
 {
+    /**
+    *   @brief Struct that is used as parameter to initialize the particles::ParticleRenderer-class.
+    *   @param vertex_shader_path: Path to the particle-vertex-shader
+    *   @param geometry_shader_path: Path to the particle-geometry-shader
+    *   @param fragment_shader_path: Path to the particle-fragment-shader
+    *   @param physical_device: Physical device that is used for GPU-operations
+    *   @param device: Logical device that is used for GPU-operations
+    *   @param render_pass: Render pass to draw the particles with
+    *   @param sub_pass: Render sub pass index that draws the particles.
+    *   @param external_command_pool: Boolean to determine if an external command pool should be used
+    *   @param command_pool: External command pool object, is ignored if @param external_command_pool is set to 'false'
+    *   @param queue_family_index: The queue family index the renderer should use
+    *   @param queue: The queue that is used for internal copy / move operations
+    *   @param buffer_capycity: The maximum capacity how many particles the buffer can contain
+    *   @param frames_in_flight: Number of frames that can be rendered at the same time, every frame has its own
+    *                            transformation matrices, descriptor set and command buffer (1 to ParticleRenderer::MAX_FRAMES_IN_FLIGHT)
+    */
+    struct ParticleRendererInitInfo
+    {
+        const char*         vertex_shader_path;
+        const char*         geometry_shader_path;
+        const char*         fragment_shader_path;
+        const char*         particle_texture_path;
+        VkPhysicalDevice    physical_device;
+        VkDevice            device;
+        VkRenderPass        render_pass;
+        uint32_t            sub_pass;
+        bool                external_command_pool;
+        VkCommandPool       command_pool;
+        uint32_t            queue_family_index;
+        VkQueue             queue;
+        uint32_t            buffer_capacity;
+        uint32_t            frames_in_flight;
+    };
+
+    /**
+    *   @brief Struct that is used as parameter for the particles::ParticleRenderer::record-method.
+    *   @param render_pass: The render pass that is used for command buffer recording.
+    *   @param sub_pass: The sub render pass that is used for command buffer recording.
+    *   @param framebuffer: The framebuffer in which the command buffer gets executed.
+    *                       This parameter can also be VK_NULL_HANDLE, if the framebuffer is unknown in which
+    *                       the command buffer gets executed at runtime.
+    *   @param viewport: The viewport of the scene.
+    *   @param scissor: Scissor of the scene.
+    */
+    struct ParticleRendererRecordInfo
+    {
+        VkRenderPass    render_pass;
+        uint32_t        sub_pass;
+        VkFramebuffer   framebuffer;
+        VkViewport      viewport;
+        VkRect2D        scissor;
+        VkQueryPipelineStatisticFlags pipeline_statistics;  // statistics of a query that is active while the commands are executed, 0 = none
+    };
+
     /**
     *   Class: ParticleRenderer
     *   @brief This calss provides the buffer where particles get stored, allocated and deallocated.
     *          It also sets up a rendering pipeline that contains three shader stages: vertex-, geometry- and fragment-shader,
     *          and provides a pre-recorded secondary command buffer which must be executed EXTERNALLY.
     *          The matrices view and projection can be set via setter-methods.
+    *          Every frame in flight has its own matrices, the setters write the ones of the frame that has been
+    *          selected by 'ParticleRenderer::set_frame'.
+    *          The frames that read the particle buffer are counted by a timeline semaphore (see particles::FrameTimeline),
+    *          every submission that executes the command buffer must signal it.
+    *          The ParticleRenderer is the Vulkan implementation of a particles::ParticleSink.
     *   NOTE: There are no default shaders for particle rendering, they are free programmable.
     *         However, the shaders must implement specific input layouts and uniforms.
     *         Templates for those shaders are in the directory "./particles/shader_templates".
     */
-    class ParticleRenderer
+    class ParticleRenderer : public ParticleSink
     {
-        friend class ParticlePool;
+    public:
+        constexpr static uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
     private:
 
         // vulkan handles
         VkDescriptorPool descriptor_pool;
         VkDescriptorSetLayout descriptor_layout;
-        VkDescriptorSet descriptor_set;
+        VkDescriptorSet descriptor_sets[MAX_FRAMES_IN_FLIGHT];
 
         bool external_command_pool;
         VkCommandPool command_pool;
-        VkCommandBuffer command_buffer;
+        VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
 
         VkPipelineLayout pipeline_layout;
         VkPipeline pipeline;
@@ -38,11 +101,14 @@ namespace particles
         vka::Texture particle_texture;
         vka::Buffer tm_buffer;
         vka::Buffer indirect_buffer;
+        FrameTimeline _timeline;
 
         // other variables
-        bool _initialized;
         uint32_t buffer_capacity;
-        TransformMatrices* transformation_matrices;
+        uint32_t frames_in_flight;
+        VkDeviceSize tm_stride;                     // distance of the matrices of two frames, aligned to minUniformBufferOffsetAlignment
+        uint8_t* tm_map;
+        TransformMatrices* transformation_matrices; // matrices of the selected frame
         VkDrawIndirectCommand* indirect_command;
 
         // internal methods to initialize the vulkan objects
@@ -60,15 +126,15 @@ namespace particles
         *   to get read/write access to the particle's buffer memory.
         *   @return The (base) pointer to the particle buffer.
         */
-        particle_t* get_particle_buffer(void) noexcept { return this->particle_buffer_map; }
+        particle_t* get_particle_buffer(void) noexcept override { return this->particle_buffer_map; }
 
         /**
         *   @brief This method cannot be accessed from outside. It is used by the particle pool
         *   to control how many particles should be drawn by an idirect draw command. The particle
-        *   pool has read/write access to the indirect draw command.
-        *   @return The pointer to a SINGLE VkDrawIndirectCommand-struct.
+        *   pool has read/write access to the vertex count of the indirect draw command.
+        *   @return The pointer to the vertex count of a SINGLE VkDrawIndirectCommand-struct.
         */
-        VkDrawIndirectCommand* get_indirect_command(void) noexcept { return this->indirect_command; }
+        uint32_t* get_draw_count(void) noexcept override { return &this->indirect_command->vertexCount; }
 
         /**
         *   @brief Destructs the object. If the ParticleRenderer is initialized while the destructor gets called,
@@ -111,11 +177,17 @@ namespace particles
         void clear(VkDevice device);
 
         /**
-        *   @brief Records a secondary command buffer that must be executed EXTERNALLY by 'vkCmdExecuteCommands'.
+        *   @brief Records the secondary command buffers of every frame in flight, they must be executed EXTERNALLY by 'vkCmdExecuteCommands'.
         *   @param Record information struct
         */
         VkResult record(const ParticleRendererRecordInfo& info);
 
+        /**
+        *   @brief Selects the frame in flight whose matrices are written by the setters.
+        *   NOTE: The GPU must have finished the last submission of the frame's command buffer.
+        */
+        void set_frame(uint32_t frame) noexcept;
+
         /** @brief Sets the particle-shader's view matrix. */
         void set_view(const glm::mat4& v) noexcept;
 
@@ -125,14 +197,18 @@ namespace particles
         /** @brief Sets the particle-shader's view and projection matrix. */
         void set_view_projection(const glm::mat4& v, const glm::mat4& p) noexcept;
 
-        /** @return 'true' if ParticleRenderer is initialized. */
-        bool initialized(void) const noexcept                               { return this->_initialized; };
-
         /** @return The maximum number of particles the particle-buffer can store. */
-        uint32_t capacity(void) const noexcept                              { return this->buffer_capacity; }
+        uint32_t capacity(void) const noexcept override                     { return this->buffer_capacity; }
+
+        /** @return The frame counter of the GPU, it is signaled by the submissions of the render thread. */
+        FrameTimeline& timeline(void) noexcept                              { return this->_timeline; }
+        const FrameCounter* frame_counter(void) const noexcept override     { return &this->_timeline; }
+
+        /** @return The number of frames in flight. */
+        uint32_t frame_count(void) const noexcept                           { return this->frames_in_flight; }
 
-        /** @return A recorded command buffer that can be executed by 'vkCmdExecuteCommands'. */
-        VkCommandBuffer get_command_buffer(void) const noexcept             { return this->command_buffer; }
-        const VkCommandBuffer* get_command_buffer_ptr(void) const noexcept  { return &this->command_buffer; }
+        /** @return The recorded command buffer of a frame in flight that can be executed by 'vkCmdExecuteCommands'. */
+        VkCommandBuffer get_command_buffer(uint32_t frame = 0) const noexcept               { return this->command_buffers[frame]; }
+        const VkCommandBuffer* get_command_buffer_ptr(uint32_t frame = 0) const noexcept    { return &this->command_buffers[frame]; }
     };
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "particle_renderer.h"
+#include "frame_arena.h"
 #include <stb/stb_image.h>
 #include <array>
 #include <stdexcept>
@@ -8,9 +9,11 @@ using namespace particles;
 
 ParticleRenderer::ParticleRenderer(void)
 {
-    this->_initialized = false;
     this->particle_buffer_map = nullptr;
     this->buffer_capacity = 0;
+    this->frames_in_flight = 0;
+    this->tm_stride = 0;
+    this->tm_map = nullptr;
     this->transformation_matrices = nullptr;
     this->indirect_command = nullptr;
 }
@@ -53,9 +56,9 @@ VkResult ParticleRenderer::init_command_buffer(const ParticleRendererInitInfo& i
     cbo_ai.pNext = nullptr;
     cbo_ai.commandPool = this->command_pool;
     cbo_ai.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-    cbo_ai.commandBufferCount = 1;
+    cbo_ai.commandBufferCount = info.frames_in_flight;
 
-    return vkAllocateCommandBuffers(info.device, &cbo_ai, &this->command_buffer);
+    return vkAllocateCommandBuffers(info.device, &cbo_ai, this->command_buffers);
 }
 
 VkResult ParticleRenderer::init_particle_buffer(const ParticleRendererInitInfo& info)
@@ -81,20 +84,29 @@ VkResult ParticleRenderer::init_particle_buffer(const ParticleRendererInitInfo&
 
 VkResult ParticleRenderer::init_uniform_buffer(const ParticleRendererInitInfo& info)
 {
+    // one slot per frame in flight, the slots are bound at offsets of the same buffer
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(info.physical_device, &properties);
+    const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+    this->tm_stride = (sizeof(TransformMatrices) + alignment - 1) / alignment * alignment;
+    this->frames_in_flight = info.frames_in_flight;
+    const VkDeviceSize buffer_size = this->tm_stride * info.frames_in_flight;
+
     this->tm_buffer.set_physical_device(info.physical_device);
     this->tm_buffer.set_device(info.device);
     this->tm_buffer.set_create_flags(0);
     this->tm_buffer.set_create_queue_families(&info.queue_family_index, 1);
     this->tm_buffer.set_create_sharing_mode(VK_SHARING_MODE_EXCLUSIVE);
     this->tm_buffer.set_create_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    this->tm_buffer.set_create_size(sizeof(TransformMatrices));
+    this->tm_buffer.set_create_size(buffer_size);
     // use DMA-cache for buffer location
     this->tm_buffer.set_memory_properties(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
     VkResult res = this->tm_buffer.create();
     if (res != VK_SUCCESS) return res;
     
     // leave the uniform buffer mapped for fast updating, it gets unmapped in ParticleRenderer::clear
-    this->transformation_matrices = (TransformMatrices*)this->tm_buffer.map(sizeof(TransformMatrices), 0);
+    this->tm_map = (uint8_t*)this->tm_buffer.map(buffer_size, 0);
+    this->transformation_matrices = (TransformMatrices*)this->tm_map;
     return VK_SUCCESS;
 }
 
@@ -210,69 +222,75 @@ VkResult ParticleRenderer::init_descritpors(const ParticleRendererInitInfo& info
 
     std::array<VkDescriptorPoolSize, 2> pool_sizes;
     pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_sizes[0].descriptorCount = 1;
+    pool_sizes[0].descriptorCount = info.frames_in_flight;
     
     pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    pool_sizes[1].descriptorCount = 1;
+    pool_sizes[1].descriptorCount = info.frames_in_flight;
 
     // create descriptor pool
     VkDescriptorPoolCreateInfo pool_ci = {};
     pool_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     pool_ci.pNext = nullptr;
     pool_ci.flags = 0;
-    pool_ci.maxSets = 1;
+    pool_ci.maxSets = info.frames_in_flight;
     pool_ci.poolSizeCount = pool_sizes.size();
     pool_ci.pPoolSizes = pool_sizes.data();
     res = vkCreateDescriptorPool(info.device, &pool_ci, nullptr, &this->descriptor_pool);
     if (res != VK_SUCCESS) return res;
 
-    // create descriptor sets
+    // create descriptor sets, one per frame in flight
+    std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> set_layouts;
+    set_layouts.fill(this->descriptor_layout);
+
     VkDescriptorSetAllocateInfo set_ai = {};
     set_ai.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     set_ai.pNext = nullptr;
     set_ai.descriptorPool = this->descriptor_pool;
-    set_ai.descriptorSetCount = 1;
-    set_ai.pSetLayouts = &this->descriptor_layout;
-    res = vkAllocateDescriptorSets(info.device, &set_ai, &this->descriptor_set);
+    set_ai.descriptorSetCount = info.frames_in_flight;
+    set_ai.pSetLayouts = set_layouts.data();
+    res = vkAllocateDescriptorSets(info.device, &set_ai, this->descriptor_sets);
     if (res != VK_SUCCESS) return res;
 
-    // update descriptor sets
-    std::array<VkDescriptorBufferInfo, 1> buffer_infos;
-    buffer_infos[0].buffer = this->tm_buffer.handle();
-    buffer_infos[0].offset = 0;
-    buffer_infos[0].range = sizeof(TransformMatrices);
-
+    // update descriptor sets, every set points to the matrices of its frame
     std::array<VkDescriptorImageInfo, 1> image_infos;
     image_infos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     image_infos[0].imageView = this->particle_texture.view();
     image_infos[0].sampler = this->particle_texture.sampler();
 
-    std::array<VkWriteDescriptorSet, 2> descriptor_writes;
-    descriptor_writes[0] = {};
-    descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptor_writes[0].pNext = nullptr;
-    descriptor_writes[0].dstSet = this->descriptor_set;
-    descriptor_writes[0].dstBinding = 0;
-    descriptor_writes[0].dstArrayElement = 0;
-    descriptor_writes[0].descriptorCount = 1;
-    descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptor_writes[0].pImageInfo = nullptr;
-    descriptor_writes[0].pBufferInfo = buffer_infos.data() + 0;
-    descriptor_writes[0].pTexelBufferView = nullptr;
-
-    descriptor_writes[1] = {};
-    descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptor_writes[1].pNext = nullptr;
-    descriptor_writes[1].dstSet = this->descriptor_set;
-    descriptor_writes[1].dstBinding = 1;
-    descriptor_writes[1].dstArrayElement = 0;
-    descriptor_writes[1].descriptorCount = 1;
-    descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptor_writes[1].pImageInfo = image_infos.data() + 0;
-    descriptor_writes[1].pBufferInfo = nullptr;
-    descriptor_writes[1].pTexelBufferView = nullptr;
-
-    vkUpdateDescriptorSets(info.device, descriptor_writes.size(), descriptor_writes.data(), 0, nullptr);
+    for (uint32_t i = 0; i < info.frames_in_flight; i++)
+    {
+        std::array<VkDescriptorBufferInfo, 1> buffer_infos;
+        buffer_infos[0].buffer = this->tm_buffer.handle();
+        buffer_infos[0].offset = i * this->tm_stride;
+        buffer_infos[0].range = sizeof(TransformMatrices);
+
+        std::array<VkWriteDescriptorSet, 2> descriptor_writes;
+        descriptor_writes[0] = {};
+        descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[0].pNext = nullptr;
+        descriptor_writes[0].dstSet = this->descriptor_sets[i];
+        descriptor_writes[0].dstBinding = 0;
+        descriptor_writes[0].dstArrayElement = 0;
+        descriptor_writes[0].descriptorCount = 1;
+        descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptor_writes[0].pImageInfo = nullptr;
+        descriptor_writes[0].pBufferInfo = buffer_infos.data() + 0;
+        descriptor_writes[0].pTexelBufferView = nullptr;
+
+        descriptor_writes[1] = {};
+        descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[1].pNext = nullptr;
+        descriptor_writes[1].dstSet = this->descriptor_sets[i];
+        descriptor_writes[1].dstBinding = 1;
+        descriptor_writes[1].dstArrayElement = 0;
+        descriptor_writes[1].descriptorCount = 1;
+        descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_writes[1].pImageInfo = image_infos.data() + 0;
+        descriptor_writes[1].pBufferInfo = nullptr;
+        descriptor_writes[1].pTexelBufferView = nullptr;
+
+        vkUpdateDescriptorSets(info.device, descriptor_writes.size(), descriptor_writes.data(), 0, nullptr);
+    }
 
     return VK_SUCCESS;
 }
@@ -293,8 +311,8 @@ VkResult ParticleRenderer::init_pipeline(const ParticleRendererInitInfo& info)
     program.attach(fragment_shader);
 
     // get vertex attributes
-    std::vector<VkVertexInputBindingDescription> bindings;
-    std::vector<VkVertexInputAttributeDescription> attributes;
+    std::pmr::vector<VkVertexInputBindingDescription> bindings(&FrameArena::local());
+    std::pmr::vector<VkVertexInputAttributeDescription> attributes(&FrameArena::local());
     particle_t::get_binding_description(bindings);
     particle_t::get_attribute_description(attributes);
 
@@ -446,6 +464,8 @@ VkResult ParticleRenderer::init(const ParticleRendererInitInfo& info)
             throw std::invalid_argument("Render pass of ParticleRenderer::init is a VK_NULL_HANDLE.");
         if (info.external_command_pool && info.command_pool == VK_NULL_HANDLE)
             throw std::invalid_argument("ParticleRenderer should use an external command pool but command pool of ParticleRenderer::init is a VK_NULL_HANDLE.");
+        if (info.frames_in_flight == 0 || info.frames_in_flight > MAX_FRAMES_IN_FLIGHT)
+            throw std::invalid_argument("Frames in flight of ParticleRenderer::init must be in the range [1, " + std::to_string(MAX_FRAMES_IN_FLIGHT) + "].");
 
         if ((result = this->init_command_pool(info))    != VK_SUCCESS) return result;
         if ((result = this->init_command_buffer(info))  != VK_SUCCESS) return result;
@@ -455,6 +475,7 @@ VkResult ParticleRenderer::init(const ParticleRendererInitInfo& info)
         if ((result = this->load_textures(info))        != VK_SUCCESS) return result;
         if ((result = this->init_descritpors(info))     != VK_SUCCESS) return result;
         if ((result = this->init_pipeline(info))        != VK_SUCCESS) return result;
+        if ((result = this->_timeline.init(info.device)) != VK_SUCCESS) return result;
         this->_initialized = true;
     }
     else
@@ -470,6 +491,7 @@ void ParticleRenderer::clear(VkDevice device)
     {
         this->_initialized = false;
 
+        this->_timeline.clear();
         vkDestroyPipeline(device, this->pipeline, nullptr);
         vkDestroyPipelineLayout(device, this->pipeline_layout, nullptr);
         vkDestroyDescriptorPool(device, this->descriptor_pool, nullptr);
@@ -481,12 +503,14 @@ void ParticleRenderer::clear(VkDevice device)
         this->particle_buffer.clear();
         this->indirect_buffer.unmap();
         this->indirect_buffer.clear();
-        vkFreeCommandBuffers(device, this->command_pool, 1, &this->command_buffer);
+        vkFreeCommandBuffers(device, this->command_pool, this->frames_in_flight, this->command_buffers);
         if (!this->external_command_pool)
             vkDestroyCommandPool(device, this->command_pool, nullptr);
 
         this->buffer_capacity = 0;
+        this->frames_in_flight = 0;
         this->particle_buffer_map = nullptr;
+        this->tm_map = nullptr;
         this->transformation_matrices = nullptr;
         this->indirect_command = nullptr;
     }
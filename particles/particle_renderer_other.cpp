@@ -29,6 +29,14 @@ void ParticleRenderer::set_view_projection(const glm::mat4& v, const glm::mat4&
     }
 }
 
+void ParticleRenderer::set_frame(uint32_t frame) noexcept
+{
+    if (this->_initialized && frame < this->frames_in_flight)
+    {
+        this->transformation_matrices = (TransformMatrices*)(this->tm_map + frame * this->tm_stride);
+    }
+}
+
 VkResult ParticleRenderer::record(const ParticleRendererRecordInfo& info)
 {
     if (!this->_initialized)
@@ -42,7 +50,7 @@ VkResult ParticleRenderer::record(const ParticleRendererRecordInfo& info)
     inheritance_info.framebuffer = info.framebuffer;
     inheritance_info.occlusionQueryEnable = VK_FALSE;
     inheritance_info.queryFlags = 0;
-    inheritance_info.pipelineStatistics = 0;
+    inheritance_info.pipelineStatistics = info.pipeline_statistics;
 
     VkCommandBufferBeginInfo begin_info = {};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -50,19 +58,25 @@ VkResult ParticleRenderer::record(const ParticleRendererRecordInfo& info)
     begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
     begin_info.pInheritanceInfo = &inheritance_info;
 
-    VkResult result = vkBeginCommandBuffer(this->command_buffer, &begin_info);
-    if (result != VK_SUCCESS) return result;
+    // the command buffers only differ in the descriptor set with the frame's matrices
+    for (uint32_t i = 0; i < this->frames_in_flight; i++)
+    {
+        VkResult result = vkBeginCommandBuffer(this->command_buffers[i], &begin_info);
+        if (result != VK_SUCCESS) return result;
+
+        vkCmdBindPipeline(this->command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
+        vkCmdSetViewport(this->command_buffers[i], 0, 1, &info.viewport);
+        vkCmdSetScissor(this->command_buffers[i], 0, 1, &info.scissor);
+        vkCmdBindDescriptorSets(this->command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_layout, 0, 1, &this->descriptor_sets[i], 0, nullptr);
 
-    vkCmdBindPipeline(this->command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
-    vkCmdSetViewport(this->command_buffer, 0, 1, &info.viewport);
-    vkCmdSetScissor(this->command_buffer, 0, 1, &info.scissor);
-    vkCmdBindDescriptorSets(this->command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline_layout, 0, 1, &this->descriptor_set, 0, nullptr);
+        VkDeviceSize offset = 0;
+        VkBuffer vertex_buffer = this->particle_buffer.handle();
+        vkCmdBindVertexBuffers(this->command_buffers[i], 0, 1, &vertex_buffer, &offset);
 
-    VkDeviceSize offset = 0;
-    VkBuffer vertex_buffer = this->particle_buffer.handle();
-    vkCmdBindVertexBuffers(this->command_buffer, 0, 1, &vertex_buffer, &offset);
-    
-    vkCmdDrawIndirect(this->command_buffer, this->indirect_buffer.handle(), 0, 1, sizeof(VkDrawIndirectCommand));
+        vkCmdDrawIndirect(this->command_buffers[i], this->indirect_buffer.handle(), 0, 1, sizeof(VkDrawIndirectCommand));
 
-    return vkEndCommandBuffer(this->command_buffer);
+        result = vkEndCommandBuffer(this->command_buffers[i]);
+        if (result != VK_SUCCESS) return result;
+    }
+    return VK_SUCCESS;
 }
\ No newline at end of file
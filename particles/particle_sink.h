@@ -0,0 +1,78 @@
+#pragma once
+
+#include "particle_types.h"
+#include <cstdint>
+
+namespace particles
+{
+    /**
+    *   Class: FrameCounter
+    *   @brief Counts the frames that consume the buffer of a particles::ParticleSink asynchronously, e.g. on the GPU.
+    *          Frames are numbered from 1. Data that is written into the buffer before 'FrameCounter::submitted'
+    *          returns N is seen by frame N + 1 at the latest, and frames up to N may still read the old contents
+    *          until 'FrameCounter::completed' has reached N. A producer that wants to reuse memory which is not
+    *          referenced anymore reads 'submitted' and waits until that frame is completed, without blocking the consumer.
+    *   NOTE: Every method may be called from any thread.
+    */
+    class FrameCounter
+    {
+    public:
+        virtual ~FrameCounter(void) = default;
+
+        /** @return The last frame that has been submitted for consumption, 0 if no frame has been submitted. */
+        virtual uint64_t submitted(void) const noexcept = 0;
+
+        /** @return The last frame that has been consumed completely. */
+        virtual uint64_t completed(void) const = 0;
+
+        /**
+        *   @brief Blocks the calling thread until a frame has been consumed.
+        *   @param frame: The frame to wait for
+        *   @param timeout_ns: Maximum time to wait in nanoseconds
+        *   @return 'true' if the frame has been consumed, 'false' if the timeout has expired.
+        */
+        virtual bool wait(uint64_t frame, uint64_t timeout_ns) const = 0;
+    };
+
+    /**
+    *   Class: ParticleSink
+    *   @brief Abstract storage that the particles::ParticlePool allocates particles from.
+    *          A sink provides the particle buffer and a draw count. The pool writes the particles
+    *          into the buffer and keeps the draw count at the highest allocated index + 1.
+    *          How the buffer is consumed is up to the sink: particles::ParticleRenderer draws it
+    *          with Vulkan, particles::HostParticleSink keeps it in plain host memory.
+    *   NOTE: The pool checks the '_initialized'-flag of the sink before every allocation,
+    *         a sink must only set it while its buffer is valid.
+    */
+    class ParticleSink
+    {
+        friend class ParticlePool;
+    protected:
+        bool _initialized;
+
+        /**
+        *   @brief Only used by the particle pool to get read/write access to the particle buffer.
+        *   @return The (base) pointer to the particle buffer.
+        */
+        virtual particle_t* get_particle_buffer(void) noexcept = 0;
+
+        /**
+        *   @brief Only used by the particle pool to control how many particles are consumed.
+        *   @return The pointer to a SINGLE draw count, e.g. the vertex count of an indirect draw command.
+        */
+        virtual uint32_t* get_draw_count(void) noexcept = 0;
+
+    public:
+        ParticleSink(void) { this->_initialized = false; }
+        virtual ~ParticleSink(void) = default;
+
+        /** @return The maximum number of particles the particle-buffer can store. */
+        virtual uint32_t capacity(void) const noexcept = 0;
+
+        /** @return 'true' if the ParticleSink is initialized. */
+        bool initialized(void) const noexcept { return this->_initialized; }
+
+        /** @return The frame counter of the consumer of the buffer, a nullptr if the buffer is consumed synchronously. */
+        virtual const FrameCounter* frame_counter(void) const noexcept { return nullptr; }
+    };
+};
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "particle_types.h"
+#include <vulkan/vulkan.h>
 #include <stdexcept>
 
 using namespace particles;
 
-void particle_t::get_binding_description(std::vector<VkVertexInputBindingDescription>& bindings)
+void particle_t::get_binding_description(std::pmr::vector<VkVertexInputBindingDescription>& bindings)
 {
     bindings.resize(1, {});
     bindings[0].binding = 0;
@@ -11,7 +12,7 @@ void particle_t::get_binding_description(std::vector<VkVertexInputBindingDescrip
     bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 }
 
-void particle_t::get_attribute_description(std::vector<VkVertexInputAttributeDescription>& attributes)
+void particle_t::get_attribute_description(std::pmr::vector<VkVertexInputAttributeDescription>& attributes)
 {
     attributes.resize(3, {});
     attributes[0].location = 0;
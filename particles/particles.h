@@ -1,6 +1,4 @@
 #pragma once
 
-#include "particle_types.h"
-#include "particle_renderer.h"
-#include "particle_pool.h"
-#include "particle_engine.h"
\ No newline at end of file
+#include "particles_core.h"
+#include "particle_renderer.h"
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "particle_types.h"
+#include "particle_sink.h"
+#include "host_particle_sink.h"
+#include "particle_pool.h"
+#include "frame_arena.h"
+#include "particle_engine.h"
+#include "session_recorder.h"
+#include "checkpoint.h"
\ No newline at end of file
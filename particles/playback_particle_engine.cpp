@@ -0,0 +1,197 @@
+#include "particle_engine.h"
+#include "../profiler/profiler.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace particles;
+
+PlaybackParticleEngine::PlaybackParticleEngine(void)
+{
+    this->pool = nullptr;
+    this->range = nullptr;
+    this->range_size = 0;
+    this->presented_size = 0;
+    this->decode_frame = 0;
+    this->_current_frame = 0;
+    this->time = 0.0;
+    this->loop = true;
+    this->decode_failed = false;
+}
+
+PlaybackParticleEngine::PlaybackParticleEngine(ParticlePool& pool, const char* path) : PlaybackParticleEngine()
+{
+    this->init(pool, path);
+}
+
+PlaybackParticleEngine::~PlaybackParticleEngine(void)
+{
+    this->stop();
+}
+
+void PlaybackParticleEngine::init(ParticlePool& pool, const char* path)
+{
+    if (this->base_running())
+        throw std::runtime_error("Cannot reinitialize running particle engine (PlaybackParticleEngine).");
+
+    this->reader.close();
+    this->reader.open(path);
+    if (this->reader.frame_count() == 0)
+        throw std::invalid_argument("Baked cache of PlaybackParticleEngine::init does not contain any frame.");
+    this->pool = &pool;
+    this->_current_frame = 0;
+    this->time = 0.0;
+}
+
+void PlaybackParticleEngine::start(void)
+{
+    if (this->pool == nullptr)
+        throw std::runtime_error("Cannot start uninitialized particle engine (PlaybackParticleEngine).");
+    if (this->base_running()) return;
+
+    // one range for the biggest frame, smaller frames leave free (NAN) particles at its end
+    this->range_size = this->reader.max_particles();
+    this->range = (this->range_size > 0) ? this->pool->allocate_range(this->range_size) : nullptr;
+    if (this->range_size > 0 && this->range == nullptr)
+        throw std::bad_alloc();
+    this->presented_size = 0;
+
+    this->decoded.clear();
+    this->decode_failed = false;
+    this->decode_frame = this->_current_frame;
+    this->start_base(this);
+    this->seek(this->_current_frame);
+}
+
+void PlaybackParticleEngine::stop(void)
+{
+    this->stop_base();  // stop the read-ahead thread first, then the particles can be freed
+    if (this->range != nullptr)
+    {
+        this->pool->free_range(this->range, this->range_size);
+        this->range = nullptr;
+        this->range_size = 0;
+        this->presented_size = 0;
+    }
+    for (decoded_frame_t& frame : this->decoded)
+        this->unused.push_back(std::move(frame));
+    this->decoded.clear();
+}
+
+void PlaybackParticleEngine::run(const std::atomic_bool& running, void* param)
+{
+    PROFILE_THREAD("PlaybackParticleEngine");
+    std::unique_lock<std::mutex> lock(this->mtx);
+    while (running)
+    {
+        // wait until there is space for another frame and there is a frame left to decode
+        const bool can_decode = this->decoded.size() < READ_AHEAD && this->decode_frame < this->reader.frame_count();
+        if (!can_decode)
+        {
+            this->decoded_cv.wait_for(lock, std::chrono::milliseconds(5));
+            continue;
+        }
+
+        const uint32_t frame = this->decode_frame;
+        decoded_frame_t buffer;
+        if (!this->unused.empty())
+        {
+            buffer = std::move(this->unused.back());
+            this->unused.pop_back();
+        }
+
+        // decode without holding the lock, a seek in the meantime discards the frame
+        lock.unlock();
+        buffer.frame = frame;
+        try
+        {
+            PROFILE_ZONE("PlaybackParticleEngine decode");
+            this->reader.read(frame, buffer.particles);
+        }
+        catch (std::exception&)
+        {
+            // reported by 'PlaybackParticleEngine::present'
+            lock.lock();
+            this->decode_failed = true;
+            this->decoded_cv.notify_all();
+            return;
+        }
+        lock.lock();
+
+        if (this->decode_frame == frame)
+        {
+            this->decoded.push_back(std::move(buffer));
+            const uint32_t next = frame + 1;
+            this->decode_frame = (next < this->reader.frame_count() || !this->loop) ? next : 0;
+            this->decoded_cv.notify_all();
+        }
+        else
+        {
+            this->unused.push_back(std::move(buffer));
+        }
+    }
+}
+
+void PlaybackParticleEngine::seek(uint32_t frame)
+{
+    if (frame >= this->reader.frame_count())
+        throw std::out_of_range("Frame of PlaybackParticleEngine::seek is out of range.");
+
+    this->time = static_cast<double>(frame) / this->reader.frame_rate();
+    this->present(frame);
+}
+
+void PlaybackParticleEngine::advance(float dt)
+{
+    const uint32_t n = this->reader.frame_count();
+    const double duration = static_cast<double>(n) / this->reader.frame_rate();
+
+    this->time += dt;
+    if (this->time >= duration)
+        this->time = this->loop ? std::fmod(this->time, duration) : duration;
+
+    uint32_t frame = static_cast<uint32_t>(this->time * this->reader.frame_rate());
+    if (frame >= n) frame = n - 1;
+    if (frame != this->_current_frame)
+        this->present(frame);
+}
+
+void PlaybackParticleEngine::present(uint32_t frame)
+{
+    if (!this->base_running())
+        throw std::runtime_error("Cannot present a frame of a stopped particle engine (PlaybackParticleEngine).");
+    if (frame >= this->reader.frame_count())
+        throw std::out_of_range("Frame of PlaybackParticleEngine::present is out of range.");
+
+    std::unique_lock<std::mutex> lock(this->mtx);
+
+    // drop the frames before the requested one, if it is not decoded (ahead), restart the read-ahead there
+    size_t pos = 0;
+    while (pos < this->decoded.size() && this->decoded[pos].frame != frame) pos++;
+    if (pos == this->decoded.size())
+    {
+        pos = this->decoded.size();
+        this->decode_frame = frame;
+    }
+    for (size_t i = 0; i < pos; i++)
+    {
+        this->unused.push_back(std::move(this->decoded.front()));
+        this->decoded.pop_front();
+    }
+    this->decoded_cv.notify_all();
+    this->decoded_cv.wait(lock, [this, frame]() { return this->decode_failed || (!this->decoded.empty() && this->decoded.front().frame == frame); });
+    if (this->decode_failed)
+        throw std::runtime_error("Failed to decode the baked cache of PlaybackParticleEngine.");
+
+    // a single copy into the consecutive particles, particles of a bigger previous frame are freed by a NAN-position
+    const std::vector<particle_t>& particles = this->decoded.front().particles;
+    const uint32_t n = static_cast<uint32_t>(particles.size());
+    if (n > 0)
+        std::memcpy(this->range, particles.data(), n * sizeof(particle_t));
+    for (uint32_t i = n; i < this->presented_size; i++)
+        this->range[i].pos = glm::vec3(NAN);
+
+    this->presented_size = n;
+    this->_current_frame = frame;
+}
\ No newline at end of file
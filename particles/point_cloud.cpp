@@ -0,0 +1,417 @@
+#include "point_cloud.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace particles;
+
+namespace
+{
+    constexpr char POINT_CLOUD_MAGIC[4] = { 'P', 'C', 'L', 'D' };
+    constexpr uint32_t POINT_CLOUD_VERSION = 1;
+    constexpr uint64_t POINT_CLOUD_PAGE_SIZE = 4096;
+
+    uint64_t align_up(uint64_t x, uint64_t alignment) { return (x + alignment - 1) & ~(alignment - 1); }
+
+    void write_zeros(std::FILE* file, uint64_t n)
+    {
+        static const uint8_t zeros[POINT_CLOUD_PAGE_SIZE] = {};
+        for (; n > 0; n -= std::min<uint64_t>(n, POINT_CLOUD_PAGE_SIZE))
+            std::fwrite(zeros, 1, static_cast<size_t>(std::min<uint64_t>(n, POINT_CLOUD_PAGE_SIZE)), file);
+    }
+
+    enum ply_type_t : uint8_t
+    {
+        PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+    };
+
+    struct ply_property_t
+    {
+        std::string name;
+        ply_type_t type;
+        uint32_t offset;    // offset in the record of the element
+    };
+
+    struct ply_element_t
+    {
+        std::string name;
+        uint64_t count;
+        uint32_t stride;    // size of a record in bytes
+        bool has_list;      // list properties have a variable size
+        std::vector<ply_property_t> properties;
+    };
+
+    uint32_t ply_type_size(ply_type_t type)
+    {
+        constexpr uint32_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+        return sizes[type];
+    }
+
+    ply_type_t parse_ply_type(const std::string& name)
+    {
+        if (name == "char" || name == "int8")       return PLY_INT8;
+        if (name == "uchar" || name == "uint8")     return PLY_UINT8;
+        if (name == "short" || name == "int16")     return PLY_INT16;
+        if (name == "ushort" || name == "uint16")   return PLY_UINT16;
+        if (name == "int" || name == "int32")       return PLY_INT32;
+        if (name == "uint" || name == "uint32")     return PLY_UINT32;
+        if (name == "float" || name == "float32")   return PLY_FLOAT32;
+        if (name == "double" || name == "float64")  return PLY_FLOAT64;
+        throw std::runtime_error("PLY file has an unknown property type \"" + name + "\".");
+    }
+
+    double read_ply_value(const uint8_t* p, ply_type_t type)
+    {
+        switch (type)
+        {
+        case PLY_INT8:      { int8_t v;   std::memcpy(&v, p, sizeof(v)); return v; }
+        case PLY_UINT8:     { uint8_t v;  std::memcpy(&v, p, sizeof(v)); return v; }
+        case PLY_INT16:     { int16_t v;  std::memcpy(&v, p, sizeof(v)); return v; }
+        case PLY_UINT16:    { uint16_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+        case PLY_INT32:     { int32_t v;  std::memcpy(&v, p, sizeof(v)); return v; }
+        case PLY_UINT32:    { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+        case PLY_FLOAT32:   { float v;    std::memcpy(&v, p, sizeof(v)); return v; }
+        default:            { double v;   std::memcpy(&v, p, sizeof(v)); return v; }
+        }
+    }
+
+    /** @brief Parses the header of a PLY file, @param data_offset returns the offset of the first element's data. */
+    std::vector<ply_element_t> parse_ply_header(const MappedFile& file, size_t& data_offset)
+    {
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const std::string end_tag = "end_header";
+        const char* end = std::search(text, text + file.size(), end_tag.begin(), end_tag.end());
+        if (file.size() < 4 || std::strncmp(text, "ply", 3) != 0 || end == text + file.size())
+            throw std::runtime_error("File is not a PLY file.");
+        const char* line_end = std::find(end, text + file.size(), '\n');
+        if (line_end == text + file.size())
+            throw std::runtime_error("PLY file is truncated.");
+        data_offset = static_cast<size_t>(line_end + 1 - text);
+
+        std::vector<ply_element_t> elements;
+        std::istringstream header(std::string(text, end));
+        std::string line;
+        while (std::getline(header, line))
+        {
+            std::istringstream tokens(line);
+            std::string keyword;
+            tokens >> keyword;
+            if (keyword == "format")
+            {
+                std::string format;
+                tokens >> format;
+                if (format != "binary_little_endian")
+                    throw std::runtime_error("PLY format \"" + format + "\" is not supported, only binary_little_endian is.");
+            }
+            else if (keyword == "element")
+            {
+                ply_element_t element = {};
+                tokens >> element.name >> element.count;
+                elements.push_back(element);
+            }
+            else if (keyword == "property")
+            {
+                if (elements.empty())
+                    throw std::runtime_error("PLY file has a property without an element.");
+                ply_element_t& element = elements.back();
+                std::string type;
+                tokens >> type;
+                if (type == "list")
+                {
+                    element.has_list = true;
+                    continue;
+                }
+                ply_property_t property;
+                property.type = parse_ply_type(type);
+                property.offset = element.stride;
+                tokens >> property.name;
+                element.stride += ply_type_size(property.type);
+                element.properties.push_back(property);
+            }
+        }
+        return elements;
+    }
+};
+
+void particles::load_ply(const char* path, float size, std::vector<particle_t>& particles)
+{
+    const MappedFile file(path);
+    size_t offset;
+    const std::vector<ply_element_t> elements = parse_ply_header(file, offset);
+
+    // skip the elements before the vertices, they must have a fixed size
+    const ply_element_t* vertex = nullptr;
+    for (const ply_element_t& element : elements)
+    {
+        if (element.name == "vertex")
+        {
+            vertex = &element;
+            break;
+        }
+        if (element.has_list)
+            throw std::runtime_error("PLY element \"" + element.name + "\" before the vertices has a list property.");
+        offset += element.count * element.stride;
+    }
+    if (vertex == nullptr)
+        throw std::runtime_error("PLY file \"" + std::string(path) + "\" does not contain vertices.");
+    if (vertex->has_list)
+        throw std::runtime_error("PLY vertices with list properties are not supported.");
+    if (offset + vertex->count * vertex->stride > file.size())
+        throw std::runtime_error("PLY file \"" + std::string(path) + "\" is truncated.");
+
+    // x, y, z, red, green, blue, alpha
+    const char* names[7] = { "x", "y", "z", "red", "green", "blue", "alpha" };
+    const ply_property_t* properties[7] = {};
+    for (const ply_property_t& property : vertex->properties)
+    {
+        for (uint32_t i = 0; i < 7; i++)
+        {
+            if (property.name == names[i])
+                properties[i] = &property;
+        }
+    }
+    if (properties[0] == nullptr || properties[1] == nullptr || properties[2] == nullptr)
+        throw std::runtime_error("PLY vertices must have the properties x, y and z.");
+
+    // 8-bit colors are normalized, float colors are taken as they are
+    float color_scale[4];
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        const ply_property_t* property = properties[3 + i];
+        color_scale[i] = (property != nullptr && property->type != PLY_FLOAT32 && property->type != PLY_FLOAT64) ? 1.0f / 255.0f : 1.0f;
+    }
+
+    particles.resize(vertex->count);
+    const uint8_t* record = file.data() + offset;
+    for (uint64_t i = 0; i < vertex->count; i++, record += vertex->stride)
+    {
+        particle_t& particle = particles[i];
+        particle.pos.x = static_cast<float>(read_ply_value(record + properties[0]->offset, properties[0]->type));
+        particle.pos.y = static_cast<float>(read_ply_value(record + properties[1]->offset, properties[1]->type));
+        particle.pos.z = static_cast<float>(read_ply_value(record + properties[2]->offset, properties[2]->type));
+        float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            const ply_property_t* property = properties[3 + c];
+            if (property != nullptr)
+                color[c] = static_cast<float>(read_ply_value(record + property->offset, property->type)) * color_scale[c];
+        }
+        particle.color = glm::vec4(color[0], color[1], color[2], color[3]);
+        particle.size = size;
+    }
+}
+
+void particles::build_point_cloud(const char* path, const std::vector<particle_t>& points, uint32_t grid_resolution, uint32_t lod_levels)
+{
+    if (grid_resolution == 0)
+        throw std::invalid_argument("Grid resolution of build_point_cloud must be bigger than 0.");
+    if (lod_levels == 0 || lod_levels > PointCloudFile::MAX_LOD_LEVELS)
+        throw std::invalid_argument("Level of detail count of build_point_cloud must be in the range [1, 8].");
+    if (points.size() >= std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("Point count of build_point_cloud must be smaller than 2^32 - 1.");
+
+    // bounding box of the valid points
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (const particle_t& p : points)
+    {
+        if (std::isnan(p.pos.x)) continue;
+        lo = glm::min(lo, p.pos);
+        hi = glm::max(hi, p.pos);
+    }
+
+    // cubic cells, 'grid_resolution' of them along the longest axis
+    const glm::vec3 extent = glm::max(hi - lo, glm::vec3(0.0f));
+    const float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    const float cell_size = (longest > 0.0f) ? longest / grid_resolution : 1.0f;
+    uint32_t dim[3];
+    for (int i = 0; i < 3; i++)
+        dim[i] = std::min(std::max(static_cast<uint32_t>(std::ceil(extent[i] / cell_size)), 1u), grid_resolution);
+    const uint32_t n_cells = dim[0] * dim[1] * dim[2];
+
+    // counting sort of the point indices by cell
+    std::vector<uint32_t> cell_of(points.size());
+    std::vector<uint32_t> cell_start(n_cells + 1, 0);
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const glm::vec3& pos = points[i].pos;
+        if (std::isnan(pos.x))
+        {
+            cell_of[i] = n_cells;
+            continue;
+        }
+        uint32_t c[3];
+        for (int a = 0; a < 3; a++)
+            c[a] = std::min(static_cast<uint32_t>((pos[a] - lo[a]) / cell_size), dim[a] - 1);
+        cell_of[i] = (c[2] * dim[1] + c[1]) * dim[0] + c[0];
+        ++cell_start[cell_of[i] + 1];
+    }
+    for (uint32_t c = 0; c < n_cells; c++)
+        cell_start[c + 1] += cell_start[c];
+    std::vector<uint32_t> order(cell_start[n_cells]);
+    {
+        std::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            if (cell_of[i] < n_cells)
+                order[fill[cell_of[i]]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // chunk table of the non-empty cells, every chunk starts at a page boundary
+    std::vector<point_cloud_chunk_t> chunks;
+    std::vector<uint32_t> chunk_cells;
+    for (uint32_t c = 0; c < n_cells; c++)
+    {
+        if (cell_start[c + 1] > cell_start[c])
+            chunk_cells.push_back(c);
+    }
+    point_cloud_header_t header = {};
+    std::memcpy(header.magic, POINT_CLOUD_MAGIC, sizeof(POINT_CLOUD_MAGIC));
+    header.version = POINT_CLOUD_VERSION;
+    header.n_points = order.size();
+    header.n_chunks = static_cast<uint32_t>(chunk_cells.size());
+    header.lod_levels = lod_levels;
+    for (int i = 0; i < 3; i++)
+    {
+        header.bounds_min[i] = lo[i];
+        header.bounds_max[i] = hi[i];
+    }
+    header.chunks_offset = sizeof(point_cloud_header_t);
+
+    uint64_t offset = align_up(header.chunks_offset + chunk_cells.size() * sizeof(point_cloud_chunk_t), POINT_CLOUD_PAGE_SIZE);
+    for (uint32_t cell : chunk_cells)
+    {
+        point_cloud_chunk_t chunk = {};
+        chunk.offset = offset;
+        chunk.count = cell_start[cell + 1] - cell_start[cell];
+        // a level has a quarter of the points of the previous one, the density on the screen
+        // stays the same if the distance doubles
+        for (uint32_t l = 0; l < lod_levels; l++)
+            chunk.lod_count[l] = std::max((chunk.count + (1u << (2 * l)) - 1) >> (2 * l), 1u);
+        chunks.push_back(chunk);
+        offset = align_up(offset + chunk.count * sizeof(particle_t), POINT_CLOUD_PAGE_SIZE);
+    }
+
+    std::FILE* file = std::fopen(path, "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Failed to create point cloud file \"" + std::string(path) + "\".");
+
+    // the chunk bounds are only known after the points are gathered, the table is written at last
+    write_zeros(file, chunks.empty() ? header.chunks_offset : chunks[0].offset);
+    std::vector<particle_t> chunk_points;
+    for (size_t k = 0; k < chunks.size(); k++)
+    {
+        point_cloud_chunk_t& chunk = chunks[k];
+        const uint32_t cell = chunk_cells[k];
+        chunk_points.clear();
+        for (uint32_t i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+            chunk_points.push_back(points[order[i]]);
+
+        // Fisher-Yates with std::minstd_rand, std::shuffle is implementation-defined
+        // and would give different files on different standard libraries.
+        std::minstd_rand engine(cell + 1);
+        for (uint32_t i = chunk.count - 1; i > 0; i--)
+            std::swap(chunk_points[i], chunk_points[engine() % (i + 1)]);
+
+        glm::vec3 chunk_lo(std::numeric_limits<float>::max()), chunk_hi(-std::numeric_limits<float>::max());
+        for (const particle_t& p : chunk_points)
+        {
+            chunk_lo = glm::min(chunk_lo, p.pos);
+            chunk_hi = glm::max(chunk_hi, p.pos);
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            chunk.bounds_min[i] = chunk_lo[i];
+            chunk.bounds_max[i] = chunk_hi[i];
+        }
+
+        const uint64_t end = chunk.offset + chunk.count * sizeof(particle_t);
+        std::fwrite(chunk_points.data(), sizeof(particle_t), chunk.count, file);
+        const uint64_t next = (k + 1 < chunks.size()) ? chunks[k + 1].offset : end;
+        write_zeros(file, next - end);
+    }
+
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    if (!chunks.empty())
+        std::fwrite(chunks.data(), sizeof(point_cloud_chunk_t), chunks.size(), file);
+    const bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed)
+        throw std::runtime_error("Failed to write point cloud file \"" + std::string(path) + "\".");
+}
+
+// ------------------------ POINT CLOUD FILE ------------------------
+
+PointCloudFile::PointCloudFile(void)
+{
+    this->header = {};
+    this->_chunks = nullptr;
+}
+
+PointCloudFile::~PointCloudFile(void)
+{
+    this->close();
+}
+
+void PointCloudFile::open(const char* path)
+{
+    if (this->is_open())
+        throw std::runtime_error("PointCloudFile has already been opened.");
+
+    this->file.open(path);
+    const size_t size = this->file.size();
+    point_cloud_header_t header;
+    if (size < sizeof(header))
+    {
+        this->close();
+        throw std::runtime_error("Point cloud file \"" + std::string(path) + "\" is truncated.");
+    }
+    std::memcpy(&header, this->file.data(), sizeof(header));
+    if (std::memcmp(header.magic, POINT_CLOUD_MAGIC, sizeof(POINT_CLOUD_MAGIC)) != 0 || header.version != POINT_CLOUD_VERSION ||
+        header.lod_levels == 0 || header.lod_levels > MAX_LOD_LEVELS || header.chunks_offset % alignof(point_cloud_chunk_t) != 0 ||
+        header.chunks_offset + static_cast<uint64_t>(header.n_chunks) * sizeof(point_cloud_chunk_t) > size)
+    {
+        this->close();
+        throw std::runtime_error("File \"" + std::string(path) + "\" is not a valid point cloud file.");
+    }
+
+    const point_cloud_chunk_t* chunks = reinterpret_cast<const point_cloud_chunk_t*>(this->file.data() + header.chunks_offset);
+    for (uint32_t i = 0; i < header.n_chunks; i++)
+    {
+        const point_cloud_chunk_t& chunk = chunks[i];
+        bool valid = chunk.offset % alignof(particle_t) == 0 && chunk.offset <= size && chunk.count <= (size - chunk.offset) / sizeof(particle_t) && chunk.lod_count[0] == chunk.count;
+        for (uint32_t l = 1; l < header.lod_levels; l++)
+            valid = valid && chunk.lod_count[l] <= chunk.lod_count[l - 1];
+        if (!valid)
+        {
+            this->close();
+            throw std::runtime_error("Point cloud file \"" + std::string(path) + "\" has an invalid chunk table.");
+        }
+    }
+    this->header = header;
+    this->_chunks = chunks;
+}
+
+void PointCloudFile::close(void)
+{
+    this->file.close();
+    this->header = {};
+    this->_chunks = nullptr;
+}
+
+const particle_t* PointCloudFile::points(uint32_t chunk) const noexcept
+{
+    return reinterpret_cast<const particle_t*>(this->file.data() + this->_chunks[chunk].offset);
+}
+
+void PointCloudFile::prefetch(uint32_t chunk, uint32_t first, uint32_t n) const noexcept
+{
+    this->file.prefetch(static_cast<size_t>(this->_chunks[chunk].offset + first * sizeof(particle_t)), n * sizeof(particle_t));
+}
\ No newline at end of file
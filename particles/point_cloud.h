@@ -0,0 +1,106 @@
+#pragma once
+
+#include "particle_types.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Chunked point cloud file layout, little endian:
+    *       header:     point_cloud_header_t
+    *       chunks:     point_cloud_chunk_t[n_chunks]
+    *       points:     per chunk: particle_t[count], every chunk starts at a page boundary (4096 bytes)
+    *
+    *   The points are sorted into a regular grid of chunks. The points of a chunk are stored in random
+    *   order, so every prefix of a chunk is a uniform subset of it. The level of detail 'l' of a chunk
+    *   is the prefix of 'lod_count[l]' points, every level has a quarter of the points of the previous one.
+    *   The points are stored as particle_t, so that a chunk can be copied from the mapped file into
+    *   the particle-buffer without decoding.
+    */
+    struct point_cloud_header_t
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t n_points;
+        uint32_t n_chunks;
+        uint32_t lod_levels;
+        float bounds_min[3];
+        float bounds_max[3];
+        uint64_t chunks_offset;
+    };
+
+    struct point_cloud_chunk_t
+    {
+        float bounds_min[3];
+        float bounds_max[3];
+        uint64_t offset;            // offset of the first point in bytes
+        uint32_t count;             // number of points, equal to lod_count[0]
+        uint32_t lod_count[8];      // number of points of every level of detail, the first one is the finest
+        uint32_t reserved;
+    };
+
+    /**
+    *   @brief Loads the vertices of a PLY file (binary little endian) as particles.
+    *          The vertex element needs the float or double properties x, y and z. The color is read
+    *          from the optional properties red, green, blue and alpha (uchar or float), other properties
+    *          are skipped. The file is mapped, so it is read with large sequential reads.
+    *   @param path: Path of the PLY file
+    *   @param size: Size of every particle
+    *   @param particles: Returns the particles
+    */
+    void load_ply(const char* path, float size, std::vector<particle_t>& particles);
+
+    /**
+    *   @brief Preprocesses points into a chunked point cloud file.
+    *   @param path: Path of the point cloud file, an existing file is overwritten
+    *   @param points: The points of the cloud, particles with a NAN-position are skipped
+    *   @param grid_resolution: Number of chunks along the longest axis of the bounding box
+    *   @param lod_levels: Number of levels of detail per chunk, 1 to 8
+    */
+    void build_point_cloud(const char* path, const std::vector<particle_t>& points, uint32_t grid_resolution, uint32_t lod_levels);
+
+    /**
+    *   Class: PointCloudFile
+    *   @brief Maps a chunked point cloud file. The points of a chunk are accessed directly in the mapping,
+    *          so only the pages of the chunks that are used are read from disk.
+    */
+    class PointCloudFile
+    {
+    private:
+        MappedFile file;
+        point_cloud_header_t header;
+        const point_cloud_chunk_t* _chunks;
+
+    public:
+        /** @brief Maximum number of levels of detail. */
+        constexpr static uint32_t MAX_LOD_LEVELS = 8;
+
+        /**
+        *   @brief The default constructor does not open a file.
+        *   In order to read a point cloud 'PointCloudFile::open' must be called.
+        */
+        PointCloudFile(void);
+        virtual ~PointCloudFile(void);
+
+        /** @brief Maps a point cloud file and validates its chunk table. */
+        void open(const char* path);
+
+        /** @brief Unmaps the file. */
+        void close(void);
+
+        /** @return A pointer to the points of the chunk @param chunk. */
+        const particle_t* points(uint32_t chunk) const noexcept;
+
+        /** @brief Hints that the points [@param first, @param first + @param n) of @param chunk are read soon. */
+        void prefetch(uint32_t chunk, uint32_t first, uint32_t n) const noexcept;
+
+        const point_cloud_chunk_t& chunk(uint32_t chunk) const noexcept    { return this->_chunks[chunk]; }
+        uint32_t chunk_count(void) const noexcept                           { return this->header.n_chunks; }
+        uint32_t lod_levels(void) const noexcept                            { return this->header.lod_levels; }
+        uint64_t point_count(void) const noexcept                           { return this->header.n_points; }
+        bool is_open(void) const noexcept                                   { return this->file.is_open(); }
+    };
+};
\ No newline at end of file
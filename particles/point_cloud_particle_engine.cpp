@@ -0,0 +1,250 @@
+#include "particle_engine.h"
+#include "../profiler/profiler.h"
+#include "../metrics/metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace particles;
+
+namespace
+{
+    uint32_t block_count(uint32_t points) { return (points + PointCloudParticleEngine::BLOCK_SIZE - 1) / PointCloudParticleEngine::BLOCK_SIZE; }
+
+    float chunk_distance(const point_cloud_chunk_t& chunk, const glm::vec3& pos)
+    {
+        // distance to the nearest point of the bounding box, 0 inside of it
+        float d2 = 0.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            const float d = std::max(std::max(chunk.bounds_min[i] - pos[i], pos[i] - chunk.bounds_max[i]), 0.0f);
+            d2 += d * d;
+        }
+        return std::sqrt(d2);
+    }
+};
+
+PointCloudParticleEngine::PointCloudParticleEngine(void)
+{
+    this->pool = nullptr;
+    this->range = nullptr;
+    this->range_size = 0;
+    this->budget = 0;
+    this->resident_points = 0;
+    this->camera = glm::vec3(0.0f);
+    this->lod_distance = 4.0f;
+    this->camera_changed = false;
+}
+
+PointCloudParticleEngine::PointCloudParticleEngine(ParticlePool& pool, const char* path, uint32_t budget) : PointCloudParticleEngine()
+{
+    this->init(pool, path, budget);
+}
+
+PointCloudParticleEngine::~PointCloudParticleEngine(void)
+{
+    this->stop();
+}
+
+void PointCloudParticleEngine::init(ParticlePool& pool, const char* path, uint32_t budget)
+{
+    if (this->base_running())
+        throw std::runtime_error("Cannot reinitialize running particle engine (PointCloudParticleEngine).");
+
+    this->cloud.close();
+    this->cloud.open(path);
+    this->pool = &pool;
+    this->budget = budget;
+}
+
+void PointCloudParticleEngine::start(void)
+{
+    if (this->pool == nullptr)
+        throw std::runtime_error("Cannot start uninitialized particle engine (PointCloudParticleEngine).");
+    if (this->base_running()) return;
+
+    // the budget in whole blocks, but not more than the whole cloud needs
+    uint64_t needed = 0;
+    for (uint32_t i = 0; i < this->cloud.chunk_count(); i++)
+        needed += block_count(this->cloud.chunk(i).count);
+    const uint32_t n_blocks = static_cast<uint32_t>(std::min<uint64_t>(this->budget / BLOCK_SIZE, needed));
+    if (n_blocks == 0) return;
+
+    this->range_size = n_blocks * BLOCK_SIZE;
+    this->range = this->pool->allocate_range(this->range_size);
+    if (this->range == nullptr)
+        throw std::bad_alloc();
+
+    // the blocks are taken from the back, so the lowest blocks are used first
+    this->free_blocks.resize(n_blocks);
+    for (uint32_t i = 0; i < n_blocks; i++)
+        this->free_blocks[i] = n_blocks - 1 - i;
+    this->chunks.assign(this->cloud.chunk_count(), chunk_state_t{ {}, 0, 0 });
+    this->resident_points = 0;
+    this->camera_changed = true;
+    this->start_base(this);
+}
+
+void PointCloudParticleEngine::stop(void)
+{
+    this->stop_base();  // stop streaming first, then the particles can be freed
+    if (this->range != nullptr)
+    {
+        this->pool->free_range(this->range, this->range_size);
+        this->range = nullptr;
+        this->range_size = 0;
+        this->resident_points = 0;
+    }
+    this->chunks.clear();
+    this->free_blocks.clear();
+}
+
+void PointCloudParticleEngine::set_camera(const glm::vec3& pos)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->camera = pos;
+        this->camera_changed = true;
+    }
+    this->camera_cv.notify_one();
+}
+
+void PointCloudParticleEngine::set_lod_distance(float distance)
+{
+    if (!(distance > 0.0f))
+        throw std::invalid_argument("Distance of PointCloudParticleEngine::set_lod_distance must be bigger than 0.");
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->lod_distance = distance;
+        this->camera_changed = true;
+    }
+    this->camera_cv.notify_one();
+}
+
+void PointCloudParticleEngine::choose_targets(const glm::vec3& camera, float lod_distance, std::vector<uint32_t>& order)
+{
+    const uint32_t n = this->cloud.chunk_count();
+    const uint32_t levels = this->cloud.lod_levels();
+    std::pmr::vector<float> distance(n, &FrameArena::local());
+    for (uint32_t i = 0; i < n; i++)
+        distance[i] = chunk_distance(this->cloud.chunk(i), camera);
+
+    order.resize(n);
+    for (uint32_t i = 0; i < n; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&distance](uint32_t a, uint32_t b) { return distance[a] < distance[b]; });
+
+    // nearest chunks first, a chunk that does not fit with its level uses a coarser one or none at all
+    uint32_t free = this->range_size / BLOCK_SIZE;
+    for (uint32_t i : order)
+    {
+        const point_cloud_chunk_t& chunk = this->cloud.chunk(i);
+        const float d = distance[i] / lod_distance;
+        uint32_t level = (d < 1.0f) ? 0 : static_cast<uint32_t>(std::log2(d)) + 1;
+        if (level >= levels) level = levels - 1;
+
+        this->chunks[i].target = 0;
+        for (; level < levels; level++)
+        {
+            const uint32_t blocks = block_count(chunk.lod_count[level]);
+            if (blocks <= free)
+            {
+                this->chunks[i].target = chunk.lod_count[level];
+                free -= blocks;
+                break;
+            }
+        }
+    }
+}
+
+void PointCloudParticleEngine::shrink(chunk_state_t& chunk)
+{
+    if (chunk.target >= chunk.resident) return;
+
+    // free the points beyond the target by a NAN-position, then return the unused blocks
+    for (uint32_t i = chunk.target; i < chunk.resident; i++)
+        this->range[chunk.blocks[i / BLOCK_SIZE] * BLOCK_SIZE + i % BLOCK_SIZE].pos = glm::vec3(NAN);
+    const uint32_t keep = block_count(chunk.target);
+    while (chunk.blocks.size() > keep)
+    {
+        this->free_blocks.push_back(chunk.blocks.back());
+        chunk.blocks.pop_back();
+    }
+    this->resident_points -= chunk.resident - chunk.target;
+    chunk.resident = chunk.target;
+}
+
+uint32_t PointCloudParticleEngine::grow(uint32_t chunk_index, uint32_t max_points)
+{
+    chunk_state_t& chunk = this->chunks[chunk_index];
+    const uint32_t end = std::min(chunk.target, chunk.resident + max_points);
+    if (end <= chunk.resident) return 0;
+
+    // the pages are read ahead asynchronously while the first blocks are copied
+    const particle_t* points = this->cloud.points(chunk_index);
+    this->cloud.prefetch(chunk_index, chunk.resident, end - chunk.resident);
+    uint32_t i = chunk.resident;
+    while (i < end)
+    {
+        if (i / BLOCK_SIZE == chunk.blocks.size())
+        {
+            chunk.blocks.push_back(this->free_blocks.back());
+            this->free_blocks.pop_back();
+        }
+        const uint32_t n = std::min(end - i, BLOCK_SIZE - i % BLOCK_SIZE);
+        std::memcpy(this->range + chunk.blocks[i / BLOCK_SIZE] * BLOCK_SIZE + i % BLOCK_SIZE, points + i, n * sizeof(particle_t));
+        i += n;
+    }
+
+    const uint32_t copied = end - chunk.resident;
+    this->resident_points += copied;
+    chunk.resident = end;
+    return copied;
+}
+
+void PointCloudParticleEngine::run(const std::atomic_bool& running, void* param)
+{
+    PROFILE_THREAD("PointCloudParticleEngine");
+    metrics::Histogram& pass_us = metrics::registry().histogram("point_cloud_pass_us");
+    std::vector<uint32_t> order;
+    bool converged = true;
+    while (running)
+    {
+        glm::vec3 camera;
+        float lod_distance;
+        {
+            // wait for a new camera position, unless the last pass ran out of its copy budget
+            std::unique_lock<std::mutex> lock(this->mtx);
+            if (converged && !this->camera_changed)
+                this->camera_cv.wait_for(lock, std::chrono::milliseconds(20));
+            if (converged && !this->camera_changed)
+                continue;
+            camera = this->camera;
+            lod_distance = this->lod_distance;
+            this->camera_changed = false;
+        }
+        PROFILE_ZONE("PointCloudParticleEngine pass");
+        metrics::ScopedTimer pass_timer(pass_us);
+        FrameArena::local().reset();
+
+        // The targets fit into the budget, so after every chunk has been shrunk to its target
+        // there are enough free blocks for every chunk to grow.
+        this->choose_targets(camera, lod_distance, order);
+        for (chunk_state_t& chunk : this->chunks)
+            this->shrink(chunk);
+
+        uint32_t copied = 0;
+        converged = true;
+        for (uint32_t i : order)
+        {
+            copied += this->grow(i, MAX_POINTS_PER_PASS - copied);
+            if (copied == MAX_POINTS_PER_PASS)
+            {
+                converged = false;
+                break;
+            }
+        }
+    }
+}
\ No newline at end of file
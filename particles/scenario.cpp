@@ -0,0 +1,332 @@
+#include "scenario.h"
+#include "../profiler/profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace particles;
+
+namespace
+{
+    constexpr float PI = 3.14159265358979323846f;
+
+    std::runtime_error scenario_error(const char* path, uint32_t line, const std::string& what)
+    {
+        return std::runtime_error("Scenario \"" + std::string(path) + "\", line " + std::to_string(line) + ": " + what);
+    }
+
+    template<typename T>
+    void read_values(std::istringstream& ss, T* values, uint32_t n, const char* path, uint32_t line, const std::string& key)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (!(ss >> values[i]))
+                throw scenario_error(path, line, "'" + key + "' expects " + std::to_string(n) + " number(s).");
+        }
+    }
+
+    scenario_shape_t parse_shape(const std::string& name, const char* path, uint32_t line)
+    {
+        if (name == "point")    return SCENARIO_SHAPE_POINT;
+        if (name == "sphere")   return SCENARIO_SHAPE_SPHERE;
+        if (name == "shell")    return SCENARIO_SHAPE_SHELL;
+        if (name == "box")      return SCENARIO_SHAPE_BOX;
+        if (name == "disk")     return SCENARIO_SHAPE_DISK;
+        throw scenario_error(path, line, "Unknown emitter shape \"" + name + "\".");
+    }
+
+    void parse_emitter(std::istringstream& ss, scenario_emitter_t& emitter, const char* path, uint32_t line)
+    {
+        std::string shape;
+        if (!(ss >> shape))
+            throw scenario_error(path, line, "'emitter' expects a shape.");
+        emitter.shape = parse_shape(shape, path, line);
+        emitter.center = glm::vec3(0.0f);
+        emitter.radius = 1.0f;
+        emitter.color = glm::vec4(1.0f);
+        emitter.size = 0.1f;
+        emitter.count = 1000;
+        emitter.churn = 0.0f;
+
+        std::string key;
+        while (ss >> key)
+        {
+            if (key == "center")        read_values(ss, &emitter.center.x, 3, path, line, key);
+            else if (key == "radius")   read_values(ss, &emitter.radius, 1, path, line, key);
+            else if (key == "color")    read_values(ss, &emitter.color.x, 4, path, line, key);
+            else if (key == "size")     read_values(ss, &emitter.size, 1, path, line, key);
+            else if (key == "count")    read_values(ss, &emitter.count, 1, path, line, key);
+            else if (key == "churn")    read_values(ss, &emitter.churn, 1, path, line, key);
+            else throw scenario_error(path, line, "Unknown emitter property \"" + key + "\".");
+        }
+        if (emitter.radius < 0.0f || emitter.size <= 0.0f || emitter.churn < 0.0f)
+            throw scenario_error(path, line, "Radius and churn of an emitter must not be negative and its size must be bigger than 0.");
+    }
+};
+
+void particles::load_scenario(const char* path, scenario_t& scenario)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("Failed to open scenario \"" + std::string(path) + "\".");
+
+    scenario.seed = 0;
+    scenario.frame_rate = 60.0f;
+    scenario.duration = 10.0f;
+    scenario.emitters.clear();
+    scenario.camera.clear();
+
+    std::string text;
+    for (uint32_t line = 1; std::getline(file, text); line++)
+    {
+        const size_t comment = text.find('#');
+        if (comment != std::string::npos)
+            text.resize(comment);
+
+        std::istringstream ss(text);
+        std::string key;
+        if (!(ss >> key))
+            continue;   // empty line
+
+        if (key == "seed")
+        {
+            read_values(ss, &scenario.seed, 1, path, line, key);
+        }
+        else if (key == "frame_rate")
+        {
+            read_values(ss, &scenario.frame_rate, 1, path, line, key);
+            if (scenario.frame_rate <= 0.0f)
+                throw scenario_error(path, line, "Frame rate must be bigger than 0.");
+        }
+        else if (key == "duration")
+        {
+            read_values(ss, &scenario.duration, 1, path, line, key);
+            if (scenario.duration <= 0.0f)
+                throw scenario_error(path, line, "Duration must be bigger than 0.");
+        }
+        else if (key == "camera")
+        {
+            scenario_keyframe_t keyframe;
+            float values[6];
+            read_values(ss, values, 6, path, line, key);
+            keyframe.time = values[0];
+            keyframe.pos = glm::vec3(values[1], values[2], values[3]);
+            keyframe.yaw = values[4];
+            keyframe.pitch = values[5];
+            if (!scenario.camera.empty() && keyframe.time <= scenario.camera.back().time)
+                throw scenario_error(path, line, "Camera keyframes must be in ascending time order.");
+            scenario.camera.push_back(keyframe);
+        }
+        else if (key == "emitter")
+        {
+            scenario.emitters.emplace_back();
+            parse_emitter(ss, scenario.emitters.back(), path, line);
+        }
+        else
+        {
+            throw scenario_error(path, line, "Unknown statement \"" + key + "\".");
+        }
+
+        std::string rest;
+        if (ss >> rest)
+            throw scenario_error(path, line, "Unexpected \"" + rest + "\".");
+    }
+}
+
+ScenarioRunner::ScenarioRunner(void)
+{
+    this->engine = nullptr;
+    this->_frame = 0;
+    this->_spawned = 0;
+    this->_killed = 0;
+}
+
+ScenarioRunner::~ScenarioRunner(void)
+{
+    this->stop();
+}
+
+void ScenarioRunner::init(StaticParticleEngine& engine, const scenario_t& scenario)
+{
+    if (this->engine != nullptr)
+        throw std::runtime_error("ScenarioRunner has already been initialized.");
+
+    this->engine = &engine;
+    this->scenario = scenario;
+    this->states.clear();
+    this->states.resize(scenario.emitters.size());
+    for (size_t i = 0; i < this->states.size(); i++)
+    {
+        // std::minstd_rand must not be seeded with 0 (mod its modulus)
+        const uint64_t seed = (scenario.seed * 2654435761ULL + i + 1) % std::minstd_rand::modulus;
+        this->states[i].engine.seed(static_cast<std::minstd_rand::result_type>((seed != 0) ? seed : 1));
+        this->states[i].pending_churn = 0.0;
+    }
+    this->_frame = 0;
+}
+
+void ScenarioRunner::start(void)
+{
+    if (this->engine == nullptr)
+        throw std::runtime_error("Cannot start uninitialized ScenarioRunner.");
+    if (!this->engine->running())
+        throw std::runtime_error("The engine of ScenarioRunner::start must have been started.");
+
+    // the initial particles are the spawns of frame 0
+    this->_frame = 0;
+    this->_spawned = 0;
+    this->_killed = 0;
+    for (uint32_t i = 0; i < this->states.size(); i++)
+    {
+        for (uint32_t j = 0; j < this->scenario.emitters[i].count; j++)
+            this->spawn(i);
+    }
+}
+
+void ScenarioRunner::stop(void)
+{
+    if (this->engine != nullptr)
+    {
+        for (emitter_state_t& state : this->states)
+        {
+            for (uint64_t uid : state.alive)
+                this->engine->kill(uid);
+            state.alive.clear();
+        }
+        this->engine = nullptr;
+    }
+    if (this->timing.is_open())
+        this->timing.close();
+}
+
+float ScenarioRunner::uniform(std::minstd_rand& engine) const
+{
+    // [0, 1), std::uniform_real_distribution is implementation-defined and would differ between standard libraries
+    return static_cast<float>((engine() - std::minstd_rand::min()) / static_cast<double>(std::minstd_rand::max() - std::minstd_rand::min() + 1));
+}
+
+void ScenarioRunner::spawn(uint32_t emitter)
+{
+    const scenario_emitter_t& e = this->scenario.emitters[emitter];
+    emitter_state_t& state = this->states[emitter];
+
+    glm::vec3 offset(0.0f);
+    switch (e.shape)
+    {
+    case SCENARIO_SHAPE_POINT:
+        break;
+    case SCENARIO_SHAPE_SPHERE:
+    case SCENARIO_SHAPE_SHELL:
+    {
+        // rejection sampling, so the sequence of random numbers only depends on the seed
+        float d2;
+        do
+        {
+            offset = glm::vec3(this->uniform(state.engine), this->uniform(state.engine), this->uniform(state.engine)) * 2.0f - 1.0f;
+            d2 = glm::dot(offset, offset);
+        } while (d2 > 1.0f || d2 < 1e-6f);
+        if (e.shape == SCENARIO_SHAPE_SHELL)
+            offset /= std::sqrt(d2);
+        break;
+    }
+    case SCENARIO_SHAPE_BOX:
+        offset = glm::vec3(this->uniform(state.engine), this->uniform(state.engine), this->uniform(state.engine)) * 2.0f - 1.0f;
+        break;
+    case SCENARIO_SHAPE_DISK:
+    {
+        const float r = std::sqrt(this->uniform(state.engine));
+        const float phi = 2.0f * PI * this->uniform(state.engine);
+        offset = glm::vec3(r * std::cos(phi), 0.0f, r * std::sin(phi));
+        break;
+    }
+    }
+
+    particle_t particle;
+    particle.pos = e.center + offset * e.radius;
+    particle.color = e.color;
+    particle.size = e.size;
+    state.alive.push_back(this->engine->spawn(particle));
+    this->_spawned++;
+}
+
+void ScenarioRunner::advance(void)
+{
+    PROFILE_ZONE("ScenarioRunner::advance");
+    if (this->engine == nullptr)
+        throw std::runtime_error("Cannot advance uninitialized ScenarioRunner.");
+
+    this->_frame++;
+    this->_spawned = 0;
+    this->_killed = 0;
+
+    const double dt = 1.0 / this->scenario.frame_rate;
+    for (uint32_t i = 0; i < this->states.size(); i++)
+    {
+        emitter_state_t& state = this->states[i];
+        state.pending_churn += this->scenario.emitters[i].churn * dt;
+        const uint32_t n = static_cast<uint32_t>(std::min<double>(state.pending_churn, state.alive.size()));
+        state.pending_churn -= std::floor(state.pending_churn);
+
+        for (uint32_t j = 0; j < n; j++)
+        {
+            this->engine->kill(state.alive.front());
+            state.alive.pop_front();
+        }
+        this->_killed += n;
+        for (uint32_t j = 0; j < n; j++)
+            this->spawn(i);
+    }
+}
+
+void ScenarioRunner::camera(glm::vec3& pos, double& yaw, double& pitch) const
+{
+    const std::vector<scenario_keyframe_t>& keys = this->scenario.camera;
+    if (keys.empty()) return;   // no camera path, the camera is not changed
+
+    const float t = static_cast<float>(this->time());
+    size_t next = 0;
+    while (next < keys.size() && keys[next].time <= t) next++;
+
+    if (next == 0 || next == keys.size())
+    {
+        const scenario_keyframe_t& key = keys[(next == 0) ? 0 : keys.size() - 1];
+        pos = key.pos;
+        yaw = key.yaw;
+        pitch = key.pitch;
+        return;
+    }
+
+    // linear interpolation between the keyframes around t
+    const scenario_keyframe_t& a = keys[next - 1];
+    const scenario_keyframe_t& b = keys[next];
+    const float s = (t - a.time) / (b.time - a.time);
+    pos = a.pos + (b.pos - a.pos) * s;
+    yaw = a.yaw + (b.yaw - a.yaw) * s;
+    pitch = a.pitch + (b.pitch - a.pitch) * s;
+}
+
+void ScenarioRunner::open_timing(const char* path)
+{
+    this->timing.close();
+    this->timing.open(path);
+    if (!this->timing)
+        throw std::runtime_error("Failed to create timing file \"" + std::string(path) + "\".");
+    this->timing << "frame,time_s,particles,spawned,killed,frame_ms,cpu_ms,gpu_ms\n";
+}
+
+void ScenarioRunner::record_frame(double frame_ms, double cpu_ms, double gpu_ms)
+{
+    if (!this->timing.is_open()) return;
+
+    uint64_t particles = 0;
+    for (const emitter_state_t& state : this->states)
+        particles += state.alive.size();
+
+    this->timing << this->_frame << ',' << this->time() << ',' << particles << ',' << this->_spawned << ',' << this->_killed << ','
+                 << frame_ms << ',' << cpu_ms << ',';
+    if (gpu_ms >= 0.0)
+        this->timing << gpu_ms;
+    this->timing << '\n';
+}
\ No newline at end of file
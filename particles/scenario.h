@@ -0,0 +1,137 @@
+#pragma once
+
+#include "particle_engine.h"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace particles
+{
+    enum scenario_shape_t : uint8_t
+    {
+        SCENARIO_SHAPE_POINT,       // every particle at the center
+        SCENARIO_SHAPE_SPHERE,      // uniform in a ball with the radius
+        SCENARIO_SHAPE_SHELL,       // uniform on a sphere with the radius
+        SCENARIO_SHAPE_BOX,         // uniform in a cube with the radius as half extent
+        SCENARIO_SHAPE_DISK         // uniform on a horizontal (xz) disk with the radius
+    };
+
+    struct scenario_emitter_t
+    {
+        scenario_shape_t shape;
+        glm::vec3 center;
+        float radius;
+        glm::vec4 color;
+        float size;
+        uint32_t count;             // number of particles that the emitter keeps alive
+        float churn;                // number of particles per second that are killed and respawned
+    };
+
+    struct scenario_keyframe_t
+    {
+        float time;                 // seconds since the start of the scenario
+        glm::vec3 pos;
+        float yaw, pitch;           // radians, same convention as the interactive camera
+    };
+
+    /**
+    *   A benchmark scenario, loaded from a text file with one statement per line ('#' starts a comment):
+    *       seed <n>
+    *       frame_rate <frames per second>
+    *       duration <seconds>
+    *       camera <time> <x> <y> <z> <yaw> <pitch>
+    *       emitter <point|sphere|shell|box|disk> [center <x> <y> <z>] [radius <r>] [color <r> <g> <b> <a>]
+    *               [size <s>] [count <n>] [churn <per second>]
+    *   Camera keyframes must be in ascending time order.
+    */
+    struct scenario_t
+    {
+        uint64_t seed;
+        float frame_rate;
+        float duration;
+        std::vector<scenario_emitter_t> emitters;
+        std::vector<scenario_keyframe_t> camera;
+    };
+
+    /** @brief Loads the scenario at @param path, a malformed statement throws an exception with its line number. */
+    void load_scenario(const char* path, scenario_t& scenario);
+
+    /**
+    *   Class: ScenarioRunner
+    *   @brief Plays a scenario into a StaticParticleEngine with a fixed time step of one frame.
+    *          The particles of every emitter are sampled from their own random engine (std::minstd_rand with
+    *          the scenario seed), so a scenario produces the same particles in every frame on every build,
+    *          independent of the global random engine, the frame rate of the display and the thread timing.
+    *          Optionally, the runner writes a CSV line with the timing of every frame.
+    */
+    class ScenarioRunner
+    {
+    private:
+        struct emitter_state_t
+        {
+            std::minstd_rand engine;
+            std::deque<uint64_t> alive;     // uids of the particles in spawn order, the oldest is killed first
+            double pending_churn;           // fractional churn that is carried to the next frame
+        };
+
+        StaticParticleEngine* engine;
+        scenario_t scenario;
+        std::vector<emitter_state_t> states;
+        uint32_t _frame;
+        uint32_t _spawned, _killed;         // spawns and kills of the last frame
+        std::ofstream timing;
+
+        float uniform(std::minstd_rand& engine) const;
+        void spawn(uint32_t emitter);
+
+    public:
+        ScenarioRunner(void);
+        virtual ~ScenarioRunner(void);
+
+        /**
+        *   @brief Initializes the runner, the particles are spawned by 'ScenarioRunner::start'.
+        *   @param engine: The engine that the particles are spawned into, it must have been started
+        *   @param scenario: The scenario to play
+        */
+        void init(StaticParticleEngine& engine, const scenario_t& scenario);
+
+        /** @brief Spawns the initial particles of every emitter, the runner is at frame 0 afterwards. */
+        void start(void);
+
+        /** @brief Kills the particles of the scenario and closes the timing file. */
+        void stop(void);
+
+        /** @brief Advances the scenario by one frame and applies the churn of the emitters. */
+        void advance(void);
+
+        /** @brief Interpolates the camera path at the current frame. */
+        void camera(glm::vec3& pos, double& yaw, double& pitch) const;
+
+        /**
+        *   @brief Writes the timing of every frame into a CSV file:
+        *          frame, time_s, particles, spawned, killed, frame_ms, cpu_ms, gpu_ms
+        */
+        void open_timing(const char* path);
+
+        /**
+        *   @brief Writes the timing of the current frame, must be called before 'ScenarioRunner::advance'.
+        *   @param gpu_ms: GPU time of the frame, a negative value if it is unknown
+        */
+        void record_frame(double frame_ms, double cpu_ms, double gpu_ms);
+
+        /** @return The current frame. */
+        uint32_t frame(void) const noexcept         { return this->_frame; }
+
+        /** @return The number of frames of the scenario. */
+        uint32_t frame_count(void) const noexcept   { return static_cast<uint32_t>(this->scenario.duration * this->scenario.frame_rate + 0.5f); }
+
+        /** @return The time of the current frame in seconds. */
+        double time(void) const noexcept            { return this->_frame / static_cast<double>(this->scenario.frame_rate); }
+
+        /** @return 'true' if every frame of the scenario has been played. */
+        bool finished(void) const noexcept          { return this->_frame >= this->frame_count(); }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "session_recorder.h"
+#include "particle_engine.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <string>
+
+using namespace particles;
+
+namespace
+{
+    constexpr char SESSION_MAGIC[4] = { 'P', 'S', 'E', 'S' };
+    constexpr uint32_t SESSION_VERSION = 2;
+
+    static_assert(sizeof(particle_t) == 8 * sizeof(float), "particle_t must be tightly packed to be recorded raw.");
+
+    // FNV-1a, the particles are hashed with their spawn index in ascending order of the spawn index,
+    // so the checksum does not depend on where the pool has put them
+    constexpr uint64_t CHECKSUM_BASIS = 14695981039346656037ull;
+
+    uint64_t checksum_update(uint64_t hash, uint32_t spawn_index, const particle_t& particle)
+    {
+        uint8_t bytes[sizeof(uint32_t) + sizeof(particle_t)];
+        std::memcpy(bytes, &spawn_index, sizeof(uint32_t));
+        std::memcpy(bytes + sizeof(uint32_t), &particle, sizeof(particle_t));
+        for (uint8_t byte : bytes)
+        {
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+// ------------------------ SESSION RECORDER ------------------------
+
+SessionRecorder::SessionRecorder(void)
+{
+    this->file = nullptr;
+    this->spawn_count = 0;
+}
+
+SessionRecorder::~SessionRecorder(void)
+{
+    this->close();
+}
+
+void SessionRecorder::open(const char* path, uint64_t seed, uint32_t capacity)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->file != nullptr)
+        throw std::runtime_error("SessionRecorder has already been opened.");
+
+    this->file = std::fopen(path, "wb");
+    if (this->file == nullptr)
+        throw std::runtime_error("Failed to create session file \"" + std::string(path) + "\".");
+
+    std::fwrite(SESSION_MAGIC, 1, sizeof(SESSION_MAGIC), this->file);
+    std::fwrite(&SESSION_VERSION, sizeof(SESSION_VERSION), 1, this->file);
+    std::fwrite(&seed, sizeof(seed), 1, this->file);
+    std::fwrite(&capacity, sizeof(capacity), 1, this->file);
+    this->spawn_indices.clear();
+    this->spawn_count = 0;
+}
+
+void SessionRecorder::close(void)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->file != nullptr)
+    {
+        const uint8_t tag = SESSION_END;
+        std::fwrite(&tag, 1, 1, this->file);
+        std::fclose(this->file);
+        this->file = nullptr;
+        this->spawn_indices.clear();
+    }
+}
+
+void SessionRecorder::write_varint(uint32_t value)
+{
+    uint8_t bytes[5];
+    size_t n = 0;
+    do
+    {
+        bytes[n] = static_cast<uint8_t>(value & 0x7F);
+        value >>= 7;
+        if (value != 0) bytes[n] |= 0x80;
+        ++n;
+    } while (value != 0);
+    std::fwrite(bytes, 1, n, this->file);
+}
+
+void SessionRecorder::record_spawn(uint64_t uid, const particle_t& particle)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->file == nullptr) return;
+
+    const uint8_t tag = SESSION_SPAWN;
+    std::fwrite(&tag, 1, 1, this->file);
+    std::fwrite(&particle, sizeof(particle_t), 1, this->file);
+    this->spawn_indices[uid] = this->spawn_count++;
+}
+
+void SessionRecorder::record_kill(uint64_t uid)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->file == nullptr) return;
+
+    auto iter = this->spawn_indices.find(uid);
+    if (iter == this->spawn_indices.end()) return;
+
+    const uint8_t tag = SESSION_KILL;
+    std::fwrite(&tag, 1, 1, this->file);
+    this->write_varint(iter->second);
+    this->spawn_indices.erase(iter);    // the uid (address) may be reused by the next spawn
+}
+
+void SessionRecorder::record_tick(float dt)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->file == nullptr) return;
+
+    const uint8_t tag = SESSION_TICK;
+    std::fwrite(&tag, 1, 1, this->file);
+    std::fwrite(&dt, sizeof(dt), 1, this->file);
+}
+
+void SessionRecorder::record_checksum(void)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->file == nullptr) return;
+
+    // the uid of a spawned particle is its address in the pool
+    std::vector<std::pair<uint32_t, uint64_t>> living;
+    living.reserve(this->spawn_indices.size());
+    for (const auto& spawn : this->spawn_indices)
+        living.emplace_back(spawn.second, spawn.first);
+    std::sort(living.begin(), living.end());
+
+    uint64_t checksum = CHECKSUM_BASIS;
+    for (const auto& spawn : living)
+        checksum = checksum_update(checksum, spawn.first, *reinterpret_cast<const particle_t*>(spawn.second));
+
+    const uint8_t tag = SESSION_CHECKSUM;
+    std::fwrite(&tag, 1, 1, this->file);
+    std::fwrite(&checksum, sizeof(checksum), 1, this->file);
+}
+
+// ------------------------ SESSION REPLAYER ------------------------
+
+SessionReplayer::SessionReplayer(void)
+{
+    this->file = nullptr;
+    this->_seed = 0;
+    this->_capacity = 0;
+    this->has_checksum = false;
+    this->_recorded_checksum = 0;
+    this->_replayed_checksum = 0;
+}
+
+SessionReplayer::~SessionReplayer(void)
+{
+    this->close();
+}
+
+void SessionReplayer::open(const char* path)
+{
+    if (this->file != nullptr)
+        throw std::runtime_error("SessionReplayer has already been opened.");
+
+    this->file = std::fopen(path, "rb");
+    if (this->file == nullptr)
+        throw std::runtime_error("Failed to open session file \"" + std::string(path) + "\".");
+
+    char magic[4];
+    uint32_t version;
+    if (std::fread(magic, 1, sizeof(magic), this->file) != sizeof(magic) || std::memcmp(magic, SESSION_MAGIC, sizeof(magic)) != 0 ||
+        std::fread(&version, sizeof(version), 1, this->file) != 1 ||
+        std::fread(&this->_seed, sizeof(this->_seed), 1, this->file) != 1 ||
+        std::fread(&this->_capacity, sizeof(this->_capacity), 1, this->file) != 1)
+    {
+        this->close();
+        throw std::runtime_error("File \"" + std::string(path) + "\" is not a session file.");
+    }
+    if (version != SESSION_VERSION)
+    {
+        this->close();
+        throw std::runtime_error("Session file \"" + std::string(path) + "\" has an unsupported version.");
+    }
+    this->spawned.clear();
+    this->has_checksum = false;
+}
+
+void SessionReplayer::close(void)
+{
+    if (this->file != nullptr)
+    {
+        std::fclose(this->file);
+        this->file = nullptr;
+    }
+}
+
+bool SessionReplayer::read_varint(uint32_t& value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7)
+    {
+        const int byte = std::fgetc(this->file);
+        if (byte == EOF) return false;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool SessionReplayer::next_tick(StaticParticleEngine& engine, float& dt)
+{
+    if (this->file == nullptr)
+        throw std::runtime_error("SessionReplayer must be opened before a session can be replayed.");
+
+    int tag;
+    while ((tag = std::fgetc(this->file)) != EOF)
+    {
+        switch (tag)
+        {
+        case SESSION_TICK:
+            if (std::fread(&dt, sizeof(dt), 1, this->file) != 1)
+                throw std::runtime_error("Session file is truncated.");
+            return true;
+
+        case SESSION_SPAWN:
+        {
+            particle_t particle;
+            if (std::fread(&particle, sizeof(particle_t), 1, this->file) != 1)
+                throw std::runtime_error("Session file is truncated.");
+            this->spawned.push_back(engine.spawn(particle));
+            break;
+        }
+
+        case SESSION_KILL:
+        {
+            uint32_t idx;
+            if (!this->read_varint(idx) || idx >= this->spawned.size())
+                throw std::runtime_error("Session file contains an invalid kill command.");
+            engine.kill(this->spawned[idx]);
+            this->spawned[idx] = 0;
+            break;
+        }
+
+        case SESSION_CHECKSUM:
+        {
+            if (std::fread(&this->_recorded_checksum, sizeof(uint64_t), 1, this->file) != 1)
+                throw std::runtime_error("Session file is truncated.");
+
+            // the uid of a spawned particle is its address in the pool of the replaying engine
+            uint64_t checksum = CHECKSUM_BASIS;
+            for (uint32_t i = 0; i < this->spawned.size(); i++)
+            {
+                if (this->spawned[i] != 0)
+                    checksum = checksum_update(checksum, i, *reinterpret_cast<const particle_t*>(this->spawned[i]));
+            }
+            this->_replayed_checksum = checksum;
+            this->has_checksum = true;
+            break;
+        }
+
+        case SESSION_END:
+            return false;
+
+        default:
+            throw std::runtime_error("Session file contains an unknown record.");
+        }
+    }
+    return false;   // a session that has not been closed properly ends without SESSION_END
+}
\ No newline at end of file
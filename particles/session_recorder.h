@@ -0,0 +1,164 @@
+#pragma once
+
+#include "particle_types.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace particles
+{
+    // forward class declarations
+    class StaticParticleEngine;
+
+    /**
+    *   Binary session log, little endian:
+    *       header:     "PSES", uint32_t version, uint64_t seed, uint32_t capacity
+    *       records:    uint8_t tag + payload
+    *                   - SESSION_TICK:     float dt
+    *                   - SESSION_SPAWN:    particle_t (raw)
+    *                   - SESSION_KILL:     varint spawn index (the n-th spawn of the session)
+    *                   - SESSION_CHECKSUM: uint64_t checksum of the living particles (see 'SessionRecorder::record_checksum')
+    *                   - SESSION_END:      no payload
+    *   Particles are referenced by their spawn index, because the uid of an engine is an address
+    *   that differs between runs.
+    */
+    enum session_record_t : uint8_t
+    {
+        SESSION_END = 0,
+        SESSION_TICK = 1,
+        SESSION_SPAWN = 2,
+        SESSION_KILL = 3,
+        SESSION_CHECKSUM = 4
+    };
+
+    /**
+    *   Class: SessionRecorder
+    *   @brief Records the seed, the spawn and kill commands and the dt of every tick of a session
+    *          into a compact binary file. Engines report their commands if a recorder is attached
+    *          to them (see 'StaticParticleEngine::set_recorder'), ticks are reported by the code that
+    *          drives the simulation. The recorder can be used from multiple threads.
+    */
+    class SessionRecorder
+    {
+    private:
+        std::FILE* file;
+        std::mutex mtx;
+        std::unordered_map<uint64_t, uint32_t> spawn_indices;  // uid -> spawn index
+        uint32_t spawn_count;
+
+        void write_varint(uint32_t value);
+
+    public:
+        /**
+        *   @brief The default constructor does not open a session.
+        *   In order to record a session 'SessionRecorder::open' must be called.
+        */
+        SessionRecorder(void);
+
+        /** @brief Closes the session if it is open. */
+        virtual ~SessionRecorder(void);
+
+        /**
+        *   @brief Creates the session file and writes the header.
+        *   @param path: Path of the session file, an existing file is overwritten
+        *   @param seed: Seed of the random engine of the session (see '__internal_random::get_seed')
+        *   @param capacity: Particle capacity of the pool that the session is recorded from
+        */
+        void open(const char* path, uint64_t seed, uint32_t capacity);
+
+        /** @brief Terminates and closes the session file. */
+        void close(void);
+
+        /** @brief Records that a particle with @param uid has been spawned with the data @param particle. */
+        void record_spawn(uint64_t uid, const particle_t& particle);
+
+        /** @brief Records that a particle with @param uid has been killed. Unknown uids are ignored. */
+        void record_kill(uint64_t uid);
+
+        /** @brief Records the end of a tick that advanced the simulation by @param dt seconds. */
+        void record_tick(float dt);
+
+        /**
+        *   @brief Records a checksum of every particle that has been spawned and not killed, in the order of
+        *          their spawns. The particles are read from the pool, so the engine must still be running,
+        *          e.g. the checksum is recorded right before the engine is stopped at the end of the session.
+        */
+        void record_checksum(void);
+
+        /** @return 'true' if a session is being recorded. */
+        bool is_open(void) const noexcept { return (this->file != nullptr); }
+    };
+
+    /**
+    *   Class: SessionReplayer
+    *   @brief Replays a session that has been recorded by particles::SessionRecorder.
+    *          The commands are applied to an engine tick by tick. As particles are always spawned with
+    *          the recorded data and the pool allocates deterministically, the replayed particle buffer
+    *          is bit-exactly the same as the recorded one. A recorded checksum is compared with the
+    *          checksum of the replayed particles when it is reached (see 'SessionReplayer::checksum_matches').
+    */
+    class SessionReplayer
+    {
+    private:
+        std::FILE* file;
+        uint64_t _seed;
+        uint32_t _capacity;
+        std::vector<uint64_t> spawned;      // spawn index -> uid of the replaying engine, 0 if the particle has been killed
+        bool has_checksum;
+        uint64_t _recorded_checksum;
+        uint64_t _replayed_checksum;
+
+        bool read_varint(uint32_t& value);
+
+    public:
+        /**
+        *   @brief The default constructor does not open a session.
+        *   In order to replay a session 'SessionReplayer::open' must be called.
+        */
+        SessionReplayer(void);
+
+        /** @brief Closes the session if it is open. */
+        virtual ~SessionReplayer(void);
+
+        /** @brief Opens a session file and reads its header. */
+        void open(const char* path);
+
+        /** @brief Closes the session file. */
+        void close(void);
+
+        /**
+        *   @brief Applies the recorded commands to @param engine up to the next tick.
+        *          The engine must be started.
+        *   @param dt: Returns the dt of the tick
+        *   @return 'true' if a tick has been replayed, 'false' if the session has ended.
+        */
+        bool next_tick(StaticParticleEngine& engine, float& dt);
+
+        /** @return The seed that the session has been recorded with. */
+        uint64_t seed(void) const noexcept          { return this->_seed; }
+
+        /** @return The particle capacity of the pool that the session has been recorded from. */
+        uint32_t capacity(void) const noexcept      { return this->_capacity; }
+
+        /** @return The number of particles that have been spawned so far. */
+        uint32_t spawn_count(void) const noexcept   { return static_cast<uint32_t>(this->spawned.size()); }
+
+        /** @return 'true' if the session contains a checksum and it has been replayed. */
+        bool checksum_replayed(void) const noexcept { return this->has_checksum; }
+
+        /** @return The recorded checksum, only valid if 'SessionReplayer::checksum_replayed' returns 'true'. */
+        uint64_t recorded_checksum(void) const noexcept { return this->_recorded_checksum; }
+
+        /** @return The checksum of the replayed particles at the point the checksum has been recorded. */
+        uint64_t replayed_checksum(void) const noexcept { return this->_replayed_checksum; }
+
+        /** @return 'true' if the replayed particles match the recorded ones at the recorded checksum. */
+        bool checksum_matches(void) const noexcept  { return this->has_checksum && this->_recorded_checksum == this->_replayed_checksum; }
+
+        /** @return 'true' if a session is open. */
+        bool is_open(void) const noexcept           { return (this->file != nullptr); }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "shm_feed.h"
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace particles;
+
+namespace
+{
+    constexpr char SHM_FEED_MAGIC[4] = { 'P', 'S', 'H', 'M' };
+    constexpr uint32_t SHM_FEED_VERSION = 1;
+    constexpr size_t SHM_FEED_ALIGNMENT = 64;
+    constexpr uint32_t MAX_COPY_ATTEMPTS = 4;
+
+    size_t align_up(size_t x, size_t alignment) { return (x + alignment - 1) & ~(alignment - 1); }
+
+    size_t slot_size(uint32_t capacity)
+    {
+        return align_up(sizeof(shm_feed_slot_t) + static_cast<size_t>(capacity) * sizeof(particle_t), SHM_FEED_ALIGNMENT);
+    }
+
+    size_t slots_offset(void) { return align_up(sizeof(shm_feed_header_t), SHM_FEED_ALIGNMENT); }
+};
+
+size_t particles::shm_feed_size(uint32_t capacity, uint32_t n_slots)
+{
+    return slots_offset() + slot_size(capacity) * n_slots;
+}
+
+// ------------------------ PRODUCER ------------------------
+
+ShmFeedProducer::ShmFeedProducer(void)
+{
+    this->memory = nullptr;
+    this->size = 0;
+    this->header = nullptr;
+    this->sequence = 0;
+    this->slot = nullptr;
+}
+
+ShmFeedProducer::~ShmFeedProducer(void)
+{
+    this->destroy();
+}
+
+shm_feed_slot_t* ShmFeedProducer::get_slot(uint64_t sequence) noexcept
+{
+    uint8_t* slots = static_cast<uint8_t*>(this->memory) + slots_offset();
+    return reinterpret_cast<shm_feed_slot_t*>(slots + (sequence % this->header->n_slots) * this->header->slot_size);
+}
+
+void ShmFeedProducer::create(const char* name, uint32_t capacity, uint32_t n_slots)
+{
+#ifdef _WIN32
+    throw std::runtime_error("ShmFeedProducer requires POSIX shared memory.");
+#else
+    if (this->header != nullptr)
+        throw std::runtime_error("ShmFeedProducer has already been created.");
+    if (capacity == 0)
+        throw std::invalid_argument("Capacity of ShmFeedProducer::create must be bigger than 0.");
+    if (n_slots < 2)
+        throw std::invalid_argument("Number of slots of ShmFeedProducer::create must be at least 2.");
+
+    const size_t size = shm_feed_size(capacity, n_slots);
+    const int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create shared memory \"" + std::string(name) + "\".");
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(name);
+        throw std::runtime_error("Failed to resize shared memory \"" + std::string(name) + "\".");
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name);
+        throw std::runtime_error("Failed to map shared memory \"" + std::string(name) + "\".");
+    }
+
+    this->name = name;
+    this->memory = memory;
+    this->size = size;
+    this->header = new (memory) shm_feed_header_t;
+    this->header->capacity = capacity;
+    this->header->n_slots = n_slots;
+    this->header->slot_size = slot_size(capacity);
+    this->header->version = SHM_FEED_VERSION;
+    this->header->latest.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n_slots; i++)
+    {
+        shm_feed_slot_t* slot = new (this->get_slot(i)) shm_feed_slot_t;
+        slot->sequence.store(0, std::memory_order_relaxed);
+        slot->count = 0;
+    }
+    this->sequence = 0;
+    this->slot = nullptr;
+
+    // the magic is written last, a consumer only accepts a completely initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(this->header->magic, SHM_FEED_MAGIC, sizeof(SHM_FEED_MAGIC));
+#endif
+}
+
+void ShmFeedProducer::destroy(void)
+{
+#ifndef _WIN32
+    if (this->header != nullptr)
+    {
+        munmap(this->memory, this->size);
+        shm_unlink(this->name.c_str());
+        this->memory = nullptr;
+        this->header = nullptr;
+        this->slot = nullptr;
+        this->size = 0;
+    }
+#endif
+}
+
+particle_t* ShmFeedProducer::begin_frame(void)
+{
+    if (this->header == nullptr)
+        throw std::runtime_error("ShmFeedProducer must be created before frames can be written.");
+
+    // mark the slot as being written (odd sequence) before its particles are touched
+    ++this->sequence;
+    this->slot = this->get_slot(this->sequence);
+    this->slot->sequence.store(2 * this->sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<particle_t*>(reinterpret_cast<uint8_t*>(this->slot) + sizeof(shm_feed_slot_t));
+}
+
+void ShmFeedProducer::end_frame(uint32_t count)
+{
+    if (this->slot == nullptr)
+        throw std::runtime_error("ShmFeedProducer::end_frame must be called after ShmFeedProducer::begin_frame.");
+    if (count > this->header->capacity)
+        throw std::invalid_argument("Count of ShmFeedProducer::end_frame must not be bigger than the capacity.");
+
+    this->slot->count = count;
+    this->slot->sequence.store(2 * this->sequence, std::memory_order_release);
+    this->header->latest.store(this->sequence, std::memory_order_release);
+    this->slot = nullptr;
+}
+
+// ------------------------ CONSUMER ------------------------
+
+ShmFeedConsumer::ShmFeedConsumer(void)
+{
+    this->memory = nullptr;
+    this->size = 0;
+    this->header = nullptr;
+    this->_capacity = 0;
+    this->n_slots = 0;
+    this->slot_stride = 0;
+    this->last_sequence = 0;
+}
+
+ShmFeedConsumer::~ShmFeedConsumer(void)
+{
+    this->close();
+}
+
+void ShmFeedConsumer::open(const char* name)
+{
+#ifdef _WIN32
+    throw std::runtime_error("ShmFeedConsumer requires POSIX shared memory.");
+#else
+    if (this->header != nullptr)
+        throw std::runtime_error("ShmFeedConsumer has already been opened.");
+
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open shared memory \"" + std::string(name) + "\".");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shm_feed_header_t))
+    {
+        ::close(fd);
+        throw std::runtime_error("Shared memory \"" + std::string(name) + "\" is not a particle feed.");
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Failed to map shared memory \"" + std::string(name) + "\".");
+
+    // the layout is read once, the producer could change the header after it has been validated
+    const shm_feed_header_t* header = static_cast<const shm_feed_header_t*>(memory);
+    const uint32_t capacity = header->capacity;
+    const uint32_t n_slots = header->n_slots;
+    const uint64_t header_slot_size = header->slot_size;
+    if (std::memcmp(header->magic, SHM_FEED_MAGIC, sizeof(SHM_FEED_MAGIC)) != 0 || header->version != SHM_FEED_VERSION ||
+        n_slots == 0 || header_slot_size != slot_size(capacity) || size < slots_offset() ||
+        n_slots > (size - slots_offset()) / header_slot_size)
+    {
+        munmap(memory, size);
+        throw std::runtime_error("Shared memory \"" + std::string(name) + "\" is not a particle feed.");
+    }
+
+    this->memory = memory;
+    this->size = size;
+    this->header = header;
+    this->_capacity = capacity;
+    this->n_slots = n_slots;
+    this->slot_stride = header_slot_size;
+    this->last_sequence = 0;
+    this->staging.resize(capacity);
+#endif
+}
+
+void ShmFeedConsumer::close(void)
+{
+#ifndef _WIN32
+    if (this->header != nullptr)
+    {
+        munmap(this->memory, this->size);
+        this->memory = nullptr;
+        this->header = nullptr;
+        this->size = 0;
+        this->_capacity = 0;
+        this->n_slots = 0;
+        this->slot_stride = 0;
+        this->staging.clear();
+        this->staging.shrink_to_fit();
+    }
+#endif
+}
+
+bool ShmFeedConsumer::copy_latest(particle_t* particles, uint32_t& count)
+{
+    if (this->header == nullptr)
+        throw std::runtime_error("ShmFeedConsumer must be opened before frames can be copied.");
+
+    const uint8_t* slots = static_cast<const uint8_t*>(this->memory) + slots_offset();
+    for (uint32_t attempt = 0; attempt < MAX_COPY_ATTEMPTS; attempt++)
+    {
+        const uint64_t sequence = this->header->latest.load(std::memory_order_acquire);
+        if (sequence == 0 || sequence == this->last_sequence)
+            return false;
+
+        const shm_feed_slot_t* slot = reinterpret_cast<const shm_feed_slot_t*>(slots + (sequence % this->n_slots) * this->slot_stride);
+        const uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (before != 2 * sequence)
+            continue;   // the producer has already lapped the ring, retry with the newest frame
+
+        // the destination may be read concurrently (e.g. by the renderer), so the frame is validated in the staging buffer
+        uint32_t n = slot->count;
+        if (n > this->_capacity) n = this->_capacity;
+        std::memcpy(this->staging.data(), reinterpret_cast<const uint8_t*>(slot) + sizeof(shm_feed_slot_t), n * sizeof(particle_t));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != before)
+            continue;   // torn copy, the destination still contains the previous frame
+
+        std::memcpy(particles, this->staging.data(), n * sizeof(particle_t));
+        count = n;
+        this->last_sequence = sequence;
+        return true;
+    }
+    return false;
+}
\ No newline at end of file
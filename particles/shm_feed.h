@@ -0,0 +1,148 @@
+#pragma once
+
+#include "particle_types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Layout of a shared memory particle feed (POSIX shm_open / mmap):
+    *       header:     shm_feed_header_t
+    *       slots:      n_slots x (shm_feed_slot_t + particle_t[capacity]), every slot is 64-byte aligned
+    *
+    *   The producer writes frames round robin into the slots. Every slot is guarded by a sequence number
+    *   like a seqlock: it is odd while the slot is written and 2 * frame sequence when the frame is complete.
+    *   Afterwards the producer publishes the frame sequence in 'latest'. A consumer copies the latest slot
+    *   and checks that its sequence number did not change during the copy, a torn copy is retried.
+    *   The header is written by another process, the consumer validates the layout once when it opens
+    *   the feed and only uses its own copy of the layout afterwards.
+    */
+    struct shm_feed_header_t
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t capacity;                  // maximum number of particles per frame
+        uint32_t n_slots;
+        uint64_t slot_size;                 // size of a slot in bytes, including its shm_feed_slot_t
+        std::atomic<uint64_t> latest;       // sequence of the latest complete frame, 0 = no frame yet
+    };
+
+    struct shm_feed_slot_t
+    {
+        std::atomic<uint64_t> sequence;
+        uint32_t count;                     // number of particles in the frame
+        uint32_t reserved;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The shared memory feed requires lock-free 64-bit atomics.");
+
+    /** @return The size of the shared memory of a feed in bytes. */
+    size_t shm_feed_size(uint32_t capacity, uint32_t n_slots);
+
+    /**
+    *   Class: ShmFeedProducer
+    *   @brief Creates a shared memory particle feed and writes frames into it. Used by external simulators.
+    *          Frames are written in place into the shared memory, the producer keeps no copy of its own.
+    */
+    class ShmFeedProducer
+    {
+    private:
+        std::string name;
+        void* memory;
+        size_t size;
+        shm_feed_header_t* header;
+        uint64_t sequence;                  // sequence of the frame that is written
+        shm_feed_slot_t* slot;              // slot of the frame that is written, nullptr if none
+
+        shm_feed_slot_t* get_slot(uint64_t sequence) noexcept;
+
+    public:
+        /** @brief Default number of slots, the consumer has two frames of time to copy the latest frame. */
+        constexpr static uint32_t DEFAULT_SLOTS = 3;
+
+        /**
+        *   @brief The default constructor does not create a feed.
+        *   In order to create a feed 'ShmFeedProducer::create' must be called.
+        */
+        ShmFeedProducer(void);
+
+        /** @brief Destroys the feed if it has been created. */
+        virtual ~ShmFeedProducer(void);
+
+        /**
+        *   @brief Creates the shared memory of the feed.
+        *   @param name: Name of the shared memory object, e.g. "/particles"
+        *   @param capacity: Maximum number of particles per frame
+        *   @param n_slots: Number of frames in the ring, must be at least 2
+        */
+        void create(const char* name, uint32_t capacity, uint32_t n_slots = DEFAULT_SLOTS);
+
+        /** @brief Unmaps and unlinks the shared memory of the feed. */
+        void destroy(void);
+
+        /** @return A pointer to the particles of the next frame, that the caller writes to. */
+        particle_t* begin_frame(void);
+
+        /** @brief Publishes the frame that has been started by 'ShmFeedProducer::begin_frame'. */
+        void end_frame(uint32_t count);
+
+        /** @return The maximum number of particles per frame. */
+        uint32_t capacity(void) const noexcept  { return (this->header != nullptr) ? this->header->capacity : 0; }
+
+        /** @return 'true' if the feed has been created. */
+        bool created(void) const noexcept       { return (this->header != nullptr); }
+    };
+
+    /**
+    *   Class: ShmFeedConsumer
+    *   @brief Maps an existing shared memory particle feed read-only and copies its latest complete frame.
+    *          A frame is copied twice: into a staging buffer, where its sequence number is validated, and
+    *          then into the destination. The destination may be read concurrently (e.g. by the renderer),
+    *          so a torn frame must never be copied into it. This costs a second copy of every frame
+    *          (32 bytes per particle).
+    *          The slot can not be validated before it is copied, the producer may lap it during the copy.
+    */
+    class ShmFeedConsumer
+    {
+    private:
+        void* memory;
+        size_t size;
+        const shm_feed_header_t* header;
+        uint32_t _capacity, n_slots;        // layout of the feed, validated against the mapped size in 'open'
+        uint64_t slot_stride;
+        uint64_t last_sequence;             // sequence of the last copied frame
+        std::vector<particle_t> staging;    // 'capacity' particles, a frame is validated here before it is published
+
+    public:
+        ShmFeedConsumer(void);
+        virtual ~ShmFeedConsumer(void);
+
+        /** @brief Maps the feed with the name @param name, it must have been created by a producer. */
+        void open(const char* name);
+
+        /** @brief Unmaps the feed. */
+        void close(void);
+
+        /**
+        *   @brief Copies the latest complete frame if there is a newer frame than the last one that has been copied.
+        *   @param particles: Destination with space for 'capacity' particles, it is not written if no frame is copied
+        *   @param count: Returns the number of copied particles
+        *   @return 'true' if a new frame has been copied, 'false' if there is no new frame or every copy was torn.
+        */
+        bool copy_latest(particle_t* particles, uint32_t& count);
+
+        /** @return The maximum number of particles per frame. */
+        uint32_t capacity(void) const noexcept      { return (this->header != nullptr) ? this->_capacity : 0; }
+
+        /** @return The sequence of the last copied frame, 0 if no frame has been copied. */
+        uint64_t sequence(void) const noexcept      { return this->last_sequence; }
+
+        /** @return 'true' if a feed is mapped. */
+        bool is_open(void) const noexcept           { return (this->header != nullptr); }
+    };
+};
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "particle_engine.h"
+#include "../profiler/profiler.h"
+#include "../metrics/metrics.h"
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+using namespace particles;
+
+ShmParticleEngine::ShmParticleEngine(void)
+{
+    this->pool = nullptr;
+    this->range = nullptr;
+    this->range_size = 0;
+    this->presented_size = 0;
+    this->frames = 0;
+}
+
+ShmParticleEngine::ShmParticleEngine(ParticlePool& pool, const char* name) : ShmParticleEngine()
+{
+    this->init(pool, name);
+}
+
+ShmParticleEngine::~ShmParticleEngine(void)
+{
+    this->stop();
+}
+
+void ShmParticleEngine::init(ParticlePool& pool, const char* name)
+{
+    if (this->base_running())
+        throw std::runtime_error("Cannot reinitialize running particle engine (ShmParticleEngine).");
+
+    this->consumer.close();
+    this->consumer.open(name);
+    this->pool = &pool;
+}
+
+void ShmParticleEngine::start(void)
+{
+    if (this->pool == nullptr)
+        throw std::runtime_error("Cannot start uninitialized particle engine (ShmParticleEngine).");
+    if (this->base_running()) return;
+
+    this->range_size = this->consumer.capacity();
+    this->range = this->pool->allocate_range(this->range_size);
+    if (this->range == nullptr)
+        throw std::bad_alloc();
+    this->presented_size = 0;
+    this->frames = 0;
+    this->start_base(this);
+}
+
+void ShmParticleEngine::stop(void)
+{
+    this->stop_base();  // stop polling first, then the particles can be freed
+    if (this->range != nullptr)
+    {
+        this->pool->free_range(this->range, this->range_size);
+        this->range = nullptr;
+        this->range_size = 0;
+        this->presented_size = 0;
+    }
+}
+
+void ShmParticleEngine::run(const std::atomic_bool& running, void* param)
+{
+    PROFILE_THREAD("ShmParticleEngine");
+    metrics::Counter& frames = metrics::registry().counter("shm_feed_frames");
+    while (running)
+    {
+        uint32_t n;
+        if (!this->consumer.copy_latest(this->range, n))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(POLL_INTERVAL_US));
+            continue;
+        }
+
+        // particles of a bigger previous frame are freed by a NAN-position
+        for (uint32_t i = n; i < this->presented_size; i++)
+            this->range[i].pos = glm::vec3(NAN);
+        this->presented_size = n;
+        ++this->frames;
+        frames.add();
+    }
+}
\ No newline at end of file
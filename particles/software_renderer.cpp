@@ -0,0 +1,352 @@
+#include "software_renderer.h"
+#include "image_writer.h"
+#include "../simd/simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+using namespace particles;
+
+namespace
+{
+    constexpr uint32_t TILE_PIXELS = SoftwareParticleRenderer::TILE_SIZE * SoftwareParticleRenderer::TILE_SIZE;
+    constexpr uint32_t TILE_PLANE = TILE_PIXELS + simd::WIDTH;     // padding, the last 8-wide access of a row may overhang
+    constexpr uint32_t DEFAULT_TEXTURE_SIZE = 64;
+    constexpr float ALPHA_DISCARD = 0.1f;                           // same as the particle fragment shader
+
+    constexpr float LANE_INDEX[simd::WIDTH] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+    uint8_t to_unorm8(float x)
+    {
+        return static_cast<uint8_t>(std::min(std::max(x, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+};
+
+SoftwareParticleRenderer::SoftwareParticleRenderer(void)
+{
+    this->_width = 0;
+    this->_height = 0;
+    this->tiles_x = 0;
+    this->tiles_y = 0;
+    this->n_threads = 0;
+    this->view = glm::mat4(1.0f);
+    this->projection = glm::mat4(1.0f);
+    this->clear_color = glm::vec4(0.0f);
+    this->texture_width = 0;
+    this->texture_height = 0;
+    this->pass = nullptr;
+    this->pass_param = nullptr;
+    this->generation = 0;
+    this->pending = 0;
+    this->exit_workers = false;
+    this->_initialized = false;
+
+    // round soft splat, white with a quadratic alpha falloff
+    std::vector<uint8_t> rgba(DEFAULT_TEXTURE_SIZE * DEFAULT_TEXTURE_SIZE * 4);
+    for (uint32_t y = 0; y < DEFAULT_TEXTURE_SIZE; y++)
+    {
+        for (uint32_t x = 0; x < DEFAULT_TEXTURE_SIZE; x++)
+        {
+            const float dx = (x + 0.5f) / DEFAULT_TEXTURE_SIZE * 2.0f - 1.0f;
+            const float dy = (y + 0.5f) / DEFAULT_TEXTURE_SIZE * 2.0f - 1.0f;
+            uint8_t* texel = rgba.data() + (y * DEFAULT_TEXTURE_SIZE + x) * 4;
+            texel[0] = texel[1] = texel[2] = 255;
+            texel[3] = to_unorm8(1.0f - (dx * dx + dy * dy));
+        }
+    }
+    this->set_texture(rgba.data(), DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE);
+}
+
+SoftwareParticleRenderer::SoftwareParticleRenderer(uint32_t width, uint32_t height, uint32_t n_threads) : SoftwareParticleRenderer()
+{
+    this->init(width, height, n_threads);
+}
+
+SoftwareParticleRenderer::~SoftwareParticleRenderer(void)
+{
+    this->clear();
+}
+
+void SoftwareParticleRenderer::init(uint32_t width, uint32_t height, uint32_t n_threads)
+{
+    if (this->_initialized)
+        throw std::runtime_error("SoftwareParticleRenderer has already been initialized.");
+    if (width == 0 || height == 0)
+        throw std::invalid_argument("Width and height of SoftwareParticleRenderer::init must be bigger than 0.");
+
+    this->_width = width;
+    this->_height = height;
+    this->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    this->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    this->n_threads = (n_threads > 0) ? n_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    this->bins.resize(this->n_threads);
+    for (worker_bins_t& worker : this->bins)
+        worker.tiles.resize(this->tiles_x * this->tiles_y);
+    this->tile_buffers.assign(this->n_threads, std::vector<float>(5 * TILE_PLANE));
+    this->_image.assign(static_cast<size_t>(width) * height * 4, 0);
+
+    this->exit_workers = false;
+    this->workers.reserve(this->n_threads - 1);
+    for (uint32_t t = 1; t < this->n_threads; t++)
+        this->workers.emplace_back(&SoftwareParticleRenderer::worker_main, this, t);
+    this->_initialized = true;
+}
+
+void SoftwareParticleRenderer::clear(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->exit_workers = true;
+    }
+    this->pass_cv.notify_all();
+    for (std::thread& worker : this->workers)
+        worker.join();
+    this->workers.clear();
+    this->generation = 0;
+
+    this->bins.clear();
+    this->tile_buffers.clear();
+    this->_image.clear();
+    this->_width = 0;
+    this->_height = 0;
+    this->tiles_x = 0;
+    this->tiles_y = 0;
+    this->n_threads = 0;
+    this->_initialized = false;
+}
+
+void SoftwareParticleRenderer::set_texture(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    if (rgba == nullptr || width == 0 || height == 0)
+        throw std::invalid_argument("Texture of SoftwareParticleRenderer::set_texture must not be empty.");
+
+    // packed little endian, so a gathered texel has red in the lowest byte
+    this->texture.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < this->texture.size(); i++)
+    {
+        this->texture[i] = static_cast<uint32_t>(rgba[4 * i]) | (static_cast<uint32_t>(rgba[4 * i + 1]) << 8) |
+                           (static_cast<uint32_t>(rgba[4 * i + 2]) << 16) | (static_cast<uint32_t>(rgba[4 * i + 3]) << 24);
+    }
+    this->texture_width = width;
+    this->texture_height = height;
+}
+
+void SoftwareParticleRenderer::worker_main(uint32_t t)
+{
+    uint64_t done = 0;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->pass_cv.wait(lock, [this, done] { return this->exit_workers || this->generation != done; });
+        if (this->exit_workers) return;
+        done = this->generation;
+        lock.unlock();
+
+        this->pass(this->pass_param, t);
+
+        lock.lock();
+        if (--this->pending == 0)
+            this->done_cv.notify_one();
+    }
+}
+
+template<typename Func>
+void SoftwareParticleRenderer::parallel(Func func)
+{
+    // the pass is called through a function pointer, so that publishing it does not allocate
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->pass = [](void* param, uint32_t t) { (*static_cast<Func*>(param))(t); };
+        this->pass_param = &func;
+        this->pending = static_cast<uint32_t>(this->workers.size());
+        ++this->generation;
+    }
+    this->pass_cv.notify_all();
+    func(0);
+
+    std::unique_lock<std::mutex> lock(this->mtx);
+    this->done_cv.wait(lock, [this] { return this->pending == 0; });
+}
+
+void SoftwareParticleRenderer::render(const particle_t* particles, uint32_t n)
+{
+    if (!this->_initialized)
+        throw std::runtime_error("SoftwareParticleRenderer must be initialized in order to render.");
+
+    // Every thread bins a consecutive part of the buffer. The tiles walk the bins in thread order,
+    // so the splats of a tile are blended in buffer order like on the GPU.
+    this->parallel([this, particles, n](uint32_t t) {
+        const uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(n) * t / this->n_threads);
+        const uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(n) * (t + 1) / this->n_threads);
+        this->bin(particles, first, last, this->bins[t]);
+    });
+
+    // the tiles are distributed dynamically, their cost depends on how many particles they contain
+    std::atomic<uint32_t> next_tile(0);
+    this->parallel([this, &next_tile](uint32_t t) {
+        for (uint32_t tile = next_tile++; tile < this->tiles_x * this->tiles_y; tile = next_tile++)
+            this->rasterize(tile, this->tile_buffers[t].data());
+    });
+}
+
+void SoftwareParticleRenderer::bin(const particle_t* particles, uint32_t first, uint32_t last, worker_bins_t& bins) const
+{
+    bins.splats.clear();
+    for (std::vector<uint32_t>& tile : bins.tiles)
+        tile.clear();
+
+    // The billboard is spanned by the right and up vector of the camera like in the geometry shader.
+    // Both are parallel to the image plane, so the billboard projects to an axis aligned rectangle.
+    const glm::mat4 vp = this->projection * this->view;
+    const glm::vec3 cam_right(this->view[0][0], this->view[1][0], this->view[2][0]);
+    const glm::vec3 cam_up(this->view[0][1], this->view[1][1], this->view[2][1]);
+    const glm::vec4 right = vp * glm::vec4(cam_right * 0.5f, 0.0f);
+    const glm::vec4 up = vp * glm::vec4(cam_up * 0.5f, 0.0f);
+    const float w = static_cast<float>(this->_width), h = static_cast<float>(this->_height);
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        const particle_t& p = particles[i];
+        if (std::isnan(p.pos.x)) continue;
+
+        const glm::vec4 clip = vp * glm::vec4(p.pos, 1.0f);
+        if (!(clip.w > 0.0f)) continue;
+        const float depth = clip.z / clip.w;
+        if (depth < 0.0f || depth > 1.0f) continue;
+
+        splat_t s;
+        s.cx = (clip.x / clip.w * 0.5f + 0.5f) * w;
+        s.cy = (clip.y / clip.w * 0.5f + 0.5f) * h;
+        const glm::vec4 cr = clip + right * p.size;
+        const glm::vec4 cu = clip + up * p.size;
+        s.hx = (cr.x / cr.w * 0.5f + 0.5f) * w - s.cx;
+        s.hy = (cu.y / cu.w * 0.5f + 0.5f) * h - s.cy;
+        s.depth = depth;
+        s.r = p.color.x;
+        s.g = p.color.y;
+        s.b = p.color.z;
+        s.a = p.color.w;
+
+        const float ax = std::fabs(s.hx), ay = std::fabs(s.hy);
+        if (!(ax > 0.0f && ay > 0.0f) || s.cx + ax < 0.0f || s.cx - ax > w || s.cy + ay < 0.0f || s.cy - ay > h) continue;
+
+        const uint32_t tx0 = static_cast<uint32_t>(std::max(s.cx - ax, 0.0f)) / TILE_SIZE;
+        const uint32_t ty0 = static_cast<uint32_t>(std::max(s.cy - ay, 0.0f)) / TILE_SIZE;
+        const uint32_t tx1 = std::min(static_cast<uint32_t>(std::min(s.cx + ax, w - 1.0f)) / TILE_SIZE, this->tiles_x - 1);
+        const uint32_t ty1 = std::min(static_cast<uint32_t>(std::min(s.cy + ay, h - 1.0f)) / TILE_SIZE, this->tiles_y - 1);
+        const uint32_t idx = static_cast<uint32_t>(bins.splats.size());
+        bins.splats.push_back(s);
+        for (uint32_t ty = ty0; ty <= ty1; ty++)
+        {
+            for (uint32_t tx = tx0; tx <= tx1; tx++)
+                bins.tiles[ty * this->tiles_x + tx].push_back(idx);
+        }
+    }
+}
+
+void SoftwareParticleRenderer::rasterize(uint32_t tile, float* tile_buffer)
+{
+    using namespace simd;
+
+    const int32_t ox = static_cast<int32_t>((tile % this->tiles_x) * TILE_SIZE);
+    const int32_t oy = static_cast<int32_t>((tile / this->tiles_x) * TILE_SIZE);
+    const int32_t tw = std::min(static_cast<int32_t>(TILE_SIZE), static_cast<int32_t>(this->_width) - ox);
+    const int32_t th = std::min(static_cast<int32_t>(TILE_SIZE), static_cast<int32_t>(this->_height) - oy);
+
+    float* planes[5];
+    for (uint32_t c = 0; c < 5; c++)
+        planes[c] = tile_buffer + c * TILE_PLANE;
+    std::fill(planes[0], planes[0] + TILE_PLANE, this->clear_color.x);
+    std::fill(planes[1], planes[1] + TILE_PLANE, this->clear_color.y);
+    std::fill(planes[2], planes[2] + TILE_PLANE, this->clear_color.z);
+    std::fill(planes[3], planes[3] + TILE_PLANE, this->clear_color.w);
+    std::fill(planes[4], planes[4] + TILE_PLANE, 1.0f);
+
+    const float8 lane = load(LANE_INDEX);
+    const float8 one = set1(1.0f);
+    const float8 tex_w = set1(static_cast<float>(this->texture_width));
+    const float8 tex_max = set1(static_cast<float>(this->texture_width - 1));
+    const int8 byte_mask = set1i(0xFF);
+    const int32_t* texels = reinterpret_cast<const int32_t*>(this->texture.data());
+
+    for (const worker_bins_t& worker : this->bins)
+    {
+        for (uint32_t idx : worker.tiles[tile])
+        {
+            const splat_t& s = worker.splats[idx];
+            const float ax = std::fabs(s.hx), ay = std::fabs(s.hy);
+
+            // pixels whose center is inside of the rectangle, clipped to the tile
+            const int32_t x0 = std::max(static_cast<int32_t>(std::ceil(s.cx - ax - 0.5f)), ox);
+            const int32_t x1 = std::min(static_cast<int32_t>(std::floor(s.cx + ax - 0.5f)), ox + tw - 1);
+            const int32_t y0 = std::max(static_cast<int32_t>(std::ceil(s.cy - ay - 0.5f)), oy);
+            const int32_t y1 = std::min(static_cast<int32_t>(std::floor(s.cy + ay - 0.5f)), oy + th - 1);
+            if (x0 > x1 || y0 > y1) continue;
+
+            // texture coordinates go from 0 to 1 along the right and up vector
+            const float du = 0.5f / s.hx, dv = 0.5f / s.hy;
+            const float8 depth = set1(s.depth);
+            const float8 color_r = set1(s.r * (1.0f / 255.0f)), color_g = set1(s.g * (1.0f / 255.0f));
+            const float8 color_b = set1(s.b * (1.0f / 255.0f)), color_a = set1(s.a * (1.0f / 255.0f));
+            const float8 alpha_discard = set1(ALPHA_DISCARD);
+
+            for (int32_t y = y0; y <= y1; y++)
+            {
+                const float v = 0.5f + (y + 0.5f - s.cy) * dv;
+                const uint32_t ty = std::min(static_cast<uint32_t>(std::max(v, 0.0f) * this->texture_height), this->texture_height - 1);
+                const int32_t* row = texels + ty * this->texture_width;
+                const uint32_t offset = (y - oy) * TILE_SIZE;
+
+                for (int32_t x = x0; x <= x1; x += WIDTH)
+                {
+                    const float8 u = fmadd(lane, set1(du), set1(0.5f + (x + 0.5f - s.cx) * du));
+                    const int8 texel = gather(row, to_int(min(max(u * tex_w, zero()), tex_max)));
+
+                    // texture(tex, f_texcoord) * f_color, discarded below the alpha threshold
+                    const float8 src_a = to_float(texel >> 24) * color_a;
+                    mask8 pass = first_lanes(static_cast<uint32_t>(x1 - x + 1)) & (src_a >= alpha_discard);
+                    float* dst[5];
+                    for (uint32_t c = 0; c < 5; c++)
+                        dst[c] = planes[c] + offset + (x - ox);
+                    const float8 dst_depth = load(dst[4]);
+                    pass = pass & (depth < dst_depth);
+                    if (!any(pass)) continue;
+
+                    const float8 src_r = to_float(texel & byte_mask) * color_r;
+                    const float8 src_g = to_float((texel >> 8) & byte_mask) * color_g;
+                    const float8 src_b = to_float((texel >> 16) & byte_mask) * color_b;
+                    const float8 inv_alpha = one - src_a;
+
+                    // color: src * src_alpha + dst * (1 - src_alpha), alpha: src_alpha * 1 + dst_alpha * 0
+                    store(dst[0], select(pass, fmadd(src_r, src_a, load(dst[0]) * inv_alpha), load(dst[0])));
+                    store(dst[1], select(pass, fmadd(src_g, src_a, load(dst[1]) * inv_alpha), load(dst[1])));
+                    store(dst[2], select(pass, fmadd(src_b, src_a, load(dst[2]) * inv_alpha), load(dst[2])));
+                    store(dst[3], select(pass, src_a, load(dst[3])));
+                    store(dst[4], select(pass, depth, dst_depth));
+                }
+            }
+        }
+    }
+
+    for (int32_t y = 0; y < th; y++)
+    {
+        uint8_t* out = this->_image.data() + ((static_cast<size_t>(oy + y) * this->_width) + ox) * 4;
+        for (int32_t x = 0; x < tw; x++)
+        {
+            const uint32_t i = y * TILE_SIZE + x;
+            out[4 * x + 0] = to_unorm8(planes[0][i]);
+            out[4 * x + 1] = to_unorm8(planes[1][i]);
+            out[4 * x + 2] = to_unorm8(planes[2][i]);
+            out[4 * x + 3] = to_unorm8(planes[3][i]);
+        }
+    }
+}
+
+void SoftwareParticleRenderer::write(const char* path) const
+{
+    if (!this->_initialized)
+        throw std::runtime_error("SoftwareParticleRenderer must be initialized in order to write its image.");
+    write_image(path, this->_image.data(), this->_width, this->_height);
+}
\ No newline at end of file
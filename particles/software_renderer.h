@@ -0,0 +1,134 @@
+#pragma once
+
+#include "particle_types.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace particles
+{
+    /**
+    *   Class: SoftwareParticleRenderer
+    *   @brief Renders particles on the CPU, for machines without a GPU. The particles are drawn like the
+    *          Vulkan particle pipeline draws them: camera-facing textured billboards with the same view and
+    *          projection matrices, a depth test (less) with depth write, alpha test (discard below 0.1)
+    *          and alpha blending (src alpha, one minus src alpha) in buffer order.
+    *          The particles are projected and binned into 64x64 tiles in parallel, then every tile is
+    *          rasterized by one thread with 8-wide SIMD blending into a tile-local framebuffer.
+    *          The render threads are started by 'init' and wait between two passes, the calling thread is one of them.
+    */
+    class SoftwareParticleRenderer
+    {
+    private:
+        struct splat_t
+        {
+            float cx, cy;           // center in pixels
+            float hx, hy;           // signed half extent in pixels of the right and the up vector
+            float depth;
+            float r, g, b, a;
+        };
+
+        struct worker_bins_t
+        {
+            std::vector<splat_t> splats;                // projected particles of the worker in buffer order
+            std::vector<std::vector<uint32_t>> tiles;   // indices of the splats that overlap every tile
+        };
+
+        uint32_t _width, _height;
+        uint32_t tiles_x, tiles_y;
+        uint32_t n_threads;
+        glm::mat4 view, projection;
+        glm::vec4 clear_color;
+        std::vector<uint32_t> texture;  // RGBA8 texels
+        uint32_t texture_width, texture_height;
+        std::vector<worker_bins_t> bins;
+        std::vector<std::vector<float>> tile_buffers;   // tile-local framebuffer of every thread
+        std::vector<uint8_t> _image;
+
+        // the pass that the render threads run, it is published by a new generation
+        std::vector<std::thread> workers;
+        std::mutex mtx;
+        std::condition_variable pass_cv, done_cv;
+        void (*pass)(void*, uint32_t);
+        void* pass_param;
+        uint64_t generation;
+        uint32_t pending;               // render threads that have not finished the pass
+        bool exit_workers;
+
+        bool _initialized;
+
+        /** @brief Main function of the render thread @param t, it runs every pass until the renderer is cleared. */
+        void worker_main(uint32_t t);
+
+        /** @brief Projects the particles [@param first, @param last) and bins them into the tiles. */
+        void bin(const particle_t* particles, uint32_t first, uint32_t last, worker_bins_t& bins) const;
+
+        /** @brief Rasterizes every splat that overlaps @param tile and writes the tile into the image. */
+        void rasterize(uint32_t tile, float* tile_buffer);
+
+        /** @brief Runs @param func(thread index) on every render thread and waits for them. */
+        template<typename Func>
+        void parallel(Func func);
+
+    public:
+        /** @brief Edge length of a tile in pixels. */
+        constexpr static uint32_t TILE_SIZE = 64;
+
+        /**
+        *   @brief The default constructor does not initialize the SoftwareParticleRenderer.
+        *   In order to initialize the SoftwareParticleRenderer 'SoftwareParticleRenderer::init' must be called.
+        */
+        SoftwareParticleRenderer(void);
+
+        /** @brief Constructor that initializes the renderer, see 'SoftwareParticleRenderer::init'. */
+        SoftwareParticleRenderer(uint32_t width, uint32_t height, uint32_t n_threads = 0);
+
+        virtual ~SoftwareParticleRenderer(void);
+
+        /**
+        *   @brief Initializes the framebuffer.
+        *   @param width: Width of the image in pixels
+        *   @param height: Height of the image in pixels
+        *   @param n_threads: Number of render threads, 0 = one per hardware thread
+        */
+        void init(uint32_t width, uint32_t height, uint32_t n_threads = 0);
+
+        /** @brief Frees the framebuffer. */
+        void clear(void);
+
+        /** @brief Sets the particle texture, RGBA8 with @param width x @param height texels. By default a round soft splat is used. */
+        void set_texture(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+        /** @brief Sets the view matrix. */
+        void set_view(const glm::mat4& v) noexcept                                      { this->view = v; }
+
+        /** @brief Sets the projection matrix (depth range [0, 1] like Vulkan). */
+        void set_projection(const glm::mat4& p) noexcept                                { this->projection = p; }
+
+        /** @brief Sets the view and projection matrix. */
+        void set_view_projection(const glm::mat4& v, const glm::mat4& p) noexcept       { this->view = v; this->projection = p; }
+
+        /** @brief Sets the background color, the default is transparent black. */
+        void set_clear_color(const glm::vec4& color) noexcept                           { this->clear_color = color; }
+
+        /**
+        *   @brief Renders a frame, free particles (NAN-position) are skipped.
+        *   @param particles: The particles to render, e.g. the particle-buffer of a HostParticleSink
+        *   @param n: Number of particles
+        */
+        void render(const particle_t* particles, uint32_t n);
+
+        /** @brief Writes the image as PNG or PPM, see 'particles::write_image'. */
+        void write(const char* path) const;
+
+        /** @return The rendered image, RGBA8 row by row from the top. */
+        const uint8_t* image(void) const noexcept   { return this->_image.data(); }
+        uint32_t width(void) const noexcept         { return this->_width; }
+        uint32_t height(void) const noexcept        { return this->_height; }
+        uint32_t thread_count(void) const noexcept  { return this->n_threads; }
+        bool initialized(void) const noexcept       { return this->_initialized; }
+    };
+};
\ No newline at end of file
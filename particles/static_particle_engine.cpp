@@ -1,14 +1,19 @@
 #include "particle_engine.h"
+#include "session_recorder.h"
+#include "../metrics/spawn_latency.h"
+#include "../profiler/alloc_tracker.h"
 #include <stdexcept>
+#include <cstring>
 
 using namespace particles;
 
 StaticParticleEngine::StaticParticleEngine(void)
 {
     this->pool = nullptr;
+    this->recorder = nullptr;
 }
 
-StaticParticleEngine::StaticParticleEngine(ParticlePool& pool)
+StaticParticleEngine::StaticParticleEngine(ParticlePool& pool) : StaticParticleEngine()
 {
     this->init(pool);
 }
@@ -40,6 +45,7 @@ void StaticParticleEngine::stop(void)
 
 uint64_t StaticParticleEngine::spawn(const particle_t& particle)
 {
+    ALLOC_SCOPE(profiler::ALLOC_ENGINE);
     uint64_t uid = 0;
     if (this->base_running())
     {
@@ -57,12 +63,19 @@ uint64_t StaticParticleEngine::spawn(const particle_t& particle)
         // the address is unique for each particle
         // for a simple solution we take the address of the particle
         uid = reinterpret_cast<uint64_t>(p);
+
+        if (this->recorder != nullptr)
+            this->recorder->record_spawn(uid, particle);
+
+        // the particle is in the pool now, the next submitted frame draws it
+        metrics::spawn_latency().stamp_spawn();
     }
     return uid;
 }
 
 void StaticParticleEngine::kill(uint64_t uid)
 {
+    ALLOC_SCOPE(profiler::ALLOC_ENGINE);
     if (this->base_running())
     {
         // for accessing the right particle, we transform the uid back to the address
@@ -75,19 +88,60 @@ void StaticParticleEngine::kill(uint64_t uid)
         //deallocate and delete particle
         this->pool->free(p);
         this->particles.erase(iter);
+
+        if (this->recorder != nullptr)
+            this->recorder->record_kill(uid);
     }
 }
 
 void StaticParticleEngine::kill_all(void)
 {
+    ALLOC_SCOPE(profiler::ALLOC_ENGINE);
     if (this->base_running())
     {
         for (auto iter = this->particles.begin(); iter != this->particles.end(); iter++)
+        {
             this->pool->free(*iter);
+            if (this->recorder != nullptr)
+                this->recorder->record_kill(reinterpret_cast<uint64_t>(*iter));
+        }
         this->particles.clear();
     }
 }
 
+void StaticParticleEngine::save_state(std::vector<uint8_t>& state) const
+{
+    // The state is the index of every owned particle. A std::set of pointers into
+    // one buffer is sorted by address, so the indices are written in ascending order.
+    state.resize(this->particles.size() * sizeof(uint32_t));
+    uint32_t* indices = reinterpret_cast<uint32_t*>(state.data());
+    for (particle_t* p : this->particles)
+        *indices++ = static_cast<uint32_t>(p - this->pool->base_address());
+}
+
+void StaticParticleEngine::restore_state(const uint8_t* state, size_t size)
+{
+    if (this->pool == nullptr)
+        throw std::runtime_error("Cannot restore uninitialized particle engine (StaticParticleEngine).");
+    if (size % sizeof(uint32_t) != 0)
+        throw std::invalid_argument("State of StaticParticleEngine::restore_state has an invalid size.");
+
+    // The indices are only range checked, looking every particle up in the pool would cost more
+    // than the whole restore. The state is trusted to belong to the checkpoint of the pool.
+    this->particles.clear();
+    const size_t n = size / sizeof(uint32_t);
+    uint32_t prev = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t idx;
+        std::memcpy(&idx, state + i * sizeof(uint32_t), sizeof(uint32_t));
+        if (idx >= this->pool->capacity() || (i > 0 && idx <= prev))
+            throw std::invalid_argument("State of StaticParticleEngine::restore_state must contain strictly ascending particle indices in range of the pool.");
+        this->particles.insert(this->particles.end(), this->pool->at(idx));   // sorted, the hint makes the insertion O(1)
+        prev = idx;
+    }
+}
+
 void StaticParticleEngine::run(const std::atomic_bool& running, void* param)
 {
     // do nothing
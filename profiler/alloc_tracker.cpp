@@ -0,0 +1,237 @@
+#include "alloc_tracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
+namespace
+{
+    constexpr const char* SUBSYSTEM_NAMES[profiler::ALLOC_SUBSYSTEM_COUNT] = {
+        "other", "render", "application", "engine", "pool", "export"
+    };
+
+    // zero-initialized before any allocation of the process, the thread locals need no dynamic initialization
+    std::atomic<uint64_t> allocations[profiler::ALLOC_SUBSYSTEM_COUNT];
+    std::atomic<uint64_t> allocated_bytes[profiler::ALLOC_SUBSYSTEM_COUNT];
+    thread_local profiler::alloc_subsystem_t local_subsystem = profiler::ALLOC_OTHER;
+    thread_local bool local_forbidden = false;
+
+#if PARTICLES_ALLOC_TRACKER
+    [[noreturn]] void forbidden_allocation(std::size_t size) noexcept
+    {
+        // the message must not allocate itself
+        local_forbidden = false;
+        char message[128];
+        std::snprintf(message, sizeof(message), "Forbidden allocation of %zu bytes in a steady-state frame (subsystem \"%s\").\n",
+            size, SUBSYSTEM_NAMES[local_subsystem]);
+        std::fputs(message, stderr);
+        std::fflush(stderr);
+        std::abort();
+    }
+
+    void count(std::size_t size) noexcept
+    {
+        allocations[local_subsystem].fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes[local_subsystem].fetch_add(size, std::memory_order_relaxed);
+        if (local_forbidden)
+            forbidden_allocation(size);
+    }
+
+    void* allocate(std::size_t size) noexcept
+    {
+        count(size);
+        return std::malloc((size > 0) ? size : 1);
+    }
+
+    void* allocate_aligned(std::size_t size, std::size_t alignment) noexcept
+    {
+        count(size);
+        if (size == 0) size = 1;
+#ifdef _WIN32
+        return _aligned_malloc(size, alignment);
+#else
+        void* p = nullptr;
+        return (posix_memalign(&p, std::max(alignment, sizeof(void*)), size) == 0) ? p : nullptr;
+#endif
+    }
+
+    void free_aligned(void* p) noexcept
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+#endif
+};
+
+using namespace profiler;
+
+const char* profiler::alloc_subsystem_name(alloc_subsystem_t subsystem) noexcept
+{
+    return (subsystem < ALLOC_SUBSYSTEM_COUNT) ? SUBSYSTEM_NAMES[subsystem] : "unknown";
+}
+
+alloc_subsystem_t profiler::alloc_subsystem(void) noexcept
+{
+    return local_subsystem;
+}
+
+void profiler::set_alloc_subsystem(alloc_subsystem_t subsystem) noexcept
+{
+    local_subsystem = (subsystem < ALLOC_SUBSYSTEM_COUNT) ? subsystem : ALLOC_OTHER;
+}
+
+void profiler::set_alloc_forbidden(bool forbidden) noexcept
+{
+    local_forbidden = forbidden;
+}
+
+void profiler::alloc_totals(alloc_counts_t counts[ALLOC_SUBSYSTEM_COUNT]) noexcept
+{
+    for (uint32_t i = 0; i < ALLOC_SUBSYSTEM_COUNT; i++)
+    {
+        counts[i].allocations = allocations[i].load(std::memory_order_relaxed);
+        counts[i].bytes = allocated_bytes[i].load(std::memory_order_relaxed);
+    }
+}
+
+AllocFrameTracker::AllocFrameTracker(void)
+{
+    this->init(0);
+}
+
+void AllocFrameTracker::init(uint32_t steady_frame)
+{
+    for (uint32_t i = 0; i < ALLOC_SUBSYSTEM_COUNT; i++)
+    {
+        this->begin[i] = { 0, 0 };
+        this->sum[i] = { 0, 0 };
+        this->max[i] = { 0, 0 };
+    }
+    this->frames = 0;
+    this->allocating_frames = 0;
+    this->steady_frame = steady_frame;
+}
+
+void AllocFrameTracker::begin_frame(void)
+{
+    alloc_totals(this->begin);
+    if (this->steady_frame > 0 && this->frames >= this->steady_frame)
+        set_alloc_forbidden(true);
+}
+
+void AllocFrameTracker::end_frame(void)
+{
+    set_alloc_forbidden(false);
+
+    alloc_counts_t end[ALLOC_SUBSYSTEM_COUNT];
+    alloc_totals(end);
+    bool allocated = false;
+    for (uint32_t i = 0; i < ALLOC_SUBSYSTEM_COUNT; i++)
+    {
+        const alloc_counts_t frame = { end[i].allocations - this->begin[i].allocations, end[i].bytes - this->begin[i].bytes };
+        this->sum[i].allocations += frame.allocations;
+        this->sum[i].bytes += frame.bytes;
+        this->max[i].allocations = std::max(this->max[i].allocations, frame.allocations);
+        this->max[i].bytes = std::max(this->max[i].bytes, frame.bytes);
+        allocated = allocated || (frame.allocations > 0);
+    }
+    this->frames++;
+    if (allocated)
+        this->allocating_frames++;
+}
+
+void AllocFrameTracker::report(std::ostream& os) const
+{
+    alloc_counts_t totals[ALLOC_SUBSYSTEM_COUNT];
+    alloc_totals(totals);
+    const double n = (this->frames > 0) ? static_cast<double>(this->frames) : 1.0;
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "Allocations: %llu frames, %llu of them allocated\n",
+        static_cast<unsigned long long>(this->frames), static_cast<unsigned long long>(this->allocating_frames));
+    os << line;
+    std::snprintf(line, sizeof(line), "    %-12s %14s %16s %14s %14s %16s %16s\n",
+        "subsystem", "total", "total bytes", "per frame", "max per frame", "bytes per frame", "max bytes/frame");
+    os << line;
+    for (uint32_t i = 0; i < ALLOC_SUBSYSTEM_COUNT; i++)
+    {
+        std::snprintf(line, sizeof(line), "    %-12s %14llu %16llu %14.2f %14llu %16.1f %16llu\n", SUBSYSTEM_NAMES[i],
+            static_cast<unsigned long long>(totals[i].allocations), static_cast<unsigned long long>(totals[i].bytes),
+            this->sum[i].allocations / n, static_cast<unsigned long long>(this->max[i].allocations),
+            this->sum[i].bytes / n, static_cast<unsigned long long>(this->max[i].bytes));
+        os << line;
+    }
+}
+
+void AllocFrameTracker::write_json(std::ostream& os) const
+{
+    const double n = (this->frames > 0) ? static_cast<double>(this->frames) : 1.0;
+    os << "{ \"frames\": " << this->frames << ", \"allocating_frames\": " << this->allocating_frames;
+    for (uint32_t i = 0; i < ALLOC_SUBSYSTEM_COUNT; i++)
+    {
+        os << ", \"" << SUBSYSTEM_NAMES[i] << "\": { \"per_frame\": " << this->sum[i].allocations / n
+           << ", \"max\": " << this->max[i].allocations
+           << ", \"bytes_per_frame\": " << this->sum[i].bytes / n
+           << ", \"max_bytes\": " << this->max[i].bytes << " }";
+    }
+    os << " }";
+}
+
+#if PARTICLES_ALLOC_TRACKER
+// ------------------------ GLOBAL OPERATOR NEW AND DELETE ------------------------
+
+void* operator new(std::size_t size)
+{
+    void* p = allocate(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* p = allocate(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept    { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept  { return allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    void* p = allocate_aligned(size, static_cast<std::size_t>(alignment));
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    void* p = allocate_aligned(size, static_cast<std::size_t>(alignment));
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept    { return allocate_aligned(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept  { return allocate_aligned(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* p) noexcept                                          { std::free(p); }
+void operator delete[](void* p) noexcept                                        { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept                             { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept                           { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept                   { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept                 { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept                        { free_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                      { free_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept           { free_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept         { free_aligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept     { free_aligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept   { free_aligned(p); }
+#endif
\ No newline at end of file
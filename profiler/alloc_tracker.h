@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// The allocation tracker replaces the global operator new and delete, so it is opt-in: -DPARTICLES_ALLOC_TRACKER=1
+// (CMake option PARTICLES_ALLOC_TRACKER). Without it the tags compile to nothing and no allocation is counted.
+#ifndef PARTICLES_ALLOC_TRACKER
+    #define PARTICLES_ALLOC_TRACKER 0
+#endif
+
+/**
+*   Allocations are counted per subsystem, the subsystem of an allocation is the tag of the allocating thread, e.g.
+*       particle_t* ParticlePool::allocate(void)
+*       {
+*           ALLOC_SCOPE(profiler::ALLOC_POOL);
+*           ...
+*       }
+*   ALLOC_THREAD tags a whole thread, scopes override the tag of their thread until they end.
+*   NOTE: Only allocations through operator new are counted, malloc of C libraries (GLFW, the Vulkan driver) is not.
+*/
+#if PARTICLES_ALLOC_TRACKER
+    #define ALLOC_CONCAT_IMPL(a, b) a##b
+    #define ALLOC_CONCAT(a, b) ALLOC_CONCAT_IMPL(a, b)
+    #define ALLOC_SCOPE(subsystem) profiler::AllocScope ALLOC_CONCAT(__alloc_scope_, __LINE__)(subsystem)
+    #define ALLOC_THREAD(subsystem) profiler::set_alloc_subsystem(subsystem)
+#else
+    #define ALLOC_SCOPE(subsystem)
+    #define ALLOC_THREAD(subsystem)
+#endif
+
+namespace profiler
+{
+    enum alloc_subsystem_t : uint32_t
+    {
+        ALLOC_OTHER = 0,        // untagged threads and scopes
+        ALLOC_RENDER = 1,       // render thread
+        ALLOC_APPLICATION = 2,  // application thread
+        ALLOC_ENGINE = 3,       // engine threads, spawns and kills
+        ALLOC_POOL = 4,         // particle pool
+        ALLOC_EXPORT = 5,       // frame export workers
+        ALLOC_SUBSYSTEM_COUNT = 6
+    };
+
+    struct alloc_counts_t
+    {
+        uint64_t allocations;
+        uint64_t bytes;
+    };
+
+    /** @return 'true' if the tracker has been compiled in. */
+    constexpr bool alloc_tracking(void) noexcept    { return PARTICLES_ALLOC_TRACKER != 0; }
+
+    /** @return The name of @param subsystem, e.g. "render". */
+    const char* alloc_subsystem_name(alloc_subsystem_t subsystem) noexcept;
+
+    /** @return The tag of the calling thread. */
+    alloc_subsystem_t alloc_subsystem(void) noexcept;
+
+    /** @brief Tags the allocations of the calling thread with @param subsystem. */
+    void set_alloc_subsystem(alloc_subsystem_t subsystem) noexcept;
+
+    /**
+    *   @brief Forbids allocations of the calling thread. A forbidden allocation prints its subsystem and size
+    *          and aborts, so a debugger stops at the allocation.
+    */
+    void set_alloc_forbidden(bool forbidden) noexcept;
+
+    /** @brief Copies the allocations of every subsystem since the start of the process into @param counts. */
+    void alloc_totals(alloc_counts_t counts[ALLOC_SUBSYSTEM_COUNT]) noexcept;
+
+    /**
+    *   Class: AllocScope
+    *   @brief Tags the allocations of its thread with a subsystem until it is destroyed.
+    */
+    class AllocScope
+    {
+    private:
+        alloc_subsystem_t previous;
+
+    public:
+        explicit AllocScope(alloc_subsystem_t subsystem) noexcept : previous(alloc_subsystem())  { set_alloc_subsystem(subsystem); }
+        ~AllocScope(void)                                                                       { set_alloc_subsystem(this->previous); }
+
+        AllocScope(const AllocScope&) = delete;
+        AllocScope& operator= (const AllocScope&) = delete;
+    };
+
+    /**
+    *   Class: AllocFrameTracker
+    *   @brief Counts the allocations of every subsystem per frame, the frames are delimited by the thread of the
+    *          frame loop. Allocations of other threads during a frame count to the frame as well.
+    *          Optionally the frame loop must not allocate after a number of warm-up frames (steady state).
+    */
+    class AllocFrameTracker
+    {
+    private:
+        alloc_counts_t begin[ALLOC_SUBSYSTEM_COUNT];
+        alloc_counts_t sum[ALLOC_SUBSYSTEM_COUNT];
+        alloc_counts_t max[ALLOC_SUBSYSTEM_COUNT];
+        uint64_t frames;
+        uint64_t allocating_frames;     // frames with at least one allocation of any subsystem
+        uint32_t steady_frame;
+
+    public:
+        AllocFrameTracker(void);
+
+        /**
+        *   @brief Resets the tracker.
+        *   @param steady_frame: First frame that must not allocate on the thread of the frame loop, 0 = allocations are allowed
+        */
+        void init(uint32_t steady_frame);
+
+        /** @brief Begins a frame, must be called on the thread of the frame loop. */
+        void begin_frame(void);
+
+        /** @brief Ends the frame that has been begun on the calling thread. */
+        void end_frame(void);
+
+        /** @brief Writes a table of the allocations per subsystem. */
+        void report(std::ostream& os) const;
+
+        /** @brief Writes the allocations per subsystem as JSON object. */
+        void write_json(std::ostream& os) const;
+
+        uint64_t frame_count(void) const noexcept   { return this->frames; }
+    };
+};
\ No newline at end of file
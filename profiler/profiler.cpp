@@ -0,0 +1,219 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct zone_event_t
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    /**
+    *   The ring of one thread. Only its thread writes events, 'head' is the total number of written
+    *   events and is published after the event has been written. A reader copies the ring and
+    *   afterwards discards every event that may have been overwritten during the copy.
+    */
+    struct thread_ring_t
+    {
+        uint32_t tid;
+        char name[32];                      // guarded by the mutex of the registry
+        bool exited;                        // guarded by the mutex of the registry
+        std::atomic<uint64_t> head;
+        zone_event_t events[profiler::RING_SIZE];
+    };
+
+    struct registry_t
+    {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<thread_ring_t>> rings;  // rings outlive their threads, so that they can still be dumped
+        uint32_t next_tid;
+
+        // clock calibration, the ticks are converted to microseconds with the steady clock
+        uint64_t tick0;
+        std::chrono::steady_clock::time_point time0;
+    };
+
+    static_assert((profiler::RING_SIZE & (profiler::RING_SIZE - 1)) == 0, "profiler::RING_SIZE must be a power of 2.");
+
+    std::atomic_bool recording(true);
+    thread_local thread_ring_t* local_ring = nullptr;
+    thread_local bool thread_exited = false;   // zones of destructors that run after the ring has been released are dropped
+
+    // never destroyed, threads may still record zones during static destruction
+    registry_t& registry(void)
+    {
+        static registry_t* r = []()
+        {
+            registry_t* r = new registry_t;
+            r->tick0 = profiler::now();
+            r->time0 = std::chrono::steady_clock::now();
+            r->next_tid = 1;
+            return r;
+        }();
+        return *r;
+    }
+    const registry_t& startup_registry = registry();   // calibrates the clock before the first zone
+
+    // releases the ring of its thread at thread exit, the oldest rings of exited threads are freed
+    struct ring_owner_t
+    {
+        ~ring_owner_t(void)
+        {
+            registry_t& r = registry();
+            std::lock_guard<std::mutex> lock(r.mtx);
+            local_ring->exited = true;
+            local_ring = nullptr;
+            thread_exited = true;
+
+            const size_t n_exited = std::count_if(r.rings.begin(), r.rings.end(),
+                [](const std::unique_ptr<thread_ring_t>& ring) { return ring->exited; });
+            if (n_exited > profiler::MAX_EXITED_RINGS)
+            {
+                r.rings.erase(std::find_if(r.rings.begin(), r.rings.end(),
+                    [](const std::unique_ptr<thread_ring_t>& ring) { return ring->exited; }));
+            }
+        }
+    };
+
+    thread_ring_t* register_thread(void)
+    {
+        registry_t& r = registry();
+        std::unique_ptr<thread_ring_t> ring(new thread_ring_t);
+        ring->name[0] = '\0';
+        ring->exited = false;
+        ring->head.store(0, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(r.mtx);
+            ring->tid = r.next_tid++;
+            local_ring = ring.get();
+            r.rings.push_back(std::move(ring));
+        }
+        thread_local ring_owner_t owner;
+        return local_ring;
+    }
+
+    void write_json_string(std::ostream& os, const char* str)
+    {
+        os << '"';
+        for (; *str != '\0'; str++)
+        {
+            if (*str == '"' || *str == '\\') os << '\\';
+            if (static_cast<unsigned char>(*str) >= 0x20) os << *str;
+        }
+        os << '"';
+    }
+}
+
+bool profiler::enabled(void) noexcept
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+void profiler::set_enabled(bool enabled) noexcept
+{
+    recording.store(enabled, std::memory_order_relaxed);
+}
+
+void profiler::record(const char* name, uint64_t begin, uint64_t end) noexcept
+{
+    thread_ring_t* ring = local_ring;
+    if (ring == nullptr)
+    {
+        if (thread_exited) return;
+        try
+        {
+            ring = register_thread();
+        }
+        catch (std::exception&)
+        {
+            return;     // out of memory, the zone is lost
+        }
+    }
+
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head & (RING_SIZE - 1)] = { name, begin, end };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void profiler::set_thread_name(const char* name)
+{
+    if (thread_exited) return;
+    thread_ring_t* ring = (local_ring != nullptr) ? local_ring : register_thread();
+    std::lock_guard<std::mutex> lock(registry().mtx);
+    std::strncpy(ring->name, name, sizeof(ring->name) - 1);
+    ring->name[sizeof(ring->name) - 1] = '\0';
+}
+
+void profiler::dump_chrome_trace(std::ostream& os)
+{
+    registry_t& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+
+    // ticks per microsecond, measured over the whole lifetime of the profiler
+    const uint64_t tick1 = now();
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - r.time0).count();
+    const double ticks_per_us = (us > 0.0 && tick1 > r.tick0) ? (tick1 - r.tick0) / us : 1.0;
+
+    // microseconds with a nanosecond resolution
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision(3);
+    os << std::fixed;
+
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    std::vector<zone_event_t> events;
+    for (const std::unique_ptr<thread_ring_t>& ring : r.rings)
+    {
+        os << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+        write_json_string(os, (ring->name[0] != '\0') ? ring->name : ("thread " + std::to_string(ring->tid)).c_str());
+        os << "}}";
+        first = false;
+
+        // copy the ring, the events that have been overwritten in the meantime are dropped
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        const uint64_t n = std::min<uint64_t>(head, RING_SIZE);
+        events.resize(n);
+        for (uint64_t i = 0; i < n; i++)
+            events[i] = ring->events[(head - n + i) & (RING_SIZE - 1)];
+
+        // event j may be overwritten as soon as event j + RING_SIZE is being written
+        const uint64_t head_after = ring->head.load(std::memory_order_acquire);
+        const uint64_t first_valid = (head_after + 1 > RING_SIZE) ? head_after + 1 - RING_SIZE : 0;
+        const uint64_t overwritten = std::min<uint64_t>((first_valid > head - n) ? first_valid - (head - n) : 0, n);
+
+        for (uint64_t i = overwritten; i < n; i++)
+        {
+            const zone_event_t& e = events[i];
+            const double ts = (e.begin >= r.tick0) ? (e.begin - r.tick0) / ticks_per_us : 0.0;
+            const double dur = (e.end >= e.begin) ? (e.end - e.begin) / ticks_per_us : 0.0;
+            os << ",\n{\"name\":";
+            write_json_string(os, e.name);
+            os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+        }
+    }
+    os << "\n]}" << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void profiler::dump_chrome_trace(const char* path)
+{
+    std::ofstream file(path);
+    if (!file)
+        throw std::runtime_error("Failed to create trace file \"" + std::string(path) + "\".");
+    dump_chrome_trace(file);
+    if (!file)
+        throw std::runtime_error("Failed to write trace file \"" + std::string(path) + "\".");
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// The profiler is cheap enough to stay compiled in, it can be removed completely with -DPARTICLES_PROFILER=0.
+#ifndef PARTICLES_PROFILER
+    #define PARTICLES_PROFILER 1
+#endif
+
+// The time stamp counter is used on x86, other architectures use std::chrono::steady_clock.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define PROFILER_RDTSC 1
+#else
+    #include <chrono>
+    #define PROFILER_RDTSC 0
+#endif
+
+/**
+*   Scoped profiling zones, e.g.
+*       void ParticlesApp::draw_frame(void)
+*       {
+*           PROFILE_ZONE("ParticlesApp::draw_frame");
+*           ...
+*       }
+*   Every thread writes its zones into its own ring buffer without any lock, the rings keep
+*   the last 'RING_SIZE' zones of every thread. 'profiler::dump_chrome_trace' writes them as a
+*   Chrome trace, that can be opened with chrome://tracing or https://ui.perfetto.dev.
+*   A ring costs RING_SIZE * 24 bytes (1.5 MiB) and is allocated by the first zone or name of a thread.
+*   When the thread exits its ring is kept for the trace, only the rings of the last 'MAX_EXITED_RINGS'
+*   exited threads are kept, older ones are freed. So the memory is bounded by the living threads + MAX_EXITED_RINGS.
+*   NOTE: The name of a zone is not copied, it must be a string literal.
+*/
+#if PARTICLES_PROFILER
+    #define PROFILER_CONCAT_IMPL(a, b) a##b
+    #define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+    #define PROFILE_ZONE(name) profiler::Zone PROFILER_CONCAT(__profile_zone_, __LINE__)(name)
+    #define PROFILE_THREAD(name) profiler::set_thread_name(name)
+#else
+    #define PROFILE_ZONE(name)
+    #define PROFILE_THREAD(name)
+#endif
+
+namespace profiler
+{
+    /** @brief Number of zones that are kept per thread, must be a power of 2. */
+    constexpr uint32_t RING_SIZE = 1 << 16;
+
+    /** @brief Number of rings of exited threads that are kept, so that their zones can still be dumped. */
+    constexpr uint32_t MAX_EXITED_RINGS = 8;
+
+    /** @return The current time in ticks of the profiler clock. */
+    inline uint64_t now(void) noexcept
+    {
+#if PROFILER_RDTSC
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /** @return 'true' if zones are recorded, they are recorded by default. */
+    bool enabled(void) noexcept;
+
+    /** @brief Enables or disables recording of zones, disabled zones only cost a branch. */
+    void set_enabled(bool enabled) noexcept;
+
+    /** @brief Records a zone of the calling thread, used by 'profiler::Zone'. */
+    void record(const char* name, uint64_t begin, uint64_t end) noexcept;
+
+    /**
+    *   @brief Names the calling thread in the trace, e.g. "render" or "application".
+    *   @param name: Name of the thread, it is copied and truncated to 31 characters.
+    */
+    void set_thread_name(const char* name);
+
+    /**
+    *   @brief Writes the recorded zones of every thread as Chrome trace JSON. The zones are
+    *          not removed, recording continues while the rings are read.
+    *   @param os: Stream to write to
+    */
+    void dump_chrome_trace(std::ostream& os);
+
+    /**
+    *   @brief Writes the recorded zones of every thread as Chrome trace JSON into a file.
+    *   @param path: Path of the JSON file
+    */
+    void dump_chrome_trace(const char* path);
+
+    /**
+    *   Class: Zone
+    *   @brief Records the time between its construction and destruction as a zone.
+    */
+    class Zone
+    {
+    private:
+        const char* name;
+        uint64_t begin;
+
+    public:
+        explicit Zone(const char* name) noexcept : name(name), begin(enabled() ? now() : 0) {}
+        ~Zone(void)                                 { if (this->begin != 0) record(this->name, this->begin, now()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator= (const Zone&) = delete;
+    };
+};
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "noise.h"
+#include "../simd/simd.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+using namespace simd;
+
+namespace
+{
+    /**
+    *   Permutation of the noise lattice, duplicated to 512 entries so that perm[perm[x] + y]
+    *   never has to be wrapped. Stored as int32 to be used by SIMD gathers.
+    */
+    struct lattice_t
+    {
+        int32_t perm[512];
+
+        lattice_t(void) { this->seed(0); }
+
+        void seed(uint32_t seed)
+        {
+            // Fisher-Yates with std::minstd_rand, std::shuffle is implementation-defined
+            // and would give different lattices on different standard libraries.
+            std::minstd_rand engine(seed);
+            for (int32_t i = 0; i < 256; i++)
+                this->perm[i] = i;
+            for (int32_t i = 255; i > 0; i--)
+            {
+                const int32_t j = static_cast<int32_t>(engine() % static_cast<uint32_t>(i + 1));
+                const int32_t tmp = this->perm[i];
+                this->perm[i] = this->perm[j];
+                this->perm[j] = tmp;
+            }
+            for (int32_t i = 0; i < 256; i++)
+                this->perm[256 + i] = this->perm[i];
+        }
+    } lattice;
+
+    // The 12 edge directions of a cube, padded to 16 to select them with '& 15'.
+    const float GRAD_X[16] = { 1.0f, -1.0f,  1.0f, -1.0f, 1.0f, -1.0f,  1.0f, -1.0f, 0.0f,  0.0f,  0.0f,  0.0f, 1.0f,  0.0f, -1.0f,  0.0f };
+    const float GRAD_Y[16] = { 1.0f,  1.0f, -1.0f, -1.0f, 0.0f,  0.0f,  0.0f,  0.0f, 1.0f, -1.0f,  1.0f, -1.0f, 1.0f, -1.0f,  1.0f, -1.0f };
+    const float GRAD_Z[16] = { 0.0f,  0.0f,  0.0f,  0.0f, 1.0f,  1.0f, -1.0f, -1.0f, 1.0f,  1.0f, -1.0f, -1.0f, 0.0f,  1.0f,  0.0f, -1.0f };
+
+    // constant offsets of the three potential fields of the curl noise, to decorrelate them
+    const float CURL_OFFSET_Y[3] = { 31.416f, 47.853f, 12.793f };
+    const float CURL_OFFSET_Z[3] = { -23.137f, 9.731f, 71.291f };
+
+    // lattice wrap mask of the non-periodic noise
+    constexpr int32_t DEFAULT_WRAP = 255;
+
+    struct corner_t
+    {
+        float8 g[3];    // gradient
+        float8 v;       // gradient dot offset
+    };
+
+    inline corner_t corner(int8 hash, float8 fx, float8 fy, float8 fz) noexcept
+    {
+        const int8 h = hash & set1i(15);
+        corner_t c;
+        c.g[0] = gather(GRAD_X, h);
+        c.g[1] = gather(GRAD_Y, h);
+        c.g[2] = gather(GRAD_Z, h);
+        c.v = dot3(c.g[0], c.g[1], c.g[2], fx, fy, fz);
+        return c;
+    }
+
+    /**
+    *   @brief Improved Perlin noise with quintic fade and analytic derivatives for 8 points.
+    *   @param wrap: Lattice coordinates are wrapped with this mask, the noise is periodic with wrap + 1 cells.
+    */
+    inline void noise8(float8 x, float8 y, float8 z, int32_t wrap, float8& value, float8 d[3]) noexcept
+    {
+        const float8 x0 = floor(x), y0 = floor(y), z0 = floor(z);
+        const float8 fx = x - x0, fy = y - y0, fz = z - z0;
+
+        const int8 mask = set1i(wrap), one = set1i(1);
+        const int8 ix = to_int(x0) & mask, iy = to_int(y0) & mask, iz = to_int(z0) & mask;
+        const int8 ix1 = (ix + one) & mask, iy1 = (iy + one) & mask, iz1 = (iz + one) & mask;
+
+        // hash the 8 lattice corners: perm[perm[perm[x] + y] + z]
+        const int8 hx0 = gather(lattice.perm, ix), hx1 = gather(lattice.perm, ix1);
+        const int8 h00 = gather(lattice.perm, hx0 + iy), h10 = gather(lattice.perm, hx1 + iy);
+        const int8 h01 = gather(lattice.perm, hx0 + iy1), h11 = gather(lattice.perm, hx1 + iy1);
+
+        const float8 ox = fx - 1.0f, oy = fy - 1.0f, oz = fz - 1.0f;
+        const corner_t a = corner(gather(lattice.perm, h00 + iz),  fx, fy, fz);    // 000
+        const corner_t b = corner(gather(lattice.perm, h10 + iz),  ox, fy, fz);    // 100
+        const corner_t c = corner(gather(lattice.perm, h01 + iz),  fx, oy, fz);    // 010
+        const corner_t e = corner(gather(lattice.perm, h11 + iz),  ox, oy, fz);    // 110
+        const corner_t f = corner(gather(lattice.perm, h00 + iz1), fx, fy, oz);    // 001
+        const corner_t g = corner(gather(lattice.perm, h10 + iz1), ox, fy, oz);    // 101
+        const corner_t h = corner(gather(lattice.perm, h01 + iz1), fx, oy, oz);    // 011
+        const corner_t k = corner(gather(lattice.perm, h11 + iz1), ox, oy, oz);    // 111
+
+        // quintic fade u = 6t^5 - 15t^4 + 10t^3 and its derivative du = 30t^4 - 60t^3 + 30t^2
+        auto fade = [](float8 t) { return t * t * t * fmadd(t, fmadd(t, set1(6.0f), set1(-15.0f)), set1(10.0f)); };
+        auto fade_d = [](float8 t) { return set1(30.0f) * t * t * fmadd(t, t - 2.0f, set1(1.0f)); };
+        const float8 u[3] = { fade(fx), fade(fy), fade(fz) };
+        const float8 du[3] = { fade_d(fx), fade_d(fy), fade_d(fz) };
+
+        // trilinear interpolation written as a polynomial in u
+        const float8 k0 = a.v;
+        const float8 k1 = b.v - a.v;
+        const float8 k2 = c.v - a.v;
+        const float8 k3 = f.v - a.v;
+        const float8 k4 = a.v - b.v - c.v + e.v;
+        const float8 k5 = a.v - c.v - f.v + h.v;
+        const float8 k6 = a.v - b.v - f.v + g.v;
+        const float8 k7 = k.v - a.v + b.v + c.v - e.v + f.v - g.v - h.v;
+
+        value = k0 + k1 * u[0] + k2 * u[1] + k3 * u[2] + k4 * u[0] * u[1] + k5 * u[1] * u[2] + k6 * u[2] * u[0] + k7 * u[0] * u[1] * u[2];
+
+        // derivative: interpolated gradients + derivative of the interpolation weights
+        const float8 uxy = u[0] * u[1], uyz = u[1] * u[2], uzx = u[2] * u[0], uxyz = uxy * u[2];
+        for (int i = 0; i < 3; i++)
+        {
+            d[i] = a.g[i] + u[0] * (b.g[i] - a.g[i]) + u[1] * (c.g[i] - a.g[i]) + u[2] * (f.g[i] - a.g[i])
+                 + uxy * (a.g[i] - b.g[i] - c.g[i] + e.g[i])
+                 + uyz * (a.g[i] - c.g[i] - f.g[i] + h.g[i])
+                 + uzx * (a.g[i] - b.g[i] - f.g[i] + g.g[i])
+                 + uxyz * (k.g[i] - a.g[i] + b.g[i] + c.g[i] - e.g[i] + f.g[i] - g.g[i] - h.g[i]);
+        }
+        d[0] = d[0] + du[0] * (k1 + k4 * u[1] + k6 * u[2] + k7 * uyz);
+        d[1] = d[1] + du[1] * (k2 + k5 * u[2] + k4 * u[0] + k7 * uzx);
+        d[2] = d[2] + du[2] * (k3 + k6 * u[0] + k5 * u[1] + k7 * uxy);
+    }
+
+    /** @brief Curl of the vector potential (N(p), N(p + offset_y), N(p + offset_z)) for 8 points. */
+    inline void curl8(float8 x, float8 y, float8 z, int32_t wrap, float8 curl[3]) noexcept
+    {
+        float8 v, dpx[3], dpy[3], dpz[3];
+        noise8(x, y, z, wrap, v, dpx);
+        noise8(x + CURL_OFFSET_Y[0], y + CURL_OFFSET_Y[1], z + CURL_OFFSET_Y[2], wrap, v, dpy);
+        noise8(x + CURL_OFFSET_Z[0], y + CURL_OFFSET_Z[1], z + CURL_OFFSET_Z[2], wrap, v, dpz);
+
+        curl[0] = dpz[1] - dpy[2];
+        curl[1] = dpx[2] - dpz[0];
+        curl[2] = dpy[0] - dpx[1];
+    }
+
+    void curl_noise_wrapped(const float* x, const float* y, const float* z, uint32_t n, int32_t wrap, float* cx, float* cy, float* cz)
+    {
+        float8 curl[3];
+        for (uint32_t i = 0; i < n; i += WIDTH)
+        {
+            const uint32_t m = (n - i < WIDTH) ? n - i : WIDTH;
+            if (m == WIDTH)
+            {
+                curl8(load(x + i), load(y + i), load(z + i), wrap, curl);
+                store(cx + i, curl[0]); store(cy + i, curl[1]); store(cz + i, curl[2]);
+            }
+            else
+            {
+                curl8(load_partial(x + i, m, 0.0f), load_partial(y + i, m, 0.0f), load_partial(z + i, m, 0.0f), wrap, curl);
+                store_partial(cx + i, curl[0], m); store_partial(cy + i, curl[1], m); store_partial(cz + i, curl[2], m);
+            }
+        }
+    }
+
+    bool is_power_of_two(uint32_t x) { return x != 0 && (x & (x - 1)) == 0; }
+};
+
+void __internal_random::set_noise_seed(uint32_t seed)
+{
+    lattice.seed(seed);
+}
+
+float __internal_random::gradient_noise(float x, float y, float z)
+{
+    float value;
+    gradient_noise(&x, &y, &z, 1, &value, nullptr, nullptr, nullptr);
+    return value;
+}
+
+float __internal_random::gradient_noise(float x, float y, float z, float& dx, float& dy, float& dz)
+{
+    float value;
+    gradient_noise(&x, &y, &z, 1, &value, &dx, &dy, &dz);
+    return value;
+}
+
+void __internal_random::gradient_noise(const float* x, const float* y, const float* z, uint32_t n, float* value, float* dx, float* dy, float* dz)
+{
+    float8 v, d[3];
+    for (uint32_t i = 0; i < n; i += WIDTH)
+    {
+        const uint32_t m = (n - i < WIDTH) ? n - i : WIDTH;
+        if (m == WIDTH)
+            noise8(load(x + i), load(y + i), load(z + i), DEFAULT_WRAP, v, d);
+        else
+            noise8(load_partial(x + i, m, 0.0f), load_partial(y + i, m, 0.0f), load_partial(z + i, m, 0.0f), DEFAULT_WRAP, v, d);
+
+        if (value != nullptr)
+            store_partial(value + i, v, m);
+        if (dx != nullptr)
+        {
+            store_partial(dx + i, d[0], m);
+            store_partial(dy + i, d[1], m);
+            store_partial(dz + i, d[2], m);
+        }
+    }
+}
+
+void __internal_random::curl_noise(const float* x, const float* y, const float* z, uint32_t n, float* cx, float* cy, float* cz)
+{
+    curl_noise_wrapped(x, y, z, n, DEFAULT_WRAP, cx, cy, cz);
+}
+
+// ------------------------ CURL NOISE VOLUME ------------------------
+
+__internal_random::CurlNoiseVolume::CurlNoiseVolume(void)
+{
+    this->_resolution = 0;
+    this->world_size = 0.0f;
+}
+
+void __internal_random::CurlNoiseVolume::build(uint32_t resolution, uint32_t period, float world_size)
+{
+    if (!is_power_of_two(resolution) || resolution > 1024)
+        throw std::invalid_argument("Resolution of CurlNoiseVolume::build must be a power of 2 and at most 1024.");
+    if (!is_power_of_two(period) || period > 256)
+        throw std::invalid_argument("Period of CurlNoiseVolume::build must be a power of 2 and at most 256.");
+    if (world_size <= 0.0f)
+        throw std::invalid_argument("World size of CurlNoiseVolume::build must be bigger than 0.");
+
+    const size_t size = static_cast<size_t>(resolution) * resolution * resolution;
+    this->volume_x.resize(size);
+    this->volume_y.resize(size);
+    this->volume_z.resize(size);
+
+    // Sample one row (along x) at a time. The lattice is wrapped with the period
+    // and a tile covers exactly 'period' cells, so the volume tiles without seams.
+    const float step = static_cast<float>(period) / static_cast<float>(resolution);
+    std::vector<float> xs(resolution), ys(resolution), zs(resolution);
+    for (uint32_t i = 0; i < resolution; i++)
+        xs[i] = static_cast<float>(i) * step;
+
+    for (uint32_t z = 0; z < resolution; z++)
+    {
+        for (uint32_t y = 0; y < resolution; y++)
+        {
+            std::fill(ys.begin(), ys.end(), static_cast<float>(y) * step);
+            std::fill(zs.begin(), zs.end(), static_cast<float>(z) * step);
+            const size_t row = (static_cast<size_t>(z) * resolution + y) * resolution;
+            curl_noise_wrapped(xs.data(), ys.data(), zs.data(), resolution, static_cast<int32_t>(period) - 1,
+                               this->volume_x.data() + row, this->volume_y.data() + row, this->volume_z.data() + row);
+        }
+    }
+
+    this->_resolution = resolution;
+    this->world_size = world_size;
+}
+
+void __internal_random::CurlNoiseVolume::clear(void)
+{
+    this->volume_x.clear();
+    this->volume_y.clear();
+    this->volume_z.clear();
+    this->_resolution = 0;
+    this->world_size = 0.0f;
+}
+
+void __internal_random::CurlNoiseVolume::sample(const float* x, const float* y, const float* z, uint32_t n, float* cx, float* cy, float* cz) const
+{
+    if (!this->built())
+        throw std::runtime_error("CurlNoiseVolume must be built before it can be sampled.");
+
+    const float8 scale = set1(static_cast<float>(this->_resolution) / this->world_size);
+    const int8 mask = set1i(static_cast<int32_t>(this->_resolution) - 1), one = set1i(1);
+    const int8 res = set1i(static_cast<int32_t>(this->_resolution));
+    const float* channels[3] = { this->volume_x.data(), this->volume_y.data(), this->volume_z.data() };
+    float* out[3] = { cx, cy, cz };
+
+    for (uint32_t i = 0; i < n; i += WIDTH)
+    {
+        const uint32_t m = (n - i < WIDTH) ? n - i : WIDTH;
+        const float8 gx = load_partial(x + i, m, 0.0f) * scale;
+        const float8 gy = load_partial(y + i, m, 0.0f) * scale;
+        const float8 gz = load_partial(z + i, m, 0.0f) * scale;
+        const float8 x0 = floor(gx), y0 = floor(gy), z0 = floor(gz);
+        const float8 tx = gx - x0, ty = gy - y0, tz = gz - z0;
+
+        const int8 ix0 = to_int(x0) & mask, iy0 = to_int(y0) & mask, iz0 = to_int(z0) & mask;
+        const int8 ix1 = (ix0 + one) & mask, iy1 = (iy0 + one) & mask, iz1 = (iz0 + one) & mask;
+
+        // linear indices of the 4 rows that contain the 8 corners
+        const int8 r00 = (iz0 * res + iy0) * res, r10 = (iz0 * res + iy1) * res;
+        const int8 r01 = (iz1 * res + iy0) * res, r11 = (iz1 * res + iy1) * res;
+
+        for (int c = 0; c < 3; c++)
+        {
+            const float* v = channels[c];
+            const float8 c00 = gather(v, r00 + ix0) + tx * (gather(v, r00 + ix1) - gather(v, r00 + ix0));
+            const float8 c10 = gather(v, r10 + ix0) + tx * (gather(v, r10 + ix1) - gather(v, r10 + ix0));
+            const float8 c01 = gather(v, r01 + ix0) + tx * (gather(v, r01 + ix1) - gather(v, r01 + ix0));
+            const float8 c11 = gather(v, r11 + ix0) + tx * (gather(v, r11 + ix1) - gather(v, r11 + ix0));
+            const float8 c0 = c00 + ty * (c10 - c00);
+            const float8 c1 = c01 + ty * (c11 - c01);
+            store_partial(out[c] + i, c0 + tz * (c1 - c0), m);
+        }
+    }
+}
\ No newline at end of file
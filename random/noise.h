@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace __internal_random
+{
+    /**
+    *   @brief Permutes the lattice of the gradient noise with a seed. The default lattice (without calling this
+    *          function) is always the same, so noise is reproducible across runs.
+    *   NOTE: Must not be called while noise is evaluated on another thread.
+    */
+    void set_noise_seed(uint32_t seed);
+
+    /** @return 3D gradient (Perlin) noise in the range of about [-1, 1] at one point. */
+    float gradient_noise(float x, float y, float z);
+
+    /** @return 3D gradient noise at one point and its analytic gradient via @param dx, dy, dz. */
+    float gradient_noise(float x, float y, float z, float& dx, float& dy, float& dz);
+
+    /**
+    *   @brief Evaluates 3D gradient noise with analytic derivatives for @param n points.
+    *          8 points are evaluated per SIMD call.
+    *   @param x, y, z: Arrays with the sample positions
+    *   @param value: Output array for the noise values, may be a nullptr
+    *   @param dx, dy, dz: Output arrays for the gradient, may be nullptrs (all three or none)
+    */
+    void gradient_noise(const float* x, const float* y, const float* z, uint32_t n, float* value, float* dx, float* dy, float* dz);
+
+    /**
+    *   @brief Evaluates divergence-free curl noise for @param n points. The result is the curl of a vector
+    *          potential built from three decorrelated gradient noise fields, it is computed from the
+    *          analytic derivatives and costs three gradient noise evaluations per point.
+    *   @param cx, cy, cz: Output arrays for the curl noise vectors
+    */
+    void curl_noise(const float* x, const float* y, const float* z, uint32_t n, float* cx, float* cy, float* cz);
+
+    /**
+    *   @brief A cached, periodic 3D volume of curl noise. Sampling the volume is a trilinear lookup
+    *          and much cheaper than evaluating curl noise directly. The volume tiles seamlessly,
+    *          as the noise that it is built from is periodic with the volume's size.
+    */
+    class CurlNoiseVolume
+    {
+    private:
+        uint32_t _resolution;
+        float world_size;
+        std::vector<float> volume_x, volume_y, volume_z;
+
+    public:
+        CurlNoiseVolume(void);
+
+        /**
+        *   @brief Builds the volume.
+        *   @param resolution: Number of samples along each axis, must be a power of 2
+        *   @param period: Number of noise lattice cells along each axis, must be a power of 2 and at most 256.
+        *                  Higher values give more detail per tile.
+        *   @param world_size: Size of one tile in world units along each axis
+        */
+        void build(uint32_t resolution, uint32_t period, float world_size);
+
+        /** @brief Frees the volume. */
+        void clear(void);
+
+        /** @brief Trilinearly samples the volume for @param n points, 8 points per SIMD call. */
+        void sample(const float* x, const float* y, const float* z, uint32_t n, float* cx, float* cy, float* cz) const;
+
+        /** @return The number of samples along each axis, 0 if the volume has not been built. */
+        uint32_t resolution(void) const noexcept    { return this->_resolution; }
+
+        /** @return 'true' if the volume has been built. */
+        bool built(void) const noexcept             { return (this->_resolution != 0); }
+    };
+};
\ No newline at end of file
@@ -1,8 +1,19 @@
 #include "random.h"
 
 std::random_device rd;
-std::seed_seq seed{ rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd() };
-std::minstd_rand rand_engine(seed);
+uint64_t rand_seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+std::minstd_rand rand_engine(static_cast<std::minstd_rand::result_type>(rand_seed % std::minstd_rand::modulus));
+
+void __internal_random::seed(uint64_t seed)
+{
+    rand_seed = seed;
+    rand_engine.seed(static_cast<std::minstd_rand::result_type>(seed % std::minstd_rand::modulus));
+}
+
+uint64_t __internal_random::get_seed(void)
+{
+    return rand_seed;
+}
 
 float __internal_random::uniform_real_dist(float min, float max)
 {
@@ -2,6 +2,15 @@
 
 namespace __internal_random
 {
+    /**
+    *   @brief Reseeds the global random engine. By default the engine is seeded with std::random_device,
+    *          a session that should be reproducible must record the seed (see 'get_seed').
+    */
+    void seed(uint64_t seed);
+
+    /** @return The seed that the global random engine has been seeded with. */
+    uint64_t get_seed(void);
+
     float uniform_real_dist(float min, float max);
     float normal_dist(float mean, float sigma);
     uint64_t uniform_uint64_dist(uint64_t min, uint64_t max);
@@ -0,0 +1,154 @@
+#include "sampling.h"
+#include <cmath>
+
+namespace
+{
+    // float on purpose, M_PI of <cmath> is a double and does not mix with glm's float vectors
+    constexpr float PI = 3.14159265358979323846f;
+
+    struct sin_cos_lookup_t
+    {
+        float sin[36000], cos[36000];
+
+        sin_cos_lookup_t(void)
+        {
+            for (int i = 0; i < 36000; i++)
+            {
+                this->sin[i] = std::sin(i * PI / 18000.0);
+                this->cos[i] = std::cos(i * PI / 18000.0);
+            }
+        }
+    };
+
+    const sin_cos_lookup_t lookup;
+};
+
+float __internal_random::fast_sin(float x)
+{
+    return lookup.sin[static_cast<size_t>((x * 18000.0f) / PI)];
+}
+
+float __internal_random::fast_cos(float x)
+{
+    return lookup.cos[static_cast<size_t>((x * 18000.0f) / PI)];
+}
+
+glm::vec3 __internal_random::vogeldisk_sample_3f(int sample_index, int samples_count, float phi)
+{
+    float theta = 2.4f * (float)sample_index + phi;
+    float r = sqrt((float)sample_index + 0.5f) / sqrt((float)samples_count);
+    glm::vec2 u = r * glm::vec2(cos(theta), sin(theta));
+    return glm::vec3(u.x, u.y, cos(r * (PI / 2)));
+}
+
+glm::vec2 __internal_random::vogeldisk_sample_2f(int sample_index, int samples_count, float phi)
+{
+    float theta = 2.4f * (float)sample_index + phi;
+    float r = sqrt((float)sample_index + 0.5f) / sqrt((float)samples_count);
+    return r * glm::vec2(cos(theta), sin(theta));
+}
+
+float __internal_random::RadicalInverse_VdC(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return static_cast<float>(bits) * 2.3283064365386963e-10; // / 0x100000000
+}
+
+glm::vec3 __internal_random::ImportanceSampleGGX(glm::vec2 Xi, glm::vec3 N, float roughness)
+{
+    float a = roughness * roughness;
+
+    float phi = 2.0 * PI * Xi.x;
+    float cosTheta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+    // from spherical coordinates to cartesian coordinates
+    glm::vec3 H;
+    H.x = cos(phi) * sinTheta;
+    H.y = sin(phi) * sinTheta;
+    H.z = cosTheta;
+
+    // from tangent-space vector to world-space sample vector
+    glm::vec3 up = glm::normalize(abs(N.z) < 0.999 ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f));
+    glm::vec3 tangent = glm::normalize(glm::cross(up, N));
+    glm::vec3 bitangent = glm::cross(N, tangent);
+
+    glm::vec3 sampleVec = tangent * H.x + bitangent * H.y + N * H.z;
+    return glm::normalize(sampleVec);
+}
+
+glm::vec3 __internal_random::light_sample(const glm::vec2& xi, const glm::vec3& l_direction, float l_distance, float l_radius)
+{
+    const float phi = xi.x * 2.0f * PI;
+    const float theta = 0.5f * PI - sqrt(xi.y) * atan(l_radius / l_distance);
+
+    const glm::vec3 dir(fast_cos(theta) * fast_cos(phi), fast_cos(theta) * fast_sin(phi), fast_sin(theta));
+    glm::vec3 up = abs(l_direction.z) < 0.999 ? glm::vec3(0.0, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0);
+
+    glm::mat3 TBN;
+    TBN[2] = glm::normalize(l_direction);
+    TBN[0] = glm::normalize(glm::cross(up, TBN[2]));
+    TBN[1] = glm::cross(TBN[2], TBN[0]);
+
+    return TBN * dir;
+}
+
+float __internal_random::white_noise(const glm::vec2& x)
+{
+    return glm::fract(sin(glm::dot(x, glm::vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+glm::vec3 __internal_random::blue_noise(const glm::u8vec3* pixels, uint32_t w, const glm::uvec2& p)
+{
+    const glm::u8vec3* pixel = pixels + (p.y * w + p.x);
+    return glm::vec3(pixel->x / 255.0f, pixel->y / 255.0f, pixel->z / 255.0f);
+}
+
+float __internal_random::hash(const glm::uvec2& x)
+{
+    glm::uvec2 q = 1103515245U * glm::uvec2((x.x >> 1U) ^ x.y, (x.y >> 1U) ^ x.x);
+    uint32_t n = 1103515245U * (q.x ^ (q.y >> 3U));
+    return static_cast<float>(n) * (1.0 / static_cast<float>(0xffffffffU));
+}
+
+glm::vec2 __internal_random::r2_sequence(uint32_t i, float lamda)
+{
+    constexpr float phi = 1.324717957244746;
+    constexpr float delta0 = 0.76f;
+    constexpr float i0 = 0.700f;
+    constexpr glm::vec2 alpha(1.0f / phi, 1.0f / phi / phi);
+
+    glm::vec2 u = glm::vec2(hash(glm::uvec2(i, 0)), hash(glm::uvec2(i, 1))) - 0.5f;
+    return glm::fract(alpha * (float)i + lamda * delta0 * std::sqrt(PI) / (4.0f * std::sqrt((float)i - i0)) * u);
+}
+
+glm::vec2 __internal_random::Hammersley(uint32_t i, uint32_t N)
+{
+    return glm::vec2((float)i / (float)N, RadicalInverse_VdC(i));
+}
+
+glm::vec2 __internal_random::halton(glm::vec2 s)
+{
+    constexpr glm::vec2 coprimes(2, 3);
+    glm::vec2 a(1, 1), b(0, 0);
+    while (s.x > 0.0 && s.y > 0.0)
+    {
+        a = a / coprimes;
+        b += a * glm::mod(s, coprimes);
+        s = glm::floor(s / coprimes);
+    }
+    return b;
+}
+
+glm::vec2 __internal_random::golden_ratio_sequence(uint32_t i, float lamda)
+{
+    constexpr glm::vec2 p0(PI / 2.0, 0.5);
+    const uint32_t a = i & 0x0000FFFF;
+    const uint32_t b = (i & 0xFFFF0000) >> 16;
+    const float jitter = (hash({ a, b }) - 0.5f) * lamda;
+    return glm::fract((p0 + glm::vec2(i * 12664745, i * 9560333) / float(0x1000000)) + jitter);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace __internal_random
+{
+    /** @return sin(x) from a lookup table with 0.01 degree steps, @param x must be in [0, 2 PI). */
+    float fast_sin(float x);
+
+    /** @return cos(x) from a lookup table with 0.01 degree steps, @param x must be in [0, 2 PI). */
+    float fast_cos(float x);
+
+    /**
+    *   @brief Vogel disk (golden angle spiral) sampling.
+    *   @param sample_index: Index of the sample in [0, samples_count)
+    *   @param samples_count: Total number of samples
+    *   @param phi: Rotation of the disk
+    *   @return The sample on the unit disk, the z-component of the 3f variant is cos(r * PI / 2).
+    */
+    glm::vec3 vogeldisk_sample_3f(int sample_index, int samples_count, float phi);
+    glm::vec2 vogeldisk_sample_2f(int sample_index, int samples_count, float phi);
+
+    /** @return The Van der Corput radical inverse of @param bits in base 2. */
+    float RadicalInverse_VdC(uint32_t bits);
+
+    /** @return A GGX importance sampled half vector around the normal @param N for the random numbers @param Xi. */
+    glm::vec3 ImportanceSampleGGX(glm::vec2 Xi, glm::vec3 N, float roughness);
+
+    /** @return A direction towards a spherical light with radius @param l_radius at distance @param l_distance. */
+    glm::vec3 light_sample(const glm::vec2& xi, const glm::vec3& l_direction, float l_distance, float l_radius);
+
+    /** @return Hash based white noise in [0, 1) at @param x. */
+    float white_noise(const glm::vec2& x);
+
+    /** @return The blue noise texel at @param p of an RGB8 texture with width @param w in [0, 1]. */
+    glm::vec3 blue_noise(const glm::u8vec3* pixels, uint32_t w, const glm::uvec2& p);
+
+    /** @return An integer hash of @param x in [0, 1]. */
+    float hash(const glm::uvec2& x);
+
+    /** @return The i-th point of the jittered R2 sequence, @param lamda scales the jitter. */
+    glm::vec2 r2_sequence(uint32_t i, float lamda);
+
+    /** @return The i-th of @param N points of the Hammersley set. */
+    glm::vec2 Hammersley(uint32_t i, uint32_t N);
+
+    /** @return The point of the Halton sequence (bases 2 and 3) for the sample indices @param s. */
+    glm::vec2 halton(glm::vec2 s);
+
+    /** @return The i-th point of the jittered golden ratio sequence, @param lamda scales the jitter. */
+    glm::vec2 golden_ratio_sequence(uint32_t i, float lamda);
+};
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+// AVX2 is used if the compiler targets it (/arch:AVX2 or -mavx2), otherwise
+// every operation falls back to plain loops that the compiler may vectorize on its own.
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SIMD_AVX2 1
+#else
+    #define SIMD_AVX2 0
+#endif
+
+/**
+*   Thin 8-lane wrapper around AVX2 so that the particle kernels can be written once
+*   and compile with or without AVX2 support. All loads and stores are unaligned.
+*/
+namespace simd
+{
+    constexpr uint32_t WIDTH = 8;
+
+#if SIMD_AVX2
+    struct float8   { __m256 v; };
+    struct int8     { __m256i v; };
+    struct mask8    { __m256 v; };
+
+    inline float8 set1(float x) noexcept                                { return { _mm256_set1_ps(x) }; }
+    inline float8 load(const float* p) noexcept                         { return { _mm256_loadu_ps(p) }; }
+    inline void store(float* p, float8 a) noexcept                      { _mm256_storeu_ps(p, a.v); }
+    inline float8 zero(void) noexcept                                   { return { _mm256_setzero_ps() }; }
+
+    inline float8 operator+(float8 a, float8 b) noexcept                { return { _mm256_add_ps(a.v, b.v) }; }
+    inline float8 operator-(float8 a, float8 b) noexcept                { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline float8 operator*(float8 a, float8 b) noexcept                { return { _mm256_mul_ps(a.v, b.v) }; }
+    inline float8 operator/(float8 a, float8 b) noexcept                { return { _mm256_div_ps(a.v, b.v) }; }
+    inline float8 operator-(float8 a) noexcept                          { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+    inline float8 fmadd(float8 a, float8 b, float8 c) noexcept          { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+    inline float8 min(float8 a, float8 b) noexcept                      { return { _mm256_min_ps(a.v, b.v) }; }
+    inline float8 max(float8 a, float8 b) noexcept                      { return { _mm256_max_ps(a.v, b.v) }; }
+    inline float8 abs(float8 a) noexcept                                { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+    inline float8 sqrt(float8 a) noexcept                               { return { _mm256_sqrt_ps(a.v) }; }
+    inline float8 floor(float8 a) noexcept                              { return { _mm256_floor_ps(a.v) }; }
+
+    inline mask8 operator<(float8 a, float8 b) noexcept                 { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+    inline mask8 operator<=(float8 a, float8 b) noexcept                { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+    inline mask8 operator>(float8 a, float8 b) noexcept                 { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+    inline mask8 operator>=(float8 a, float8 b) noexcept                { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+    inline mask8 operator&(mask8 a, mask8 b) noexcept                   { return { _mm256_and_ps(a.v, b.v) }; }
+    inline mask8 operator|(mask8 a, mask8 b) noexcept                   { return { _mm256_or_ps(a.v, b.v) }; }
+    inline mask8 operator~(mask8 a) noexcept                            { return { _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+    inline mask8 all_lanes(void) noexcept                               { return { _mm256_castsi256_ps(_mm256_set1_epi32(-1)) }; }
+
+    /** @return 'a' where the mask is set and 'b' otherwise. */
+    inline float8 select(mask8 m, float8 a, float8 b) noexcept          { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+    inline bool any(mask8 m) noexcept                                   { return _mm256_movemask_ps(m.v) != 0; }
+    inline bool all(mask8 m) noexcept                                   { return _mm256_movemask_ps(m.v) == 0xFF; }
+    inline uint32_t bits(mask8 m) noexcept                              { return static_cast<uint32_t>(_mm256_movemask_ps(m.v)); }
+    /** @return A mask where the first 'n' lanes are set. */
+    inline mask8 first_lanes(uint32_t n) noexcept
+    {
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(n)), lane)) };
+    }
+
+    inline int8 set1i(int32_t x) noexcept                               { return { _mm256_set1_epi32(x) }; }
+    inline int8 to_int(float8 a) noexcept                               { return { _mm256_cvttps_epi32(a.v) }; }
+    inline float8 to_float(int8 a) noexcept                             { return { _mm256_cvtepi32_ps(a.v) }; }
+    inline int8 operator+(int8 a, int8 b) noexcept                      { return { _mm256_add_epi32(a.v, b.v) }; }
+    inline int8 operator-(int8 a, int8 b) noexcept                      { return { _mm256_sub_epi32(a.v, b.v) }; }
+    inline int8 operator*(int8 a, int8 b) noexcept                      { return { _mm256_mullo_epi32(a.v, b.v) }; }
+    inline int8 operator&(int8 a, int8 b) noexcept                      { return { _mm256_and_si256(a.v, b.v) }; }
+    inline int8 operator^(int8 a, int8 b) noexcept                      { return { _mm256_xor_si256(a.v, b.v) }; }
+    inline int8 operator>>(int8 a, int s) noexcept                      { return { _mm256_srli_epi32(a.v, s) }; }
+    inline int8 operator<<(int8 a, int s) noexcept                      { return { _mm256_slli_epi32(a.v, s) }; }
+    inline mask8 operator==(int8 a, int8 b) noexcept                    { return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v)) }; }
+    /** @return table[idx] for every lane. */
+    inline int8 gather(const int32_t* table, int8 idx) noexcept         { return { _mm256_i32gather_epi32(table, idx.v, 4) }; }
+    inline float8 gather(const float* table, int8 idx) noexcept         { return { _mm256_i32gather_ps(table, idx.v, 4) }; }
+#else
+    struct float8   { float v[WIDTH]; };
+    struct int8     { int32_t v[WIDTH]; };
+    struct mask8    { bool v[WIDTH]; };
+
+    #define SIMD_LANES(expr) for (uint32_t i = 0; i < WIDTH; i++) { expr; }
+
+    inline float8 set1(float x) noexcept                                { float8 r; SIMD_LANES(r.v[i] = x) return r; }
+    inline float8 load(const float* p) noexcept                         { float8 r; SIMD_LANES(r.v[i] = p[i]) return r; }
+    inline void store(float* p, float8 a) noexcept                      { SIMD_LANES(p[i] = a.v[i]) }
+    inline float8 zero(void) noexcept                                   { return set1(0.0f); }
+
+    inline float8 operator+(float8 a, float8 b) noexcept                { SIMD_LANES(a.v[i] += b.v[i]) return a; }
+    inline float8 operator-(float8 a, float8 b) noexcept                { SIMD_LANES(a.v[i] -= b.v[i]) return a; }
+    inline float8 operator*(float8 a, float8 b) noexcept                { SIMD_LANES(a.v[i] *= b.v[i]) return a; }
+    inline float8 operator/(float8 a, float8 b) noexcept                { SIMD_LANES(a.v[i] /= b.v[i]) return a; }
+    inline float8 operator-(float8 a) noexcept                          { SIMD_LANES(a.v[i] = -a.v[i]) return a; }
+    inline float8 fmadd(float8 a, float8 b, float8 c) noexcept          { SIMD_LANES(a.v[i] = a.v[i] * b.v[i] + c.v[i]) return a; }
+    inline float8 min(float8 a, float8 b) noexcept                      { SIMD_LANES(a.v[i] = (a.v[i] < b.v[i]) ? a.v[i] : b.v[i]) return a; }
+    inline float8 max(float8 a, float8 b) noexcept                      { SIMD_LANES(a.v[i] = (a.v[i] > b.v[i]) ? a.v[i] : b.v[i]) return a; }
+    inline float8 abs(float8 a) noexcept                                { SIMD_LANES(a.v[i] = std::fabs(a.v[i])) return a; }
+    inline float8 sqrt(float8 a) noexcept                               { SIMD_LANES(a.v[i] = std::sqrt(a.v[i])) return a; }
+    inline float8 floor(float8 a) noexcept                              { SIMD_LANES(a.v[i] = std::floor(a.v[i])) return a; }
+
+    inline mask8 operator<(float8 a, float8 b) noexcept                 { mask8 r; SIMD_LANES(r.v[i] = a.v[i] < b.v[i]) return r; }
+    inline mask8 operator<=(float8 a, float8 b) noexcept                { mask8 r; SIMD_LANES(r.v[i] = a.v[i] <= b.v[i]) return r; }
+    inline mask8 operator>(float8 a, float8 b) noexcept                 { mask8 r; SIMD_LANES(r.v[i] = a.v[i] > b.v[i]) return r; }
+    inline mask8 operator>=(float8 a, float8 b) noexcept                { mask8 r; SIMD_LANES(r.v[i] = a.v[i] >= b.v[i]) return r; }
+    inline mask8 operator&(mask8 a, mask8 b) noexcept                   { SIMD_LANES(a.v[i] = a.v[i] && b.v[i]) return a; }
+    inline mask8 operator|(mask8 a, mask8 b) noexcept                   { SIMD_LANES(a.v[i] = a.v[i] || b.v[i]) return a; }
+    inline mask8 operator~(mask8 a) noexcept                            { SIMD_LANES(a.v[i] = !a.v[i]) return a; }
+    inline mask8 all_lanes(void) noexcept                               { mask8 r; SIMD_LANES(r.v[i] = true) return r; }
+
+    /** @return 'a' where the mask is set and 'b' otherwise. */
+    inline float8 select(mask8 m, float8 a, float8 b) noexcept          { SIMD_LANES(b.v[i] = m.v[i] ? a.v[i] : b.v[i]) return b; }
+    inline bool any(mask8 m) noexcept                                   { bool r = false; SIMD_LANES(r = r || m.v[i]) return r; }
+    inline bool all(mask8 m) noexcept                                   { bool r = true; SIMD_LANES(r = r && m.v[i]) return r; }
+    inline uint32_t bits(mask8 m) noexcept                              { uint32_t r = 0; SIMD_LANES(r |= (m.v[i] ? 1u : 0u) << i) return r; }
+    /** @return A mask where the first 'n' lanes are set. */
+    inline mask8 first_lanes(uint32_t n) noexcept                       { mask8 r; SIMD_LANES(r.v[i] = i < n) return r; }
+
+    inline int8 set1i(int32_t x) noexcept                               { int8 r; SIMD_LANES(r.v[i] = x) return r; }
+    inline int8 to_int(float8 a) noexcept                               { int8 r; SIMD_LANES(r.v[i] = static_cast<int32_t>(a.v[i])) return r; }
+    inline float8 to_float(int8 a) noexcept                             { float8 r; SIMD_LANES(r.v[i] = static_cast<float>(a.v[i])) return r; }
+    inline int8 operator+(int8 a, int8 b) noexcept                      { SIMD_LANES(a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) + static_cast<uint32_t>(b.v[i]))) return a; }
+    inline int8 operator-(int8 a, int8 b) noexcept                      { SIMD_LANES(a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) - static_cast<uint32_t>(b.v[i]))) return a; }
+    inline int8 operator*(int8 a, int8 b) noexcept                      { SIMD_LANES(a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) * static_cast<uint32_t>(b.v[i]))) return a; }
+    inline int8 operator&(int8 a, int8 b) noexcept                      { SIMD_LANES(a.v[i] &= b.v[i]) return a; }
+    inline int8 operator^(int8 a, int8 b) noexcept                      { SIMD_LANES(a.v[i] ^= b.v[i]) return a; }
+    inline int8 operator>>(int8 a, int s) noexcept                      { SIMD_LANES(a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) >> s)) return a; }
+    inline int8 operator<<(int8 a, int s) noexcept                      { SIMD_LANES(a.v[i] = static_cast<int32_t>(static_cast<uint32_t>(a.v[i]) << s)) return a; }
+    inline mask8 operator==(int8 a, int8 b) noexcept                    { mask8 r; SIMD_LANES(r.v[i] = a.v[i] == b.v[i]) return r; }
+    /** @return table[idx] for every lane. */
+    inline int8 gather(const int32_t* table, int8 idx) noexcept         { SIMD_LANES(idx.v[i] = table[idx.v[i]]) return idx; }
+    inline float8 gather(const float* table, int8 idx) noexcept         { float8 r; SIMD_LANES(r.v[i] = table[idx.v[i]]) return r; }
+
+    #undef SIMD_LANES
+#endif
+
+    // operations that are built on top of the primitives above
+    inline float8 operator+(float8 a, float b) noexcept                 { return a + set1(b); }
+    inline float8 operator-(float8 a, float b) noexcept                 { return a - set1(b); }
+    inline float8 operator*(float8 a, float b) noexcept                 { return a * set1(b); }
+    inline float8 operator*(float b, float8 a) noexcept                 { return set1(b) * a; }
+    inline uint32_t count(mask8 m) noexcept
+    {
+        uint32_t b = bits(m), n = 0;
+        for (; b != 0; b &= b - 1) ++n;
+        return n;
+    }
+    inline float8 clamp(float8 x, float8 lo, float8 hi) noexcept        { return min(max(x, lo), hi); }
+    inline float8 dot3(float8 ax, float8 ay, float8 az, float8 bx, float8 by, float8 bz) noexcept
+    {
+        return fmadd(ax, bx, fmadd(ay, by, az * bz));
+    }
+
+    /**
+    *   @brief Loads up to 8 floats into a register, lanes beyond 'n' are filled with 'fill'.
+    *          Used for the remainder of a batch whose size is not a multiple of 8.
+    */
+    inline float8 load_partial(const float* p, uint32_t n, float fill) noexcept
+    {
+        float tmp[WIDTH];
+        for (uint32_t i = 0; i < WIDTH; i++)
+            tmp[i] = (i < n) ? p[i] : fill;
+        return load(tmp);
+    }
+
+    /** @brief Stores the first 'n' lanes of a register. */
+    inline void store_partial(float* p, float8 a, uint32_t n) noexcept
+    {
+        float tmp[WIDTH];
+        store(tmp, a);
+        for (uint32_t i = 0; i < n; i++)
+            p[i] = tmp[i];
+    }
+};
\ No newline at end of file
@@ -0,0 +1,428 @@
+/**
+*   Micro benchmarks of the hot paths of the simulation core: particle pool, static engine, RNG and sampling.
+*   Usage: particles_bench [options]
+*       --filter <text>         only runs benchmarks whose name contains the text
+*       --min-time <seconds>    minimum time of one repetition, default 0.1
+*       --repetitions <n>       number of repetitions, the median is reported, default 5
+*       --format <table|csv|json>   output format, default table
+*       --out <file>            writes the results to a file instead of stdout
+*       --baseline <file>       compares against the JSON results of a previous run
+*       --threshold <percent>   slowdown that counts as a regression, default 10
+*   Exit code 2 if a benchmark regressed against the baseline.
+*/
+#include "../particles/particles_core.h"
+#include "../random/random.h"
+#include "../random/sampling.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace particles;
+
+namespace
+{
+    // keeps the compiler from optimizing a result away
+    template<typename T>
+    inline void keep(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+    *   A benchmark runs @param n operations and returns the time in seconds that they took,
+    *   so that the setup of a benchmark is not measured.
+    */
+    struct benchmark_t
+    {
+        std::string name;
+        std::function<double(uint64_t n)> run;
+    };
+
+    struct result_t
+    {
+        std::string name;
+        uint64_t iterations;        // operations per repetition
+        double ns_per_op;           // median of the repetitions
+        double ns_min, ns_max, ns_stddev;
+    };
+
+    double seconds_since(clock_type::time_point t0)
+    {
+        return std::chrono::duration<double>(clock_type::now() - t0).count();
+    }
+
+    const uint32_t POOL_CAPACITIES[] = { 1U << 10, 1U << 16, 1U << 20 };
+
+    particle_t make_particle(void)
+    {
+        particle_t particle;
+        particle.pos = glm::vec3(0.0f);
+        particle.color = glm::vec4(1.0f);
+        particle.size = 0.1f;
+        return particle;
+    }
+
+    void add_pool_benchmarks(std::vector<benchmark_t>& benchmarks)
+    {
+        for (uint32_t capacity : POOL_CAPACITIES)
+        {
+            // LIFO churn: a burst of allocations that is freed in reverse order, the pool is half full
+            benchmarks.push_back({ "pool/lifo_churn/" + std::to_string(capacity), [capacity](uint64_t n) {
+                constexpr uint32_t BURST = 64;
+                HostParticleSink sink(capacity);
+                ParticlePool pool(sink);
+                for (uint32_t i = 0; i < capacity / 2; i++)
+                    pool.allocate();
+
+                particle_t* burst[BURST];
+                const auto t0 = clock_type::now();
+                for (uint64_t i = 0; i < n; i += BURST)
+                {
+                    for (uint32_t j = 0; j < BURST; j++)
+                        burst[j] = pool.allocate();
+                    for (uint32_t j = BURST; j > 0; j--)
+                        pool.free(burst[j - 1]);
+                }
+                return seconds_since(t0);
+            } });
+
+            // random churn: a random allocated particle is freed and another one allocated, the pool is half full
+            benchmarks.push_back({ "pool/random_churn/" + std::to_string(capacity), [capacity](uint64_t n) {
+                HostParticleSink sink(capacity);
+                ParticlePool pool(sink);
+                std::vector<particle_t*> allocated(capacity / 2);
+                for (particle_t*& p : allocated)
+                    p = pool.allocate();
+
+                std::minstd_rand engine(1);
+                std::vector<uint32_t> victims(4096);
+                for (uint32_t& v : victims)
+                    v = engine() % allocated.size();
+
+                const auto t0 = clock_type::now();
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    particle_t*& p = allocated[victims[i % victims.size()]];
+                    pool.free(p);
+                    p = pool.allocate();
+                }
+                return seconds_since(t0);
+            } });
+        }
+    }
+
+    void add_engine_benchmarks(std::vector<benchmark_t>& benchmarks)
+    {
+        for (uint32_t capacity : POOL_CAPACITIES)
+        {
+            benchmarks.push_back({ "engine/spawn_kill/" + std::to_string(capacity), [capacity](uint64_t n) {
+                HostParticleSink sink(capacity);
+                ParticlePool pool(sink);
+                StaticParticleEngine engine(pool);
+                engine.start();
+                const particle_t particle = make_particle();
+                for (uint32_t i = 0; i < capacity / 2; i++)
+                    engine.spawn(particle);
+
+                const auto t0 = clock_type::now();
+                for (uint64_t i = 0; i < n; i++)
+                    engine.kill(engine.spawn(particle));
+                const double t = seconds_since(t0);
+                engine.stop();
+                return t;
+            } });
+
+            // one operation is one killed particle
+            benchmarks.push_back({ "engine/kill_all/" + std::to_string(capacity), [capacity](uint64_t n) {
+                HostParticleSink sink(capacity);
+                ParticlePool pool(sink);
+                StaticParticleEngine engine(pool);
+                engine.start();
+                const particle_t particle = make_particle();
+
+                double t = 0.0;
+                for (uint64_t done = 0; done < n; done += capacity)
+                {
+                    const uint64_t batch = std::min<uint64_t>(capacity, n - done);
+                    for (uint64_t i = 0; i < batch; i++)
+                        engine.spawn(particle);
+                    const auto t0 = clock_type::now();
+                    engine.kill_all();
+                    t += seconds_since(t0);
+                }
+                engine.stop();
+                return t;
+            } });
+        }
+    }
+
+    void add_random_benchmarks(std::vector<benchmark_t>& benchmarks)
+    {
+        using namespace __internal_random;
+
+        benchmarks.push_back({ "random/uniform_real_dist", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(uniform_real_dist(-1.0f, 1.0f));
+            return seconds_since(t0);
+        } });
+        benchmarks.push_back({ "random/normal_dist", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(normal_dist(0.0f, 1.0f));
+            return seconds_since(t0);
+        } });
+        benchmarks.push_back({ "random/uniform_uint64_dist", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(uniform_uint64_dist(0, 1000000));
+            return seconds_since(t0);
+        } });
+    }
+
+    void add_sampling_benchmarks(std::vector<benchmark_t>& benchmarks)
+    {
+        using namespace __internal_random;
+
+        benchmarks.push_back({ "sampling/vogeldisk_sample_3f", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(vogeldisk_sample_3f(static_cast<int>(i & 1023), 1024, 0.5f));
+            return seconds_since(t0);
+        } });
+        benchmarks.push_back({ "sampling/Hammersley", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(Hammersley(static_cast<uint32_t>(i & 1023), 1024));
+            return seconds_since(t0);
+        } });
+        benchmarks.push_back({ "sampling/halton", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+            {
+                const float s = static_cast<float>((i & 1023) + 1);
+                keep(halton(glm::vec2(s, s)));
+            }
+            return seconds_since(t0);
+        } });
+        benchmarks.push_back({ "sampling/r2_sequence", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(r2_sequence(static_cast<uint32_t>(i & 1023) + 1, 0.5f));
+            return seconds_since(t0);
+        } });
+        benchmarks.push_back({ "sampling/golden_ratio_sequence", [](uint64_t n) {
+            const auto t0 = clock_type::now();
+            for (uint64_t i = 0; i < n; i++)
+                keep(golden_ratio_sequence(static_cast<uint32_t>(i), 0.5f));
+            return seconds_since(t0);
+        } });
+    }
+
+    /**
+    *   Calibrates the number of operations, so that a repetition takes at least @param min_time seconds,
+    *   and runs the repetitions.
+    */
+    result_t run_benchmark(const benchmark_t& benchmark, double min_time, uint32_t repetitions)
+    {
+        uint64_t n = 1;
+        double t = benchmark.run(n);
+        while (t < min_time)
+        {
+            const double scale = (t > 0.0) ? std::min(1.2 * min_time / t, 100.0) : 100.0;
+            n = std::max(n + 1, static_cast<uint64_t>(n * scale));
+            t = benchmark.run(n);
+        }
+
+        std::vector<double> ns(1, t * 1e9 / n);
+        for (uint32_t i = 1; i < repetitions; i++)
+            ns.push_back(benchmark.run(n) * 1e9 / n);
+        std::sort(ns.begin(), ns.end());
+
+        double mean = 0.0, variance = 0.0;
+        for (double x : ns)
+            mean += x / ns.size();
+        for (double x : ns)
+            variance += (x - mean) * (x - mean) / ns.size();
+
+        return { benchmark.name, n, ns[ns.size() / 2], ns.front(), ns.back(), std::sqrt(variance) };
+    }
+
+    void write_table(std::ostream& os, const std::vector<result_t>& results)
+    {
+        os << std::left << std::setw(36) << "benchmark" << std::right << std::setw(14) << "ns/op" << std::setw(14) << "min" << std::setw(14) << "max" << std::setw(14) << "iterations" << '\n';
+        for (const result_t& r : results)
+            os << std::left << std::setw(36) << r.name << std::right << std::fixed << std::setprecision(2)
+               << std::setw(14) << r.ns_per_op << std::setw(14) << r.ns_min << std::setw(14) << r.ns_max
+               << std::setw(14) << r.iterations << '\n';
+        os.unsetf(std::ios::fixed);
+    }
+
+    void write_csv(std::ostream& os, const std::vector<result_t>& results)
+    {
+        os << "name,iterations,ns_per_op,ns_min,ns_max,ns_stddev\n";
+        for (const result_t& r : results)
+            os << r.name << ',' << r.iterations << ',' << r.ns_per_op << ',' << r.ns_min << ',' << r.ns_max << ',' << r.ns_stddev << '\n';
+    }
+
+    void write_json(std::ostream& os, const std::vector<result_t>& results)
+    {
+        os << "{\n    \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const result_t& r = results[i];
+            os << "        { \"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+               << ", \"ns_per_op\": " << r.ns_per_op << ", \"ns_min\": " << r.ns_min
+               << ", \"ns_max\": " << r.ns_max << ", \"ns_stddev\": " << r.ns_stddev << " }"
+               << ((i + 1 < results.size()) ? ",\n" : "\n");
+        }
+        os << "    ]\n}\n";
+    }
+
+    // reads name -> ns_per_op from the JSON output of a previous run, it is not a general JSON parser
+    std::map<std::string, double> read_baseline(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("Failed to open baseline \"" + std::string(path) + "\".");
+        std::stringstream ss;
+        ss << file.rdbuf();
+        const std::string json = ss.str();
+
+        std::map<std::string, double> baseline;
+        const std::string name_key = "\"name\": \"";
+        const std::string value_key = "\"ns_per_op\": ";
+        for (size_t pos = json.find(name_key); pos != std::string::npos; pos = json.find(name_key, pos))
+        {
+            pos += name_key.size();
+            const size_t name_end = json.find('"', pos);
+            const size_t value = json.find(value_key, name_end);
+            if (name_end == std::string::npos || value == std::string::npos)
+                throw std::runtime_error("Baseline \"" + std::string(path) + "\" is not a benchmark result.");
+            baseline[json.substr(pos, name_end - pos)] = std::strtod(json.c_str() + value + value_key.size(), nullptr);
+        }
+        return baseline;
+    }
+
+    /** @return 'true' if a benchmark is slower than the baseline by more than @param threshold percent. */
+    bool compare(const std::vector<result_t>& results, const std::map<std::string, double>& baseline, double threshold)
+    {
+        bool regressed = false;
+        std::cout << '\n' << std::left << std::setw(36) << "benchmark" << std::right << std::setw(14) << "baseline" << std::setw(14) << "ns/op" << std::setw(10) << "delta" << '\n';
+        for (const result_t& r : results)
+        {
+            const auto iter = baseline.find(r.name);
+            if (iter == baseline.end() || iter->second <= 0.0)
+            {
+                std::cout << std::left << std::setw(36) << r.name << std::right << std::setw(14) << "-" << '\n';
+                continue;
+            }
+            const double delta = 100.0 * (r.ns_per_op - iter->second) / iter->second;
+            const char* verdict = (delta > threshold) ? "  REGRESSED" : ((delta < -threshold) ? "  improved" : "");
+            regressed |= (delta > threshold);
+            std::cout << std::left << std::setw(36) << r.name << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(14) << iter->second << std::setw(14) << r.ns_per_op
+                      << std::setw(9) << std::showpos << delta << std::noshowpos << '%' << verdict << '\n';
+            std::cout.unsetf(std::ios::fixed);
+        }
+        return regressed;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    const char* filter = "";
+    const char* format = "table";
+    const char* out_path = nullptr;
+    const char* baseline_path = nullptr;
+    double min_time = 0.1;
+    double threshold = 10.0;
+    uint32_t repetitions = 5;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--filter") == 0)              filter = argv[i + 1];
+        else if (std::strcmp(argv[i], "--min-time") == 0)       min_time = std::strtod(argv[i + 1], nullptr);
+        else if (std::strcmp(argv[i], "--repetitions") == 0)    repetitions = std::max(1UL, std::strtoul(argv[i + 1], nullptr, 10));
+        else if (std::strcmp(argv[i], "--format") == 0)         format = argv[i + 1];
+        else if (std::strcmp(argv[i], "--out") == 0)            out_path = argv[i + 1];
+        else if (std::strcmp(argv[i], "--baseline") == 0)       baseline_path = argv[i + 1];
+        else if (std::strcmp(argv[i], "--threshold") == 0)      threshold = std::strtod(argv[i + 1], nullptr);
+        else
+        {
+            std::cout << "Unknown option \"" << argv[i] << "\", see the head of tools/bench.cpp." << std::endl;
+            return 1;
+        }
+    }
+
+    bool regressed = false;
+    try
+    {
+        std::map<std::string, double> baseline;
+        if (baseline_path != nullptr)
+            baseline = read_baseline(baseline_path);
+
+        // the RNG benchmarks are reproducible
+        __internal_random::seed(1);
+
+        std::vector<benchmark_t> benchmarks;
+        add_pool_benchmarks(benchmarks);
+        add_engine_benchmarks(benchmarks);
+        add_random_benchmarks(benchmarks);
+        add_sampling_benchmarks(benchmarks);
+
+        std::vector<result_t> results;
+        for (const benchmark_t& benchmark : benchmarks)
+        {
+            if (benchmark.name.find(filter) == std::string::npos)
+                continue;
+            results.push_back(run_benchmark(benchmark, min_time, repetitions));
+            if (out_path != nullptr)
+                std::cout << benchmark.name << ": " << results.back().ns_per_op << " ns/op" << std::endl;
+        }
+
+        std::ofstream file;
+        if (out_path != nullptr)
+        {
+            file.open(out_path);
+            if (!file)
+                throw std::runtime_error("Failed to create \"" + std::string(out_path) + "\".");
+        }
+        std::ostream& os = file.is_open() ? file : std::cout;
+
+        if (std::strcmp(format, "csv") == 0)
+            write_csv(os, results);
+        else if (std::strcmp(format, "json") == 0)
+            write_json(os, results);
+        else
+            write_table(os, results);
+        os.flush();
+
+        if (baseline_path != nullptr)
+            regressed = compare(results, baseline, threshold);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Benchmark failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return regressed ? 2 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+/**
+*   Prints the live metrics that a renderer publishes into shared memory (see metrics::ShmMetricsPublisher).
+*   Usage: particles_metrics [name] [interval in seconds]
+*   The renderer publishes with 'particles --metrics <name>', the default name is "/particles_metrics".
+*   An interval of 0 prints a single snapshot, otherwise the snapshot is printed periodically.
+*/
+#include "../metrics/metrics_shm.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    void print_snapshot(const char* name, const metrics::metrics_snapshot_t& snapshot)
+    {
+        const uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+        const double age = (now > snapshot.publish_time) ? (now - snapshot.publish_time) * 1e-3 : 0.0;
+        std::printf("\"%s\": pid %u, snapshot %llu, %.2f s old\n", name, snapshot.pid, static_cast<unsigned long long>(snapshot.sequence), age);
+        std::printf("%-32s %-10s %14s %12s %12s %12s %12s %12s\n", "name", "kind", "value/count", "mean", "p50", "p90", "p99", "max");
+
+        for (const metrics::metric_snapshot_t& metric : snapshot.metrics)
+        {
+            switch (metric.kind)
+            {
+            case metrics::KIND_COUNTER:
+                std::printf("%-32s %-10s %14llu\n", metric.name.c_str(), "counter", static_cast<unsigned long long>(metric.counter));
+                break;
+            case metrics::KIND_GAUGE:
+                std::printf("%-32s %-10s %14.6g\n", metric.name.c_str(), "gauge", metric.gauge);
+                break;
+            case metrics::KIND_HISTOGRAM:
+            {
+                const double mean = (metric.count > 0) ? static_cast<double>(metric.sum) / metric.count : 0.0;
+                const uint64_t* buckets = metric.buckets.empty() ? nullptr : metric.buckets.data();
+                // the upper bound of a bucket may be bigger than the biggest recorded value
+                const auto percentile = [buckets, &metric](double p) { return (buckets != nullptr) ? static_cast<unsigned long long>(std::min(metrics::histogram_percentile(buckets, p), metric.max)) : 0ULL; };
+                std::printf("%-32s %-10s %14llu %12.1f %12llu %12llu %12llu %12llu\n", metric.name.c_str(), "histogram",
+                    static_cast<unsigned long long>(metric.count), mean, percentile(0.5), percentile(0.9), percentile(0.99), static_cast<unsigned long long>(metric.max));
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = (argc > 1) ? argv[1] : "/particles_metrics";
+    const double interval = (argc > 2) ? std::strtod(argv[2], nullptr) : 1.0;
+
+    try
+    {
+        metrics::ShmMetricsReader reader;
+        reader.open(name);
+
+        metrics::metrics_snapshot_t snapshot;
+        do
+        {
+            if (reader.read(snapshot))
+                print_snapshot(name, snapshot);
+            else
+                std::cout << "No consistent snapshot of \"" << name << "\" available." << std::endl;
+            if (interval > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+        } while (interval > 0.0);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Reading metrics failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
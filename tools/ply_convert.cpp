@@ -0,0 +1,119 @@
+/**
+*   Preprocesses a PLY point cloud into a chunked point cloud file (see particles::build_point_cloud).
+*   Usage: particles_ply_convert <input.ply> <output.pcld> [grid resolution] [lod levels] [point size]
+*   The output is streamed into the renderer with 'particles --points <output.pcld>'.
+*
+*   With --pages the points are written into a page file for out-of-core paging instead (see particles::ParticlePageFile).
+*   Usage: particles_ply_convert --pages <input.ply> <output.pages> [page size] [point size]
+*   The output is paged into the renderer with 'particles --paged <output.pages>'.
+*/
+#include "../particles/point_cloud.h"
+#include "../particles/page_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// sorts the points by a grid of 64^3 cells, so that every page has a small bounding box
+static void sort_spatially(std::vector<particles::particle_t>& points)
+{
+    glm::vec3 min(INFINITY), max(-INFINITY);
+    for (const particles::particle_t& p : points)
+    {
+        min = glm::min(min, p.pos);
+        max = glm::max(max, p.pos);
+    }
+    const glm::vec3 scale = glm::vec3(64.0f) / glm::max(max - min, glm::vec3(1e-6f));
+
+    // the cell index is ordered x-major within z-slabs, the key is computed once per point
+    std::vector<std::pair<uint32_t, uint32_t>> keys(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const glm::uvec3 cell = glm::min(glm::uvec3((points[i].pos - min) * scale), glm::uvec3(63));
+        keys[i] = { (cell.z * 64 + cell.y) * 64 + cell.x, static_cast<uint32_t>(i) };
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<particles::particle_t> sorted(points.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        sorted[i] = points[keys[i].second];
+    points.swap(sorted);
+}
+
+static int convert_pages(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        std::cout << "Usage: particles_ply_convert --pages <input.ply> <output.pages> [page size] [point size]" << std::endl;
+        return 1;
+    }
+    const uint32_t page_size = (argc > 4) ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : particles::ParticlePageFile::DEFAULT_PAGE_SIZE;
+    const float point_size = (argc > 5) ? std::strtof(argv[5], nullptr) : 0.01f;
+
+    try
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<particles::particle_t> points;
+        particles::load_ply(argv[2], point_size, points);
+        const auto t1 = std::chrono::steady_clock::now();
+        sort_spatially(points);
+
+        particles::ParticlePageFile file;
+        file.create(argv[3], points.size(), page_size);
+        for (size_t first = 0; first < points.size(); first += page_size)
+            file.write(first, points.data() + first, static_cast<uint32_t>(std::min<size_t>(page_size, points.size() - first)));
+        file.close();
+        const auto t2 = std::chrono::steady_clock::now();
+
+        std::cout << "Converted " << points.size() << " points into " << (points.size() + page_size - 1) / page_size << " pages." << std::endl;
+        std::cout << "Loading: " << std::chrono::duration<double>(t1 - t0).count() << "s, writing: "
+                  << std::chrono::duration<double>(t2 - t1).count() << "s" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Conversion failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--pages") == 0)
+        return convert_pages(argc, argv);
+
+    if (argc < 3)
+    {
+        std::cout << "Usage: particles_ply_convert <input.ply> <output.pcld> [grid resolution] [lod levels] [point size]" << std::endl;
+        std::cout << "       particles_ply_convert --pages <input.ply> <output.pages> [page size] [point size]" << std::endl;
+        return 1;
+    }
+    const uint32_t grid_resolution = (argc > 3) ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 16;
+    const uint32_t lod_levels = (argc > 4) ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : 6;
+    const float point_size = (argc > 5) ? std::strtof(argv[5], nullptr) : 0.01f;
+
+    try
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<particles::particle_t> points;
+        particles::load_ply(argv[1], point_size, points);
+        const auto t1 = std::chrono::steady_clock::now();
+        particles::build_point_cloud(argv[2], points, grid_resolution, lod_levels);
+        const auto t2 = std::chrono::steady_clock::now();
+
+        particles::PointCloudFile cloud;
+        cloud.open(argv[2]);
+        std::cout << "Converted " << cloud.point_count() << " points into " << cloud.chunk_count() << " chunks with "
+                  << cloud.lod_levels() << " levels of detail." << std::endl;
+        std::cout << "Loading: " << std::chrono::duration<double>(t1 - t0).count() << "s, building: "
+                  << std::chrono::duration<double>(t2 - t1).count() << "s" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Conversion failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+*   Headless replay of a recorded particle session (see particles::SessionRecorder).
+*   Usage: particles_replay <session file>
+*   The session is replayed into host memory, no GPU or window is needed. The checksum of the
+*   replayed particles is compared with the checksum that has been recorded at the end of the session,
+*   the exit code is 1 if they differ or if the session has no checksum.
+*/
+#include "../particles/particles_core.h"
+#include "../random/random.h"
+#include <chrono>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <session file>" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        particles::SessionReplayer replayer;
+        replayer.open(argv[1]);
+        __internal_random::seed(replayer.seed());
+
+        particles::HostParticleSink sink(replayer.capacity());
+        particles::ParticlePool pool(sink);
+        particles::StaticParticleEngine engine(pool);
+        engine.start();
+
+        uint64_t ticks = 0;
+        double simulated_time = 0.0;
+        float dt;
+
+        const auto t0 = std::chrono::steady_clock::now();
+        while (replayer.next_tick(engine, dt))
+        {
+            ++ticks;
+            simulated_time += dt;
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+
+        std::cout << "seed:           " << replayer.seed() << std::endl;
+        std::cout << "ticks:          " << ticks << std::endl;
+        std::cout << "simulated time: " << simulated_time << " s" << std::endl;
+        std::cout << "spawns:         " << replayer.spawn_count() << std::endl;
+        std::cout << "particles:      " << engine.count() << std::endl;
+        std::cout << "replay time:    " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms" << std::endl;
+        if (!replayer.checksum_replayed())
+        {
+            std::cout << "The session has no checksum, it has not been closed properly." << std::endl;
+            return 1;
+        }
+        std::cout << "checksum:       " << std::hex << replayer.replayed_checksum() << " (recorded " << replayer.recorded_checksum() << ")" << std::dec << std::endl;
+        if (!replayer.checksum_matches())
+        {
+            std::cout << "The replayed particles differ from the recorded ones." << std::endl;
+            return 1;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Replay failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
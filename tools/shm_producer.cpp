@@ -0,0 +1,57 @@
+/**
+*   Test producer for the shared memory particle feed (see particles::ShmFeedProducer).
+*   Usage: particles_shm_producer [name] [particles] [frames per second] [seconds]
+*   Simulates a rotating particle disk and writes one frame per tick into the feed,
+*   the renderer ingests it with 'particles --shm <name>'.
+*/
+#include "../particles/shm_feed.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+int main(int argc, char** argv)
+{
+    const char* name = (argc > 1) ? argv[1] : "/particles";
+    const uint32_t n = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000000;
+    const double fps = (argc > 3) ? std::strtod(argv[3], nullptr) : 60.0;
+    const double seconds = (argc > 4) ? std::strtod(argv[4], nullptr) : 60.0;
+
+    try
+    {
+        particles::ShmFeedProducer producer;
+        producer.create(name, n);
+        std::cout << "Producing " << n << " particles at " << fps << " fps into \"" << name << "\"." << std::endl;
+
+        const std::chrono::duration<double> tick(1.0 / fps);
+        const auto t0 = std::chrono::steady_clock::now();
+        auto next = t0;
+        uint64_t frame = 0;
+        for (double t = 0.0; t < seconds; t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count())
+        {
+            // a disk that rotates with a radius-dependent angular velocity
+            particles::particle_t* particles = producer.begin_frame();
+            for (uint32_t i = 0; i < n; i++)
+            {
+                const float r = 0.5f + 5.0f * std::sqrt((i + 0.5f) / n);
+                const float phi = 2.4f * i + static_cast<float>(t) / r;
+                particles[i].pos = glm::vec3(r * std::cos(phi), 5.0f + 0.2f * std::sin(3.0f * phi), 5.0f + r * std::sin(phi));
+                particles[i].color = glm::vec4(1.0f - r / 5.5f, 0.5f, r / 5.5f, 1.0f);
+                particles[i].size = 0.02f;
+            }
+            producer.end_frame(n);
+            ++frame;
+
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(tick);
+            std::this_thread::sleep_until(next);
+        }
+        std::cout << "Produced " << frame << " frames." << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Producer failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
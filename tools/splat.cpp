@@ -0,0 +1,132 @@
+/**
+*   Renders particles on the CPU into a PNG or PPM image (see particles::SoftwareParticleRenderer).
+*   Usage: particles_splat <output.png|ppm> [--cache <baked cache> [--frame <n>]] [--size <w> <h>]
+*                          [--texture <image>] [--threads <n>] [--repeat <n>]
+*   Without a baked cache, a synthetic cloud of 1M particles is rendered as a benchmark.
+*   The camera looks at the bounding box of the particles like the application camera (100 deg fov).
+*/
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define STB_IMAGE_IMPLEMENTATION
+#include "../particles/particles_core.h"
+#include "../particles/software_renderer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    void synthetic_cloud(uint32_t n, std::vector<particles::particle_t>& cloud)
+    {
+        // a noisy shell, so that there is overdraw and blending in every tile
+        std::minstd_rand engine(1);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        cloud.resize(n);
+        for (particles::particle_t& p : cloud)
+        {
+            glm::vec3 d(dist(engine), dist(engine), dist(engine));
+            const float len = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) + 1e-6f;
+            d = d * ((4.0f + 0.5f * dist(engine)) / len);
+            p.pos = d + glm::vec3(0.0f, 5.0f, 5.0f);
+            p.color = glm::vec4(0.5f + 0.1f * d.x, 0.5f + 0.1f * d.y, 0.5f + 0.1f * d.z, 1.0f);
+            p.size = 0.02f;
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: particles_splat <output.png|ppm> [--cache <baked cache> [--frame <n>]] [--size <w> <h>] "
+                     "[--texture <image>] [--threads <n>] [--repeat <n>]" << std::endl;
+        return 1;
+    }
+    const char* output = argv[1];
+    const char* cache = nullptr;
+    const char* texture = nullptr;
+    uint32_t frame = 0, width = 1920, height = 1080, n_threads = 0, repeat = 1;
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cache = argv[++i];
+        else if (std::strcmp(argv[i], "--frame") == 0 && i + 1 < argc)
+            frame = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc)
+        {
+            width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            height = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+            texture = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            n_threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = std::max(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)), 1u);
+    }
+
+    try
+    {
+        std::vector<particles::particle_t> cloud;
+        if (cache != nullptr)
+        {
+            particles::BakedCacheReader reader;
+            reader.open(cache);
+            reader.read(frame, cloud);
+        }
+        else
+        {
+            synthetic_cloud(1000000, cloud);
+        }
+
+        particles::SoftwareParticleRenderer renderer(width, height, n_threads);
+        if (texture != nullptr)
+        {
+            int w, h, c;
+            uint8_t* data = stbi_load(texture, &w, &h, &c, 4);
+            if (data == nullptr)
+                throw std::runtime_error("Failed to load texture \"" + std::string(texture) + "\".");
+            renderer.set_texture(data, static_cast<uint32_t>(w), static_cast<uint32_t>(h));
+            stbi_image_free(data);
+        }
+
+        // frame the bounding box of the particles
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (const particles::particle_t& p : cloud)
+        {
+            if (std::isnan(p.pos.x)) continue;
+            lo = glm::min(lo, p.pos);
+            hi = glm::max(hi, p.pos);
+        }
+        const glm::vec3 center = (cloud.empty()) ? glm::vec3(0.0f) : (lo + hi) * 0.5f;
+        const glm::vec3 extent = (cloud.empty()) ? glm::vec3(1.0f) : hi - lo;
+        const float radius = std::max(0.5f * std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z), 1e-3f);
+        const glm::vec3 eye = center - glm::vec3(0.0f, 0.0f, 1.2f * radius);
+        const glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, -1.0f, 0.0f));
+        const glm::mat4 projection = glm::perspective(glm::radians(100.0f), static_cast<float>(width) / height, 0.001f * radius, 100.0f * radius);
+        renderer.set_view_projection(view, projection);
+        renderer.set_clear_color(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+        double best = 1e30;
+        for (uint32_t i = 0; i < repeat; i++)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            renderer.render(cloud.data(), static_cast<uint32_t>(cloud.size()));
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+        renderer.write(output);
+        std::cout << "Rendered " << cloud.size() << " particles at " << width << "x" << height << " with "
+                  << renderer.thread_count() << " threads in " << best << " ms." << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Rendering failed:\nWhat: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file